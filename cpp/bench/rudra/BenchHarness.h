@@ -0,0 +1,84 @@
+/*
+ * BenchHarness.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_BENCH_BENCHHARNESS_H_
+#define RUDRA_BENCH_BENCHHARNESS_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+
+/*
+ * The timing and checking shared by the benches. Each bench is a single
+ * translation unit, so the failure count is simply a static here.
+ */
+
+/** Wall-clock time in seconds. */
+static inline double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/** The given clock in nanoseconds, monotonic by default. */
+static inline uint64_t nowNanos(clockid_t clock = CLOCK_MONOTONIC) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/** The number of failed checks so far. */
+static int failures = 0;
+
+/** Count and report a failure unless ok. */
+static inline void check(bool ok, const char* what) {
+	if (!ok) {
+		printf("FAILED: %s\n", what);
+		++failures;
+	}
+}
+
+/**
+ * Print whether every check passed, and return the exit status for main:
+ * nonzero if any failed.
+ */
+static inline int checksResult() {
+	printf(failures == 0 ? "all checks passed\n" : "CHECKS FAILED\n");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* RUDRA_BENCH_BENCHHARNESS_H_ */
@@ -0,0 +1,169 @@
+/*
+ * CheckpointBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/BinaryMatrixReader.h"
+#include "rudra/io/CheckpointFile.h"
+#include "rudra/util/ConvertKernels.h"
+#include "rudra/util/MatrixContainer.h"
+#include "BenchHarness.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace rudra;
+
+/**
+ * Compare the time a checkpoint of a model of the given size stalls the
+ * training thread when written synchronously through an ofstream (as
+ * MatrixContainer::writeBinMat does) and when handed to a CheckpointWriter,
+ * along with the time taken by the background write and by loading the
+ * checkpoint back. Round trips of fp32 and fp16 checkpoints, and of
+ * writeBinMat through readBinMat, are checked, as is detection of a
+ * corrupted block.
+ * Usage: CheckpointBench [megabytes=500] [directory=/tmp]
+ */
+int main(int argc, char** argv) {
+	const size_t megabytes = argc > 1 ? atol(argv[1]) : 500;
+	const std::string dir = argc > 2 ? argv[2] : "/tmp";
+	const size_t count = megabytes * (1 << 20) / sizeof(float);
+	const std::string ofstreamName = dir + "/CheckpointBench.raw";
+	const std::string ckptName = dir + "/CheckpointBench.ckpt";
+	const std::string halfName = dir + "/CheckpointBench16.ckpt";
+
+	std::vector<float> weights(count);
+	srand(42);
+	for (size_t i = 0; i < count; ++i) {
+		weights[i] = (rand() / (float) RAND_MAX - 0.5f) * 0.1f;
+	}
+
+	printf("%-28s %10s\n", "checkpoint of", "seconds");
+	printf("%-28s %10zuMB\n", "model", megabytes);
+
+	double start = now();
+	{
+		std::ofstream f(ofstreamName.c_str(),
+				std::ios::out | std::ios::trunc | std::ios::binary);
+		f.write((const char*) &weights[0], count * sizeof(float));
+		f.close();
+		int fd = open(ofstreamName.c_str(), O_RDONLY);
+		fsync(fd);
+		close(fd);
+	}
+	printf("%-28s %10.3f\n", "ofstream stall", now() - start);
+
+	CheckpointWriter writer;
+	start = now();
+	writer.reserve(count);
+	printf("%-28s %10.3f\n", "reserve snapshots", now() - start);
+	for (int round = 0; round < 2; ++round) {
+		writer.write(ckptName, &weights[0], count, FLOAT, round);
+		printf("%-28s %10.3f\n", "writer stall",
+				writer.getLastStallTime());
+		writer.wait();
+		printf("%-28s %10.3f\n", "  background fp32 write",
+				writer.getLastWriteTime());
+	}
+	writer.write(halfName, &weights[0], count, HALF, 7);
+	printf("%-28s %10.3f\n", "writer stall fp16", writer.getLastStallTime());
+	writer.wait();
+	printf("%-28s %10.3f\n", "  background fp16 write",
+			writer.getLastWriteTime());
+
+	start = now();
+	{
+		CheckpointFile f(ckptName, false);
+		printf("%-28s %10.3f\n", "open and map", now() - start);
+		check(f.isMappable(), "fp32 checkpoint is mappable");
+		start = now();
+		check(f.verify(), "fp32 checksums");
+		printf("%-28s %10.3f\n", "verify checksums", now() - start);
+		check(f.getCount() == count && f.getTag() == 1, "fp32 header");
+		check(memcmp(f.weights(), &weights[0], count * sizeof(float)) == 0,
+				"fp32 round trip");
+	}
+	{
+		std::vector<float> got(count);
+		start = now();
+		readCheckpoint(halfName, &got[0], count);
+		printf("%-28s %10.3f\n", "read fp16", now() - start);
+		std::vector<uint16_t> halfs(count);
+		std::vector<float> expected(count);
+		for (size_t i = 0; i < count; ++i) {
+			halfs[i] = floatToHalf(weights[i]);
+		}
+		halfsToFloats(&halfs[0], &expected[0], count);
+		check(memcmp(&expected[0], &got[0], count * sizeof(float)) == 0,
+				"fp16 round trip");
+		CheckpointFile f(halfName);
+		check(!f.isMappable() && f.getTag() == 7, "fp16 header");
+	}
+
+	// flip a byte in the last block, which verify must notice
+	{
+		FILE* fp = fopen(ckptName.c_str(), "r+b");
+		fseek(fp, -1, SEEK_END);
+		int c = fgetc(fp);
+		fseek(fp, -1, SEEK_END);
+		fputc(c ^ 1, fp);
+		fclose(fp);
+		CheckpointFile f(ckptName, false);
+		check(!f.verify(), "corrupt block detected");
+	}
+
+	// writeBinMat and readBinMat agree on byte order
+	{
+		MatrixContainer<float> m(3, 5);
+		for (size_t i = 0; i < 15; ++i) {
+			m.buf[i] = weights[i];
+		}
+		const std::string binName = dir + "/CheckpointBench.bin";
+		m.writeBinMat(binName);
+		MatrixContainer<float> r = readBinMat<float>(binName);
+		check(r.dimM == 3 && r.dimN == 5
+				&& memcmp(r.buf, m.buf, 15 * sizeof(float)) == 0,
+				"writeBinMat round trip");
+		unlink(binName.c_str());
+	}
+
+	unlink(ofstreamName.c_str());
+	unlink(ckptName.c_str());
+	unlink(halfName.c_str());
+	return checksResult();
+}
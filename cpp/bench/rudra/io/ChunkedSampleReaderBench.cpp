@@ -0,0 +1,226 @@
+/*
+ * ChunkedSampleReaderBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/BinarySampleReader.h"
+#include "rudra/io/BlockShuffleSampler.h"
+#include "rudra/io/ChunkCodec.h"
+#include "rudra/io/ChunkedSampleReader.h"
+#include "rudra/io/ShuffleSampler.h"
+#include "BenchHarness.h"
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Compare a BinarySampleReader on a .bin/.bin8 data set with a
+ * ChunkedSampleReader on the same data converted by bin2binz, reporting the
+ * bytes read from the files per epoch and the samples read per second.
+ * First checks that every available codec round-trips, and that the two
+ * readers return the same samples and labels for every record; exits with
+ * status 1 if any check fails.
+ * Usage: ChunkedSampleReaderBench data labels data.binz labels.binz
+ *            [batchSize] [sampler] [cacheMB]
+ * where sampler is seq, shuffle (the default) or block[:blockSize[:windowSize]].
+ */
+static Sampler* makeSampler(const std::string& kind, size_t numSamples) {
+	if (kind == "seq") {
+		return new SequentialSampler(numSamples);
+	}
+	if (kind.compare(0, 5, "block") == 0) {
+		size_t blockSize = 64, windowSize = 4096;
+		sscanf(kind.c_str(), "block:%zu:%zu", &blockSize, &windowSize);
+		return new BlockShuffleSampler(numSamples, RudraRand(0, 0), blockSize,
+				windowSize);
+	}
+	return new ShuffleSampler(numSamples, RudraRand(0, 0));
+}
+
+/**
+ * Compress and decompress data shaped like a data set with each available
+ * codec, with and without byte shuffling, and check the bytes come back.
+ */
+static void checkCodecs() {
+	const size_t count = 50000; // floats, several repeats for the LZ codecs
+	std::vector<float> values(count);
+	RudraRand rand(3, 0, 0);
+	for (size_t i = 0; i < count; ++i) {
+		// smooth runs, exact zeros and noise
+		values[i] = i % 7 == 0 ? 0.0f :
+				(i / 64) % 2 == 0 ? (i % 784) / 255.0f : (float) rand.nextDouble();
+	}
+	const char* raw = (const char*) &values[0];
+	const size_t rawSize = count * sizeof(float);
+	std::vector<char> shuffled(rawSize), back(rawSize), restored(rawSize);
+	shuffleBytes(raw, &shuffled[0], count, sizeof(float));
+	unshuffleBytes(&shuffled[0], &restored[0], count, sizeof(float));
+	check(memcmp(raw, &restored[0], rawSize) == 0, "unshuffleBytes(shuffleBytes)");
+
+	const ChunkCodecType codecs[] = { CODEC_NONE, CODEC_RLZ, CODEC_LZ4,
+			CODEC_ZSTD };
+	const size_t sizes[] = { 0, 1, 13, rawSize };
+	for (size_t c = 0; c < sizeof(codecs) / sizeof(codecs[0]); ++c) {
+		if (!codecAvailable(codecs[c])) {
+			continue;
+		}
+		const std::string name = codecName(codecs[c]);
+		for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+			for (int shuffle = 0; shuffle < 2; ++shuffle) {
+				const char* src = shuffle ? &shuffled[0] : raw;
+				std::vector<char> packed(compressBound(codecs[c], sizes[k]) + 1);
+				const size_t packedSize = compressChunk(codecs[c], src,
+						sizes[k], &packed[0], packed.size());
+				char what[96];
+				snprintf(what, sizeof(what), "%s round trip of %zu%s bytes",
+						name.c_str(), sizes[k], shuffle ? " shuffled" : "");
+				check((packedSize > 0 || sizes[k] == 0)
+						&& decompressChunk(codecs[c], &packed[0], packedSize,
+								&back[0], sizes[k])
+						&& memcmp(src, &back[0], sizes[k]) == 0, what);
+			}
+		}
+	}
+}
+
+/**
+ * Read every record through both readers, in order and then in one
+ * shuffled epoch, and check they return the same samples and labels.
+ */
+static void checkSameRecords(SampleReader& binary, SampleReader& chunked,
+		size_t batchSize) {
+	if (binary.numSamples != chunked.numSamples
+			|| binary.sizePerSample != chunked.sizePerSample
+			|| binary.sizePerLabel != chunked.sizePerLabel) {
+		check(false, "chunked files have the shape of the binary files");
+		return;
+	}
+	const size_t n = binary.numSamples;
+	std::vector<float> bx(batchSize * binary.sizePerSample), cx(bx.size());
+	std::vector<float> by(batchSize * binary.sizePerLabel), cy(by.size());
+	size_t mismatched = 0;
+	for (int pass = 0; pass < 2; ++pass) {
+		Sampler* sampler = makeSampler(pass == 0 ? "seq" : "shuffle", n);
+		for (size_t b = 0; b < (n + batchSize - 1) / batchSize; ++b) {
+			std::vector<size_t> idx(std::min(batchSize, n - b * batchSize));
+			sampler->nextBatch(idx);
+			std::sort(idx.begin(), idx.end());
+			binary.readLabelledSamples(idx, &bx[0], &by[0]);
+			chunked.readLabelledSamples(idx, &cx[0], &cy[0]);
+			for (size_t i = 0; i < idx.size(); ++i) {
+				const size_t sx = binary.sizePerSample;
+				const size_t sy = binary.sizePerLabel;
+				if (memcmp(&bx[i * sx], &cx[i * sx], sx * sizeof(float)) != 0
+						|| memcmp(&by[i * sy], &cy[i * sy], sy * sizeof(float))
+								!= 0) {
+					if (mismatched++ == 0) {
+						printf("record %zu differs\n", idx[i]);
+					}
+				}
+			}
+		}
+		delete sampler;
+	}
+	check(mismatched == 0, "ChunkedSampleReader matches BinarySampleReader");
+}
+
+/** Bytes this process has read through read system calls so far. */
+static size_t bytesReadByProcess() {
+	FILE* f = fopen("/proc/self/io", "r");
+	if (f == NULL) {
+		return 0;
+	}
+	char line[128];
+	size_t n = 0;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "rchar: %zu", &n) == 1) {
+			break;
+		}
+	}
+	fclose(f);
+	return n;
+}
+
+static void runEpoch(const char* name, SampleReader& reader,
+		const std::string& kind, size_t batchSize) {
+	Sampler* sampler = makeSampler(kind, reader.numSamples);
+	std::vector<size_t> idx(batchSize);
+	std::vector<float> X(batchSize * reader.sizePerSample);
+	std::vector<float> Y(batchSize * reader.sizePerLabel);
+	const size_t numBatches = (reader.numSamples + batchSize - 1) / batchSize;
+
+	const size_t before = bytesReadByProcess();
+	double start = now();
+	for (size_t b = 0; b < numBatches; ++b) {
+		sampler->nextBatch(idx);
+		std::sort(idx.begin(), idx.end());
+		reader.readLabelledSamples(idx, &X[0], &Y[0]);
+	}
+	double elapsed = now() - start;
+	const size_t bytes = bytesReadByProcess() - before;
+	printf("%-16s %-18s %-16zu %-14.1f\n", name, kind.c_str(), bytes,
+			numBatches * batchSize / elapsed);
+	delete sampler;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 5) {
+		fprintf(stderr,
+				"usage: %s data labels data.binz labels.binz [batchSize] [sampler] [cacheMB]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	const size_t batchSize = argc > 5 ? atol(argv[5]) : 128;
+	const std::string kind = argc > 6 ? argv[6] : "shuffle";
+	const size_t cacheMB = argc > 7 ? atol(argv[7]) : 256;
+
+	BinarySampleReader binary(argv[1], argv[2]);
+	ChunkedSampleReader chunked(argv[3], argv[4], cacheMB << 20);
+	checkCodecs();
+	checkSameRecords(binary, chunked, batchSize);
+
+	// a fresh reader, so that the first chunked epoch starts cold
+	ChunkedSampleReader timed(argv[3], argv[4], cacheMB << 20);
+	printf("%-16s %-18s %-16s %-14s\n", "reader", "sampler", "bytes/epoch",
+			"samples/s");
+	runEpoch("binary", binary, kind, batchSize);
+	runEpoch("chunked", timed, kind, batchSize);
+	runEpoch("chunked (warm)", timed, kind, batchSize);
+
+	return checksResult();
+}
@@ -0,0 +1,162 @@
+/*
+ * GPFSSampleClientBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/GPFSSampleClient.h"
+#include "rudra/io/BinarySampleReader.h"
+#include "rudra/io/BijectiveSampler.h"
+#include "rudra/io/BlockShuffleSampler.h"
+#include "rudra/io/ShuffleSampler.h"
+#include "BenchHarness.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <time.h>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Measure minibatch throughput of GPFSSampleClient as the number of producer
+ * threads is scaled up. With latencyUs > 0, each record read first waits that
+ * many microseconds, standing in for storage where every sparse record costs
+ * a round trip, so reads are bound by latency rather than by the CPU.
+ * First checks, for each number of producers, that the first batches match
+ * the same records read directly from the reader.
+ * Usage: GPFSSampleClientBench dataFile labelFile [batchSize] [numBatches]
+ *            [maxProducers] [sampler] [latencyUs] [numBuffers]
+ * where sampler is one of seq, shuffle (the default), bijective or
+ * block[:blockSize[:windowSize]], and numBuffers defaults to one more than
+ * the number of producers.
+ */
+static Sampler* makeSampler(const std::string& kind, size_t numSamples) {
+	if (kind == "seq") {
+		return new SequentialSampler(numSamples);
+	}
+	if (kind == "bijective") {
+		return new BijectiveSampler(numSamples, RudraRand(0, 0));
+	}
+	if (kind.compare(0, 5, "block") == 0) {
+		size_t blockSize = 64, windowSize = 4096;
+		sscanf(kind.c_str(), "block:%zu:%zu", &blockSize, &windowSize);
+		return new BlockShuffleSampler(numSamples, RudraRand(0, 0), blockSize,
+				windowSize);
+	}
+	return new ShuffleSampler(numSamples, RudraRand(0, 0));
+}
+
+/** A reader that waits latencyUs per record before reading from another. */
+class LatencyReader: public SampleReader {
+public:
+	LatencyReader(SampleReader* reader, double latencyUs) :
+			reader(reader), latencyUs(latencyUs) {
+		numSamples = reader->numSamples;
+		sizePerSample = reader->sizePerSample;
+		sizePerLabel = reader->sizePerLabel;
+	}
+
+	void readLabelledSamples(const std::vector<size_t>& idx, float* X,
+			float* Y) {
+		const double nanos = latencyUs * 1000 * idx.size();
+		if (nanos > 0) {
+			struct timespec ts;
+			ts.tv_sec = (time_t) (nanos / 1e9);
+			ts.tv_nsec = (long) (nanos - ts.tv_sec * 1e9);
+			nanosleep(&ts, NULL);
+		}
+		reader->readLabelledSamples(idx, X, Y);
+	}
+
+private:
+	SampleReader* reader;
+	const double latencyUs;
+};
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		fprintf(stderr,
+				"usage: %s dataFile labelFile [batchSize] [numBatches] [maxProducers] [sampler] [latencyUs] [numBuffers]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	const size_t batchSize = argc > 3 ? atol(argv[3]) : 128;
+	const size_t numBatches = argc > 4 ? atol(argv[4]) : 200;
+	const size_t maxProducers = argc > 5 ? atol(argv[5]) : 8;
+	const std::string kind = argc > 6 ? argv[6] : "shuffle";
+	const double latencyUs = argc > 7 ? atof(argv[7]) : 0;
+	const size_t buffers = argc > 8 ? atol(argv[8]) : 0;
+
+	BinarySampleReader direct(argv[1], argv[2]);
+	LatencyReader reader(&direct, latencyUs);
+	const size_t sampleSize = reader.sizePerSample * batchSize;
+	const size_t labelSize = reader.sizePerLabel * batchSize;
+	std::vector<size_t> idx(batchSize);
+	std::vector<float> expectX(sampleSize), expectY(labelSize);
+	printf("%-10s %-10s %-14s %-14s\n", "producers", "buffers", "batches/s",
+			"samples/s");
+	for (size_t p = 1; p <= maxProducers; p *= 2) {
+		const size_t numBuffers = buffers ? buffers : p + 1;
+		GPFSSampleClient* client = new GPFSSampleClient("bench", batchSize,
+				&reader, makeSampler(kind, reader.numSamples), numBuffers, p);
+		float* X;
+		float* Y;
+		// the client reads the sampler's batches, sorted, whatever the
+		// split; this also lets the ring fill so start-up is not measured
+		Sampler* expected = makeSampler(kind, reader.numSamples);
+		bool same = true;
+		for (size_t i = 0; i < 4; ++i) {
+			expected->nextBatch(idx);
+			std::sort(idx.begin(), idx.end());
+			direct.readLabelledSamples(idx, &expectX[0], &expectY[0]);
+			const size_t handle = client->acquireLabelledSamples(X, Y);
+			same &= memcmp(X, &expectX[0], sampleSize * sizeof(float)) == 0
+					&& memcmp(Y, &expectY[0], labelSize * sizeof(float)) == 0;
+			client->releaseLabelledSamples(handle);
+		}
+		delete expected;
+		check(same, "batches match the records read directly");
+		double start = now();
+		for (size_t i = 0; i < numBatches; ++i) {
+			client->releaseLabelledSamples(
+					client->acquireLabelledSamples(X, Y));
+		}
+		double elapsed = now() - start;
+		printf("%-10zu %-10zu %-14.1f %-14.1f\n", p, numBuffers,
+				numBatches / elapsed, numBatches * batchSize / elapsed);
+		delete client;
+	}
+	return checksResult();
+}
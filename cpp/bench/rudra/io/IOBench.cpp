@@ -0,0 +1,466 @@
+/*
+ * IOBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/BinaryMatrixReader.h"
+#include "rudra/io/BinarySampleReader.h"
+#include "rudra/io/GPFSSampleClient.h"
+#include "rudra/io/MmapSampleReader.h"
+#include "rudra/io/SyntheticData.h"
+#include "rudra/util/MatrixContainer.h"
+#include "rudra/util/RudraRand.h"
+#include "BenchHarness.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * The librudra I/O benchmark suite. Generates a synthetic N x D data set in
+ * every supported file format (see SyntheticData.h), then measures
+ *   writeBinMat, readBinMat and readMat (text) whole-file throughput,
+ *   readRecordsFromBinMat with sequential and random minibatches,
+ *   BinarySampleReader and MmapSampleReader::readLabelledSamples for each
+ *   BinFileType, checking that the two readers return identical batches, and
+ *   GPFSSampleClient end-to-end samples/s and the time the consumer spends
+ *   waiting for each batch, with a simulated compute time per batch.
+ * Results read back are checked against the generated data. Files are read
+ * through the page cache, warmed by one pass, so the suite measures the
+ * library rather than the disk.
+ * The results are printed and, with -json, written as JSON with one result
+ * per line. With -baseline, every result is compared with the same result
+ * in an earlier JSON file, and any that is worse by more than the tolerance
+ * is reported as a regression (and the exit status is nonzero).
+ * Usage: IOBench [-rows 20000] [-cols 784] [-batch 128] [-batches 200]
+ *            [-computeUs 1000] [-dir /tmp] [-json out.json]
+ *            [-baseline old.json] [-tolerance 0.2]
+ */
+struct Result {
+	std::string name;
+	double value;
+	const char* unit;
+	bool higherIsBetter;
+};
+
+static std::vector<Result> results;
+
+static void report(const std::string& name, double value, const char* unit,
+		bool higherIsBetter = true) {
+	Result r = { name, value, unit, higherIsBetter };
+	results.push_back(r);
+	printf("%-36s %12.2f %s\n", name.c_str(), value, unit);
+}
+
+struct Config {
+	size_t rows;
+	size_t cols;
+	size_t batch;
+	size_t batches;
+	double computeUs;
+	std::string dir;
+	std::string json;
+	std::string baseline;
+	double tolerance;
+};
+
+static std::string configJson(const Config& c) {
+	char buf[256];
+	snprintf(buf, sizeof(buf), "\"config\": {\"rows\": %zu, \"cols\": %zu, "
+			"\"batch\": %zu, \"batches\": %zu, \"computeUs\": %g},", c.rows,
+			c.cols, c.batch, c.batches, c.computeUs);
+	return buf;
+}
+
+static bool writeJson(const Config& c) {
+	FILE* f = fopen(c.json.c_str(), "w");
+	if (f == NULL) {
+		return false;
+	}
+	char host[256] = "";
+	gethostname(host, sizeof(host) - 1);
+	char stamp[32];
+	const time_t t = time(NULL);
+	strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+	fprintf(f, "{\n\"bench\": \"IOBench\",\n\"time\": \"%s\",\n"
+			"\"host\": \"%s\",\n", stamp, host);
+	fprintf(f, "%s\n\"results\": [\n", configJson(c).c_str());
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		fprintf(f, "{\"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\", "
+				"\"better\": \"%s\"}%s\n", r.name.c_str(), r.value, r.unit,
+				r.higherIsBetter ? "higher" : "lower",
+				i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "]\n}\n");
+	return fclose(f) == 0;
+}
+
+/**
+ * Compare the results with those in a file written by writeJson, which has
+ * one result per line.
+ */
+static void compareWithBaseline(const Config& c) {
+	FILE* f = fopen(c.baseline.c_str(), "r");
+	if (f == NULL) {
+		printf("FAILED: cannot open baseline %s\n", c.baseline.c_str());
+		++failures;
+		return;
+	}
+	std::map<std::string, double> old;
+	const std::string config = configJson(c) + "\n";
+	char line[1024];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (strncmp(line, "\"config\"", 8) == 0 && config != line) {
+			printf("note: the baseline was run with a different configuration\n");
+		}
+		char name[256];
+		double value;
+		if (sscanf(line, "{\"name\": \"%255[^\"]\", \"value\": %lf", name,
+				&value) == 2) {
+			old[name] = value;
+		}
+	}
+	fclose(f);
+	printf("\n%-36s %12s %12s %8s\n", "compared with baseline", "old", "new",
+			"change");
+	size_t regressions = 0;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		std::map<std::string, double>::const_iterator o = old.find(r.name);
+		if (o == old.end() || o->second == 0) {
+			continue;
+		}
+		const double change = (r.value - o->second) / o->second;
+		const bool worse = r.higherIsBetter ?
+				change < -c.tolerance : change > c.tolerance;
+		printf("%-36s %12.2f %12.2f %+7.1f%%%s\n", r.name.c_str(), o->second,
+				r.value, change * 100, worse ? "  REGRESSION" : "");
+		regressions += worse;
+	}
+	if (regressions > 0) {
+		printf("FAILED: %zu results regressed by more than %.0f%%\n",
+				regressions, c.tolerance * 100);
+		++failures;
+	}
+}
+
+/** A random minibatch of distinct indices, sorted as GPFSSampleClient sorts them. */
+static void randomBatch(RudraRand& rand, size_t rows, std::vector<size_t>& idx) {
+	for (size_t i = 0; i < idx.size(); ++i) {
+		idx[i] = rand.uniform(rows);
+	}
+	std::sort(idx.begin(), idx.end());
+}
+
+static double fileMB(const std::string& fileName) {
+	struct stat st;
+	return stat(fileName.c_str(), &st) == 0 ? st.st_size / 1e6 : 0;
+}
+
+static bool near(const float* a, const float* b, size_t n, float tol) {
+	for (size_t i = 0; i < n; ++i) {
+		if (!(fabsf(a[i] - b[i]) <= tol)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void benchWholeFile(const Config& c, const std::string& text,
+		const MatrixContainer<float>& X) {
+	const std::string copy = c.dir + "/iobench-copy.bin";
+	double t = now();
+	X.writeBinMat(copy);
+	report("writeBinMat/float", fileMB(copy) / (now() - t), "MB/s");
+
+	t = now();
+	MatrixContainer<float> back = readBinMat<float>(copy);
+	report("readBinMat/float", fileMB(copy) / (now() - t), "MB/s");
+	check(back.dimM == X.dimM && back.dimN == X.dimN
+			&& memcmp(back.buf, X.buf, X.dimM * X.dimN * sizeof(float)) == 0,
+			"writeBinMat/readBinMat round trip");
+	unlink(copy.c_str());
+
+	t = now();
+	MatrixContainer<float> parsed = readMat(text);
+	const double elapsed = now() - t;
+	report("readMat/text", fileMB(text) / elapsed, "MB/s");
+	report("readMat/text rows", X.dimM / elapsed, "rows/s");
+	check(parsed.dimM == X.dimM && parsed.dimN == X.dimN
+			&& near(parsed.buf, X.buf, X.dimM * X.dimN, 1e-5f),
+			"readMat matches the generated data");
+}
+
+static void benchRecords(const Config& c, const std::string& bin,
+		const MatrixContainer<float>& X) {
+	int fd = open(bin.c_str(), O_RDONLY);
+	if (fd < 0) {
+		check(false, "open the float data file");
+		return;
+	}
+	std::vector<float> buf(c.batch * c.cols);
+	std::vector<size_t> idx(c.batch);
+	const char* patterns[] = { "sequential", "random" };
+	for (int p = 0; p < 2; ++p) {
+		RudraRand rand(7, 0, 0);
+		bool ok = true;
+		double t = now();
+		for (size_t b = 0; b < c.batches; ++b) {
+			if (p == 0) {
+				const size_t first = b * c.batch % (c.rows - c.batch + 1);
+				for (size_t i = 0; i < c.batch; ++i) {
+					idx[i] = first + i;
+				}
+			} else {
+				randomBatch(rand, c.rows, idx);
+			}
+			readRecordsFromBinMat(&buf[0], idx, c.cols, fd);
+			const size_t i = b % c.batch;
+			ok &= memcmp(&buf[i * c.cols], X.buf + idx[i] * c.cols,
+					c.cols * sizeof(float)) == 0;
+		}
+		const double elapsed = now() - t;
+		const std::string name = std::string("readRecordsFromBinMat/")
+				+ patterns[p];
+		report(name, c.batches * c.batch / elapsed, "records/s");
+		report(name + " MB", c.batches * c.batch * c.cols * 4 / elapsed / 1e6,
+				"MB/s");
+		check(ok, "readRecordsFromBinMat matches the generated data");
+	}
+	close(fd);
+}
+
+static void benchSampleReaders(const Config& c, const std::string& labels,
+		const MatrixContainer<float>& X, const MatrixContainer<float>& Y) {
+	// decoded values are in [0, 255] for the integer types
+	const struct {
+		const char* ext;
+		float unit;
+		float tol;
+	} types[] = { { "bin8", 255, 0.51f }, { "bin32", 255, 0.51f }, { "bin", 1,
+			0 }, { "bin16", 1, 5e-4f }, { "binbf16", 1, 4e-3f }, { "binq8", 1,
+			0.51f / 255 + 1e-6f } };
+	const char* readerNames[] = { "BinarySampleReader", "MmapSampleReader" };
+	std::vector<float> bx(c.batch * c.cols), by(c.batch);
+	std::vector<float> mx(c.batch * c.cols), my(c.batch);
+	std::vector<size_t> idx(c.batch);
+	for (size_t k = 0; k < sizeof(types) / sizeof(types[0]); ++k) {
+		const std::string data = c.dir + "/iobench." + types[k].ext;
+		BinarySampleReader binary(data, labels);
+		MmapSampleReader mapped(data, labels, true);
+		SampleReader* readers[] = { &binary, &mapped };
+		for (int r = 0; r < 2; ++r) {
+			RudraRand rand(11, 0, 0);
+			bool ok = true;
+			double t = now();
+			for (size_t b = 0; b < c.batches; ++b) {
+				randomBatch(rand, c.rows, idx);
+				readers[r]->readLabelledSamples(idx, &bx[0], &by[0]);
+				const size_t i = b % c.batch;
+				for (size_t j = 0; j < c.cols; ++j) {
+					ok &= fabsf(bx[i * c.cols + j]
+							- X.buf[idx[i] * c.cols + j] * types[k].unit)
+							<= types[k].tol;
+				}
+				ok &= by[i] == Y.buf[idx[i]];
+			}
+			const double elapsed = now() - t;
+			report(std::string(readerNames[r]) + "/" + types[k].ext,
+					c.batches * c.batch / elapsed, "samples/s");
+			check(ok, (std::string(readerNames[r])
+					+ " matches the generated data: " + types[k].ext).c_str());
+		}
+
+		// both readers decode with the same kernels, so must agree exactly,
+		// including on a batch of consecutive records, which the mapped
+		// reader converts in one run
+		RudraRand rand(13, 0, 0);
+		bool same = true;
+		for (size_t b = 0; b < 4; ++b) {
+			randomBatch(rand, c.rows, idx);
+			if (b == 0) {
+				for (size_t i = 0; i < c.batch; ++i) {
+					idx[i] = (idx[0] + i) % c.rows;
+				}
+			}
+			binary.readLabelledSamples(idx, &bx[0], &by[0]);
+			mapped.readLabelledSamples(idx, &mx[0], &my[0]);
+			same &= memcmp(&bx[0], &mx[0], bx.size() * sizeof(float)) == 0
+					&& memcmp(&by[0], &my[0], by.size() * sizeof(float)) == 0;
+		}
+		check(same, (std::string("MmapSampleReader matches BinarySampleReader: ")
+				+ types[k].ext).c_str());
+
+		// a scale set after construction must reach every decoder, including
+		// the affine map QUANT8 precomputes
+		binary.readLabelledSamples(idx, &bx[0], &by[0]);
+		binary.setScale(0.5f);
+		mapped.setScale(0.5f);
+		bool scaled = true;
+		for (int r = 0; r < 2; ++r) {
+			readers[r]->readLabelledSamples(idx, &mx[0], &my[0]);
+			for (size_t j = 0; j < mx.size(); ++j) {
+				scaled &= fabsf(mx[j] - 0.5f * bx[j])
+						<= 1e-6f * (1 + fabsf(bx[j]));
+			}
+		}
+		check(scaled, (std::string("setScale applies to both readers: ")
+				+ types[k].ext).c_str());
+	}
+}
+
+static void spin(double seconds) {
+	const double until = now() + seconds;
+	while (now() < until) {
+	}
+}
+
+static void benchSampleClient(const Config& c, const std::string& data,
+		const std::string& labels) {
+	BinarySampleReader reader(data, labels);
+	const size_t producers[] = { 1, 2 };
+	for (size_t p = 0; p < 2; ++p) {
+		const size_t numBuffers = producers[p] + 1;
+		GPFSSampleClient client("bench", c.batch, &reader, RudraRand(3, 0, 0),
+				numBuffers, producers[p]);
+		float* X;
+		float* Y;
+		// let the ring fill once so start-up is not measured
+		client.releaseLabelledSamples(client.acquireLabelledSamples(X, Y));
+		std::vector<float> bx(c.batch * c.cols), by(c.batch);
+		double waited = 0;
+		const double start = now();
+		for (size_t b = 0; b < c.batches; ++b) {
+			const double t = now();
+			client.getLabelledSamples(&bx[0], &by[0]);
+			waited += now() - t;
+			spin(c.computeUs * 1e-6);
+		}
+		const double elapsed = now() - start;
+		char name[64];
+		snprintf(name, sizeof(name), "GPFSSampleClient/%zup%zub",
+				producers[p], numBuffers);
+		report(name, c.batches * c.batch / elapsed, "samples/s");
+		report(std::string(name) + " wait", waited / c.batches * 1e6,
+				"us/batch", false);
+	}
+}
+
+int main(int argc, char** argv) {
+	Config c = { 20000, 784, 128, 200, 1000, "/tmp", "", "", 0.2 };
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string opt = argv[i];
+		const char* v = argv[i + 1];
+		if (opt == "-rows") {
+			c.rows = atol(v);
+		} else if (opt == "-cols") {
+			c.cols = atol(v);
+		} else if (opt == "-batch") {
+			c.batch = atol(v);
+		} else if (opt == "-batches") {
+			c.batches = atol(v);
+		} else if (opt == "-computeUs") {
+			c.computeUs = atof(v);
+		} else if (opt == "-dir") {
+			c.dir = v;
+		} else if (opt == "-json") {
+			c.json = v;
+		} else if (opt == "-baseline") {
+			c.baseline = v;
+		} else if (opt == "-tolerance") {
+			c.tolerance = atof(v);
+		} else {
+			fprintf(stderr, "%s: unknown option %s\n", argv[0], argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (c.rows < c.batch || c.batch == 0 || c.cols == 0) {
+		fprintf(stderr, "%s: need rows >= batch > 0 and cols > 0\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), "/iobench-%d", (int) getpid());
+	c.dir += suffix;
+	if (mkdir(c.dir.c_str(), 0700) != 0) {
+		fprintf(stderr, "%s: failed to create %s\n", argv[0], c.dir.c_str());
+		return EXIT_FAILURE;
+	}
+	const char* exts[] = { "bin", "bin8", "bin32", "bin16", "binbf16",
+			"binq8", "csv" };
+	const size_t numExts = sizeof(exts) / sizeof(exts[0]);
+	const std::string labels = c.dir + "/iobench-labels.bin";
+	double t = now();
+	for (size_t k = 0; k < numExts; ++k) {
+		writeSyntheticData(c.dir + "/iobench." + exts[k], labels, c.rows,
+				c.cols, 10, 1);
+	}
+	printf("generated %zu x %zu in %zu formats in %.1f s\n", c.rows, c.cols,
+			numExts, now() - t);
+
+	const std::string bin = c.dir + "/iobench.bin";
+	const std::string text = c.dir + "/iobench.csv";
+	const MatrixContainer<float> X = readBinMat<float>(bin); // warms the cache
+	const MatrixContainer<float> Y = readBinMat<float>(labels);
+
+	benchWholeFile(c, text, X);
+	benchRecords(c, bin, X);
+	benchSampleReaders(c, labels, X, Y);
+	benchSampleClient(c, bin, labels);
+
+	for (size_t k = 0; k < numExts; ++k) {
+		unlink((c.dir + "/iobench." + exts[k]).c_str());
+	}
+	unlink(labels.c_str());
+	rmdir(c.dir.c_str());
+
+	if (!c.json.empty() && !writeJson(c)) {
+		printf("FAILED: cannot write %s\n", c.json.c_str());
+		++failures;
+	}
+	if (!c.baseline.empty()) {
+		compareWithBaseline(c);
+	}
+	return checksResult();
+}
@@ -0,0 +1,218 @@
+/*
+ * CollectiveScheduleBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/CollectiveSchedule.h"
+#include "rudra/util/RudraRand.h"
+#include "BenchHarness.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Run the collective schedules of every rank in one process, each rank's
+ * operations interleaved with the others' in random order, and check that
+ * none deadlocks and that allreduce, reduce and bcast give exactly the
+ * right result, for every algorithm over a range of place counts, sizes,
+ * segments and roots. Then report, for n floats over the given number of
+ * places, the messages and bytes sent by the busiest rank under each
+ * algorithm, its modelled time, and the algorithm AUTO picks.
+ * Usage: CollectiveScheduleBench [n=7340032] [places=16] [segmentKB=256]
+ */
+static const char* KIND_NAMES[] = { "allreduce", "reduce", "bcast" };
+
+/**
+ * Run the collective with each rank's buffer bufs[r], returning false if
+ * the ranks got stuck waiting for messages that were never sent.
+ */
+static bool simulate(CollectiveKind kind, CollectiveAlgorithm algorithm,
+		size_t n, int places, int root, size_t segment,
+		std::vector<std::vector<float> >& bufs, RudraRand& rand) {
+	std::vector<CollectiveSchedule> s(places);
+	for (int r = 0; r < places; ++r) {
+		collectiveSchedule(kind, algorithm, n, places, r, root, segment, s[r]);
+	}
+	std::vector<std::vector<float> > staging(places,
+			std::vector<float>(s[0].stagingSize));
+	std::vector<std::vector<char> > arrived(places,
+			std::vector<char>(s[0].messages));
+	std::vector<size_t> pc(places);
+	for (;;) {
+		bool progress = false, done = true;
+		for (int r = 0; r < places; ++r) {
+			// a random number of steps, so ranks run at random relative speeds
+			for (size_t budget = 1 + rand.uniform(4); budget > 0
+					&& pc[r] < s[r].ops.size(); --budget) {
+				const CollectiveOp& op = s[r].ops[pc[r]];
+				float* buf = &bufs[r][0];
+				if (op.kind == COLLECTIVE_SEND) {
+					std::copy(buf + op.lo, buf + op.lo + op.n,
+							&staging[op.peer][op.slot]);
+					arrived[op.peer][op.msg] = 1;
+				} else if (!arrived[r][op.msg]) {
+					break;
+				} else {
+					const float* in = &staging[r][op.slot];
+					for (size_t i = 0; i < op.n; ++i) {
+						buf[op.lo + i] = op.kind == COLLECTIVE_RECV_ADD ?
+								buf[op.lo + i] + in[i] : in[i];
+					}
+				}
+				++pc[r];
+				progress = true;
+			}
+			done = done && pc[r] == s[r].ops.size();
+		}
+		if (done) {
+			return true;
+		}
+		if (!progress) {
+			return false;
+		}
+	}
+}
+
+static void checkCollectives() {
+	static const int placeCounts[] = { 1, 2, 3, 4, 5, 6, 7, 8, 12, 13, 16 };
+	static const size_t sizes[] = { 0, 1, 5, 1000, 40009 };
+	static const size_t segments[] = { 1, 700, 1 << 16 };
+	RudraRand rand(1, 0, 0);
+	size_t runs = 0;
+	for (int a = COLLECTIVE_RING; a <= COLLECTIVE_TREE; ++a) {
+		for (int k = 0; k < 3; ++k) {
+			for (size_t pi = 0; pi < sizeof(placeCounts) / sizeof(int); ++pi) {
+				const int P = placeCounts[pi];
+				for (size_t ni = 0; ni < sizeof(sizes) / sizeof(size_t); ++ni) {
+					const size_t n = sizes[ni];
+					for (size_t si = 0; si < 3; ++si) {
+						const size_t seg = segments[si];
+						if (seg == 1 && n > 1000) {
+							continue; // too many messages to be quick
+						}
+						const int root = k == 0 ? -1 : (int) rand.uniform(P);
+						std::vector<std::vector<float> > bufs(P,
+								std::vector<float>(n));
+						std::vector<float> sum(n);
+						for (int r = 0; r < P; ++r) {
+							for (size_t i = 0; i < n; ++i) {
+								// small integers, so every order sums exactly
+								bufs[r][i] = (float) rand.uniform(64) - 32;
+								sum[i] += bufs[r][i];
+							}
+						}
+						const std::vector<float> rootBuf =
+								root >= 0 ? bufs[root] : sum;
+						const bool ok = simulate((CollectiveKind) k,
+								(CollectiveAlgorithm) a, n, P, root, seg, bufs,
+								rand);
+						bool right = ok;
+						for (int r = 0; ok && r < P; ++r) {
+							if (k == COLLECTIVE_REDUCE && r != root) {
+								continue;
+							}
+							const std::vector<float>& want =
+									k == COLLECTIVE_BCAST ? rootBuf : sum;
+							right = right && bufs[r] == want;
+						}
+						char what[160];
+						snprintf(what, sizeof(what),
+								"%s %s: %d places, n %zu, segment %zu, root %d",
+								collectiveAlgorithmName((CollectiveAlgorithm) a),
+								KIND_NAMES[k], P, n, seg, root);
+						check(ok, what);
+						check(right, what);
+						++runs;
+					}
+				}
+			}
+		}
+	}
+	printf("checked %zu collectives\n", runs);
+}
+
+static void report(size_t n, int places, size_t segment) {
+	printf("%zu floats over %d places, %zu-float segments:\n", n, places,
+			segment);
+	for (int k = 0; k < 3; ++k) {
+		const CollectiveAlgorithm pick = chooseCollective((CollectiveKind) k,
+				n, places, segment);
+		for (int a = COLLECTIVE_RING; a <= COLLECTIVE_TREE; ++a) {
+			const double t0 = now();
+			size_t worstMsgs = 0, worstBytes = 0, staging = 0;
+			for (int r = 0; r < places; ++r) {
+				CollectiveSchedule s;
+				collectiveSchedule((CollectiveKind) k, (CollectiveAlgorithm) a,
+						n, places, r, 0, segment, s);
+				size_t msgs = 0, bytes = 0;
+				for (size_t i = 0; i < s.ops.size(); ++i) {
+					if (s.ops[i].kind == COLLECTIVE_SEND) {
+						++msgs;
+						bytes += 4 * s.ops[i].n;
+					}
+				}
+				worstMsgs = std::max(worstMsgs, msgs);
+				worstBytes = std::max(worstBytes, bytes);
+				staging = s.stagingSize;
+			}
+			const double t = (now() - t0) / places;
+			printf("  %-9s %-4s %6zu msgs %8.2f MB sent by the busiest rank,"
+					" %7.2f MB staging, %.2f ms to schedule a rank%s\n",
+					KIND_NAMES[k],
+					collectiveAlgorithmName((CollectiveAlgorithm) a), worstMsgs,
+					worstBytes / 1048576.0, staging * 4 / 1048576.0, t * 1e3,
+					a == pick ? "  <- auto" : "");
+		}
+	}
+	// where AUTO switches, for allreduce over this many places
+	printf("  auto allreduce by size:");
+	for (size_t m = 1024; m <= n * 4; m *= 4) {
+		printf(" %zuK:%s", m / 1024 ? m / 1024 : 1,
+				collectiveAlgorithmName(chooseCollective(COLLECTIVE_ALLREDUCE,
+						m / 4, places, segment)));
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv) {
+	const size_t n = argc > 1 ? atol(argv[1]) : 7340032;
+	const int places = argc > 2 ? atoi(argv[2]) : 16;
+	const size_t segment = (argc > 3 ? atol(argv[3]) : 256) * 256;
+	checkCollectives();
+	report(n, places, segment);
+	report(n, places - 3, segment);
+	return checksResult();
+}
@@ -0,0 +1,191 @@
+/*
+ * ConvertKernelsBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/ConvertKernels.h"
+#include "rudra/util/SimdDispatch.h"
+#include "BenchHarness.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Measure the throughput of the conversion kernels at every SIMD level
+ * supported by this machine, checking each level's output against the
+ * scalar path.
+ * Usage: ConvertKernelsBench [numRecords] [recordSize] [repeats]
+ */
+enum Kernel {
+	BSWAP, BSWAP_MEAN, U8, U8_MEAN, U8_INPLACE, I32_MEAN, HALF_MEAN, BF16_MEAN,
+	AFFINE
+};
+
+/** Bytes per input element of the given kernel. */
+static size_t inputSize(Kernel k) {
+	switch (k) {
+	case BSWAP:
+	case BSWAP_MEAN:
+	case I32_MEAN:
+		return 4;
+	case HALF_MEAN:
+	case BF16_MEAN:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+static const char* kernelName(Kernel k) {
+	switch (k) {
+	case BSWAP:
+		return "bswap";
+	case BSWAP_MEAN:
+		return "bswap+mean";
+	case U8:
+		return "u8";
+	case U8_MEAN:
+		return "u8+mean";
+	case U8_INPLACE:
+		return "u8+mean inplace";
+	case I32_MEAN:
+		return "i32+mean";
+	case HALF_MEAN:
+		return "fp16+mean";
+	case BF16_MEAN:
+		return "bf16+mean";
+	default:
+		return "q8 affine";
+	}
+}
+
+static void run(Kernel k, const std::vector<char>& src,
+		std::vector<float>& dst, size_t numRecords, size_t recordSize,
+		const float* mean, const float* scales) {
+	const size_t len = numRecords * recordSize;
+	switch (k) {
+	case BSWAP:
+		convertBigEndianFloats(&src[0], &dst[0], numRecords, recordSize);
+		break;
+	case BSWAP_MEAN:
+		convertBigEndianFloats(&src[0], &dst[0], numRecords, recordSize, mean,
+				1.0f / 255);
+		break;
+	case U8:
+		convertUint8((const uint8_t*) &src[0], &dst[0], numRecords,
+				recordSize);
+		break;
+	case U8_MEAN:
+		convertUint8((const uint8_t*) &src[0], &dst[0], numRecords,
+				recordSize, mean, 1.0f / 255);
+		break;
+	case U8_INPLACE: {
+		uint8_t* raw = (uint8_t*) (&dst[0] + len) - len;
+		memcpy(raw, &src[0], len);
+		convertUint8(raw, &dst[0], numRecords, recordSize, mean, 1.0f / 255);
+		break;
+	}
+	case I32_MEAN:
+		convertBigEndianInt32(&src[0], &dst[0], numRecords, recordSize, mean,
+				1.0f / 255);
+		break;
+	case HALF_MEAN:
+		convertBigEndianHalfs(&src[0], &dst[0], numRecords, recordSize, mean,
+				1.0f / 255);
+		break;
+	case BF16_MEAN:
+		convertBigEndianBfloat16s(&src[0], &dst[0], numRecords, recordSize,
+				mean, 1.0f / 255);
+		break;
+	default:
+		convertUint8Affine((const uint8_t*) &src[0], &dst[0], numRecords,
+				recordSize, scales, mean);
+		break;
+	}
+}
+
+int main(int argc, char** argv) {
+	const size_t numRecords = argc > 1 ? atol(argv[1]) : 128;
+	const size_t recordSize = argc > 2 ? atol(argv[2]) : 3073; // odd on purpose
+	const size_t repeats = argc > 3 ? atol(argv[3]) : 200;
+	const size_t len = numRecords * recordSize;
+
+	std::vector<char> src(len * sizeof(float));
+	for (size_t i = 0; i < src.size(); ++i) {
+		src[i] = (char) (rand() & 0x3f); // keep floats finite
+	}
+	std::vector<float> mean(recordSize);
+	for (size_t j = 0; j < recordSize; ++j) {
+		mean[j] = (float) (rand() % 25600) / 100;
+	}
+	std::vector<float> scales(recordSize);
+	for (size_t j = 0; j < recordSize; ++j) {
+		scales[j] = (float) (rand() % 1000 + 1) / 1000;
+	}
+
+	const SimdLevel best = simdLevel();
+	printf("%-16s %-8s %-12s %-8s\n", "kernel", "simd", "GB/s in", "check");
+	for (int k = BSWAP; k <= AFFINE; ++k) {
+		const Kernel kernel = (Kernel) k;
+		const size_t inBytes = len * inputSize(kernel);
+		std::vector<float> expected(len);
+		setSimdLevel(SIMD_SCALAR);
+		run(kernel, src, expected, numRecords, recordSize, &mean[0],
+				&scales[0]);
+
+		for (int l = SIMD_SCALAR; l <= best; ++l) {
+			setSimdLevel((SimdLevel) l);
+			std::vector<float> dst(len);
+			run(kernel, src, dst, numRecords, recordSize, &mean[0],
+					&scales[0]);
+			const bool ok = memcmp(&dst[0], &expected[0],
+					len * sizeof(float)) == 0;
+			failures += ok ? 0 : 1;
+
+			double start = now();
+			for (size_t r = 0; r < repeats; ++r) {
+				run(kernel, src, dst, numRecords, recordSize, &mean[0],
+					&scales[0]);
+			}
+			double elapsed = now() - start;
+			printf("%-16s %-8s %-12.2f %-8s\n", kernelName(kernel),
+					simdLevelName((SimdLevel) l), inBytes * repeats / elapsed / 1e9,
+					ok ? "ok" : "MISMATCH");
+		}
+	}
+	setSimdLevel(best);
+	return checksResult();
+}
@@ -0,0 +1,234 @@
+/*
+ * GradientKernelsBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/GradientKernels.h"
+#include "rudra/util/SimdDispatch.h"
+#include "BenchHarness.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Compare the gradient kernels with the plain loops that TimedGradient used
+ * (addIn, clear and calcHash), at every SIMD level supported by this machine,
+ * for vectors of 1M to 100M floats. Elementwise kernels are checked for
+ * bit-identical results against the loops, or for axpy and scaledAdd
+ * against the scalar level, and reductions against a long double
+ * reference.
+ * Usage: GradientKernelsBench [maxMillions=100] [repeats=5]
+ */
+// the loops being replaced, kept out of line so they are not specialized
+__attribute__((noinline)) static void loopAddIn(const float* x, float* y,
+		size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		y[i] += x[i];
+	}
+}
+
+__attribute__((noinline)) static void loopClear(float* y, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		y[i] = 0.0f;
+	}
+}
+
+__attribute__((noinline)) static float loopCalcHash(const float* x,
+		size_t n) {
+	float result = 0.0f;
+	for (size_t i = 0; i < n; ++i) {
+		result += x[i];
+	}
+	return result / n;
+}
+
+static void report(const char* name, const char* simd, size_t n,
+		double bytesPerElem, double seconds, const char* check) {
+	printf("%-12s %-8s %6zuM %10.2f %10.3f  %s\n", name, simd, n / 1000000,
+			n * bytesPerElem / seconds / 1e9, seconds * 1e3, check);
+}
+
+int main(int argc, char** argv) {
+	const size_t maxMillions = argc > 1 ? atol(argv[1]) : 100;
+	const int repeats = argc > 2 ? atoi(argv[2]) : 5;
+
+	printf("%-12s %-8s %7s %10s %10s  %s\n", "kernel", "impl", "n", "GB/s",
+			"ms", "check");
+	for (size_t millions = 1; millions <= maxMillions; millions *= 10) {
+		const size_t n = millions * 1000000 + 3; // odd tail on purpose
+		std::vector<float> x(n), y0(n), y(n), expected(n);
+		srand(42);
+		for (size_t i = 0; i < n; ++i) {
+			x[i] = (float) (rand() % 2001 - 1000) / 1000;
+			x[i] = i % 7 == 0 ? 0.0f : x[i];
+			y0[i] = (float) (rand() % 2001 - 1000) / 1000;
+		}
+		long double refSum = 0, refSquares = 0;
+		float refMax = 0;
+		for (size_t i = 0; i < n; ++i) {
+			refSum += x[i];
+			refSquares += (long double) x[i] * x[i];
+			refMax = fabsf(x[i]) > refMax ? fabsf(x[i]) : refMax;
+		}
+		size_t refCount = 0;
+		for (size_t i = 0; i < n; ++i) {
+			refCount += x[i] != 0.0f;
+		}
+
+		// the current loops
+		memcpy(&expected[0], &y0[0], n * sizeof(float));
+		loopAddIn(&x[0], &expected[0], n);
+		double t = now();
+		for (int r = 0; r < repeats; ++r) {
+			loopAddIn(&x[0], &y[0], n);
+		}
+		report("addIn", "loop", n, 12, (now() - t) / repeats, "");
+		t = now();
+		for (int r = 0; r < repeats; ++r) {
+			loopClear(&y[0], n);
+		}
+		report("clear", "loop", n, 4, (now() - t) / repeats, "");
+		float hash = 0;
+		t = now();
+		for (int r = 0; r < repeats; ++r) {
+			hash += loopCalcHash(&x[0], n);
+		}
+		report("calcHash", "loop", n, 4, (now() - t) / repeats,
+				fabs(hash / repeats - refSum / n) < 1e-4 ? "" : "(drifts)");
+
+		// axpy and scaledAdd have no loop to replace; every level must give
+		// exactly what the scalar path does
+		const SimdLevel best = simdLevel();
+		std::vector<float> expectedAxpy(y0), expectedScaled(y0);
+		setSimdLevel(SIMD_SCALAR);
+		axpy(0.5f, &x[0], &expectedAxpy[0], n);
+		scaledAdd(0.5f, &x[0], 0.9f, &expectedScaled[0], n);
+		for (int l = SIMD_SCALAR; l <= best; ++l) {
+			if (l == SIMD_SSE) {
+				continue; // no SSE variants; same as scalar
+			}
+			setSimdLevel((SimdLevel) l);
+			const char* simd = simdLevelName((SimdLevel) l);
+
+			memcpy(&y[0], &y0[0], n * sizeof(float));
+			addInto(&x[0], &y[0], n);
+			bool ok = memcmp(&y[0], &expected[0], n * sizeof(float)) == 0;
+			failures += !ok;
+			t = now();
+			for (int r = 0; r < repeats; ++r) {
+				addInto(&x[0], &y[0], n);
+			}
+			report("addInto", simd, n, 12, (now() - t) / repeats,
+					ok ? "ok" : "MISMATCH");
+
+			memcpy(&y[0], &y0[0], n * sizeof(float));
+			axpy(0.5f, &x[0], &y[0], n);
+			ok = memcmp(&y[0], &expectedAxpy[0], n * sizeof(float)) == 0;
+			failures += !ok;
+			t = now();
+			for (int r = 0; r < repeats; ++r) {
+				axpy(0.5f, &x[0], &y[0], n);
+			}
+			report("axpy", simd, n, 12, (now() - t) / repeats,
+					ok ? "ok" : "MISMATCH");
+
+			memcpy(&y[0], &y0[0], n * sizeof(float));
+			scaledAdd(0.5f, &x[0], 0.9f, &y[0], n);
+			ok = memcmp(&y[0], &expectedScaled[0], n * sizeof(float)) == 0;
+			failures += !ok;
+			t = now();
+			for (int r = 0; r < repeats; ++r) {
+				scaledAdd(0.5f, &x[0], 0.9f, &y[0], n);
+			}
+			report("scaledAdd", simd, n, 12, (now() - t) / repeats,
+					ok ? "ok" : "MISMATCH");
+
+			t = now();
+			for (int r = 0; r < repeats; ++r) {
+				zero(&y[0], n);
+			}
+			ok = maxAbs(&y[0], n) == 0.0f;
+			failures += !ok;
+			report("zero", simd, n, 4, (now() - t) / repeats,
+					ok ? "ok" : "MISMATCH");
+
+			double s = 0;
+			t = now();
+			for (int r = 0; r < repeats; ++r) {
+				s = sum(&x[0], n);
+			}
+			ok = fabs(s - (double) refSum) <= 1e-9 * n;
+			failures += !ok;
+			report("sum", simd, n, 4, (now() - t) / repeats,
+					ok ? "ok" : "MISMATCH");
+
+			t = now();
+			for (int r = 0; r < repeats; ++r) {
+				s = l2Norm(&x[0], n);
+			}
+			ok = fabs(s - sqrtl(refSquares)) <= 1e-9 * s;
+			failures += !ok;
+			report("l2Norm", simd, n, 4, (now() - t) / repeats,
+					ok ? "ok" : "MISMATCH");
+
+			float m = 0;
+			t = now();
+			for (int r = 0; r < repeats; ++r) {
+				m = maxAbs(&x[0], n);
+			}
+			ok = m == refMax;
+			failures += !ok;
+			report("maxAbs", simd, n, 4, (now() - t) / repeats,
+					ok ? "ok" : "MISMATCH");
+
+			memcpy(&y[0], &y0[0], n * sizeof(float));
+			size_t count = accumulateCount(&x[0], &y[0], n);
+			ok = count == refCount
+					&& memcmp(&y[0], &expected[0], n * sizeof(float)) == 0;
+			failures += !ok;
+			t = now();
+			for (int r = 0; r < repeats; ++r) {
+				accumulateCount(&x[0], &y[0], n);
+			}
+			report("accumCount", simd, n, 12, (now() - t) / repeats,
+					ok ? "ok" : "MISMATCH");
+		}
+		setSimdLevel(best);
+	}
+	return checksResult();
+}
@@ -0,0 +1,314 @@
+/*
+ * GradientWireBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/GradientKernels.h"
+#include "rudra/util/GradientWire.h"
+#include "rudra/util/RudraRand.h"
+#include "rudra/util/SimdDispatch.h"
+#include "BenchHarness.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Check that every wire format encodes and decodes identically at every
+ * SIMD level supported by this machine, stays within one step of the
+ * format of each value (keeping NaNs and infinities), and rounds without
+ * bias. Then time encoding and decoding, and simulate the compressed
+ * allreduce used between places (each place encodes one chunk for each
+ * owner, owners decode and sum their chunk, and re-encode it for
+ * everyone), reporting bytes sent per place per step and the error of the
+ * result against the fp32 sum.
+ * Usage: GradientWireBench [n=4194304] [places=8] [reps=10]
+ */
+static const WireFormat FORMATS[] = { WIRE_FP32, WIRE_FP16, WIRE_BF16,
+		WIRE_INT8 };
+static const size_t NUM_FORMATS = sizeof(FORMATS) / sizeof(FORMATS[0]);
+
+/** Roughly gradient-like: mostly small values, with a heavy tail. */
+static void fillGradient(RudraRand& rand, float* x, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		const double u = rand.nextDouble();
+		const double v = rand.nextDouble() - 0.5;
+		x[i] = (float) (v * 1e-3 / (u + 1e-3));
+	}
+}
+
+/** The largest error a value x may have after one trip through format. */
+static double allowedError(WireFormat format, float x, float blockMax) {
+	const double a = fabs(x);
+	switch (format) {
+	case WIRE_FP16:
+		return a < 6.103515625e-05 ? ldexp(1.0, -24) : ldexp(a, -10);
+	case WIRE_BF16:
+		return ldexp(a, -7);
+	case WIRE_INT8:
+		return blockMax / 127.0 * 1.0001;
+	default:
+		return 0.0;
+	}
+}
+
+/**
+ * Encode the same awkward vector at every level: results must match the
+ * scalar encoding byte for byte, and decode to within one step.
+ */
+static void checkFormats() {
+	const size_t n = 100003; // an int8 block and a vector tail left over
+	RudraRand rand(21, 0, 0);
+	std::vector<float> x(n);
+	fillGradient(rand, &x[0], n);
+	const float specials[] = { 0.0f, -0.0f, 1e-30f, -3e-8f, 6e-5f, 65504.0f,
+			-65519.0f, 1e6f, 3.4e38f, -__builtin_inff() };
+	for (size_t s = 0; s < sizeof(specials) / sizeof(specials[0]); ++s) {
+		x[1000 + 37 * s] = specials[s];
+	}
+	x[n - 5] = __builtin_nanf(""); // spoils only the last int8 block
+	x[n - 300] = __builtin_inff();
+
+	const SimdLevel best = simdLevel();
+	for (size_t f = 0; f < NUM_FORMATS; ++f) {
+		const WireFormat format = FORMATS[f];
+		const size_t bytes = wireBytes(format, n);
+		std::vector<uint8_t> reference(bytes), wire(bytes);
+		std::vector<float> decoded(n), added(n), expected(n);
+		for (int level = SIMD_SCALAR; level <= best; ++level) {
+			setSimdLevel((SimdLevel) level);
+			char what[128];
+			snprintf(what, sizeof(what), "%s at %s",
+					wireFormatName(format), simdLevelName((SimdLevel) level));
+			encodeWire(format, &x[0], n, 99, &wire[0]);
+			decodeWire(format, &wire[0], n, &decoded[0]);
+			for (size_t i = 0; i < n; ++i) {
+				added[i] = expected[i] = (float) i;
+			}
+			decodeAddWire(format, &wire[0], n, &added[0]);
+			if (level == SIMD_SCALAR) {
+				reference = wire;
+			} else {
+				check(wire == reference, what);
+			}
+			bool close = true, sums = true;
+			for (size_t i = 0; i < n; ++i) {
+				const float y = decoded[i];
+				sums &= memcmp(&added[i], &(expected[i] += y), sizeof(float))
+						== 0;
+				if (format == WIRE_INT8 && !(y == y)) {
+					// a non-finite value spoils its whole block
+					const size_t b = i / WIRE_INT8_BLOCK * WIRE_INT8_BLOCK;
+					bool spoiled = false;
+					for (size_t j = b; j < b + WIRE_INT8_BLOCK && j < n; ++j) {
+						spoiled |= !(fabsf(x[j]) < __builtin_inff());
+					}
+					close &= spoiled;
+				} else if (!(fabsf(x[i]) < __builtin_inff())) {
+					close &= x[i] != x[i] ? y != y : y == x[i];
+				} else if (format == WIRE_FP16 && fabsf(x[i]) > 65504.0f) {
+					close &= fabsf(y) == 65504.0f;
+				} else if (format == WIRE_BF16 && fabsf(x[i]) > 3.38953139e38f) {
+					close &= fabsf(y) == 3.38953139e38f;
+				} else {
+					float blockMax = 0.0f;
+					const size_t b = i / WIRE_INT8_BLOCK * WIRE_INT8_BLOCK;
+					for (size_t j = b; j < b + WIRE_INT8_BLOCK && j < n; ++j) {
+						blockMax = std::max(blockMax, fabsf(x[j]));
+					}
+					close &= fabs((double) y - x[i])
+							<= allowedError(format, x[i], blockMax);
+				}
+			}
+			check(close, "decoded values within one step");
+			check(sums, "decodeAddWire adds what decodeWire returns");
+		}
+		setSimdLevel(best);
+	}
+}
+
+/**
+ * Round values that fall between two representable values many times
+ * with different seeds; the mean must converge to the value itself.
+ */
+static void checkUnbiased() {
+	const size_t n = 4096, trials = 200;
+	std::vector<float> x(n), y(n), mean(n, 0.0f);
+	for (size_t i = 0; i < n; ++i) {
+		// between bf16 and half steps, with a scale per int8 block that
+		// reaches subnormal halves
+		x[i] = (i & 1 ? 1.0f : -1.0f) * (1.0f + (i % 7) / 3072.0f)
+				* ldexpf(1.0f, (int) (i / WIRE_INT8_BLOCK) - 16);
+	}
+	for (size_t f = 1; f < NUM_FORMATS; ++f) {
+		std::vector<uint8_t> wire(wireBytes(FORMATS[f], n));
+		std::vector<double> sum(n, 0.0);
+		for (size_t t = 0; t < trials; ++t) {
+			encodeWire(FORMATS[f], &x[0], n, t, &wire[0]);
+			decodeWire(FORMATS[f], &wire[0], n, &y[0]);
+			for (size_t i = 0; i < n; ++i) {
+				sum[i] += y[i];
+			}
+		}
+		// compare the total relative bias over all the values
+		double bias = 0.0, norm = 0.0;
+		for (size_t i = 0; i < n; ++i) {
+			if (fabsf(x[i]) > 1e-6f) {
+				bias += sum[i] / trials / x[i] - 1.0;
+				norm += 1.0;
+			}
+		}
+		char what[64];
+		snprintf(what, sizeof(what), "%s rounding is unbiased",
+				wireFormatName(FORMATS[f]));
+		check(fabs(bias / norm) < 1e-3, what);
+	}
+}
+
+struct Result {
+	double bytes; // per place per step
+	double seconds; // per step, in the kernels
+	double error; // relative to the fp32 sum
+};
+
+/**
+ * One allreduce among places of n values each, sent in format: a
+ * reduce-scatter of encoded chunks and an all-gather of the encoded sums.
+ */
+static Result simulate(WireFormat format, size_t n, size_t places,
+		size_t reps) {
+	RudraRand rand(22, 0, 0);
+	std::vector<std::vector<float> > grads(places, std::vector<float>(n));
+	std::vector<float> exact(n, 0.0f), reduced(n), owned(n);
+	for (size_t p = 0; p < places; ++p) {
+		fillGradient(rand, &grads[p][0], n);
+		addInto(&grads[p][0], &exact[0], n);
+	}
+	const size_t chunk = (n + places - 1) / places;
+	const size_t chunkBytes = wireBytes(format, chunk);
+	std::vector<uint8_t> sent(places * places * chunkBytes);
+	double seconds = 0.0;
+	for (size_t r = 0; r < reps; ++r) {
+		const double t0 = now();
+		for (size_t p = 0; p < places; ++p) {
+			for (size_t c = 0; c < places; ++c) {
+				const size_t lo = std::min(n, c * chunk);
+				const size_t hi = std::min(n, lo + chunk);
+				encodeWire(format, &grads[p][lo], hi - lo,
+						(r * places + p) * places + c,
+						&sent[(p * places + c) * chunkBytes]);
+			}
+		}
+		zero(&owned[0], n);
+		for (size_t c = 0; c < places; ++c) {
+			const size_t lo = std::min(n, c * chunk);
+			const size_t hi = std::min(n, lo + chunk);
+			for (size_t p = 0; p < places; ++p) {
+				decodeAddWire(format, &sent[(p * places + c) * chunkBytes],
+						hi - lo, &owned[lo]);
+			}
+			encodeWire(format, &owned[lo], hi - lo, ~(r * places + c),
+					&sent[c * chunkBytes]);
+		}
+		for (size_t c = 0; c < places; ++c) {
+			const size_t lo = std::min(n, c * chunk);
+			const size_t hi = std::min(n, lo + chunk);
+			decodeWire(format, &sent[c * chunkBytes], hi - lo, &reduced[lo]);
+		}
+		seconds += now() - t0;
+	}
+	double diff = 0.0, norm = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		diff += (double) (reduced[i] - exact[i]) * (reduced[i] - exact[i]);
+		norm += (double) exact[i] * exact[i];
+	}
+	Result res;
+	// each place sends one chunk to each other place in both phases
+	res.bytes = 2.0 * (places - 1) * chunkBytes;
+	// all places run on this one; count the kernel time of one
+	res.seconds = seconds / reps / places;
+	res.error = sqrt(diff / norm);
+	return res;
+}
+
+int main(int argc, char** argv) {
+	const size_t n = argc > 1 ? atol(argv[1]) : 4194304;
+	const size_t places = argc > 2 ? atol(argv[2]) : 8;
+	const size_t reps = argc > 3 ? atol(argv[3]) : 10;
+
+	checkFormats();
+	checkUnbiased();
+
+	const SimdLevel best = simdLevel();
+	printf("%zu floats, SIMD %s\n", n, simdLevelName(best));
+	printf("%-6s %12s %14s %14s\n", "format", "bytes", "encode GB/s",
+			"decodeAdd GB/s");
+	RudraRand rand(23, 0, 0);
+	std::vector<float> x(n), y(n, 0.0f);
+	fillGradient(rand, &x[0], n);
+	std::vector<uint8_t> wire(wireBytes(WIRE_FP32, n));
+	for (size_t f = 0; f < NUM_FORMATS; ++f) {
+		double t0 = now();
+		for (size_t r = 0; r < reps; ++r) {
+			encodeWire(FORMATS[f], &x[0], n, r, &wire[0]);
+		}
+		const double encode = (now() - t0) / reps;
+		t0 = now();
+		for (size_t r = 0; r < reps; ++r) {
+			decodeAddWire(FORMATS[f], &wire[0], n, &y[0]);
+		}
+		const double decode = (now() - t0) / reps;
+		// GB/s of floats encoded or decoded
+		printf("%-6s %12zu %14.2f %14.2f\n", wireFormatName(FORMATS[f]),
+				wireBytes(FORMATS[f], n), n * 4 / encode * 1e-9,
+				n * 4 / decode * 1e-9);
+	}
+
+	printf("\nallreduce over %zu places\n", places);
+	printf("%-6s %14s %10s %12s %12s\n", "format", "bytes/step", "vs fp32",
+			"kernel ms", "rel error");
+	const Result fp32 = simulate(WIRE_FP32, n, places, reps);
+	for (size_t f = 0; f < NUM_FORMATS; ++f) {
+		const Result r =
+				f == 0 ? fp32 : simulate(FORMATS[f], n, places, reps);
+		printf("%-6s %14.0f %9.3fx %12.2f %12.2e\n",
+				wireFormatName(FORMATS[f]), r.bytes, r.bytes / fp32.bytes,
+				r.seconds * 1e3, r.error);
+	}
+	check(fp32.error == 0.0 || fp32.error < 1e-6, "fp32 allreduce is exact");
+	return checksResult();
+}
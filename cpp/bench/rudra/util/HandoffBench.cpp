@@ -0,0 +1,348 @@
+/*
+ * HandoffBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/MpscQueue.h"
+#include "rudra/util/SpscQueue.h"
+#include "rudra/util/SwapSlot.h"
+#include "BenchHarness.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Measure the latency of handing a value from one thread to another through
+ * a monitor (a mutex and condition variable, as the X10 SwapBuffers use) and
+ * through the lock-free SwapSlot, SpscQueue and MpscQueue:
+ *  - ping-pong: two threads bounce a value back and forth, and each one-way
+ *    handoff is timed;
+ *  - contention: several producers push timestamps as fast as they can
+ *    into one bounded queue, and the consumer records how long each waited.
+ * Background threads that spin on the CPU may be added to simulate load.
+ * Queue contents are checked for loss and per-producer order.
+ * Usage: HandoffBench [iterations=100000] [producers=4] [loadThreads=0]
+ */
+static void report(const char* test, const char* impl,
+		std::vector<uint64_t>& lat, double seconds) {
+	std::sort(lat.begin(), lat.end());
+	const size_t n = lat.size();
+	printf("%-11s %-14s %10.0f %9.2f %9.2f %9.2f\n", test, impl,
+			n / seconds, lat[n / 2] / 1e3, lat[n * 99 / 100] / 1e3,
+			lat[n - 1] / 1e3);
+}
+
+/** The monitor handshake of BlockingSwapBuffer. */
+class MonitorSlot {
+public:
+	MonitorSlot() :
+			full(false) {
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&changed, NULL);
+	}
+	void awaitFull() {
+		pthread_mutex_lock(&lock);
+		while (!full) {
+			pthread_cond_wait(&changed, &lock);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	void awaitEmpty() {
+		pthread_mutex_lock(&lock);
+		while (full) {
+			pthread_cond_wait(&changed, &lock);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	void set(bool f) {
+		pthread_mutex_lock(&lock);
+		full = f;
+		pthread_cond_broadcast(&changed);
+		pthread_mutex_unlock(&lock);
+	}
+	void setFull() {
+		set(true);
+	}
+	void setEmpty() {
+		set(false);
+	}
+private:
+	bool full;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+};
+
+/** A bounded queue guarded by a monitor, like BBuffer. */
+class MonitorQueue {
+public:
+	explicit MonitorQueue(size_t capacity) :
+			capacity(capacity) {
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&changed, NULL);
+	}
+	void push(uint64_t v) {
+		pthread_mutex_lock(&lock);
+		while (q.size() >= capacity) {
+			pthread_cond_wait(&changed, &lock);
+		}
+		q.push_back(v);
+		pthread_cond_broadcast(&changed);
+		pthread_mutex_unlock(&lock);
+	}
+	uint64_t pop() {
+		pthread_mutex_lock(&lock);
+		while (q.empty()) {
+			pthread_cond_wait(&changed, &lock);
+		}
+		uint64_t v = q.front();
+		q.pop_front();
+		pthread_cond_broadcast(&changed);
+		pthread_mutex_unlock(&lock);
+		return v;
+	}
+private:
+	size_t capacity;
+	std::deque<uint64_t> q;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+};
+
+static volatile bool stopLoad = false;
+
+static void* spin(void*) {
+	volatile uint64_t x = 0;
+	while (!stopLoad) {
+		++x;
+	}
+	return NULL;
+}
+
+/*
+ * Ping-pong over a pair of one-place slots: the pinger puts a timestamp in
+ * ping, the ponger takes it and records the latency, then answers on pong.
+ */
+template<class Slot>
+struct PingPong {
+	Slot ping, pong;
+	uint64_t value;
+	size_t iterations;
+	std::vector<uint64_t> lat;
+
+	static void* ponger(void* arg) {
+		PingPong* p = (PingPong*) arg;
+		for (size_t i = 0; i < p->iterations; ++i) {
+			p->ping.awaitFull();
+			p->lat.push_back(nowNanos() - p->value);
+			p->ping.setEmpty();
+			p->value = nowNanos();
+			p->pong.setFull();
+		}
+		return NULL;
+	}
+
+	void run(const char* name) {
+		lat.reserve(iterations * 2);
+		pthread_t t;
+		pthread_create(&t, NULL, ponger, this);
+		const double start = nowNanos();
+		for (size_t i = 0; i < iterations; ++i) {
+			ping.awaitEmpty();
+			value = nowNanos();
+			ping.setFull();
+			pong.awaitFull();
+			lat.push_back(nowNanos() - value);
+			pong.setEmpty();
+		}
+		pthread_join(t, NULL);
+		report("ping-pong", name, lat, (nowNanos() - start) * 1e-9);
+	}
+};
+
+/** Ping-pong over a pair of SpscQueues of timestamps. */
+static void pingPongQueue(size_t iterations) {
+	SpscQueue<uint64_t> ping(16), pong(16);
+	std::vector<uint64_t> lat;
+	lat.reserve(iterations * 2);
+	struct Args {
+		SpscQueue<uint64_t> *ping, *pong;
+		std::vector<uint64_t>* lat;
+		size_t iterations;
+		static void* run(void* arg) {
+			Args* a = (Args*) arg;
+			for (size_t i = 0; i < a->iterations; ++i) {
+				uint64_t v = a->ping->pop();
+				a->lat->push_back(nowNanos() - v);
+				a->pong->push(nowNanos());
+			}
+			return NULL;
+		}
+	};
+	std::vector<uint64_t> ponged;
+	ponged.reserve(iterations);
+	Args args = { &ping, &pong, &ponged, iterations };
+	pthread_t t;
+	pthread_create(&t, NULL, Args::run, &args);
+	const double start = nowNanos();
+	for (size_t i = 0; i < iterations; ++i) {
+		ping.push(nowNanos());
+		const uint64_t v = pong.pop();
+		lat.push_back(nowNanos() - v);
+	}
+	pthread_join(t, NULL);
+	lat.insert(lat.end(), ponged.begin(), ponged.end());
+	report("ping-pong", "SpscQueue", lat, (nowNanos() - start) * 1e-9);
+}
+
+/*
+ * Contention: each producer pushes (producer, sequence, timestamp) packed
+ * into a timestamp table; values are indices into that table.
+ */
+template<class Queue>
+struct Contention {
+	Queue* queue;
+	int producers;
+	size_t perProducer;
+	std::vector<uint64_t> sent; // send time of each value
+
+	struct Producer {
+		Contention* c;
+		int id;
+	};
+
+	static void* produce(void* arg) {
+		Producer* p = (Producer*) arg;
+		Contention* c = p->c;
+		for (size_t i = 0; i < c->perProducer; ++i) {
+			const uint64_t v = i * c->producers + p->id;
+			c->sent[v] = nowNanos();
+			c->queue->push(v);
+		}
+		return NULL;
+	}
+
+	void run(const char* name) {
+		const size_t total = perProducer * producers;
+		sent.assign(total, 0);
+		std::vector<uint64_t> lat;
+		lat.reserve(total);
+		std::vector<uint64_t> next(producers, 0); // next sequence expected
+		std::vector<Producer> args(producers);
+		std::vector<pthread_t> tids(producers);
+		const double start = nowNanos();
+		for (int i = 0; i < producers; ++i) {
+			args[i].c = this;
+			args[i].id = i;
+			pthread_create(&tids[i], NULL, produce, &args[i]);
+		}
+		bool ordered = true;
+		for (size_t i = 0; i < total; ++i) {
+			const uint64_t v = queue->pop();
+			lat.push_back(nowNanos() - sent[v]);
+			const int p = v % producers;
+			ordered &= v / producers == next[p]++;
+		}
+		const double seconds = (nowNanos() - start) * 1e-9;
+		for (int i = 0; i < producers; ++i) {
+			pthread_join(tids[i], NULL);
+		}
+		check(ordered, "values arrive in order for each producer");
+		char test[32];
+		snprintf(test, sizeof(test), "%d-producer", producers);
+		report(test, name, lat, seconds);
+	}
+};
+
+int main(int argc, char** argv) {
+	const size_t iterations = argc > 1 ? atol(argv[1]) : 100000;
+	const int producers = argc > 2 ? atoi(argv[2]) : 4;
+	const int loadThreads = argc > 3 ? atoi(argv[3]) : 0;
+
+	std::vector<pthread_t> load(loadThreads);
+	for (int i = 0; i < loadThreads; ++i) {
+		pthread_create(&load[i], NULL, spin, NULL);
+	}
+
+	printf("%-11s %-14s %10s %9s %9s %9s   (latency in us, %d load threads)\n",
+			"test", "impl", "handoffs/s", "median", "p99", "max", loadThreads);
+	{
+		PingPong<MonitorSlot> p;
+		p.iterations = iterations;
+		p.run("monitor");
+	}
+	{
+		PingPong<SwapSlot> p;
+		p.iterations = iterations;
+		p.run("SwapSlot");
+	}
+	pingPongQueue(iterations);
+
+	for (int n = 1; n <= producers; n *= 2) {
+		{
+			MonitorQueue q(64);
+			Contention<MonitorQueue> c;
+			c.queue = &q;
+			c.producers = n;
+			c.perProducer = iterations / n;
+			c.run("monitor");
+		}
+		{
+			MpscQueue<uint64_t> q(64);
+			Contention<MpscQueue<uint64_t> > c;
+			c.queue = &q;
+			c.producers = n;
+			c.perProducer = iterations / n;
+			c.run("MpscQueue");
+		}
+		if (n == 1) {
+			SpscQueue<uint64_t> q(64);
+			Contention<SpscQueue<uint64_t> > c;
+			c.queue = &q;
+			c.producers = 1;
+			c.perProducer = iterations;
+			c.run("SpscQueue");
+		}
+	}
+
+	stopLoad = true;
+	for (int i = 0; i < loadThreads; ++i) {
+		pthread_join(load[i], NULL);
+	}
+	return checksResult();
+}
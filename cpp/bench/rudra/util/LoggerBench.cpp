@@ -0,0 +1,198 @@
+/*
+ * LoggerBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/Logger.h"
+#include "BenchHarness.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <pthread.h>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Measure the cost to the calling thread of a log message, in CPU time for
+ * messages that are written:
+ *  - filtered out, formatted eagerly into a string (as callers of logInfo
+ *    must) and lazily through the RUDRA_LOG macros;
+ *  - written synchronously to a log file;
+ *  - queued for the background writer, from several threads at once. This
+ *    includes formatting, which is most of it, so the bench also times the
+ *    same messages formatted alone and a short constant message queued.
+ * The log file is then read back to check that every queued message was
+ * written once, whole and in order for each thread, including messages too
+ * long for one ring record.
+ * Usage: LoggerBench [messages=200000] [threads=2] [logFile=LoggerBench.log]
+ */
+static void report(const char* test, size_t n, uint64_t nanos) {
+	printf("%-24s %10.1f ns/message\n", test, (double) nanos / n);
+}
+
+/** Every LONG_EVERY-th message is padded to span several ring records. */
+static const size_t LONG_EVERY = 100;
+static const std::string PADDING(600, 'x');
+
+struct ProducerArgs {
+	int thread;
+	size_t messages;
+	uint64_t nanos; // CPU time the thread spent logging
+};
+
+static void* producer(void* p) {
+	ProducerArgs* args = (ProducerArgs*) p;
+	const uint64_t start = nowNanos(CLOCK_THREAD_CPUTIME_ID);
+	for (size_t i = 0; i < args->messages; ++i) {
+		RUDRA_LOG_TRACE("async t" << args->thread << " m" << i << " loss "
+				<< 0.5f / (i + 1) << (i % LONG_EVERY == 0 ? PADDING : ""));
+	}
+	args->nanos = nowNanos(CLOCK_THREAD_CPUTIME_ID) - start;
+	return NULL;
+}
+
+/**
+ * Check that the log holds messages 0..messages-1 of each thread in order,
+ * with the long ones intact.
+ */
+static void checkLog(const char* fileName, int threads, size_t messages) {
+	std::ifstream in(fileName);
+	std::vector<size_t> next(threads, 0);
+	std::string line;
+	bool whole = true;
+	while (std::getline(in, line)) {
+		size_t at = line.find("async t");
+		if (at == std::string::npos) {
+			continue;
+		}
+		int t;
+		size_t i;
+		if (sscanf(line.c_str() + at, "async t%d m%zu", &t, &i) != 2 || t < 0
+				|| t >= threads) {
+			whole = false;
+			continue;
+		}
+		check(i == next[t], "async messages in order for each thread");
+		next[t] = i + 1;
+		const bool padded = line.size() >= PADDING.size()
+				&& line.compare(line.size() - PADDING.size(), PADDING.size(),
+						PADDING) == 0;
+		if (padded != (i % LONG_EVERY == 0)) {
+			whole = false;
+		}
+	}
+	check(whole, "async messages written whole");
+	for (int t = 0; t < threads; ++t) {
+		check(next[t] == messages, "every async message written");
+	}
+}
+
+int main(int argc, char** argv) {
+	const size_t messages = argc > 1 ? atol(argv[1]) : 200000;
+	const int threads = argc > 2 ? atoi(argv[2]) : 2;
+	const char* fileName = argc > 3 ? argv[3] : "LoggerBench.log";
+	remove(fileName);
+
+	Logger::setLevel(WARNING);
+	uint64_t start = nowNanos();
+	for (size_t i = 0; i < messages; ++i) {
+		std::ostringstream msg;
+		msg << "filtered m" << i << " loss " << 0.5f / (i + 1);
+		Logger::logInfo(msg.str());
+	}
+	report("filtered, eager", messages, nowNanos() - start);
+	start = nowNanos();
+	for (size_t i = 0; i < messages; ++i) {
+		RUDRA_LOG_INFO("filtered m" << i << " loss " << 0.5f / (i + 1));
+	}
+	report("filtered, macro", messages, nowNanos() - start);
+
+	Logger::setLevel(TRACE);
+	Logger::setLogFile(fileName);
+	start = nowNanos(CLOCK_THREAD_CPUTIME_ID);
+	for (size_t i = 0; i < messages; ++i) {
+		RUDRA_LOG_TRACE("sync m" << i << " loss " << 0.5f / (i + 1));
+	}
+	report("sync to file", messages,
+			nowNanos(CLOCK_THREAD_CPUTIME_ID) - start);
+
+	Logger::startAsync();
+	check(Logger::isAsync(), "async mode started");
+	std::vector<pthread_t> tids(threads);
+	std::vector<ProducerArgs> args(threads);
+	start = nowNanos();
+	for (int t = 0; t < threads; ++t) {
+		args[t].thread = t;
+		args[t].messages = messages;
+		pthread_create(&tids[t], NULL, producer, &args[t]);
+	}
+	uint64_t producerNanos = 0;
+	for (int t = 0; t < threads; ++t) {
+		pthread_join(tids[t], NULL);
+		producerNanos += args[t].nanos;
+	}
+	const uint64_t queued = nowNanos() - start;
+	Logger::flush();
+	const uint64_t written = nowNanos() - start;
+	report("async, queued", messages * threads, producerNanos);
+	printf("async: %.0f messages/s queued, %.0f messages/s written\n",
+			messages * threads / (queued / 1e9),
+			messages * threads / (written / 1e9));
+
+	LogLine::Buffer buf;
+	std::ostream os(&buf);
+	start = nowNanos(CLOCK_THREAD_CPUTIME_ID);
+	for (size_t i = 0; i < messages; ++i) {
+		buf.clear();
+		os << "format m" << i << " loss " << 0.5f / (i + 1)
+				<< (i % LONG_EVERY == 0 ? PADDING : "");
+	}
+	report("format only", messages, nowNanos(CLOCK_THREAD_CPUTIME_ID) - start);
+	start = nowNanos(CLOCK_THREAD_CPUTIME_ID);
+	for (size_t i = 0; i < messages; ++i) {
+		RUDRA_LOG_TRACE("queue only");
+	}
+	report("async, queue only", messages,
+			nowNanos(CLOCK_THREAD_CPUTIME_ID) - start);
+	Logger::stopAsync();
+	check(!Logger::isAsync(), "async mode stopped");
+
+	checkLog(fileName, threads, messages);
+	return checksResult();
+}
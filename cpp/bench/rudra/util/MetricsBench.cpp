@@ -0,0 +1,199 @@
+/*
+ * MetricsBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/Metrics.h"
+#include "BenchHarness.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Measure the cost of updating a counter and recording in a histogram, from
+ * one thread and from several at once (each updating its own shard), against
+ * a single shared atomic counter, as time per update in each thread and as
+ * total throughput. Then check that no update was lost, that
+ * histogram quantiles are within a bucket of the exact values, and that both
+ * export formats are consistent with the registry.
+ * Usage: MetricsBench [updates=10000000] [threads=4] [exportFile=MetricsBench.prom]
+ */
+static void report(const char* test, int threads, size_t n, uint64_t nanos) {
+	printf("%-22s %2d threads %8.2f ns/update %8.1f M updates/s\n", test,
+			threads, (double) nanos * threads / n, n / (nanos / 1e3));
+}
+
+static std::atomic<uint64_t> sharedCounter(0);
+
+struct Args {
+	int kind;
+	size_t updates;
+};
+
+enum {
+	SHARED_ATOMIC, COUNTER_ADD, HISTOGRAM_RECORD, SCOPED_TIMER
+};
+
+static void* worker(void* p) {
+	const Args* args = (const Args*) p;
+	Counter& c = Metrics::counter("bench_updates_total");
+	Histogram& h = Metrics::histogram("bench_latency_seconds");
+	for (size_t i = 0; i < args->updates; ++i) {
+		switch (args->kind) {
+		case SHARED_ATOMIC:
+			sharedCounter.fetch_add(1, std::memory_order_relaxed);
+			break;
+		case COUNTER_ADD:
+			c.add();
+			break;
+		case HISTOGRAM_RECORD:
+			h.record(i & 0xffff);
+			break;
+		default:
+			ScopedTimer t(h);
+		}
+	}
+	return NULL;
+}
+
+static uint64_t run(int kind, int threads, size_t updates) {
+	std::vector<pthread_t> tids(threads);
+	Args args = { kind, updates };
+	const uint64_t start = metricNanos();
+	for (int t = 0; t < threads; ++t) {
+		pthread_create(&tids[t], NULL, worker, &args);
+	}
+	for (int t = 0; t < threads; ++t) {
+		pthread_join(tids[t], NULL);
+	}
+	return metricNanos() - start;
+}
+
+/** Check every quantile of a known distribution against its exact value. */
+static void checkQuantiles() {
+	Histogram& h = Metrics::histogram("bench_quantiles_seconds",
+			"Values 1000..100999 ns");
+	std::vector<double> values;
+	for (uint64_t v = 1000; v < 101000; ++v) {
+		h.record(v);
+		values.push_back(v);
+	}
+	const Histogram::Snapshot s = h.snapshot();
+	check(s.count == values.size(), "histogram count");
+	static const double QS[] = { 0.01, 0.5, 0.9, 0.99, 0.999 };
+	for (int i = 0; i < 5; ++i) {
+		const double exact = values[(size_t) (QS[i] * (values.size() - 1))];
+		const double approx = s.quantile(QS[i]);
+		check(std::fabs(approx - exact) <= 0.25 * exact,
+				"quantile within a bucket of exact value");
+	}
+	for (uint64_t v = 1; v < (1ull << 41); v = v * 3 + 1) {
+		const int b = Histogram::bucketOf(v);
+		check(v < Histogram::bucketLimit(b)
+				&& (b == 0 || v >= Histogram::bucketLimit(b - 1)),
+				"value lies within its bucket");
+	}
+}
+
+/** Check the Prometheus export of the counter and latency histogram. */
+static void checkExport(uint64_t expectedUpdates, const char* fileName) {
+	Metrics::setLabel("place", "0");
+	Metrics::writeFile(fileName);
+	std::ifstream in(fileName);
+	std::string line;
+	uint64_t counter = 0, lastBucket = 0, infBucket = 0, count = 0;
+	bool monotonic = true;
+	while (std::getline(in, line)) {
+		std::istringstream ls(line);
+		std::string name;
+		uint64_t value;
+		ls >> name >> value;
+		if (name == "bench_updates_total{place=\"0\"}") {
+			counter = value;
+		} else if (name.find("bench_latency_seconds_bucket{place=\"0\",le=\"+Inf\"}")
+				== 0) {
+			infBucket = value;
+		} else if (name.find("bench_latency_seconds_bucket") == 0) {
+			monotonic = monotonic && value >= lastBucket;
+			lastBucket = value;
+		} else if (name == "bench_latency_seconds_count{place=\"0\"}") {
+			count = value;
+		}
+	}
+	check(counter == expectedUpdates, "exported counter value");
+	check(monotonic && lastBucket <= infBucket, "cumulative buckets");
+	check(infBucket == count && count > 0, "+Inf bucket equals count");
+
+	std::ostringstream json;
+	Metrics::writeJson(json);
+	check(json.str().find("\"bench_updates_total\": ") != std::string::npos,
+			"JSON export holds the counter");
+	check(json.str().find("\"p99\": ") != std::string::npos,
+			"JSON export holds quantiles");
+}
+
+int main(int argc, char** argv) {
+	const size_t updates = argc > 1 ? atol(argv[1]) : 10000000;
+	const int maxThreads = argc > 2 ? atoi(argv[2]) : 4;
+	const char* fileName = argc > 3 ? argv[3] : "MetricsBench.prom";
+
+	uint64_t counted = 0;
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		const size_t perThread = updates / threads;
+		report("shared atomic", threads, perThread * threads,
+				run(SHARED_ATOMIC, threads, perThread));
+		report("Counter::add", threads, perThread * threads,
+				run(COUNTER_ADD, threads, perThread));
+		counted += perThread * threads;
+		report("Histogram::record", threads, perThread * threads,
+				run(HISTOGRAM_RECORD, threads, perThread));
+		report("ScopedTimer", threads, perThread * threads,
+				run(SCOPED_TIMER, threads, perThread));
+	}
+	check(Metrics::counter("bench_updates_total").value() == counted,
+			"no counter update lost");
+
+	checkQuantiles();
+	checkExport(counted, fileName);
+	check(&Metrics::counter("Bench Updates Total")
+			== &Metrics::counter("bench_updates_total"),
+			"names are sanitized");
+	return checksResult();
+}
@@ -0,0 +1,221 @@
+/*
+ * RudraRandBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/RudraRand.h"
+#include "rudra/util/SimdDispatch.h"
+#include "BenchHarness.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Check RudraRand against the Philox4x32-10 known-answer vectors, check that
+ * bulk fill returns the same words as next64 at every SIMD level supported by
+ * this machine, that copies and generators built from the same key repeat
+ * the same sequence while other places, threads and streams do not, and that
+ * uniform is unbiased (chi-square over a small range). Then compare the
+ * throughput of next64, fill and fillUniform with the lrand48_r calls the
+ * previous implementation made, in million words per second.
+ * Usage: RudraRandBench [millions=64]
+ */
+static void report(const char* test, const char* simd, size_t n, double t) {
+	printf("%-12s %-7s %8.1f M words/s\n", test, simd, n / t * 1e-6);
+}
+
+static void checkKnownAnswers() {
+	// from the Random123 distribution (kat_vectors, philox4x32 10 rounds)
+	static const uint32_t vectors[3][10] = { { 0, 0, 0, 0, 0, 0, 0x6627e8d5,
+			0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 }, { 0xffffffff, 0xffffffff,
+			0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0x408f276d,
+			0x41c83b0e, 0xa20bc7c6, 0x6d5451fd }, { 0x243f6a88, 0x85a308d3,
+			0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0, 0xd16cfe09,
+			0x94fdcceb, 0x5001e420, 0x24126ea1 } };
+	for (int v = 0; v < 3; ++v) {
+		uint32_t out[4];
+		RudraRand::philox(vectors[v], vectors[v] + 4, out);
+		check(memcmp(out, vectors[v] + 6, sizeof(out)) == 0,
+				"philox known-answer vector");
+	}
+}
+
+/** Check fill against next64 on a copy, starting part way into a block. */
+static void checkFill(const char* simd) {
+	RudraRand a(42, 3, 1);
+	a.next64(); // leave one word of the first block buffered
+	RudraRand b(a);
+	const size_t lengths[] = { 0, 1, 2, 7, 16, 33, 1000 };
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+		std::vector<uint64_t> bulk(lengths[l] + 1);
+		a.fill(&bulk[0], lengths[l]);
+		bool same = true;
+		for (size_t i = 0; i < lengths[l]; ++i) {
+			same &= bulk[i] == b.next64();
+		}
+		char what[64];
+		snprintf(what, sizeof(what), "fill == next64 (%s, n=%zu)", simd,
+				lengths[l]);
+		check(same, what);
+	}
+	check(a.next64() == b.next64(), "fill leaves the sequence in step");
+}
+
+static void checkStreams() {
+	RudraRand a(7, 0, 0);
+	for (int i = 0; i < 5; ++i) {
+		a.next64();
+	}
+	RudraRand copy(a);
+	check(copy.next64() == a.next64(), "a copy continues the sequence");
+
+	RudraRand again(7, 0, 0);
+	RudraRand fresh(7, 0, 0);
+	check(again.next64() == fresh.next64(), "the same key repeats");
+
+	std::set<uint64_t> firsts;
+	const uint64_t seeds[] = { 7, 8 };
+	for (int s = 0; s < 2; ++s) {
+		for (uint32_t p = 0; p < 4; ++p) {
+			for (uint32_t t = 0; t < 4; ++t) {
+				for (uint32_t st = 0; st < 2; ++st) {
+					RudraRand r(seeds[s], p, t, st);
+					firsts.insert(r.next64());
+				}
+			}
+		}
+	}
+	check(firsts.size() == 2 * 4 * 4 * 2,
+			"seeds, places, threads and streams give distinct sequences");
+
+	RudraRand s(7, 0, 0);
+	s.seek(10);
+	RudraRand t(7, 0, 0);
+	for (int i = 0; i < 20; ++i) {
+		t.next64();
+	}
+	check(s.next64() == t.next64(), "seek skips whole blocks");
+
+	RudraRand::setDefaultSeed(99);
+	RudraRand d1(2, 3), d2(99, 2, 3);
+	check(d1.next64() == d2.next64(), "the default seed keys new generators");
+}
+
+static void checkUniform(size_t n) {
+	RudraRand r(1, 0, 0);
+	const uint64_t bound = 10;
+	std::vector<uint64_t> v(n);
+	r.fillUniform(&v[0], n, bound);
+	std::vector<size_t> counts(bound);
+	bool inRange = true;
+	for (size_t i = 0; i < n; ++i) {
+		inRange &= v[i] < bound;
+		counts[v[i] % bound]++;
+	}
+	check(inRange, "fillUniform stays below its bound");
+	double chi2 = 0.0;
+	const double expected = (double) n / bound;
+	for (uint64_t k = 0; k < bound; ++k) {
+		chi2 += (counts[k] - expected) * (counts[k] - expected) / expected;
+	}
+	// 9 degrees of freedom: p = 0.001 at 27.9
+	printf("uniform(10) chi-square %.2f over %zu draws\n", chi2, n);
+	check(chi2 < 27.9, "uniform is unbiased");
+
+	// modulo reduction would put half of the draws below 2^62, not a third
+	const uint64_t big = 3ULL << 62;
+	size_t low = 0;
+	for (size_t i = 0; i < 300000; ++i) {
+		low += r.uniform(big) < (1ULL << 62);
+	}
+	check(low > 99000 && low < 101000, "uniform(3 * 2^62) is unbiased");
+}
+
+int main(int argc, char** argv) {
+	const size_t n = (argc > 1 ? atol(argv[1]) : 64) * 1000000;
+	checkKnownAnswers();
+	checkStreams();
+	checkUniform(1000000);
+
+	std::vector<uint64_t> words(n);
+	std::vector<uint64_t> reference(n);
+	RudraRand(5, 1, 2).fill(&reference[0], n);
+
+	struct drand48_data dd;
+	srand48_r(5, &dd);
+	double t = now();
+	uint64_t sink = 0;
+	for (size_t i = 0; i < n; ++i) {
+		long x;
+		lrand48_r(&dd, &x);
+		sink += x;
+	}
+	report("lrand48_r", "", n, now() - t);
+
+	RudraRand r(5, 1, 2);
+	t = now();
+	for (size_t i = 0; i < n; ++i) {
+		sink += r.next64();
+	}
+	report("next64", "", n, now() - t);
+
+	const SimdLevel best = simdLevel();
+	for (int l = SIMD_SCALAR; l <= best; ++l) {
+		if (l == SIMD_SSE) {
+			continue; // no SSE variant; same as scalar
+		}
+		setSimdLevel((SimdLevel) l);
+		const char* simd = simdLevelName((SimdLevel) l);
+		checkFill(simd);
+		RudraRand f(5, 1, 2);
+		t = now();
+		f.fill(&words[0], n);
+		report("fill", simd, n, now() - t);
+		check(memcmp(&words[0], &reference[0], n * sizeof(uint64_t)) == 0,
+				"fill agrees across SIMD levels");
+		RudraRand u(5, 1, 2);
+		t = now();
+		u.fillUniform(&words[0], n, 1000003);
+		report("fillUniform", simd, n, now() - t);
+	}
+	setSimdLevel(best);
+	if (sink == 42) {
+		printf("\n"); // keep the timed loops
+	}
+
+	return checksResult();
+}
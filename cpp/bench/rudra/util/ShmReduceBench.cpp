@@ -0,0 +1,205 @@
+/*
+ * ShmReduceBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/ShmReduce.h"
+#include "BenchHarness.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace rudra;
+
+/**
+ * Fork groups of processes that sum vectors through a ShmReduce, and check
+ * the sums exactly for a range of member counts and sizes, including sizes
+ * that take several pieces, and that a change one member makes to the
+ * result is seen by all after a barrier, as a node leader's write-back of
+ * the other nodes' sums would be. Then time reducing n floats over each
+ * member count up to the given one. The parent process only creates the
+ * segments and collects the exit codes, so it never starts OpenMP threads
+ * before forking.
+ * Usage: ShmReduceBench [n=7340032] [members=4] [reps=10]
+ */
+/** Small integers, so that the sums are exact in any order. */
+static float value(int member, size_t i) {
+	return (float) ((int) ((member * 31 + i * 7) % 64) - 32);
+}
+
+/** Run by each member: check sums of each count; return the failures. */
+static int checkMember(ShmReduce* r, const std::vector<size_t>& counts) {
+	const int members = r->members(), me = r->member();
+	int bad = 0;
+	std::vector<float> src(r->capacity());
+	for (size_t c = 0; c < counts.size(); ++c) {
+		const size_t n = counts[c];
+		for (size_t i = 0; i < n; ++i) {
+			src[i] = value(me, i);
+		}
+		r->reduce(&src[0], n);
+		for (size_t i = 0; i < n; ++i) {
+			float expected = 0.0f;
+			for (int m = 0; m < members; ++m) {
+				expected += value(m, i);
+			}
+			if (r->result()[i] != expected) {
+				++bad;
+				break;
+			}
+		}
+		// the last member changes the result, as a node leader would
+		r->barrier();
+		if (me == members - 1) {
+			for (size_t i = 0; i < n; ++i) {
+				r->result()[i] += 1.0f;
+			}
+		}
+		r->barrier();
+		for (size_t i = 0; i < n; ++i) {
+			float expected = 1.0f;
+			for (int m = 0; m < members; ++m) {
+				expected += value(m, i);
+			}
+			if (r->result()[i] != expected) {
+				++bad;
+				break;
+			}
+		}
+		r->barrier(); // before the next reduce overwrites the result
+	}
+	return bad;
+}
+
+/** Run by each member: time reps reductions of n floats; member 0 prints. */
+static int timeMember(ShmReduce* r, size_t n, int reps) {
+	std::vector<float> src(n, 1.0f);
+	r->reduce(&src[0], n); // fault the segment in
+	r->barrier();
+	const double t0 = now();
+	for (int i = 0; i < reps; ++i) {
+		r->reduce(&src[0], n);
+	}
+	const double t = (now() - t0) / reps;
+	if (r->member() == 0) {
+		printf("  %d members: %8.2f ms per reduce of %zu floats, %7.2f GB/s"
+				" summed\n", r->members(), t * 1e3, n,
+				r->members() * n * sizeof(float) / t * 1e-9);
+	}
+	return r->result()[n - 1] == (float) r->members() ? 0 : 1;
+}
+
+/**
+ * Create a segment for members processes of up to capacity floats, run
+ * f(r) in each, and return the total of their exit codes.
+ */
+template<class F>
+static int runGroup(int members, size_t capacity, F f) {
+	char name[64];
+	snprintf(name, sizeof(name), "/rudra-shmbench-%d", (int) getpid());
+	ShmReduce* creator = ShmReduce::create(name, members, capacity);
+	fflush(stdout); // or the children print it again
+	std::vector<pid_t> pids;
+	for (int m = 0; m < members; ++m) {
+		const pid_t pid = fork();
+		if (pid == 0) {
+			ShmReduce* r = m == 0 ?
+					creator : ShmReduce::attach(name, members, m, capacity);
+			const int bad = f(r);
+			fflush(stdout);
+			_exit(std::min(bad, 100));
+		}
+		pids.push_back(pid);
+	}
+	int total = 0;
+	for (size_t i = 0; i < pids.size(); ++i) {
+		int status = 0;
+		waitpid(pids[i], &status, 0);
+		total += WIFEXITED(status) ? WEXITSTATUS(status) : 100;
+	}
+	creator->unlink();
+	delete creator;
+	return total;
+}
+
+struct Check {
+	std::vector<size_t> counts;
+	int operator()(ShmReduce* r) const {
+		return checkMember(r, counts);
+	}
+};
+
+struct Time {
+	size_t n;
+	int reps;
+	int operator()(ShmReduce* r) const {
+		return timeMember(r, n, reps);
+	}
+};
+
+int main(int argc, char** argv) {
+	const size_t n = argc > 1 ? atol(argv[1]) : 7340032;
+	const int maxMembers = argc > 2 ? atoi(argv[2]) : 4;
+	const int reps = argc > 3 ? atoi(argv[3]) : 10;
+
+	Check check1;
+	const size_t counts[] = { 0, 1, 17, 1000, SHM_REDUCE_PIECE - 1,
+			SHM_REDUCE_PIECE + 5, 3 * SHM_REDUCE_PIECE };
+	check1.counts.assign(counts, counts + sizeof(counts) / sizeof(counts[0]));
+	for (int members = 1; members <= 5; ++members) {
+		char what[64];
+		snprintf(what, sizeof(what), "sums over %d members", members);
+		check(runGroup(members, 3 * SHM_REDUCE_PIECE, check1) == 0, what);
+		// a segment smaller than a piece
+		Check small;
+		small.counts.push_back(0);
+		small.counts.push_back(1);
+		small.counts.push_back(33);
+		snprintf(what, sizeof(what), "small sums over %d members", members);
+		check(runGroup(members, 33, small) == 0, what);
+	}
+	printf("checked sums over 1 to 5 members\n");
+
+	printf("%zu floats:\n", n);
+	Time time1;
+	time1.n = n;
+	time1.reps = reps;
+	for (int members = 1; members <= maxMembers; members *= 2) {
+		check(runGroup(members, n, time1) == 0, "timed sums");
+	}
+	return checksResult();
+}
@@ -0,0 +1,210 @@
+/*
+ * SparseGradientBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/GradientKernels.h"
+#include "rudra/util/RudraRand.h"
+#include "rudra/util/SimdDispatch.h"
+#include "rudra/util/SparseGradient.h"
+#include "BenchHarness.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Check that packTopK sends exactly the k largest entries of the residual
+ * (and only those above the threshold, if one is given), keeps the rest,
+ * and that unpackAdd scatters them back, at every SIMD level supported by
+ * this machine. Then simulate the CAR reducer exchanging one gradient per
+ * place per step, dense (an allreduce of every float) against top-k with
+ * error feedback (an all-to-all of each place's packed pairs), reporting
+ * bytes sent per place per step, the time per step spent in the kernels
+ * (network time excluded), and how far the sum of the sparse updates has
+ * drifted from the dense sum after all the steps.
+ * Usage: SparseGradientBench [n=4194304] [places=8] [steps=20]
+ */
+/** Roughly gradient-like: mostly small values, with a heavy tail. */
+static void fillGradient(RudraRand& rand, float* x, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		const double u = rand.nextDouble();
+		const double v = rand.nextDouble() - 0.5;
+		x[i] = (float) (v * 1e-3 / (u + 1e-3));
+	}
+}
+
+static void checkSelection(SimdLevel level) {
+	setSimdLevel(level);
+	const size_t n = 100003, k = 1000;
+	RudraRand rand(11, 0, 0);
+	std::vector<float> grad(n), residual(n, 0.0f), packed(sparsePackedSize(k));
+	fillGradient(rand, &grad[0], n);
+	for (size_t i = 0; i < n; i += 10) {
+		grad[i] = 0.0f; // zeros are never sent
+	}
+	std::vector<float> mags(n);
+	for (size_t i = 0; i < n; ++i) {
+		mags[i] = fabsf(grad[i]);
+	}
+	std::nth_element(mags.begin(), mags.begin() + k - 1, mags.end(),
+			std::greater<float>());
+	const float kth = mags[k - 1];
+
+	const size_t count = packTopK(&grad[0], &residual[0], n, k, 0.0f,
+			&packed[0]);
+	check(count == k && packed[0] == k, "packTopK sends k entries");
+	std::vector<float> sent(n, 0.0f);
+	unpackAdd(&packed[0], &sent[0], n);
+	size_t wrong = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const bool wasSent = sent[i] != 0.0f;
+		// what was sent plus what was kept is the gradient, exactly
+		wrong += sent[i] + residual[i] != grad[i];
+		wrong += wasSent != (fabsf(grad[i]) >= kth);
+		wrong += wasSent && residual[i] != 0.0f;
+	}
+	char what[128];
+	snprintf(what, sizeof(what), "packTopK %s sends the largest k",
+			simdLevelName(level));
+	check(wrong == 0, what);
+
+	// with a threshold above the k-th magnitude, fewer are sent
+	const float threshold = kth * 4;
+	std::vector<float> r2(grad);
+	const size_t above = std::count_if(grad.begin(), grad.end(),
+			[&](float x) {return fabsf(x) >= threshold;});
+	const size_t count2 = packTopK(NULL, &r2[0], n, k, threshold, &packed[0]);
+	snprintf(what, sizeof(what), "packTopK %s honours the threshold",
+			simdLevelName(level));
+	check(count2 == above && above < k, what);
+
+	// an all-zero residual sends nothing
+	std::vector<float> zeros(n, 0.0f);
+	check(packTopK(NULL, &zeros[0], n, k, 0.0f, &packed[0]) == 0,
+			"packTopK sends no zeros");
+}
+
+struct Result {
+	double bytes; // per place per step
+	double seconds; // per step
+	double drift; // of the summed updates from the dense sum
+};
+
+/**
+ * Run steps of the exchange among places, each with a fresh gradient per
+ * step; k == 0 means dense. The updates each place would apply are summed
+ * over all steps and compared with the dense sum.
+ */
+static Result simulate(size_t n, size_t places, size_t steps, size_t k) {
+	RudraRand rand(12, 0, 0);
+	std::vector<std::vector<float> > grads(places, std::vector<float>(n));
+	std::vector<std::vector<float> > residuals(places,
+			std::vector<float>(n, 0.0f));
+	const size_t block = sparsePackedSize(k);
+	std::vector<float> exchanged(places * block);
+	std::vector<float> reduced(n), applied(n, 0.0f), dense(n, 0.0f);
+	double seconds = 0.0;
+	for (size_t s = 0; s < steps; ++s) {
+		for (size_t p = 0; p < places; ++p) {
+			fillGradient(rand, &grads[p][0], n);
+			addInto(&grads[p][0], &dense[0], n);
+		}
+		const double t0 = now();
+		zero(&reduced[0], n);
+		if (k == 0) {
+			for (size_t p = 0; p < places; ++p) {
+				addInto(&grads[p][0], &reduced[0], n);
+			}
+		} else {
+			for (size_t p = 0; p < places; ++p) {
+				packTopK(&grads[p][0], &residuals[p][0], n, k, 0.0f,
+						&exchanged[p * block]);
+			}
+			for (size_t p = 0; p < places; ++p) {
+				unpackAdd(&exchanged[p * block], &reduced[0], n);
+			}
+		}
+		seconds += now() - t0;
+		addInto(&reduced[0], &applied[0], n);
+	}
+	double diff = 0.0, norm = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		diff += (double) (applied[i] - dense[i]) * (applied[i] - dense[i]);
+		norm += (double) dense[i] * dense[i];
+	}
+	Result r;
+	// an allreduce sends about the whole vector; an all-to-all sends the
+	// packed block (with its header) to each of the places
+	r.bytes = k == 0 ? (n + 1) * sizeof(float) : places * block * sizeof(float);
+	r.seconds = seconds / steps;
+	r.drift = sqrt(diff / norm);
+	return r;
+}
+
+int main(int argc, char** argv) {
+	const size_t n = argc > 1 ? atol(argv[1]) : 4194304;
+	const size_t places = argc > 2 ? atol(argv[2]) : 8;
+	const size_t steps = argc > 3 ? atol(argv[3]) : 20;
+
+	const SimdLevel best = simdLevel();
+	for (int level = SIMD_SCALAR; level <= best; ++level) {
+		checkSelection((SimdLevel) level);
+	}
+	setSimdLevel(best);
+
+	printf("%zu floats, %zu places, %zu steps, SIMD %s\n", n, places, steps,
+			simdLevelName(best));
+	printf("%-10s %14s %10s %12s %10s\n", "mode", "bytes/step", "vs dense",
+			"kernel ms", "drift");
+	const Result dense = simulate(n, places, steps, 0);
+	printf("%-10s %14.0f %10s %12.2f %10s\n", "dense", dense.bytes, "1",
+			dense.seconds * 1e3, "0");
+	const double fractions[] = { 0.01, 0.001, 0.0001 };
+	for (size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); ++f) {
+		const size_t k = std::max((size_t) 1, (size_t) (fractions[f] * n));
+		const Result r = simulate(n, places, steps, k);
+		char mode[32];
+		snprintf(mode, sizeof(mode), "top %g%%", fractions[f] * 100);
+		printf("%-10s %14.0f %9.4fx %12.2f %10.4f\n", mode, r.bytes,
+				r.bytes / dense.bytes, r.seconds * 1e3, r.drift);
+		// error feedback keeps the drift bounded by one step's residual
+		check(r.drift < 1.0, "error feedback bounds the drift");
+	}
+	return checksResult();
+}
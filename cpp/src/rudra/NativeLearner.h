@@ -92,6 +92,63 @@ public:
 	 */
 	void accumulateGradients(float *gradients);
 
+	// Overlapped training. Instead of trainMiniBatch, a caller may
+	// startMiniBatch, then take the gradients of each layer as backprop
+	// finishes it, e.g. to start reducing them while the earlier layers are
+	// still being computed, and finally finishMiniBatch. Only one minibatch
+	// may be in flight, and nothing else may be called on the learner until
+	// it is finished, except the calls below.
+	//
+	// These calls are optional. librudra has weak definitions of them that
+	// fail, and of supportsLayerGradients that returns false, so a learner
+	// that does not implement them still links; callers must check
+	// supportsLayerGradients first.
+
+	/** Whether this learner implements the overlapped training calls. */
+	bool supportsLayerGradients();
+
+	/** The number of layers with parameters. */
+	int getNumGradientLayers();
+
+	/**
+	 * Fill offsets[0..getNumGradientLayers()] with where the parameters of
+	 * each layer with parameters start, in parameter order, followed by
+	 * getNetworkSize(). Layer l owns [offsets[l], offsets[l+1]).
+	 */
+	void getGradientLayerOffsets(long *offsets);
+
+	/** Start training with a minibatch of samples in the background. */
+	void startMiniBatch();
+
+	/**
+	 * Block until more than ready layers, counted from the last, have their
+	 * final gradients, and return how many now do. Backprop finishes the
+	 * layers last first, so with L layers and r returned, the gradients
+	 * from offsets[L - r] to the end of the network are ready.
+	 */
+	int waitGradientLayers(int ready);
+
+	/**
+	 * Wait for the minibatch started by startMiniBatch to finish, and return
+	 * the training error, as trainMiniBatch would.
+	 */
+	float finishMiniBatch();
+
+	/**
+	 * As getGradients, accumulateGradients, but only for the gradients in
+	 * [lo, hi), which are read from and written to the same positions in
+	 * the array provided. They may be called for ready layers before the
+	 * minibatch is finished.
+	 */
+	void getGradientRange(float *gradients, long lo, long hi);
+	void accumulateGradientRange(float *gradients, long lo, long hi);
+
+	/**
+	 * The wall-clock seconds spent computing the gradients of the last
+	 * minibatch, from when it was started until backprop finished.
+	 */
+	double getTrainSeconds();
+
 	/**
 	 * Output the current weights into the specified file.
 	 *
@@ -111,6 +168,51 @@ public:
 	 */
 	void deserializeWeights(float *weights);
 
+	// Zero-copy exchange. By default the learner owns its weights and
+	// gradients, and the calls above copy them to and from the caller's
+	// arrays. Instead, a caller may lend the learner arrays of
+	// getNetworkSize() floats to keep them in, e.g. the rails they are
+	// reduced in or sent from, and then pass the same arrays to the calls
+	// above: getGradients, getGradientRange, serializeWeights and
+	// deserializeWeights (and so testOneEpoch) do nothing when given the
+	// array they would copy to or from, and acceptGradients updates a bound
+	// weights array in place.
+	//
+	// A bound array still belongs to the caller, who must keep it valid and
+	// at the same address until it is unbound, by binding another array or
+	// NULL, or the learner is cleaned up; the learner never frees it. Neither
+	// call may be made while a minibatch started by startMiniBatch is in
+	// flight.
+	//
+	// Like overlapped training, this is optional: by default (see
+	// supportsLayerGradients) supportsZeroCopy returns false, and only NULL
+	// may be bound.
+
+	/** Whether this learner implements bindWeights and bindGradients. */
+	bool supportsZeroCopy();
+
+	/**
+	 * Keep the weights in the array provided from now on, or in the
+	 * learner's own storage if it is NULL, copying the current weights
+	 * across either way. Training reads the weights there, and
+	 * acceptGradients and deserializeWeights write them there, so the
+	 * caller must not write to the array while a minibatch is in flight,
+	 * and writing to it at other times sets the weights.
+	 */
+	void bindWeights(float *weights);
+
+	/**
+	 * Have backprop write the gradients straight into the array provided
+	 * from now on, or into the learner's own storage if it is NULL. Nothing
+	 * is copied: the array holds the gradients once those of a minibatch
+	 * are ready (for ready layers, while it is still in flight), and they
+	 * are overwritten by the next one. The caller may reduce them in place
+	 * in between; the learner does not read them back. accumulateGradients
+	 * and accumulateGradientRange cannot sum into the bound array, since
+	 * its contents are the gradients they would add.
+	 */
+	void bindGradients(float *gradients);
+
 	/**
 	 * Set the learning rate multipler used in the learner.  A lrMultipler of
 	 * 1.0 means that the learning rate alpha should be the default alpha
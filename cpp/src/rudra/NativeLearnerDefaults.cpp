@@ -0,0 +1,112 @@
+/*
+ * NativeLearnerDefaults.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/NativeLearner.h"
+#include "rudra/util/Logger.h"
+
+/*
+ * Default definitions of the optional NativeLearner calls, for learners that
+ * do not implement them. They are weak, and the learner library comes before
+ * librudra when Rudra is linked, so a learner's own definitions take their
+ * place.
+ */
+#define RUDRA_WEAK __attribute__((weak))
+
+namespace rudra {
+
+static void unsupported(const char* call) {
+	Logger::logFatal(
+			std::string("NativeLearner: this learner does not implement ")
+					+ call);
+}
+
+RUDRA_WEAK bool NativeLearner::supportsLayerGradients() {
+	return false;
+}
+
+RUDRA_WEAK int NativeLearner::getNumGradientLayers() {
+	unsupported("getNumGradientLayers");
+	return 0;
+}
+
+RUDRA_WEAK void NativeLearner::getGradientLayerOffsets(long *) {
+	unsupported("getGradientLayerOffsets");
+}
+
+RUDRA_WEAK void NativeLearner::startMiniBatch() {
+	unsupported("startMiniBatch");
+}
+
+RUDRA_WEAK int NativeLearner::waitGradientLayers(int) {
+	unsupported("waitGradientLayers");
+	return 0;
+}
+
+RUDRA_WEAK float NativeLearner::finishMiniBatch() {
+	unsupported("finishMiniBatch");
+	return 0.0f;
+}
+
+RUDRA_WEAK void NativeLearner::getGradientRange(float *, long, long) {
+	unsupported("getGradientRange");
+}
+
+RUDRA_WEAK void NativeLearner::accumulateGradientRange(float *, long,
+		long) {
+	unsupported("accumulateGradientRange");
+}
+
+RUDRA_WEAK double NativeLearner::getTrainSeconds() {
+	unsupported("getTrainSeconds");
+	return 0.0;
+}
+
+RUDRA_WEAK bool NativeLearner::supportsZeroCopy() {
+	return false;
+}
+
+RUDRA_WEAK void NativeLearner::bindWeights(float *weights) {
+	if (weights != NULL) {
+		unsupported("bindWeights");
+	}
+}
+
+RUDRA_WEAK void NativeLearner::bindGradients(float *gradients) {
+	if (gradients != NULL) {
+		unsupported("bindGradients");
+	}
+}
+
+} /* namespace rudra */
@@ -0,0 +1,80 @@
+/*
+ * BijectiveSampler.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/BijectiveSampler.h"
+
+namespace rudra {
+BijectiveSampler::BijectiveSampler(size_t numSamples, RudraRand rand) :
+		Sampler(numSamples), rand(rand), cursor(0) {
+	unsigned bits = 2;
+	while (bits < 64 && ((uint64_t) 1 << bits) < numSamples) {
+		bits += 2;
+	}
+	halfBits = bits / 2;
+	halfMask = ((uint64_t) 1 << halfBits) - 1;
+}
+
+void BijectiveSampler::beginEpoch(size_t) {
+	for (int r = 0; r < ROUNDS; ++r) {
+		keys[r] = randomBits(rand);
+	}
+	cursor = 0;
+}
+
+/** One pass through the Feistel network; a bijection on [0, 2^(2*halfBits)). */
+uint64_t BijectiveSampler::permute(uint64_t x) const {
+	uint64_t left = x >> halfBits;
+	uint64_t right = x & halfMask;
+	for (int r = 0; r < ROUNDS; ++r) {
+		// splitmix64 finalizer as the round function
+		uint64_t f = right ^ keys[r];
+		f = (f ^ (f >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		f = (f ^ (f >> 27)) * 0x94d049bb133111ebULL;
+		f ^= f >> 31;
+		uint64_t t = right;
+		right = (left ^ f) & halfMask;
+		left = t;
+	}
+	return (left << halfBits) | right;
+}
+
+size_t BijectiveSampler::next() {
+	uint64_t x = permute(cursor++);
+	while (x >= numSamples) {
+		x = permute(x);
+	}
+	return x;
+}
+} /* namespace rudra */
@@ -0,0 +1,72 @@
+/*
+ * BijectiveSampler.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_BIJECTIVESAMPLER_H_
+#define RUDRA_IO_BIJECTIVESAMPLER_H_
+
+#include "rudra/io/Sampler.h"
+#include "rudra/util/RudraRand.h"
+#include <stdint.h>
+
+namespace rudra {
+/**
+ * Visits the records in a fresh pseudo-random order every epoch, using a
+ * keyed bijection on [0, numSamples) instead of a stored permutation, so it
+ * needs constant memory however large the data set.
+ * The bijection is a four-round Feistel network over the smallest even
+ * number of bits that covers numSamples; values that fall outside the data
+ * set are mapped again until they land inside it (cycle walking), which
+ * takes fewer than four rounds on average.
+ */
+class BijectiveSampler: public Sampler {
+public:
+	BijectiveSampler(size_t numSamples, RudraRand rand);
+
+protected:
+	void beginEpoch(size_t epoch);
+	size_t next();
+
+private:
+	static const int ROUNDS = 4;
+	RudraRand rand;
+	unsigned halfBits;
+	uint64_t halfMask;
+	uint64_t keys[ROUNDS];
+	size_t cursor;
+	uint64_t permute(uint64_t x) const;
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_BIJECTIVESAMPLER_H_ */
@@ -36,8 +36,12 @@
 #ifndef RUDRA_IO_BINARYMATRIXREADER_H_
 #define RUDRA_IO_BINARYMATRIXREADER_H_
 
+#include "rudra/io/ReadPlanner.h"
+#include "rudra/util/ConvertKernels.h"
 #include "rudra/util/MatrixContainer.h"
 #include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <vector>
 
 namespace rudra {
@@ -45,69 +49,104 @@ namespace rudra {
 /** Size of a binary matrix file header. */
 const size_t HEADER_SIZE = 2 * sizeof(uint32_t);
 
+/**
+ * Convert a buffer of big-endian values, as stored in a binary file, to host
+ * byte order in place.
+ */
 template<class T>
-MatrixContainer<T> readBinMat(std::string s) {
-	std::ifstream f1(s.c_str(), std::ios::in | std::ios::binary);
+inline void toHostByteOrder(T* buf, const size_t len) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	switch (sizeof(T)) {
+	case 2:
+		for (size_t i = 0; i < len; i++) {
+			uint16_t v;
+			memcpy(&v, &buf[i], sizeof(v));
+			v = be16toh(v);
+			memcpy(&buf[i], &v, sizeof(v));
+		}
+		break;
+	case 4:
+		bigEndianToHost32(buf, buf, len);
+		break;
+	default:
+		// no need to swap byte order
+		break;
+	}
+#endif
+}
+
+/**
+ * Open a binary matrix file and read its dimensions, leaving f1 positioned
+ * at the first element.
+ */
+inline void openBinMat(const std::string& s, std::ifstream& f1, size_t& rows,
+		size_t& cols) {
+	f1.open(s.c_str(), std::ios::in | std::ios::binary);
 	if (!f1) {
 		std::cout << "readBinMat: Error! failed to open file: " << s
 				<< std::endl;
 		exit(EXIT_FAILURE);
 	}
 
-	uint32_t rows, cols;
-	f1.read((char*) &rows, sizeof(uint32_t));
-	f1.read((char*) &cols, sizeof(uint32_t));
+	uint32_t r, c;
+	f1.read((char*) &r, sizeof(uint32_t));
+	f1.read((char*) &c, sizeof(uint32_t));
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
 	// swap byte order
-	rows = be32toh(rows);
-	cols = be32toh(cols);
+	r = be32toh(r);
+	c = be32toh(c);
 #endif
 
-	if (rows == 0 || cols == 0) {
-		std::cout << "readBinMat: Invalid matrix dimensions:" << rows << " X "
-				<< cols << std::endl;
+	if (!f1 || r == 0 || c == 0) {
+		std::cout << "readBinMat: Invalid matrix dimensions:" << r << " X "
+				<< c << std::endl;
 		exit(EXIT_FAILURE);
 
 	}
+	rows = r;
+	cols = c;
+}
 
-	MatrixContainer<T> res(rows, cols, _ZEROS);
-	f1.read((char*) res.buf, rows * cols * sizeof(T));
-
-	switch (sizeof(T)) {
-
-	case 1:
-		// no need to swap byte order
-		// do nothing
-		break;
-	case 2:
-		// 16 bit data -- need to swap byte order
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-		// swap byte order
-		for (size_t i = 0; i < rows * cols; i++) {
-			uint16_t swapped = be16toh(
-					*reinterpret_cast<uint16_t *>(&res.buf[i]));
-			res.buf[i] = *reinterpret_cast<uint16_t *>(&swapped);
-		}
-		break;
-#endif
+/** Read the elements of an opened binary matrix file into buf. */
+template<class T>
+inline void readBinMatData(const std::string& s, std::ifstream& f1, T* buf,
+		size_t len) {
+	if (!f1.read((char*) buf, len * sizeof(T))) {
+		std::cout << "readBinMat: Error! " << s
+				<< " is shorter than its header says" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	toHostByteOrder(buf, len);
+}
 
-	case 4:
-		// 32 bit data -- need to swap byte order
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-		// swap byte order
-		for (size_t i = 0; i < rows * cols; i++) {
-			uint32_t swapped = be32toh(
-					*reinterpret_cast<uint32_t *>(&res.buf[i]));
-			res.buf[i] = *reinterpret_cast<float *>(&swapped);
-		}
-		break;
-#endif
+template<class T>
+MatrixContainer<T> readBinMat(std::string s) {
+	std::ifstream f1;
+	size_t rows, cols;
+	openBinMat(s, f1, rows, cols);
 
-	default:
-		break;
+	// every element is read, so there is no need to initialize
+	MatrixContainer<T> res(rows, cols);
+	readBinMatData(s, f1, res.buf, rows * cols);
+	return res;
+}
 
+/**
+ * Read a binary matrix file into memory owned by the caller, such as an X10
+ * Rail, whose dimensions must match those in the file.
+ */
+template<class T>
+void readBinMat(std::string s, MatrixView<T> dst) {
+	std::ifstream f1;
+	size_t rows, cols;
+	openBinMat(s, f1, rows, cols);
+	if (rows != dst.dimM || cols != dst.dimN) {
+		std::cout << "readBinMat: " << s << " holds a " << rows << " X "
+				<< cols << " matrix, expected " << dst.dimM << " X "
+				<< dst.dimN << std::endl;
+		exit(EXIT_FAILURE);
 	}
-	return res;
+	readBinMatData(s, f1, dst.buf, rows * cols);
 }
 
 /**
@@ -121,39 +160,7 @@ inline void readRecordFromBinMat(T* buf, const size_t idx,
 
 	f1.seekg(seekPos);
 	f1.read((char*) buf, recordSize * sizeof(T));
-
-	switch (sizeof(T)) {
-
-	case 1:
-		// no need to swap byte order
-		// do nothing
-		break;
-	case 2:
-		// 16 bit data -- need to swap byte order
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-		// swap byte order
-		for (size_t i = 0; i < recordSize; i++) {
-			uint16_t swapped = be16toh(*reinterpret_cast<uint16_t *>(&buf[i]));
-			buf[i] = *reinterpret_cast<uint16_t *>(&swapped);
-		}
-		break;
-#endif
-
-	case 4:
-		// 32 bit data -- need to swap byte order
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-		// swap byte order
-		for (size_t i = 0; i < recordSize; i++) {
-			uint32_t swapped = be32toh(*reinterpret_cast<uint32_t *>(&buf[i]));
-			buf[i] = *reinterpret_cast<float *>(&swapped);
-		}
-		break;
-#endif
-
-	default:
-		break;
-
-	}
+	toHostByteOrder(buf, recordSize);
 }
 
 /**
@@ -173,6 +180,35 @@ void readRecordFromBinMat(T* buf, const size_t idx, const size_t recordSize,
 	readRecordFromBinMat(buf, idx, recordSize, f1);
 }
 
+/**
+ * Read a number of records from an open binary file into a matrix buffer.
+ * Nearby records are coalesced into a few large vectored reads; see
+ * ReadPlanner.
+ * @param buf the matrix buffer into which to read the records
+ * @param idx the file indices of the records to be read
+ * @param recordSize the size of each record in number of fields of type T
+ * @param fd file descriptor of the binary file
+ * @param maxGapBytes the largest gap between records to read through
+ */
+template<class T>
+void readRecordsFromBinMat(T* buf, const std::vector<size_t>& idx,
+		const size_t recordSize, int fd, size_t maxGapBytes) {
+	ReadPlanner planner(recordSize * sizeof(T), HEADER_SIZE, maxGapBytes);
+	planner.readRecords(fd, idx, (char*) buf);
+	toHostByteOrder(buf, idx.size() * recordSize);
+}
+
+/**
+ * Read a number of records from an open binary file into a matrix buffer,
+ * reading through gaps up to defaultMaxReadGap for the record size.
+ */
+template<class T>
+void readRecordsFromBinMat(T* buf, const std::vector<size_t>& idx,
+		const size_t recordSize, int fd) {
+	readRecordsFromBinMat(buf, idx, recordSize, fd,
+			defaultMaxReadGap(recordSize * sizeof(T)));
+}
+
 /**
  * Read a number of records from a binary file into a matrix buffer.
  * @param buf the matrix buffer into which to read the records
@@ -184,16 +220,15 @@ template<class T>
 void readRecordsFromBinMat(T* buf, const std::vector<size_t> idx,
 		const size_t recordSize, std::string fileName) {
 
-	std::ifstream f1(fileName.c_str(), std::ios::in | std::ios::binary);
-	if (!f1) {
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
 		std::cout << "readRecordsFromBinMat: Error! failed to open file: "
 				<< fileName << std::endl;
 		exit(EXIT_FAILURE);
 	}
 
-	for (size_t i = 0; i < idx.size(); ++i) {
-		readRecordFromBinMat(buf + i * recordSize, idx[i], recordSize, f1);
-	}
+	readRecordsFromBinMat(buf, idx, recordSize, fd);
+	close(fd);
 }
 
 }
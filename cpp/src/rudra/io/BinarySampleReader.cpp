@@ -35,15 +35,115 @@
 
 #include "BinarySampleReader.h"
 #include "rudra/io/BinaryMatrixReader.h"
+#include "rudra/util/ConvertKernels.h"
 #include "rudra/util/Logger.h"
 #include <stdint.h>
 #include <iostream>
 #include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace rudra {
+size_t binDataOffset(BinFileType type, size_t cols) {
+	return HEADER_SIZE + (type == QUANT8 ? 2 * cols * sizeof(float) : 0);
+}
+
+BinFileType binFileTypeFromExtension(const std::string& ext) {
+	if (ext == "bin") {
+		return FLOAT;
+	}
+	if (ext == "bin8") {
+		return CHAR;
+	}
+	if (ext == "bin32") {
+		return INT;
+	}
+	if (ext == "bin16") {
+		return HALF;
+	}
+	if (ext == "binbf16") {
+		return BFLOAT16;
+	}
+	if (ext == "binq8") {
+		return QUANT8;
+	}
+	return INVALID;
+}
+
+void QuantParams::read(const std::string& fileName, size_t cols) {
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		Logger::logFatal("QuantParams: failed to open " + fileName);
+	}
+	scale.resize(cols);
+	offset.resize(cols);
+	if (cols > 0) {
+		ReadPlanner::preadFully(fd, (char*) &scale[0], cols * sizeof(float),
+				HEADER_SIZE);
+		ReadPlanner::preadFully(fd, (char*) &offset[0], cols * sizeof(float),
+				HEADER_SIZE + cols * sizeof(float));
+		bigEndianToHost32(&scale[0], &scale[0], cols);
+		bigEndianToHost32(&offset[0], &offset[0], cols);
+	}
+	close(fd);
+	fold(NULL, 1.0f);
+}
+
+void QuantParams::fold(const float* mean, float s) {
+	const size_t cols = scale.size();
+	mul.resize(cols);
+	add.resize(cols);
+	for (size_t j = 0; j < cols; ++j) {
+		mul[j] = scale[j] * s;
+		add[j] = (offset[j] - (mean ? mean[j] : 0.0f)) * s;
+	}
+}
+
+void convertRecords(BinFileType type, const char* src, float* dst,
+		size_t numRecords, size_t recordSize, const float* mean, float scale,
+		const QuantParams* quant) {
+	switch (type) {
+	case FLOAT:
+		convertBigEndianFloats(src, dst, numRecords, recordSize, mean, scale);
+		break;
+	case CHAR:
+		convertUint8((const uint8_t*) src, dst, numRecords, recordSize, mean,
+				scale);
+		break;
+	case INT:
+		convertBigEndianInt32(src, dst, numRecords, recordSize, mean, scale);
+		break;
+	case HALF:
+		convertBigEndianHalfs(src, dst, numRecords, recordSize, mean, scale);
+		break;
+	case BFLOAT16:
+		convertBigEndianBfloat16s(src, dst, numRecords, recordSize, mean,
+				scale);
+		break;
+	case QUANT8:
+		convertUint8Affine((const uint8_t*) src, dst, numRecords, recordSize,
+				recordSize ? &quant->mul[0] : NULL,
+				recordSize ? &quant->add[0] : NULL);
+		break;
+	default:
+		Logger::logFatal("File type is invalid!");
+		break;
+	}
+}
+
 BinarySampleReader::BinarySampleReader(std::string sampleFileName,
 		std::string labelFileName) :
 		trainingDataFile(sampleFileName), trainingLabelFile(labelFileName) {
+	this->init(true);
+}
+
+BinarySampleReader::BinarySampleReader(std::string sampleFileName,
+		std::string labelFileName, bool openFiles) :
+		trainingDataFile(sampleFileName), trainingLabelFile(labelFileName) {
+	this->init(openFiles);
+}
+
+void BinarySampleReader::init(bool openFiles) {
 	this->checkFiles();
 
 	SampleReader::readHeader(trainingDataFile, numSamples, sizePerSample);
@@ -54,6 +154,46 @@ BinarySampleReader::BinarySampleReader(std::string sampleFileName,
 	trainingDataFileType = lookupFileType(xExt);
 	std::string yExt = getFileExt(trainingLabelFile);
 	trainingLabelFileType = lookupFileType(yExt);
+	dataReadGap = defaultMaxReadGap(
+			sizePerSample * binFileTypeSize(trainingDataFileType));
+	labelReadGap = defaultMaxReadGap(
+			sizePerLabel * binFileTypeSize(trainingLabelFileType));
+
+	dataFd = -1;
+	labelFd = -1;
+	if (openFiles) {
+		dataFd = open(trainingDataFile.c_str(), O_RDONLY);
+		labelFd = open(trainingLabelFile.c_str(), O_RDONLY);
+		if (dataFd < 0 || labelFd < 0) {
+			Logger::logFatal("BinarySampleReader: failed to open data files");
+		}
+	}
+	if (trainingDataFileType == QUANT8) {
+		dataQuant.read(trainingDataFile, sizePerSample);
+	}
+	if (trainingLabelFileType == QUANT8) {
+		labelQuant.read(trainingLabelFile, sizePerLabel);
+	}
+}
+
+BinarySampleReader::~BinarySampleReader() {
+	if (dataFd >= 0) {
+		close(dataFd);
+	}
+	if (labelFd >= 0) {
+		close(labelFd);
+	}
+}
+
+void BinarySampleReader::normalizationChanged() {
+	if (trainingDataFileType == QUANT8) {
+		dataQuant.fold(meanOrNull(), scale);
+	}
+}
+
+void BinarySampleReader::setMaxReadGap(size_t bytes) {
+	dataReadGap = bytes;
+	labelReadGap = bytes;
 }
 
 void BinarySampleReader::checkFiles() {
@@ -80,17 +220,35 @@ std::string BinarySampleReader::getFileExt(const std::string& fileName) {
 }
 
 BinFileType BinarySampleReader::lookupFileType(const std::string& s) {
-	if (s.compare("bin") == 0) {
-		return FLOAT;
-	}
-	if (s.compare("bin8") == 0) {
-		return CHAR;
+	BinFileType type = binFileTypeFromExtension(s);
+	if (type == INVALID) {
+		Logger::logFatal("Wrong files extension");
+		exit(EXIT_FAILURE);
 	}
-	if (s.compare("bin32") == 0) {
-		return INT;
+	return type;
+}
+
+/**
+ * Read the records with the given indices from fd into dst, converting them
+ * to float with the given mean subtracted and scale applied. Data narrower
+ * than float is read into the tail of dst and widened in place, so no
+ * temporary buffer is needed.
+ */
+void BinarySampleReader::readConverted(int fd, BinFileType type,
+		const std::vector<size_t>& idx, size_t recordSize, size_t maxReadGap,
+		float* dst, const float* mean, float scale, const QuantParams* quant) {
+	const size_t elemSize = binFileTypeSize(type);
+	if (elemSize == 0) {
+		Logger::logFatal("File type is invalid!");
+		exit(EXIT_FAILURE);
 	}
-	Logger::logFatal("Wrong files extension");
-	exit(EXIT_FAILURE);
+	const size_t len = idx.size() * recordSize;
+	ReadPlanner planner(recordSize * elemSize,
+			binDataOffset(type, recordSize), maxReadGap);
+	char* raw = (char*) (dst + len) - len * elemSize;
+	planner.readRecords(fd, idx, raw);
+	convertRecords(type, raw, dst, idx.size(), recordSize, mean, scale,
+			quant);
 }
 
 /**
@@ -99,69 +257,10 @@ BinFileType BinarySampleReader::lookupFileType(const std::string& s) {
  */
 void BinarySampleReader::readLabelledSamples(const std::vector<size_t>& idx,
 		float* X, float* Y) {
-
-	const size_t batchSize = idx.size();
-
-	switch (trainingDataFileType) {
-	case FLOAT: {
-		readRecordsFromBinMat(X, idx, sizePerSample, trainingDataFile);
-		break;
-	}
-
-	case CHAR: {
-		uint8_t* tempX = new uint8_t[batchSize * sizePerSample];
-		readRecordsFromBinMat(tempX, idx, sizePerSample, trainingDataFile);
-		for (size_t i = 0; i < batchSize * sizePerSample; ++i) {
-			X[i] = tempX[i]; // convert from uint8 to float
-		}
-		delete[] tempX;
-		break;
-	}
-
-	case INT: {
-		//TODO
-		Logger::logFatal("Training data file type of INT is not supported yet");
-		exit(EXIT_FAILURE);
-		break;
-	}
-	default: {
-		Logger::logFatal("Training data file type is invalid!");
-		exit(EXIT_FAILURE);
-		break;
-	}
-
-	}
-
-	switch (trainingLabelFileType) {
-	case FLOAT: {
-		readRecordsFromBinMat(Y, idx, sizePerLabel, trainingLabelFile);
-		break;
-	}
-
-	case CHAR: {
-		uint8_t* tempY = new uint8_t[batchSize * sizePerLabel];
-		readRecordsFromBinMat(tempY, idx, sizePerLabel, trainingLabelFile);
-		for (size_t i = 0; i < batchSize * sizePerLabel; ++i) {
-			Y[i] = tempY[i]; // convert from uint8 to float
-		}
-		delete[] tempY;
-		break;
-	}
-
-	case INT: {
-		//TODO
-		Logger::logFatal(
-				"Training label file type of INT is not supported yet");
-		exit(EXIT_FAILURE);
-		break;
-	}
-	default: {
-		Logger::logFatal("Training label file type is invalid!");
-		exit(EXIT_FAILURE);
-		break;
-	}
-
-	}
+	readConverted(dataFd, trainingDataFileType, idx, sizePerSample,
+			dataReadGap, X, meanOrNull(), scale, &dataQuant);
+	readConverted(labelFd, trainingLabelFileType, idx, sizePerLabel,
+			labelReadGap, Y, NULL, 1.0f, &labelQuant);
 }
 
 } /* namespace rudra */
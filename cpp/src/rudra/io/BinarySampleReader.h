@@ -41,9 +41,79 @@
 #include <vector>
 
 namespace rudra {
+/**
+ * Element types of binary matrix files, named by file extension:
+ *   bin8     CHAR      unsigned bytes
+ *   bin32    INT       big-endian signed 32-bit integers
+ *   bin      FLOAT     big-endian IEEE single precision
+ *   bin16    HALF      big-endian IEEE half precision
+ *   binbf16  BFLOAT16  big-endian bfloat16 (the top 16 bits of a float)
+ *   binq8    QUANT8    unsigned bytes q, each decoding to
+ *                      q * scale[j] + offset[j] for feature j
+ * All files start with the 8-byte rows/cols header. A QUANT8 header is
+ * followed by cols big-endian float scales and then cols offsets, and the
+ * records follow those.
+ */
 enum BinFileType {
-	CHAR, INT, FLOAT, INVALID
+	CHAR, INT, FLOAT, HALF, BFLOAT16, QUANT8, INVALID
+};
+
+/** Size in bytes of a single element stored in a file of the given type. */
+inline size_t binFileTypeSize(BinFileType type) {
+	switch (type) {
+	case CHAR:
+	case QUANT8:
+		return sizeof(uint8_t);
+	case INT:
+		return sizeof(uint32_t);
+	case FLOAT:
+		return sizeof(float);
+	case HALF:
+	case BFLOAT16:
+		return sizeof(uint16_t);
+	default:
+		return 0;
+	}
+}
+
+/** Offset in bytes of the first record in a file of the given type. */
+size_t binDataOffset(BinFileType type, size_t cols);
+
+/** The element type for a file extension, or INVALID if there is none. */
+BinFileType binFileTypeFromExtension(const std::string& ext);
+
+/**
+ * The per-feature dequantization parameters of a QUANT8 file, and the affine
+ * map that decodes and normalizes a byte in one step:
+ *     (q * scale[j] + offset[j] - mean[j]) * s = q * mul[j] + add[j]
+ */
+struct QuantParams {
+	std::vector<float> scale;
+	std::vector<float> offset;
+	std::vector<float> mul;
+	std::vector<float> add;
+
+	/**
+	 * Read the parameters of a QUANT8 file with cols features, and fold them
+	 * with no mean and a scale of 1.
+	 */
+	void read(const std::string& fileName, size_t cols);
+	/** Recompute mul and add for the given mean (if not NULL) and scale. */
+	void fold(const float* mean, float s);
 };
+
+/**
+ * Convert numRecords records of recordSize elements, stored as type at src,
+ * to floats in dst, with the given mean (if not NULL) subtracted and scale
+ * applied. QUANT8 data is decoded with quant's mul and add instead, which
+ * must already have the mean and scale folded in. src may lie in the tail of
+ * dst, i.e. start numRecords * recordSize * (4 - binFileTypeSize(type))
+ * bytes into it, and is then converted in place.
+ */
+void convertRecords(BinFileType type, const char* src, float* dst,
+		size_t numRecords, size_t recordSize, const float* mean, float scale,
+		const QuantParams* quant);
+
 class BinarySampleReader: public SampleReader {
 public:
 	std::string trainingDataFile;
@@ -52,17 +122,46 @@ public:
 	BinFileType trainingLabelFileType;
 
 	BinarySampleReader(std::string sampleFileName, std::string labelFileName);
-	virtual ~BinarySampleReader() {}
+	virtual ~BinarySampleReader();
 
 	std::string getFileExt(const std::string& s);
 	BinFileType lookupFileType(const std::string& s);
 	void readLabelledSamples(const std::vector<size_t>& idx, float* X,
 			float* Y);
 
+	/**
+	 * Set the largest gap in bytes between two records in a minibatch that
+	 * is read through rather than skipped with a separate read, for both
+	 * files. The default is defaultMaxReadGap for each file's record size.
+	 */
+	void setMaxReadGap(size_t bytes);
+
 protected:
+	/**
+	 * Read the headers (and any QUANT8 parameters) of the files, opening
+	 * them for readLabelledSamples only if openFiles; a subclass that reads
+	 * the files by other means passes false and overrides
+	 * readLabelledSamples.
+	 */
+	BinarySampleReader(std::string sampleFileName, std::string labelFileName,
+			bool openFiles);
+
+	QuantParams dataQuant; // set if the data file is QUANT8
+	QuantParams labelQuant; // set if the label file is QUANT8
+
+	void normalizationChanged();
+
 	void retrieveData(const size_t numSamples, const std::vector<size_t>& idx,
 			float* X, float* Y);
 private:
+	int dataFd; // open for the lifetime of the reader, shared by all threads,
+	int labelFd; // or -1 if not opened
+	void init(bool openFiles);
+	size_t dataReadGap;
+	size_t labelReadGap;
+	void readConverted(int fd, BinFileType type, const std::vector<size_t>& idx,
+			size_t recordSize, size_t maxReadGap, float* dst,
+			const float* mean, float scale, const QuantParams* quant);
 	void checkFiles(); // to check if files exist
 	void initSizePerLabel();
 };
@@ -0,0 +1,91 @@
+/*
+ * BlockShuffleSampler.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/BlockShuffleSampler.h"
+#include "rudra/util/Logger.h"
+#include <algorithm>
+
+namespace rudra {
+BlockShuffleSampler::BlockShuffleSampler(size_t numSamples, RudraRand rand,
+		size_t blockSize, size_t windowSize) :
+		Sampler(numSamples), rand(rand), blockSize(blockSize), windowSize(
+				windowSize), blockPos(0), blockOffset(0), windowPos(0) {
+	if (blockSize == 0 || windowSize == 0) {
+		Logger::logFatal(
+				"BlockShuffleSampler: block and window sizes must be positive");
+	}
+	const size_t numBlocks = (numSamples + blockSize - 1) / blockSize;
+	blocks.resize(numBlocks);
+	for (size_t i = 0; i < numBlocks; ++i) {
+		blocks[i] = i;
+	}
+}
+
+void BlockShuffleSampler::beginEpoch(size_t) {
+	shuffle(rand, blocks);
+	blockPos = 0;
+	blockOffset = 0;
+	window.clear();
+	windowPos = 0;
+}
+
+/**
+ * Copy the next windowSize records of the shuffled block sequence into the
+ * window, and shuffle them.
+ */
+void BlockShuffleSampler::fillWindow() {
+	window.clear();
+	while (window.size() < windowSize && blockPos < blocks.size()) {
+		const size_t start = blocks[blockPos] * blockSize;
+		const size_t end = std::min(start + blockSize, numSamples);
+		while (window.size() < windowSize && start + blockOffset < end) {
+			window.push_back(start + blockOffset++);
+		}
+		if (start + blockOffset == end) {
+			++blockPos;
+			blockOffset = 0;
+		}
+	}
+	shuffle(rand, window);
+	windowPos = 0;
+}
+
+size_t BlockShuffleSampler::next() {
+	if (windowPos == window.size()) {
+		fillWindow();
+	}
+	return window[windowPos++];
+}
+} /* namespace rudra */
@@ -0,0 +1,77 @@
+/*
+ * BlockShuffleSampler.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_BLOCKSHUFFLESAMPLER_H_
+#define RUDRA_IO_BLOCKSHUFFLESAMPLER_H_
+
+#include "rudra/io/Sampler.h"
+#include "rudra/util/RudraRand.h"
+#include <vector>
+
+namespace rudra {
+/**
+ * Visits the records in an approximately random order that keeps reads
+ * mostly sequential. Each epoch, the data set is cut into contiguous blocks
+ * of blockSize records and the blocks are shuffled; the resulting sequence
+ * is then cut into windows of windowSize records, and the records within
+ * each window are shuffled. A minibatch therefore draws from only a few
+ * contiguous runs of the file, which the reader can coalesce into large
+ * reads, while every record is still visited exactly once per epoch.
+ * Larger windows (relative to blocks) mix better; windowSize == numSamples
+ * gives a full shuffle.
+ */
+class BlockShuffleSampler: public Sampler {
+public:
+	BlockShuffleSampler(size_t numSamples, RudraRand rand, size_t blockSize,
+			size_t windowSize);
+
+protected:
+	void beginEpoch(size_t epoch);
+	size_t next();
+
+private:
+	RudraRand rand;
+	const size_t blockSize;
+	const size_t windowSize;
+	std::vector<size_t> blocks; // shuffled block numbers
+	size_t blockPos; // next block to be copied into the window
+	size_t blockOffset; // next record within that block
+	std::vector<size_t> window; // shuffled records of the current window
+	size_t windowPos;
+	void fillWindow();
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_BLOCKSHUFFLESAMPLER_H_ */
@@ -0,0 +1,492 @@
+/*
+ * CheckpointFile.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/CheckpointFile.h"
+#include "rudra/util/AlignedAlloc.h"
+#include "rudra/util/Checksum.h"
+#include "rudra/util/ConvertKernels.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/Metrics.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <vector>
+
+namespace rudra {
+
+static const char CHECKPOINT_MAGIC[8] = { 'R', 'U', 'D', 'R', 'A', 'C', 'K',
+		'P' };
+/** Offset of the header checksum, which covers the header bytes before it. */
+static const size_t HEADER_CRC_OFFSET = 60;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const uint32_t HOST_BYTE_ORDER = CHECKPOINT_LITTLE_ENDIAN;
+#else
+static const uint32_t HOST_BYTE_ORDER = CHECKPOINT_BIG_ENDIAN;
+#endif
+
+static uint32_t getBE32(const char* p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return be32toh(v);
+}
+
+static uint64_t getBE64(const char* p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return be64toh(v);
+}
+
+static char* putBE32(char* p, uint32_t v) {
+	v = htobe32(v);
+	memcpy(p, &v, sizeof(v));
+	return p + sizeof(v);
+}
+
+static char* putBE64(char* p, uint64_t v) {
+	v = htobe64(v);
+	memcpy(p, &v, sizeof(v));
+	return p + sizeof(v);
+}
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static Histogram& checkpointStallTime = Metrics::histogram(
+		"rudra_checkpoint_stall_seconds",
+		"Time callers of CheckpointWriter::write were held up");
+static Histogram& checkpointWriteTime = Metrics::histogram(
+		"rudra_checkpoint_write_seconds",
+		"Time the background writer took to write one checkpoint");
+
+static void writeFully(int fd, const char* buf, size_t size,
+		const std::string& fileName) {
+	while (size > 0) {
+		ssize_t n = ::write(fd, buf, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			Logger::logFatal(
+					"writeCheckpoint: failed to write " + fileName + ": "
+							+ strerror(errno));
+		}
+		buf += n;
+		size -= n;
+	}
+}
+
+/** Offset of the payload in a file with the given number of checksums. */
+static size_t payloadOffset(size_t numBlocks) {
+	const size_t end = CHECKPOINT_HEADER_SIZE + numBlocks * sizeof(uint32_t);
+	return (end + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT
+			* CHECKPOINT_ALIGNMENT;
+}
+
+void writeCheckpoint(const std::string& fileName, const float* weights,
+		size_t count, BinFileType elemType, uint64_t tag, size_t blockSize) {
+	if (elemType != FLOAT && elemType != HALF) {
+		Logger::logFatal("writeCheckpoint: weights must be stored as floats or halfs");
+	}
+	const size_t elemSize = binFileTypeSize(elemType);
+	// each block holds a whole number of elements
+	blockSize = blockSize < elemSize ? elemSize : blockSize / elemSize * elemSize;
+	const size_t payloadBytes = count * elemSize;
+	const size_t numBlocks = (payloadBytes + blockSize - 1) / blockSize;
+	const size_t dataOffset = payloadOffset(numBlocks);
+
+	const std::string tmpName = fileName + ".tmp";
+	int fd = open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		Logger::logFatal("writeCheckpoint: failed to create " + tmpName);
+	}
+
+	// write the payload first, checksumming each block as it goes, then go
+	// back for the header and checksum table
+	std::vector<char> head(dataOffset, 0);
+	std::vector<uint16_t> halfs(elemType == HALF ? blockSize / elemSize : 0);
+	if (lseek(fd, dataOffset, SEEK_SET) < 0) {
+		Logger::logFatal("writeCheckpoint: failed to seek in " + tmpName);
+	}
+	char* table = &head[CHECKPOINT_HEADER_SIZE];
+	const char* src = (const char*) weights;
+	for (size_t b = 0; b < numBlocks; ++b) {
+		const size_t offset = b * blockSize;
+		const size_t bytes =
+				payloadBytes - offset < blockSize ?
+						payloadBytes - offset : blockSize;
+		const char* block = src + offset;
+		if (elemType == HALF) {
+			floatsToHalfs(weights + offset / elemSize, &halfs[0],
+					bytes / elemSize);
+			block = (const char*) &halfs[0];
+		}
+		table = putBE32(table, crc32c(block, bytes));
+		writeFully(fd, block, bytes, tmpName);
+	}
+
+	char* p = &head[0];
+	memcpy(p, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+	p = putBE32(p + sizeof(CHECKPOINT_MAGIC), CHECKPOINT_FORMAT_VERSION);
+	p = putBE32(p, elemType);
+	p = putBE32(p, HOST_BYTE_ORDER);
+	p = putBE32(p, blockSize);
+	p = putBE64(p, count);
+	p = putBE64(p, tag);
+	p = putBE64(p, dataOffset);
+	p = putBE32(p, numBlocks);
+	uint32_t crc = crc32c(&head[0], HEADER_CRC_OFFSET);
+	crc = crc32c(&head[CHECKPOINT_HEADER_SIZE], numBlocks * sizeof(uint32_t),
+			crc);
+	putBE32(&head[HEADER_CRC_OFFSET], crc);
+	if (lseek(fd, 0, SEEK_SET) < 0) {
+		Logger::logFatal("writeCheckpoint: failed to seek in " + tmpName);
+	}
+	writeFully(fd, &head[0], head.size(), tmpName);
+
+	if (fsync(fd) != 0 || close(fd) != 0) {
+		Logger::logFatal("writeCheckpoint: failed to sync " + tmpName);
+	}
+	if (rename(tmpName.c_str(), fileName.c_str()) != 0) {
+		Logger::logFatal(
+				"writeCheckpoint: failed to rename " + tmpName + " to "
+						+ fileName);
+	}
+}
+
+void readCheckpoint(const std::string& fileName, float* weights,
+		size_t count) {
+	CheckpointFile f(fileName);
+	if (f.getCount() != count) {
+		Logger::logFatal(
+				"readCheckpoint: " + fileName
+						+ " does not hold the expected number of weights");
+	}
+	f.readWeights(weights);
+}
+
+CheckpointFile::CheckpointFile(const std::string& fileName, bool verify) :
+		fileName(fileName) {
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		Logger::logFatal("CheckpointFile: failed to open " + fileName);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		Logger::logFatal("CheckpointFile: failed to stat " + fileName);
+	}
+	mapSize = st.st_size;
+	if (mapSize < CHECKPOINT_HEADER_SIZE) {
+		close(fd);
+		Logger::logFatal("CheckpointFile: " + fileName + " is truncated");
+	}
+	void* m = mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps its own reference to the file
+	if (m == MAP_FAILED) {
+		Logger::logFatal("CheckpointFile: failed to map " + fileName);
+	}
+	map = (const char*) m;
+
+	if (memcmp(map, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0
+			|| getBE32(map + 8) != CHECKPOINT_FORMAT_VERSION) {
+		Logger::logFatal(
+				"CheckpointFile: " + fileName
+						+ " is not a checkpoint file of a known version");
+	}
+	elemType = (BinFileType) getBE32(map + 12);
+	byteOrder = getBE32(map + 16);
+	blockSize = getBE32(map + 20);
+	count = getBE64(map + 24);
+	tag = getBE64(map + 32);
+	dataOffset = getBE64(map + 40);
+	numBlocks = getBE32(map + 48);
+	const size_t elemSize = binFileTypeSize(elemType);
+	if ((elemType != FLOAT && elemType != HALF)
+			|| (byteOrder != CHECKPOINT_LITTLE_ENDIAN
+					&& byteOrder != CHECKPOINT_BIG_ENDIAN) || blockSize == 0
+			|| numBlocks != (count * elemSize + blockSize - 1) / blockSize
+			|| dataOffset != payloadOffset(numBlocks)) {
+		Logger::logFatal("CheckpointFile: corrupt header in " + fileName);
+	}
+	if (mapSize < dataOffset + payloadBytes()) {
+		Logger::logFatal("CheckpointFile: " + fileName + " is truncated");
+	}
+	uint32_t crc = crc32c(map, HEADER_CRC_OFFSET);
+	crc = crc32c(map + CHECKPOINT_HEADER_SIZE, numBlocks * sizeof(uint32_t),
+			crc);
+	if (crc != getBE32(map + HEADER_CRC_OFFSET)) {
+		Logger::logFatal("CheckpointFile: corrupt header in " + fileName);
+	}
+	if (verify) {
+		madvise((void*) payload(), payloadBytes(), MADV_SEQUENTIAL);
+		if (!this->verify()) {
+			Logger::logFatal(
+					"CheckpointFile: checksum mismatch in " + fileName);
+		}
+	}
+}
+
+CheckpointFile::~CheckpointFile() {
+	munmap((void*) map, mapSize);
+}
+
+bool CheckpointFile::isMappable() const {
+	return elemType == FLOAT && byteOrder == HOST_BYTE_ORDER;
+}
+
+const float* CheckpointFile::weights() const {
+	if (!isMappable()) {
+		Logger::logFatal(
+				"CheckpointFile: " + fileName
+						+ " does not hold host-order floats; use readWeights");
+	}
+	return (const float*) payload();
+}
+
+void CheckpointFile::readWeights(float* dst) const {
+	const bool swap = byteOrder != HOST_BYTE_ORDER;
+	if (elemType == FLOAT) {
+		if (!swap) {
+			memcpy(dst, payload(), payloadBytes());
+		} else if (byteOrder == CHECKPOINT_BIG_ENDIAN) {
+			convertBigEndianFloats(payload(), dst, 1, count);
+		} else {
+			const uint32_t* in = (const uint32_t*) payload();
+			uint32_t* out = (uint32_t*) dst;
+			for (size_t i = 0; i < count; ++i) {
+				out[i] = __builtin_bswap32(in[i]);
+			}
+		}
+	} else if (!swap) {
+		halfsToFloats((const uint16_t*) payload(), dst, count);
+	} else if (byteOrder == CHECKPOINT_BIG_ENDIAN) {
+		convertBigEndianHalfs(payload(), dst, 1, count);
+	} else {
+		// little-endian halfs on a big-endian host: swap into the tail of
+		// dst, then widen in place
+		const uint16_t* in = (const uint16_t*) payload();
+		uint16_t* tail = (uint16_t*) (dst + count) - count;
+		for (size_t i = 0; i < count; ++i) {
+			tail[i] = __builtin_bswap16(in[i]);
+		}
+		halfsToFloats(tail, dst, count);
+	}
+}
+
+bool CheckpointFile::verify() const {
+	const char* table = map + CHECKPOINT_HEADER_SIZE;
+	const size_t bytes = payloadBytes();
+	for (size_t b = 0; b < numBlocks; ++b) {
+		const size_t offset = b * blockSize;
+		const size_t n = bytes - offset < blockSize ? bytes - offset : blockSize;
+		if (crc32c(payload() + offset, n) != getBE32(table + b * 4)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CheckpointFile::isCheckpointFile(const std::string& fileName) {
+	char magic[sizeof(CHECKPOINT_MAGIC)];
+	FILE* f = fopen(fileName.c_str(), "rb");
+	if (f == NULL) {
+		return false;
+	}
+	const bool isCheckpoint = fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+			&& memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0;
+	fclose(f);
+	return isCheckpoint;
+}
+
+CheckpointWriter::CheckpointWriter() :
+		nextSeq(0), stopping(false), lastStallTime(0.0), lastWriteTime(0.0) {
+	for (int i = 0; i < NUM_SLOTS; ++i) {
+		slots[i].buf = NULL;
+		slots[i].capacity = 0;
+		slots[i].count = 0;
+		slots[i].elemType = FLOAT;
+		slots[i].tag = 0;
+		slots[i].state = SLOT_FREE;
+		slots[i].seq = 0;
+	}
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&changed, NULL);
+	if (pthread_create(&thread, NULL, run, this) != 0) {
+		Logger::logFatal("CheckpointWriter: failed to start writer thread");
+	}
+}
+
+CheckpointWriter::~CheckpointWriter() {
+	pthread_mutex_lock(&lock);
+	stopping = true;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+	pthread_join(thread, NULL);
+	for (int i = 0; i < NUM_SLOTS; ++i) {
+		alignedFree(slots[i].buf);
+	}
+	pthread_cond_destroy(&changed);
+	pthread_mutex_destroy(&lock);
+}
+
+CheckpointWriter& CheckpointWriter::shared() {
+	// never destroyed, as the writer thread may outlive static destructors;
+	// callers wait() for their checkpoints before exiting
+	static CheckpointWriter* writer = new CheckpointWriter();
+	return *writer;
+}
+
+void CheckpointWriter::write(const std::string& fileName,
+		const float* weights, size_t count, BinFileType elemType,
+		uint64_t tag) {
+	const double start = now();
+	pthread_mutex_lock(&lock);
+	Snapshot* s = NULL;
+	while (s == NULL) {
+		for (int i = 0; i < NUM_SLOTS && s == NULL; ++i) {
+			if (slots[i].state == SLOT_FREE) {
+				s = &slots[i];
+			}
+		}
+		if (s == NULL) {
+			pthread_cond_wait(&changed, &lock);
+		}
+	}
+	// a free slot is touched only by this thread until it is queued, so the
+	// copy is done without holding the lock
+	s->state = SLOT_WRITING;
+	pthread_mutex_unlock(&lock);
+
+	grow(s, count);
+	memcpy(s->buf, weights, count * sizeof(float));
+	s->count = count;
+	s->fileName = fileName;
+	s->elemType = elemType;
+	s->tag = tag;
+
+	pthread_mutex_lock(&lock);
+	s->state = SLOT_QUEUED;
+	s->seq = nextSeq++;
+	lastStallTime = now() - start;
+	checkpointStallTime.record(lastStallTime * 1e9);
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+}
+
+void CheckpointWriter::grow(Snapshot* s, size_t count) {
+	if (s->capacity < count) {
+		alignedFree(s->buf);
+		s->buf = (float*) alignedAlloc(count * sizeof(float));
+		s->capacity = count;
+	}
+}
+
+void CheckpointWriter::reserve(size_t count) {
+	wait();
+	for (int i = 0; i < NUM_SLOTS; ++i) {
+		if (slots[i].capacity < count) {
+			grow(&slots[i], count);
+			memset(slots[i].buf, 0, count * sizeof(float));
+		}
+	}
+}
+
+bool CheckpointWriter::busy() const {
+	for (int i = 0; i < NUM_SLOTS; ++i) {
+		if (slots[i].state != SLOT_FREE) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void CheckpointWriter::wait() {
+	pthread_mutex_lock(&lock);
+	while (busy()) {
+		pthread_cond_wait(&changed, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+void* CheckpointWriter::run(void* arg) {
+	((CheckpointWriter*) arg)->writeLoop();
+	return NULL;
+}
+
+void CheckpointWriter::writeLoop() {
+	pthread_mutex_lock(&lock);
+	while (true) {
+		Snapshot* next = NULL;
+		for (int i = 0; i < NUM_SLOTS; ++i) {
+			if (slots[i].state == SLOT_QUEUED
+					&& (next == NULL || slots[i].seq < next->seq)) {
+				next = &slots[i];
+			}
+		}
+		if (next == NULL) {
+			if (stopping && !busy()) {
+				break;
+			}
+			pthread_cond_wait(&changed, &lock);
+			continue;
+		}
+		next->state = SLOT_WRITING;
+		pthread_mutex_unlock(&lock);
+
+		const double start = now();
+		writeCheckpoint(next->fileName, next->buf, next->count,
+				next->elemType, next->tag);
+		const double elapsed = now() - start;
+
+		checkpointWriteTime.record(elapsed * 1e9);
+		pthread_mutex_lock(&lock);
+		lastWriteTime = elapsed;
+		next->state = SLOT_FREE;
+		pthread_cond_broadcast(&changed);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+} /* namespace rudra */
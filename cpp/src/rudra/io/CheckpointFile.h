@@ -0,0 +1,229 @@
+/*
+ * CheckpointFile.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_CHECKPOINTFILE_H_
+#define RUDRA_IO_CHECKPOINTFILE_H_
+
+#include "rudra/io/BinarySampleReader.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+
+namespace rudra {
+
+/*
+ * A checkpoint file (extension "ckpt") holds a flat array of model weights.
+ * The layout is:
+ *
+ *   header       CHECKPOINT_HEADER_SIZE bytes, see below
+ *   checksums    numBlocks CRC-32C values, one for each blockSize bytes of
+ *                payload (the last block may be shorter)
+ *   payload      count elements, starting at dataOffset, a multiple of
+ *                CHECKPOINT_ALIGNMENT
+ *
+ * The header holds, in order: the 8-byte magic "RUDRACKP", uint32 version,
+ * uint32 element type (FLOAT or HALF), uint32 payload byte order
+ * (CHECKPOINT_LITTLE_ENDIAN or CHECKPOINT_BIG_ENDIAN), uint32 blockSize,
+ * uint64 count, uint64 tag (chosen by the writer, e.g. the epoch), uint64
+ * dataOffset, uint32 numBlocks, 8 reserved zero bytes, and the CRC-32C of
+ * the preceding 60 header bytes followed by the checksum table.
+ * Header and checksum integers are big-endian, as in the other Rudra binary
+ * formats. The payload is in the byte order of the machine that wrote it,
+ * so that float weights can be used straight from a mapping of the file.
+ */
+const size_t CHECKPOINT_HEADER_SIZE = 64;
+const uint32_t CHECKPOINT_FORMAT_VERSION = 1;
+const uint32_t CHECKPOINT_LITTLE_ENDIAN = 0;
+const uint32_t CHECKPOINT_BIG_ENDIAN = 1;
+/** Alignment of the payload within the file, so a mapping of it is aligned. */
+const size_t CHECKPOINT_ALIGNMENT = 4096;
+/** Default number of payload bytes covered by each checksum. */
+const size_t CHECKPOINT_BLOCK_SIZE = 1 << 20;
+
+/**
+ * Write count weights to the named checkpoint file, as floats or rounded to
+ * halfs (elemType FLOAT or HALF). The file is written under a temporary name,
+ * synced and then renamed, so a reader never sees a partial checkpoint.
+ */
+void writeCheckpoint(const std::string& fileName, const float* weights,
+		size_t count, BinFileType elemType = FLOAT, uint64_t tag = 0,
+		size_t blockSize = CHECKPOINT_BLOCK_SIZE);
+
+/**
+ * Read the weights from the named checkpoint file into weights, which must
+ * hold count floats, where count is the number of weights in the file.
+ */
+void readCheckpoint(const std::string& fileName, float* weights,
+		size_t count);
+
+/**
+ * Read access to a checkpoint file, which is mapped into memory. The header
+ * is always checked; the payload is checked against its checksums at
+ * construction if verify is true, or by a later call to verify().
+ */
+class CheckpointFile {
+public:
+	CheckpointFile(const std::string& fileName, bool verify = true);
+	~CheckpointFile();
+
+	size_t getCount() const {
+		return count;
+	}
+	BinFileType getElemType() const {
+		return elemType;
+	}
+	uint64_t getTag() const {
+		return tag;
+	}
+
+	/**
+	 * Whether the payload is floats in host byte order, and so can be used
+	 * in place through weights().
+	 */
+	bool isMappable() const;
+
+	/**
+	 * The weights, straight from the mapping, valid for the lifetime of this
+	 * object. Fatal unless isMappable().
+	 */
+	const float* weights() const;
+
+	/** Copy the weights into dst, which must hold getCount() floats. */
+	void readWeights(float* dst) const;
+
+	/** Check the payload against its checksums. */
+	bool verify() const;
+
+	/** Check whether the named file starts with the checkpoint magic. */
+	static bool isCheckpointFile(const std::string& fileName);
+
+private:
+	std::string fileName;
+	const char* map;
+	size_t mapSize;
+	size_t count;
+	BinFileType elemType;
+	uint32_t byteOrder;
+	uint64_t tag;
+	size_t blockSize;
+	size_t dataOffset;
+	size_t numBlocks;
+
+	const char* payload() const {
+		return map + dataOffset;
+	}
+	size_t payloadBytes() const {
+		return count * binFileTypeSize(elemType);
+	}
+};
+
+/**
+ * Writes checkpoints on a background thread, so that the caller is stalled
+ * only for the time taken to copy the weights into an in-memory snapshot.
+ * There are two snapshot buffers: one being written while the next is
+ * filled. A call to write() blocks only if both are still in use, that is,
+ * if checkpoints are requested faster than the filesystem can take them.
+ */
+class CheckpointWriter {
+public:
+	CheckpointWriter();
+	/** Finishes writing any queued checkpoints. */
+	~CheckpointWriter();
+
+	/**
+	 * Snapshot count weights and queue them to be written to the named file
+	 * by writeCheckpoint. Checkpoints are written in the order queued.
+	 */
+	void write(const std::string& fileName, const float* weights,
+			size_t count, BinFileType elemType = FLOAT, uint64_t tag = 0);
+
+	/**
+	 * Allocate and fault in snapshot buffers for count weights, so that the
+	 * first checkpoints stall only for the copy. Must not be called while
+	 * another thread is in write().
+	 */
+	void reserve(size_t count);
+
+	/** Block until every queued checkpoint has been written. */
+	void wait();
+
+	/** Seconds the most recent write() call stalled its caller. */
+	double getLastStallTime() const {
+		return lastStallTime;
+	}
+	/** Seconds taken to write the most recently completed checkpoint. */
+	double getLastWriteTime() const {
+		return lastWriteTime;
+	}
+
+	/** A writer shared by all callers in this process, created on first use. */
+	static CheckpointWriter& shared();
+
+private:
+	enum SlotState {
+		SLOT_FREE, SLOT_QUEUED, SLOT_WRITING
+	};
+	struct Snapshot {
+		float* buf;
+		size_t capacity;
+		size_t count;
+		std::string fileName;
+		BinFileType elemType;
+		uint64_t tag;
+		SlotState state;
+		uint64_t seq;
+	};
+	static const int NUM_SLOTS = 2;
+
+	Snapshot slots[NUM_SLOTS];
+	uint64_t nextSeq;
+	bool stopping;
+	double lastStallTime;
+	double lastWriteTime;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	pthread_t thread;
+
+	CheckpointWriter(const CheckpointWriter&);
+	CheckpointWriter& operator=(const CheckpointWriter&);
+
+	static void* run(void* arg);
+	void writeLoop();
+	void grow(Snapshot* s, size_t count);
+	bool busy() const;
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_CHECKPOINTFILE_H_ */
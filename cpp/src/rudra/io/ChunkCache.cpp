@@ -0,0 +1,156 @@
+/*
+ * ChunkCache.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/ChunkCache.h"
+#include "rudra/util/Metrics.h"
+
+namespace rudra {
+static Counter& cacheHits = Metrics::counter("rudra_chunk_cache_hits_total",
+		"Chunk lookups served from a chunk cache");
+static Counter& cacheMisses = Metrics::counter(
+		"rudra_chunk_cache_misses_total",
+		"Chunk lookups that had to read and decode the chunk");
+static Histogram& decodeTime = Metrics::histogram(
+		"rudra_chunk_decode_seconds", "Time to read and decode one chunk");
+
+ChunkCache::ChunkCache(const ChunkedMatrixFile& file, size_t capacityBytes) :
+		file(file), capacityBytes(capacityBytes), cachedBytes(0), storedBytesRead(
+				0), hits(0), misses(0) {
+	pthread_mutex_init(&mutex, NULL);
+}
+
+ChunkCache::~ChunkCache() {
+	for (std::map<size_t, Entry*>::iterator it = entries.begin();
+			it != entries.end(); ++it) {
+		delete it->second;
+	}
+	pthread_mutex_destroy(&mutex);
+}
+
+const std::vector<char>& ChunkCache::acquire(size_t chunk) {
+	pthread_mutex_lock(&mutex);
+	std::map<size_t, Entry*>::iterator it = entries.find(chunk);
+	if (it != entries.end()) {
+		Entry* e = it->second;
+		++e->pins;
+		lru.splice(lru.begin(), lru, e->lruPos);
+		++hits;
+		pthread_mutex_unlock(&mutex);
+		cacheHits.add();
+		return e->data;
+	}
+	++misses;
+	storedBytesRead += file.storedSize(chunk);
+	pthread_mutex_unlock(&mutex);
+	cacheMisses.add();
+
+	// decode without holding the lock
+	Entry* fresh = new Entry();
+	{
+		ScopedTimer t(decodeTime);
+		file.readChunk(chunk, fresh->data);
+	}
+	fresh->pins = 1;
+
+	pthread_mutex_lock(&mutex);
+	it = entries.find(chunk);
+	Entry* e;
+	if (it != entries.end()) {
+		// another thread decoded the same chunk meanwhile
+		delete fresh;
+		e = it->second;
+		++e->pins;
+		lru.splice(lru.begin(), lru, e->lruPos);
+	} else {
+		e = fresh;
+		lru.push_front(chunk);
+		e->lruPos = lru.begin();
+		entries[chunk] = e;
+		cachedBytes += e->data.size();
+		evict();
+	}
+	pthread_mutex_unlock(&mutex);
+	return e->data;
+}
+
+void ChunkCache::release(size_t chunk) {
+	pthread_mutex_lock(&mutex);
+	--entries[chunk]->pins;
+	if (cachedBytes > capacityBytes) {
+		evict();
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Drop unpinned chunks, least recently used first, until the cache is back
+ * within its capacity. Must be called with the mutex held.
+ */
+void ChunkCache::evict() {
+	std::list<size_t>::iterator it = lru.end();
+	while (cachedBytes > capacityBytes && it != lru.begin()) {
+		--it;
+		Entry* e = entries[*it];
+		if (e->pins > 0) {
+			continue;
+		}
+		cachedBytes -= e->data.size();
+		entries.erase(*it);
+		delete e;
+		it = lru.erase(it);
+	}
+}
+
+size_t ChunkCache::getStoredBytesRead() {
+	pthread_mutex_lock(&mutex);
+	size_t n = storedBytesRead;
+	pthread_mutex_unlock(&mutex);
+	return n;
+}
+
+size_t ChunkCache::getHits() {
+	pthread_mutex_lock(&mutex);
+	size_t n = hits;
+	pthread_mutex_unlock(&mutex);
+	return n;
+}
+
+size_t ChunkCache::getMisses() {
+	pthread_mutex_lock(&mutex);
+	size_t n = misses;
+	pthread_mutex_unlock(&mutex);
+	return n;
+}
+} /* namespace rudra */
@@ -0,0 +1,93 @@
+/*
+ * ChunkCache.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_CHUNKCACHE_H_
+#define RUDRA_IO_CHUNKCACHE_H_
+
+#include "rudra/io/ChunkedMatrixFile.h"
+#include <list>
+#include <map>
+#include <vector>
+#include <pthread.h>
+
+namespace rudra {
+/**
+ * A thread-safe LRU cache of the decompressed chunks of a chunked matrix
+ * file, bounded by the total size of the decompressed chunks. Chunks are
+ * pinned while in use and are never evicted while pinned. Decompression
+ * happens outside the cache lock, so several threads can decode different
+ * chunks at once.
+ */
+class ChunkCache {
+public:
+	ChunkCache(const ChunkedMatrixFile& file, size_t capacityBytes);
+	~ChunkCache();
+
+	/**
+	 * Return the decompressed data of the given chunk, reading it if it is
+	 * not cached. The data stays valid until release(chunk) is called.
+	 */
+	const std::vector<char>& acquire(size_t chunk);
+
+	/** Unpin a chunk returned by acquire. */
+	void release(size_t chunk);
+
+	/** Bytes of stored (compressed) chunk data read from the file. */
+	size_t getStoredBytesRead();
+	size_t getHits();
+	size_t getMisses();
+
+private:
+	struct Entry {
+		std::vector<char> data;
+		size_t pins;
+		std::list<size_t>::iterator lruPos;
+	};
+
+	const ChunkedMatrixFile& file;
+	const size_t capacityBytes;
+	std::map<size_t, Entry*> entries;
+	std::list<size_t> lru; // most recently used first
+	size_t cachedBytes;
+	size_t storedBytesRead;
+	size_t hits;
+	size_t misses;
+	pthread_mutex_t mutex;
+
+	void evict();
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_CHUNKCACHE_H_ */
@@ -0,0 +1,334 @@
+/*
+ * ChunkCodec.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/ChunkCodec.h"
+#include <cstring>
+#ifdef RUDRA_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef RUDRA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace rudra {
+
+/*
+ * RLZ stream format, after LZ4's block format: a sequence of
+ *   token, [literal length bytes], literals, offset, [match length bytes]
+ * where the token's high nibble is the number of literals and its low nibble
+ * the match length minus MIN_MATCH, each extended by 255-valued bytes when
+ * it reaches 15, and the offset is two little-endian bytes counting back from
+ * the current output position. The final sequence has literals only.
+ */
+static const size_t MIN_MATCH = 4;
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 14;
+
+static inline uint32_t read32(const char* p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t hash32(uint32_t v) {
+	return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static inline char* writeLength(char* op, size_t len) {
+	while (len >= 255) {
+		*op++ = (char) 255;
+		len -= 255;
+	}
+	*op++ = (char) len;
+	return op;
+}
+
+static size_t rlzBound(size_t srcSize) {
+	return srcSize + srcSize / 255 + 16;
+}
+
+static size_t rlzCompress(const char* src, size_t srcSize, char* dst,
+		size_t dstCapacity) {
+	if (dstCapacity < rlzBound(srcSize)) {
+		return 0;
+	}
+	uint32_t table[1 << HASH_BITS];
+	memset(table, 0, sizeof(table));
+	const char* const end = src + srcSize;
+	// leave room to read four bytes past any match candidate
+	const char* const matchLimit = srcSize > MIN_MATCH ? end - MIN_MATCH : src;
+	const char* anchor = src; // start of pending literals
+	const char* ip = src + 1;
+	char* op = dst;
+
+	while (ip < matchLimit) {
+		const uint32_t h = hash32(read32(ip));
+		const char* ref = src + table[h];
+		table[h] = (uint32_t) (ip - src);
+		if (ref >= ip || (size_t) (ip - ref) > MAX_OFFSET
+				|| read32(ref) != read32(ip)) {
+			++ip;
+			continue;
+		}
+		// extend the match forwards
+		size_t matchLen = MIN_MATCH;
+		while (ip + matchLen < end && ref[matchLen] == ip[matchLen]) {
+			++matchLen;
+		}
+		const size_t litLen = ip - anchor;
+		const size_t ml = matchLen - MIN_MATCH;
+		char* token = op++;
+		*token = (char) (((litLen < 15 ? litLen : 15) << 4)
+				| (ml < 15 ? ml : 15));
+		if (litLen >= 15) {
+			op = writeLength(op, litLen - 15);
+		}
+		memcpy(op, anchor, litLen);
+		op += litLen;
+		const size_t offset = ip - ref;
+		*op++ = (char) (offset & 0xff);
+		*op++ = (char) (offset >> 8);
+		if (ml >= 15) {
+			op = writeLength(op, ml - 15);
+		}
+		ip += matchLen;
+		anchor = ip;
+	}
+
+	// the final literals
+	const size_t litLen = end - anchor;
+	*op++ = (char) ((litLen < 15 ? litLen : 15) << 4);
+	if (litLen >= 15) {
+		op = writeLength(op, litLen - 15);
+	}
+	memcpy(op, anchor, litLen);
+	op += litLen;
+	return op - dst;
+}
+
+static bool readLength(const unsigned char*& ip, const unsigned char* end,
+		size_t& len) {
+	unsigned char b;
+	do {
+		if (ip >= end) {
+			return false;
+		}
+		b = *ip++;
+		len += b;
+	} while (b == 255);
+	return true;
+}
+
+static bool rlzDecompress(const char* src, size_t srcSize, char* dst,
+		size_t rawSize) {
+	const unsigned char* ip = (const unsigned char*) src;
+	const unsigned char* const end = ip + srcSize;
+	char* op = dst;
+	char* const oend = dst + rawSize;
+
+	while (ip < end) {
+		const unsigned char token = *ip++;
+		size_t litLen = token >> 4;
+		if (litLen == 15 && !readLength(ip, end, litLen)) {
+			return false;
+		}
+		if ((size_t) (end - ip) < litLen || (size_t) (oend - op) < litLen) {
+			return false;
+		}
+		memcpy(op, ip, litLen);
+		op += litLen;
+		ip += litLen;
+		if (ip == end) {
+			break; // the final sequence has no match
+		}
+
+		if (end - ip < 2) {
+			return false;
+		}
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		size_t matchLen = token & 15;
+		if (matchLen == 15 && !readLength(ip, end, matchLen)) {
+			return false;
+		}
+		matchLen += MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| (size_t) (oend - op) < matchLen) {
+			return false;
+		}
+		// byte by byte, since the match may overlap its own output
+		const char* ref = op - offset;
+		for (size_t i = 0; i < matchLen; ++i) {
+			op[i] = ref[i];
+		}
+		op += matchLen;
+	}
+	return op == oend;
+}
+
+bool codecAvailable(ChunkCodecType codec) {
+	switch (codec) {
+	case CODEC_NONE:
+	case CODEC_RLZ:
+		return true;
+#ifdef RUDRA_HAVE_LZ4
+	case CODEC_LZ4:
+		return true;
+#endif
+#ifdef RUDRA_HAVE_ZSTD
+	case CODEC_ZSTD:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* codecName(ChunkCodecType codec) {
+	switch (codec) {
+	case CODEC_NONE:
+		return "none";
+	case CODEC_RLZ:
+		return "rlz";
+	case CODEC_LZ4:
+		return "lz4";
+	case CODEC_ZSTD:
+		return "zstd";
+	default:
+		return "unknown";
+	}
+}
+
+ChunkCodecType codecFromName(const std::string& name) {
+	if (name == "rlz") {
+		return CODEC_RLZ;
+	}
+	if (name == "lz4") {
+		return CODEC_LZ4;
+	}
+	if (name == "zstd") {
+		return CODEC_ZSTD;
+	}
+	return CODEC_NONE;
+}
+
+size_t compressBound(ChunkCodecType codec, size_t srcSize) {
+	switch (codec) {
+	case CODEC_RLZ:
+		return rlzBound(srcSize);
+#ifdef RUDRA_HAVE_LZ4
+	case CODEC_LZ4:
+		return LZ4_compressBound(srcSize);
+#endif
+#ifdef RUDRA_HAVE_ZSTD
+	case CODEC_ZSTD:
+		return ZSTD_compressBound(srcSize);
+#endif
+	default:
+		return srcSize;
+	}
+}
+
+size_t compressChunk(ChunkCodecType codec, const char* src, size_t srcSize,
+		char* dst, size_t dstCapacity) {
+	switch (codec) {
+	case CODEC_NONE:
+		if (dstCapacity < srcSize) {
+			return 0;
+		}
+		memcpy(dst, src, srcSize);
+		return srcSize;
+	case CODEC_RLZ:
+		return rlzCompress(src, srcSize, dst, dstCapacity);
+#ifdef RUDRA_HAVE_LZ4
+	case CODEC_LZ4: {
+		int n = LZ4_compress_default(src, dst, srcSize, dstCapacity);
+		return n > 0 ? n : 0;
+	}
+#endif
+#ifdef RUDRA_HAVE_ZSTD
+	case CODEC_ZSTD: {
+		size_t n = ZSTD_compress(dst, dstCapacity, src, srcSize, 3);
+		return ZSTD_isError(n) ? 0 : n;
+	}
+#endif
+	default:
+		return 0;
+	}
+}
+
+bool decompressChunk(ChunkCodecType codec, const char* src, size_t srcSize,
+		char* dst, size_t rawSize) {
+	switch (codec) {
+	case CODEC_NONE:
+		if (srcSize != rawSize) {
+			return false;
+		}
+		memcpy(dst, src, rawSize);
+		return true;
+	case CODEC_RLZ:
+		return rlzDecompress(src, srcSize, dst, rawSize);
+#ifdef RUDRA_HAVE_LZ4
+	case CODEC_LZ4:
+		return LZ4_decompress_safe(src, dst, srcSize, rawSize) == (int) rawSize;
+#endif
+#ifdef RUDRA_HAVE_ZSTD
+	case CODEC_ZSTD:
+		return ZSTD_decompress(dst, rawSize, src, srcSize) == rawSize;
+#endif
+	default:
+		return false;
+	}
+}
+
+void shuffleBytes(const char* src, char* dst, size_t count, size_t elemSize) {
+	for (size_t b = 0; b < elemSize; ++b) {
+		char* out = dst + b * count;
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = src[i * elemSize + b];
+		}
+	}
+}
+
+void unshuffleBytes(const char* src, char* dst, size_t count,
+		size_t elemSize) {
+	for (size_t b = 0; b < elemSize; ++b) {
+		const char* in = src + b * count;
+		for (size_t i = 0; i < count; ++i) {
+			dst[i * elemSize + b] = in[i];
+		}
+	}
+}
+} /* namespace rudra */
@@ -0,0 +1,89 @@
+/*
+ * ChunkCodec.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_CHUNKCODEC_H_
+#define RUDRA_IO_CHUNKCODEC_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+namespace rudra {
+/**
+ * Compression codecs for the chunks of a chunked matrix file.
+ * CODEC_RLZ is a small LZ77 codec built into librudra, so files written
+ * with it can always be read. CODEC_LZ4 and CODEC_ZSTD are only available
+ * if librudra was built with RUDRA_HAVE_LZ4 or RUDRA_HAVE_ZSTD.
+ */
+enum ChunkCodecType {
+	CODEC_NONE = 0, CODEC_RLZ = 1, CODEC_LZ4 = 2, CODEC_ZSTD = 3
+};
+
+bool codecAvailable(ChunkCodecType codec);
+const char* codecName(ChunkCodecType codec);
+
+/** Look up a codec by name; returns CODEC_NONE for "none" or unknown names. */
+ChunkCodecType codecFromName(const std::string& name);
+
+/** The largest compressed size of srcSize bytes, for sizing buffers. */
+size_t compressBound(ChunkCodecType codec, size_t srcSize);
+
+/**
+ * Compress srcSize bytes from src into dst, which has room for dstCapacity
+ * bytes. Returns the compressed size, or 0 if the data did not fit.
+ */
+size_t compressChunk(ChunkCodecType codec, const char* src, size_t srcSize,
+		char* dst, size_t dstCapacity);
+
+/**
+ * Decompress srcSize bytes from src into exactly rawSize bytes at dst.
+ * Returns false if the data is corrupt.
+ */
+bool decompressChunk(ChunkCodecType codec, const char* src, size_t srcSize,
+		char* dst, size_t rawSize);
+
+/**
+ * Transpose count elements of elemSize bytes so that all their first bytes
+ * come first, then all their second bytes and so on. Grouping the bytes of
+ * equal significance makes float data far more compressible.
+ */
+void shuffleBytes(const char* src, char* dst, size_t count, size_t elemSize);
+
+/** Undo shuffleBytes. */
+void unshuffleBytes(const char* src, char* dst, size_t count,
+		size_t elemSize);
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_CHUNKCODEC_H_ */
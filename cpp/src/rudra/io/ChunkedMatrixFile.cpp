@@ -0,0 +1,271 @@
+/*
+ * ChunkedMatrixFile.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/ChunkedMatrixFile.h"
+#include "rudra/io/ReadPlanner.h"
+#include "rudra/util/Logger.h"
+#include <cstring>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace rudra {
+
+static const char CHUNKED_MAGIC[8] = { 'R', 'U', 'D', 'R', 'A', 'B', 'N', 'Z' };
+
+static uint32_t getBE32(const char* p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return be32toh(v);
+}
+
+static uint64_t getBE64(const char* p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return be64toh(v);
+}
+
+static char* putBE32(char* p, uint32_t v) {
+	v = htobe32(v);
+	memcpy(p, &v, sizeof(v));
+	return p + sizeof(v);
+}
+
+static char* putBE64(char* p, uint64_t v) {
+	v = htobe64(v);
+	memcpy(p, &v, sizeof(v));
+	return p + sizeof(v);
+}
+
+ChunkedMatrixFile::ChunkedMatrixFile(const std::string& fileName) :
+		fileName(fileName) {
+	fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		Logger::logFatal("ChunkedMatrixFile: failed to open " + fileName);
+	}
+	char header[CHUNKED_HEADER_SIZE];
+	ReadPlanner::preadFully(fd, header, CHUNKED_HEADER_SIZE, 0);
+	if (memcmp(header, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC)) != 0
+			|| getBE32(header + 8) != CHUNKED_FORMAT_VERSION) {
+		Logger::logFatal(
+				"ChunkedMatrixFile: " + fileName
+						+ " is not a chunked matrix file of a known version");
+	}
+	elemType = (BinFileType) getBE32(header + 12);
+	rows = getBE64(header + 16);
+	cols = getBE64(header + 24);
+	rowsPerChunk = getBE32(header + 32);
+	filter = getBE32(header + 40);
+	numChunks = getBE32(header + 44);
+	const uint64_t indexOffset = getBE64(header + 48);
+	if (binFileTypeSize(elemType) == 0 || rowsPerChunk == 0
+			|| numChunks != (rows + rowsPerChunk - 1) / rowsPerChunk) {
+		Logger::logFatal("ChunkedMatrixFile: corrupt header in " + fileName);
+	}
+
+	std::vector<char> indexData(numChunks * 16);
+	if (numChunks > 0) {
+		ReadPlanner::preadFully(fd, &indexData[0], indexData.size(),
+				indexOffset);
+	}
+	index.resize(numChunks);
+	for (size_t i = 0; i < numChunks; ++i) {
+		const char* p = &indexData[i * 16];
+		index[i].offset = getBE64(p);
+		index[i].storedSize = getBE32(p + 8);
+		index[i].codec = getBE32(p + 12);
+		if (!codecAvailable((ChunkCodecType) index[i].codec)) {
+			Logger::logFatal(
+					std::string("ChunkedMatrixFile: ") + fileName
+							+ " needs codec "
+							+ codecName((ChunkCodecType) index[i].codec)
+							+ ", which this librudra was built without");
+		}
+	}
+}
+
+ChunkedMatrixFile::~ChunkedMatrixFile() {
+	close(fd);
+}
+
+size_t ChunkedMatrixFile::chunkRows(size_t chunk) const {
+	const size_t first = chunk * rowsPerChunk;
+	return rows - first < rowsPerChunk ? rows - first : rowsPerChunk;
+}
+
+void ChunkedMatrixFile::readChunk(size_t chunk, std::vector<char>& raw) const {
+	const IndexEntry& e = index[chunk];
+	const size_t elemSize = binFileTypeSize(elemType);
+	const size_t rawSize = chunkRows(chunk) * rowBytes();
+	std::vector<char> stored(e.storedSize);
+	if (e.storedSize > 0) {
+		ReadPlanner::preadFully(fd, &stored[0], e.storedSize, e.offset);
+	}
+	raw.resize(rawSize);
+	const bool shuffled = (filter & CHUNK_FILTER_SHUFFLE) && elemSize > 1;
+	std::vector<char> tmp(shuffled ? rawSize : 0);
+	char* out = shuffled ? &tmp[0] : &raw[0];
+	if (rawSize > 0
+			&& !decompressChunk((ChunkCodecType) e.codec, &stored[0],
+					e.storedSize, out, rawSize)) {
+		Logger::logFatal("ChunkedMatrixFile: corrupt chunk in " + fileName);
+	}
+	if (shuffled) {
+		unshuffleBytes(&tmp[0], &raw[0], rawSize / elemSize, elemSize);
+	}
+}
+
+bool ChunkedMatrixFile::isChunkedFile(const std::string& fileName) {
+	char magic[sizeof(CHUNKED_MAGIC)];
+	FILE* f = fopen(fileName.c_str(), "rb");
+	if (f == NULL) {
+		return false;
+	}
+	const bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+			&& memcmp(magic, CHUNKED_MAGIC, sizeof(magic)) == 0;
+	fclose(f);
+	return ok;
+}
+
+ChunkedMatrixWriter::ChunkedMatrixWriter(const std::string& fileName,
+		BinFileType elemType, size_t cols, size_t rowsPerChunk,
+		ChunkCodecType codec, bool shuffle) :
+		fileName(fileName), elemType(elemType), cols(cols), rowsPerChunk(
+				rowsPerChunk), codec(codec), shuffle(shuffle), rows(0), storedBytes(
+				0) {
+	if (!codecAvailable(codec)) {
+		Logger::logFatal(
+				std::string("ChunkedMatrixWriter: codec ") + codecName(codec)
+						+ " is not available in this librudra");
+	}
+	if (rowsPerChunk == 0 || binFileTypeSize(elemType) == 0) {
+		Logger::logFatal("ChunkedMatrixWriter: invalid chunk or element type");
+	}
+	file = fopen(fileName.c_str(), "wb");
+	if (file == NULL) {
+		Logger::logFatal("ChunkedMatrixWriter: failed to create " + fileName);
+	}
+	// the header is written last, once the index offset is known
+	char header[CHUNKED_HEADER_SIZE];
+	memset(header, 0, sizeof(header));
+	fwrite(header, 1, sizeof(header), file);
+}
+
+ChunkedMatrixWriter::~ChunkedMatrixWriter() {
+	if (file != NULL) {
+		close();
+	}
+}
+
+void ChunkedMatrixWriter::appendRows(const char* data, size_t numRows) {
+	const size_t rowBytes = cols * binFileTypeSize(elemType);
+	while (numRows > 0) {
+		const size_t have = pending.size() / rowBytes;
+		const size_t take =
+				numRows < rowsPerChunk - have ? numRows : rowsPerChunk - have;
+		pending.insert(pending.end(), data, data + take * rowBytes);
+		data += take * rowBytes;
+		numRows -= take;
+		rows += take;
+		if (pending.size() == rowsPerChunk * rowBytes) {
+			flushChunk();
+		}
+	}
+}
+
+void ChunkedMatrixWriter::flushChunk() {
+	if (pending.empty()) {
+		return;
+	}
+	const size_t elemSize = binFileTypeSize(elemType);
+	const char* src = &pending[0];
+	if (shuffle && elemSize > 1) {
+		shuffled.resize(pending.size());
+		shuffleBytes(&pending[0], &shuffled[0], pending.size() / elemSize,
+				elemSize);
+		src = &shuffled[0];
+	}
+	compressed.resize(compressBound(codec, pending.size()));
+	size_t n = compressChunk(codec, src, pending.size(), &compressed[0],
+			compressed.size());
+	ChunkCodecType used = codec;
+	if (n == 0 || n >= pending.size()) {
+		// incompressible: store as is
+		used = CODEC_NONE;
+		n = pending.size();
+		memcpy(&compressed[0], src, n);
+	}
+
+	char entry[16];
+	char* p = putBE64(entry, (uint64_t) ftell(file));
+	p = putBE32(p, (uint32_t) n);
+	putBE32(p, (uint32_t) used);
+	indexData.insert(indexData.end(), entry, entry + sizeof(entry));
+
+	if (fwrite(&compressed[0], 1, n, file) != n) {
+		Logger::logFatal("ChunkedMatrixWriter: failed to write " + fileName);
+	}
+	storedBytes += n;
+	pending.clear();
+}
+
+void ChunkedMatrixWriter::close() {
+	flushChunk();
+	const uint64_t indexOffset = (uint64_t) ftell(file);
+	if (!indexData.empty()) {
+		fwrite(&indexData[0], 1, indexData.size(), file);
+	}
+
+	char header[CHUNKED_HEADER_SIZE];
+	memcpy(header, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC));
+	char* p = putBE32(header + 8, CHUNKED_FORMAT_VERSION);
+	p = putBE32(p, (uint32_t) elemType);
+	p = putBE64(p, rows);
+	p = putBE64(p, cols);
+	p = putBE32(p, (uint32_t) rowsPerChunk);
+	p = putBE32(p, (uint32_t) codec);
+	p = putBE32(p,
+			shuffle && binFileTypeSize(elemType) > 1 ?
+					CHUNK_FILTER_SHUFFLE : 0);
+	p = putBE32(p, (uint32_t) (indexData.size() / 16));
+	putBE64(p, indexOffset);
+	fseek(file, 0, SEEK_SET);
+	if (fwrite(header, 1, sizeof(header), file) != sizeof(header)
+			|| fclose(file) != 0) {
+		Logger::logFatal("ChunkedMatrixWriter: failed to write " + fileName);
+	}
+	file = NULL;
+}
+} /* namespace rudra */
@@ -0,0 +1,166 @@
+/*
+ * ChunkedMatrixFile.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_CHUNKEDMATRIXFILE_H_
+#define RUDRA_IO_CHUNKEDMATRIXFILE_H_
+
+#include "rudra/io/BinarySampleReader.h"
+#include "rudra/io/ChunkCodec.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace rudra {
+
+/*
+ * A chunked matrix file (extension "binz") holds the same big-endian
+ * elements as a .bin, .bin8 or .bin32 file, cut into chunks of rowsPerChunk
+ * rows that are compressed independently, so that any row can be read by
+ * decompressing only its chunk. The layout is:
+ *
+ *   header       CHUNKED_HEADER_SIZE bytes, see below
+ *   chunks       compressed chunk data, in row order
+ *   index        numChunks entries of {uint64 offset, uint32 storedSize,
+ *                uint32 codec}, where offset is from the start of the file
+ *
+ * The header holds, in order: the 8-byte magic "RUDRABNZ", uint32 version,
+ * uint32 element type (BinFileType), uint64 rows, uint64 cols, uint32
+ * rowsPerChunk, uint32 default codec, uint32 filter flags, uint32 numChunks
+ * and uint64 index offset. All integers are big-endian.
+ * A chunk whose data does not compress is stored with CODEC_NONE.
+ */
+const size_t CHUNKED_HEADER_SIZE = 56;
+const uint32_t CHUNKED_FORMAT_VERSION = 1;
+/** Filter flag: bytes of each chunk's elements were shuffled before compression. */
+const uint32_t CHUNK_FILTER_SHUFFLE = 1;
+
+/** Read access to a chunked matrix file. Safe for concurrent readChunk calls. */
+class ChunkedMatrixFile {
+public:
+	ChunkedMatrixFile(const std::string& fileName);
+	~ChunkedMatrixFile();
+
+	size_t getRows() const {
+		return rows;
+	}
+	size_t getCols() const {
+		return cols;
+	}
+	BinFileType getElemType() const {
+		return elemType;
+	}
+	size_t getRowsPerChunk() const {
+		return rowsPerChunk;
+	}
+	size_t getNumChunks() const {
+		return numChunks;
+	}
+	/** Size in bytes of the elements of one row. */
+	size_t rowBytes() const {
+		return cols * binFileTypeSize(elemType);
+	}
+	/** Number of rows in the given chunk. */
+	size_t chunkRows(size_t chunk) const;
+	/** Size in bytes of the given chunk on disk. */
+	size_t storedSize(size_t chunk) const {
+		return index[chunk].storedSize;
+	}
+
+	/**
+	 * Read and decompress the given chunk into raw, which is resized to hold
+	 * chunkRows(chunk) rows of big-endian elements, as in a .bin file.
+	 */
+	void readChunk(size_t chunk, std::vector<char>& raw) const;
+
+	/** Check whether the named file starts with the chunked matrix magic. */
+	static bool isChunkedFile(const std::string& fileName);
+
+private:
+	struct IndexEntry {
+		uint64_t offset;
+		uint32_t storedSize;
+		uint32_t codec;
+	};
+
+	std::string fileName;
+	int fd;
+	size_t rows;
+	size_t cols;
+	BinFileType elemType;
+	size_t rowsPerChunk;
+	size_t numChunks;
+	uint32_t filter;
+	std::vector<IndexEntry> index;
+};
+
+/** Writes a chunked matrix file one block of rows at a time. */
+class ChunkedMatrixWriter {
+public:
+	ChunkedMatrixWriter(const std::string& fileName, BinFileType elemType,
+			size_t cols, size_t rowsPerChunk, ChunkCodecType codec,
+			bool shuffle);
+	~ChunkedMatrixWriter();
+
+	/** Append numRows rows of big-endian elements, as in a .bin file. */
+	void appendRows(const char* data, size_t numRows);
+
+	/** Flush the last chunk and write the index and header. */
+	void close();
+
+	/** Total bytes of chunk data written so far. */
+	size_t getStoredBytes() const {
+		return storedBytes;
+	}
+
+private:
+	std::string fileName;
+	FILE* file;
+	BinFileType elemType;
+	size_t cols;
+	size_t rowsPerChunk;
+	ChunkCodecType codec;
+	bool shuffle;
+	size_t rows;
+	size_t storedBytes;
+	std::vector<char> pending; // rows of the chunk being filled
+	std::vector<char> shuffled;
+	std::vector<char> compressed;
+	std::vector<char> indexData;
+
+	void flushChunk();
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_CHUNKEDMATRIXFILE_H_ */
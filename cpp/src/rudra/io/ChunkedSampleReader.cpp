@@ -0,0 +1,104 @@
+/*
+ * ChunkedSampleReader.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/ChunkedSampleReader.h"
+#include "rudra/util/ConvertKernels.h"
+#include "rudra/util/Logger.h"
+
+namespace rudra {
+ChunkedSampleReader::ChunkedSampleReader(std::string sampleFileName,
+		std::string labelFileName, size_t cacheBytes) :
+		sampleFile(sampleFileName), labelFile(labelFileName), sampleCache(
+				sampleFile, cacheBytes), labelCache(labelFile, cacheBytes) {
+	if (sampleFile.getRows() != labelFile.getRows()) {
+		Logger::logFatal(
+				"ChunkedSampleReader: " + sampleFileName + " and "
+						+ labelFileName
+						+ " hold different numbers of records");
+	}
+	numSamples = sampleFile.getRows();
+	sizePerSample = sampleFile.getCols();
+	sizePerLabel = labelFile.getCols();
+}
+
+ChunkedSampleReader::~ChunkedSampleReader() {
+}
+
+/**
+ * Copy records idx[i] of the file into dst, converting them to float with
+ * the given mean subtracted and scale applied. Consecutive records from the
+ * same chunk share one cache lookup.
+ */
+void ChunkedSampleReader::gather(const ChunkedMatrixFile& file,
+		ChunkCache& cache, const std::vector<size_t>& idx, float* dst,
+		const float* mean, float scale) {
+	const size_t cols = file.getCols();
+	const size_t rowBytes = file.rowBytes();
+	const size_t rowsPerChunk = file.getRowsPerChunk();
+	const BinFileType type = file.getElemType();
+	if (type == QUANT8) {
+		// the chunked header has no room for the dequantization parameters
+		Logger::logFatal("ChunkedSampleReader: QUANT8 data is not supported");
+	}
+
+	size_t current = (size_t) -1;
+	const std::vector<char>* data = NULL;
+	for (size_t i = 0; i < idx.size(); ++i) {
+		const size_t chunk = idx[i] / rowsPerChunk;
+		if (chunk != current) {
+			if (data != NULL) {
+				cache.release(current);
+			}
+			data = &cache.acquire(chunk);
+			current = chunk;
+		}
+		const char* src = &(*data)[(idx[i] - chunk * rowsPerChunk) * rowBytes];
+		convertRecords(type, src, dst + i * cols, 1, cols, mean, scale, NULL);
+	}
+	if (data != NULL) {
+		cache.release(current);
+	}
+}
+
+void ChunkedSampleReader::readLabelledSamples(const std::vector<size_t>& idx,
+		float* X, float* Y) {
+	gather(sampleFile, sampleCache, idx, X, meanOrNull(), scale);
+	gather(labelFile, labelCache, idx, Y, NULL, 1.0f);
+}
+
+size_t ChunkedSampleReader::getStoredBytesRead() {
+	return sampleCache.getStoredBytesRead() + labelCache.getStoredBytesRead();
+}
+} /* namespace rudra */
@@ -0,0 +1,81 @@
+/*
+ * ChunkedSampleReader.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_CHUNKEDSAMPLEREADER_H_
+#define RUDRA_IO_CHUNKEDSAMPLEREADER_H_
+
+#include "rudra/io/ChunkCache.h"
+#include "rudra/io/ChunkedMatrixFile.h"
+#include "rudra/io/SampleReader.h"
+#include <string>
+#include <vector>
+
+namespace rudra {
+/**
+ * A SampleReader for chunked, compressed sample and label files (see
+ * ChunkedMatrixFile). Only the chunks that hold the records of a minibatch
+ * are read and decompressed, and recently used chunks are kept in a cache,
+ * so minibatches drawn from a few contiguous runs of the file (as with
+ * BlockShuffleSampler) cost little more I/O than the compressed size of the
+ * data they contain.
+ */
+class ChunkedSampleReader: public SampleReader {
+public:
+	/** Default capacity of the decompressed chunk cache, in bytes. */
+	static const size_t DEFAULT_CACHE_BYTES = 256 << 20;
+
+	ChunkedSampleReader(std::string sampleFileName, std::string labelFileName,
+			size_t cacheBytes = DEFAULT_CACHE_BYTES);
+	virtual ~ChunkedSampleReader();
+
+	void readLabelledSamples(const std::vector<size_t>& idx, float* X,
+			float* Y);
+
+	/** Bytes of compressed data read from the sample and label files. */
+	size_t getStoredBytesRead();
+
+private:
+	ChunkedMatrixFile sampleFile;
+	ChunkedMatrixFile labelFile;
+	ChunkCache sampleCache;
+	ChunkCache labelCache;
+
+	static void gather(const ChunkedMatrixFile& file, ChunkCache& cache,
+			const std::vector<size_t>& idx, float* dst, const float* mean,
+			float scale);
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_CHUNKEDSAMPLEREADER_H_ */
@@ -0,0 +1,95 @@
+/*
+ * DataSharding.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/DataSharding.h"
+#include "rudra/util/Logger.h"
+
+namespace rudra {
+bool DataSharding::enabled = false;
+size_t DataSharding::shardIndex = 0;
+size_t DataSharding::numShards = 1;
+size_t DataSharding::residentBytes = 0;
+
+void DataSharding::configure(size_t shardIndex, size_t numShards,
+		size_t residentMB) {
+	if (numShards == 0 || shardIndex >= numShards) {
+		Logger::logFatal("DataSharding: shard index out of range");
+	}
+	DataSharding::enabled = true;
+	DataSharding::shardIndex = shardIndex;
+	DataSharding::numShards = numShards;
+	DataSharding::residentBytes = residentMB << 20;
+	RUDRA_LOG_INFO("DataSharding: training on shard " << shardIndex << " of "
+			<< numShards << ", rotating every epoch");
+}
+
+bool DataSharding::isEnabled() {
+	return enabled;
+}
+
+size_t DataSharding::getShardIndex() {
+	return shardIndex;
+}
+
+size_t DataSharding::getNumShards() {
+	return numShards;
+}
+
+size_t DataSharding::getResidentBytes() {
+	return residentBytes;
+}
+
+size_t DataSharding::shardBegin(size_t shard, size_t numShards,
+		size_t numSamples) {
+	return shard * numSamples / numShards;
+}
+
+size_t DataSharding::maxShardRows(size_t numShards, size_t numSamples) {
+	return (numSamples + numShards - 1) / numShards;
+}
+
+size_t DataSharding::shardOf(size_t row, size_t numShards,
+		size_t numSamples) {
+	size_t shard = row * numShards / numSamples; // a guess, within one
+	while (shard > 0 && shardBegin(shard, numShards, numSamples) > row) {
+		--shard;
+	}
+	while (shard + 1 < numShards
+			&& shardBegin(shard + 1, numShards, numSamples) <= row) {
+		++shard;
+	}
+	return shard;
+}
+} /* namespace rudra */
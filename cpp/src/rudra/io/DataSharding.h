@@ -0,0 +1,90 @@
+/*
+ * DataSharding.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_DATASHARDING_H_
+#define RUDRA_IO_DATASHARDING_H_
+
+#include <cstddef>
+
+namespace rudra {
+/**
+ * Process-wide settings for sharding the training data between learner
+ * places. When sharding is enabled, the data set is cut into numShards
+ * contiguous shards of rows, and in epoch e the place with shard index i
+ * trains only on shard (i + e) % numShards, so the places read disjoint
+ * parts of the file in every epoch and each sees the whole data set over
+ * numShards epochs.
+ * GPFSSampleClients constructed without an explicit Sampler pick these
+ * settings up, so configure() must be called before the learner creates
+ * its sample client.
+ */
+class DataSharding {
+public:
+	/** Default memory budget for keeping shards resident, in megabytes. */
+	static const size_t DEFAULT_RESIDENT_MB = 2048;
+
+	/**
+	 * Enable sharding for this process.
+	 * @param shardIndex index of this place among the learner places
+	 * @param numShards the number of learner places
+	 * @param residentMB memory available for keeping shards resident; shards
+	 *   larger than this are streamed from the file instead
+	 */
+	static void configure(size_t shardIndex, size_t numShards,
+			size_t residentMB = DEFAULT_RESIDENT_MB);
+	static bool isEnabled();
+	static size_t getShardIndex();
+	static size_t getNumShards();
+	static size_t getResidentBytes();
+
+	/** First row of the given shard of a data set of numSamples rows. */
+	static size_t shardBegin(size_t shard, size_t numShards,
+			size_t numSamples);
+
+	/** Number of rows in the largest shard of a data set. */
+	static size_t maxShardRows(size_t numShards, size_t numSamples);
+
+	/** The shard holding the given row. */
+	static size_t shardOf(size_t row, size_t numShards, size_t numSamples);
+
+private:
+	static bool enabled;
+	static size_t shardIndex;
+	static size_t numShards;
+	static size_t residentBytes;
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_DATASHARDING_H_ */
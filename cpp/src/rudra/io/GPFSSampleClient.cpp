@@ -34,48 +34,134 @@
  */
 
 #include "rudra/io/GPFSSampleClient.h"
+#include "rudra/io/DataSharding.h"
 #include "rudra/io/SampleReader.h"
+#include "rudra/io/ShardSampler.h"
+#include "rudra/io/ShardedSampleReader.h"
+#include "rudra/io/ShuffleSampler.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/Metrics.h"
 #include <cstring>
 #include <pthread.h>
 #include <algorithm>
 
 namespace rudra {
 
-GPFSSampleClient::GPFSSampleClient(std::string name, size_t batchSize,
-		SampleReader* reader) :
-		batchSize(batchSize), sampleReader(reader), X(
-				new float[batchSize * reader->sizePerSample]), Y(
-				new float[batchSize * reader->sizePerLabel]), finishedFlag(
-				false), rand(), cursor(0), isRandom(false) {
+/** Wrap the reader to keep this place's shards resident, if sharding. */
+static SampleReader* shardReader(SampleReader* reader) {
+	if (!DataSharding::isEnabled()) {
+		return reader;
+	}
+	return new ShardedSampleReader(reader, DataSharding::getNumShards(),
+			DataSharding::getResidentBytes());
+}
+
+/**
+ * Make a sampler over the whole data set, or over this place's shard if
+ * sharding; random if rand is not NULL, sequential otherwise.
+ */
+static Sampler* makeSampler(size_t numSamples, RudraRand* rand) {
+	if (!DataSharding::isEnabled()) {
+		return rand ?
+				(Sampler*) new ShuffleSampler(numSamples, *rand) :
+				new SequentialSampler(numSamples);
+	}
+	const size_t numShards = DataSharding::getNumShards();
+	const size_t rows = DataSharding::maxShardRows(numShards, numSamples);
+	Sampler* inner =
+			rand ? (Sampler*) new ShuffleSampler(rows, *rand) :
+					new SequentialSampler(rows);
+	return new ShardSampler(numSamples, DataSharding::getShardIndex(),
+			numShards, inner);
+}
+
+GPFSSampleClient::GPFSSampleClient(std::string, size_t batchSize,
+		SampleReader* reader, size_t numBuffers, size_t numProducers) :
+		batchSize(batchSize), numBuffers(numBuffers), numProducers(
+				numProducers), sampleReader(shardReader(reader)), sampler(
+				makeSampler(reader->numSamples, NULL)), finishedFlag(false) {
+	ownedReader = sampleReader == reader ? NULL : sampleReader;
+	this->init();
+}
+
+GPFSSampleClient::GPFSSampleClient(std::string, size_t batchSize,
+		SampleReader* reader, RudraRand rand, size_t numBuffers,
+		size_t numProducers) :
+		batchSize(batchSize), numBuffers(numBuffers), numProducers(
+				numProducers), sampleReader(shardReader(reader)), sampler(
+				makeSampler(reader->numSamples, &rand)), finishedFlag(false) {
+	ownedReader = sampleReader == reader ? NULL : sampleReader;
 	this->init();
 }
 
-GPFSSampleClient::GPFSSampleClient(std::string name, size_t batchSize,
-		SampleReader* reader, RudraRand rand) :
-		batchSize(batchSize), sampleReader(reader), X(
-				new float[batchSize * reader->sizePerSample]), Y(
-				new float[batchSize * reader->sizePerLabel]), finishedFlag(
-				false), rand(rand), cursor(0), isRandom(true) {
+GPFSSampleClient::GPFSSampleClient(std::string, size_t batchSize,
+		SampleReader* reader, Sampler* sampler, size_t numBuffers,
+		size_t numProducers) :
+		batchSize(batchSize), numBuffers(numBuffers), numProducers(
+				numProducers), sampleReader(reader), ownedReader(NULL), sampler(
+				sampler), finishedFlag(false) {
 	this->init();
 }
 
 void GPFSSampleClient::init() {
-	this->count = 0;
+	if (numBuffers == 0) {
+		Logger::logFatal("GPFSSampleClient: need at least one batch buffer");
+	}
+	if (numProducers == 0) {
+		Logger::logFatal("GPFSSampleClient: need at least one producer");
+	}
+	slots.resize(numBuffers);
+	for (size_t i = 0; i < numBuffers; ++i) {
+		slots[i].X = new float[batchSize * sampleReader->sizePerSample];
+		slots[i].Y = new float[batchSize * sampleReader->sizePerLabel];
+		slots[i].idx.resize(batchSize);
+		slots[i].epoch = 0;
+		slots[i].state = SLOT_FREE;
+		slots[i].partsClaimed = 0;
+		slots[i].partsDone = 0;
+	}
+	this->currentEpoch = 0;
+	this->fillPos = 0;
+	this->readPos = 0;
+	this->numParts = std::max((size_t) 1, std::min(numProducers, batchSize));
+	this->splitting = NULL;
 	pthread_mutex_init(&(mutex), NULL);
 	pthread_cond_init(&(fill), NULL);
 	pthread_cond_init(&(empty), NULL);
-	this->startProducerThd();
+	this->startProducerThds();
 }
 
+static Histogram& batchReadTime = Metrics::histogram(
+		"rudra_sample_client_read_seconds",
+		"Time for a producer to read one minibatch, or its part of one");
+static Counter& producerWaits = Metrics::counter(
+		"rudra_sample_client_producer_waits_total",
+		"Times a producer found no free batch buffer");
+static Histogram& producerWaitTime = Metrics::histogram(
+		"rudra_sample_client_producer_wait_seconds",
+		"Time a producer waited for a free batch buffer");
+static Counter& consumerWaits = Metrics::counter(
+		"rudra_sample_client_consumer_waits_total",
+		"Times the learner found no minibatch ready");
+static Histogram& consumerWaitTime = Metrics::histogram(
+		"rudra_sample_client_consumer_wait_seconds",
+		"Time the learner waited for a minibatch to be read");
+static Counter& batchesServed = Metrics::counter(
+		"rudra_sample_client_batches_total",
+		"Minibatches handed to the learner");
+
 struct p_thd_args {
 	GPFSSampleClient *instance;
 };
 
-void GPFSSampleClient::startProducerThd() {
-	p_thd_args *pta = new p_thd_args();
-	pta->instance = this;
-	pthread_create(&producerTID, NULL, &(GPFSSampleClient::producerThdHook),
-			pta);
+void GPFSSampleClient::startProducerThds() {
+	producerTIDs.resize(numProducers);
+	for (size_t i = 0; i < numProducers; ++i) {
+		p_thd_args *pta = new p_thd_args();
+		pta->instance = this;
+		pthread_create(&producerTIDs[i], NULL,
+				&(GPFSSampleClient::producerThdHook), pta);
+	}
 }
 
 void *GPFSSampleClient::producerThdHook(void *args) {
@@ -85,48 +171,122 @@ void *GPFSSampleClient::producerThdHook(void *args) {
 	return NULL;
 }
 
-void GPFSSampleClient::producerThdFunc(void *args) {
-	while (!finishedFlag) {
+void GPFSSampleClient::producerThdFunc(void *) {
+	const size_t sampleSize = sampleReader->sizePerSample;
+	const size_t labelSize = sampleReader->sizePerLabel;
+	std::vector<size_t> partIdx;
+	while (true) {
 		pthread_mutex_lock(&mutex);
-		while ((count == GPFS_BUFFER_COUNT) && !finishedFlag) {
-			pthread_cond_wait(&empty, &mutex);
+		if (splitting == NULL && slots[fillPos % numBuffers].state != SLOT_FREE
+				&& !finishedFlag) {
+			const uint64_t start = metricNanos();
+			producerWaits.add();
+			while (splitting == NULL
+					&& slots[fillPos % numBuffers].state != SLOT_FREE
+					&& !finishedFlag) {
+				pthread_cond_wait(&empty, &mutex);
+			}
+			producerWaitTime.record(metricNanos() - start);
 		}
-		// produce
 		if (finishedFlag) {
+			pthread_mutex_unlock(&mutex);
 			return;
 		}
-
-		std::vector<size_t> idx(batchSize);
-		if (isRandom) {
-			for (size_t i = 0; i < batchSize; ++i) {
-				idx[i] = rand.getLong() % sampleReader->numSamples;
+		// help with the batch being filled before starting another
+		BatchSlot* slot = splitting;
+		if (slot == NULL) {
+			slot = &slots[fillPos++ % numBuffers];
+			slot->state = SLOT_FILLING;
+			// draw indices under the mutex, so batches follow the sampler's
+			// order, and sort them before any part is handed out
+			slot->epoch = sampler->nextBatch(slot->idx);
+			std::sort(slot->idx.begin(), slot->idx.end());
+			slot->partsClaimed = 0;
+			slot->partsDone = 0;
+			if (numParts > 1) {
+				splitting = slot;
+				pthread_cond_broadcast(&empty); // wake producers to help
 			}
-			std::sort(idx.begin(), idx.end());
-		} else {
-			for (size_t i = 0; i < batchSize; ++i) {
-				idx[i] = (cursor++) % sampleReader->numSamples;
+		}
+		const size_t part = slot->partsClaimed++;
+		if (slot->partsClaimed == numParts) {
+			splitting = NULL;
+		}
+		const size_t epoch = slot->epoch;
+		pthread_mutex_unlock(&mutex);
+
+		// produce, without holding the lock
+		const size_t n = slot->idx.size();
+		const size_t lo = n * part / numParts;
+		const size_t hi = n * (part + 1) / numParts;
+		if (lo < hi) {
+			ScopedTimer t(batchReadTime);
+			if (numParts == 1) {
+				sampleReader->readLabelledSamples(slot->idx, slot->X, slot->Y);
+			} else {
+				partIdx.assign(slot->idx.begin() + lo, slot->idx.begin() + hi);
+				sampleReader->readLabelledSamples(partIdx,
+						slot->X + lo * sampleSize, slot->Y + lo * labelSize);
 			}
 		}
 
-		sampleReader->readLabelledSamples(idx, X, Y);
-		count++; // don't forget to increment count
-		pthread_cond_signal(&fill);
+		pthread_mutex_lock(&mutex);
+		const bool ready = ++slot->partsDone == numParts;
+		if (ready) {
+			slot->state = SLOT_READY;
+			pthread_cond_broadcast(&fill);
+		}
 		pthread_mutex_unlock(&mutex);
+		if (ready) {
+			RUDRA_LOG_TRACE("GPFSSampleClient: read batch of " << n
+					<< " samples for epoch " << epoch);
+		}
 	}
-
 }
 
-void GPFSSampleClient::getLabelledSamples(float* samples, float* labels) {
+size_t GPFSSampleClient::acquireLabelledSamples(float*& samples,
+		float*& labels) {
 	pthread_mutex_lock(&mutex);
-	while (count == 0) {
-		pthread_cond_wait(&fill, &mutex);
+	if (slots[readPos % numBuffers].state != SLOT_READY) {
+		const uint64_t start = metricNanos();
+		consumerWaits.add();
+		while (slots[readPos % numBuffers].state != SLOT_READY) {
+			pthread_cond_wait(&fill, &mutex);
+		}
+		consumerWaitTime.record(metricNanos() - start);
 	}
+	size_t handle = readPos++ % numBuffers;
+	slots[handle].state = SLOT_LENT;
+	currentEpoch = slots[handle].epoch;
+	pthread_mutex_unlock(&mutex);
+	batchesServed.add();
+
+	samples = slots[handle].X;
+	labels = slots[handle].Y;
+	return handle;
+}
+
+void GPFSSampleClient::releaseLabelledSamples(size_t handle) {
+	pthread_mutex_lock(&mutex);
+	slots[handle].state = SLOT_FREE;
+	pthread_cond_broadcast(&empty);
+	pthread_mutex_unlock(&mutex);
+}
+
+void GPFSSampleClient::getLabelledSamples(float* samples, float* labels) {
+	float* X;
+	float* Y;
+	size_t handle = acquireLabelledSamples(X, Y);
 	memcpy(samples, X, batchSize * sampleReader->sizePerSample * sizeof(float));
 	memcpy(labels, Y, batchSize * sampleReader->sizePerLabel * sizeof(float));
+	releaseLabelledSamples(handle);
+}
 
-	count--; // don't forget the decrement count
-	pthread_cond_signal(&empty);
+size_t GPFSSampleClient::getEpoch() {
+	pthread_mutex_lock(&mutex);
+	size_t epoch = currentEpoch;
 	pthread_mutex_unlock(&mutex);
+	return epoch;
 }
 
 size_t GPFSSampleClient::getSizePerSample() {
@@ -140,10 +300,19 @@ size_t GPFSSampleClient::getSizePerLabel() {
 GPFSSampleClient::~GPFSSampleClient() {
 	pthread_mutex_lock(&mutex);
 	finishedFlag = true;
-	pthread_cond_signal(&empty);
+	pthread_cond_broadcast(&empty);
 	pthread_mutex_unlock(&mutex);
-	pthread_join(producerTID, NULL); // join the producer thread
-	delete[] X;
-	delete[] Y;
+	for (size_t i = 0; i < numProducers; ++i) {
+		pthread_join(producerTIDs[i], NULL); // join the producer threads
+	}
+	for (size_t i = 0; i < numBuffers; ++i) {
+		delete[] slots[i].X;
+		delete[] slots[i].Y;
+	}
+	delete sampler;
+	delete ownedReader;
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&fill);
+	pthread_cond_destroy(&empty);
 }
 } /* namespace rudra */
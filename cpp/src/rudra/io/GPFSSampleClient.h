@@ -37,48 +37,104 @@
 #define RUDRA_IO_GPFSSAMPLECLIENT_H
 
 #include "rudra/io/SampleClient.h"
+#include "rudra/io/Sampler.h"
 #include "rudra/util/RudraRand.h"
 #include <iostream>
+#include <vector>
 #include <pthread.h>
 
-#define GPFS_BUFFER_COUNT 1
+/** Default number of minibatch buffers in the prefetch ring. */
+#define GPFS_BUFFER_COUNT 2
 
 namespace rudra {
 class SampleReader;
 
+/**
+ * A SampleClient that prefetches minibatches into a ring of numBuffers batch
+ * buffers, using a pool of numProducers I/O threads. With several producers
+ * each batch is split into numProducers parts, each a disjoint range of the
+ * batch's file indices, and an idle producer helps read the parts of the
+ * batch being filled before it claims the next free buffer. Several batches
+ * may still be read at once into disjoint buffers, but batches are always
+ * handed to the consumer in the order in which they were claimed. The mutex
+ * is only held to hand out buffers and parts and to draw and sort indices
+ * from the Sampler, never while reading from disk or copying. The records
+ * within a minibatch are sorted by file index.
+ * The SampleReader must allow concurrent calls to readLabelledSamples when
+ * numProducers > 1.
+ * If DataSharding is enabled, the constructors that do not take a Sampler
+ * read only this place's shard of the data set, keeping it resident in
+ * memory when it fits.
+ */
 class GPFSSampleClient: public SampleClient {
 public:
 	const size_t batchSize;
+	const size_t numBuffers;
+	const size_t numProducers;
 
 	/** Construct a new GPFSSampleClient to read samples in order. */
 	GPFSSampleClient(std::string name, size_t batchSize,
-			SampleReader *sampleReader);
+			SampleReader *sampleReader, size_t numBuffers = GPFS_BUFFER_COUNT,
+			size_t numProducers = 1);
+
+	/**
+	 * Construct a new GPFSSampleClient to read random samples, visiting every
+	 * sample once per epoch in a fresh random order (see ShuffleSampler).
+	 */
+	GPFSSampleClient(std::string name, size_t batchSize,
+			SampleReader *sampleReader, RudraRand rand, size_t numBuffers =
+					GPFS_BUFFER_COUNT, size_t numProducers = 1);
 
-	/** Construct a new GPFSSampleClient to read random samples. */
+	/**
+	 * Construct a new GPFSSampleClient to read samples in the order chosen by
+	 * the given sampler, which the client takes ownership of.
+	 */
 	GPFSSampleClient(std::string name, size_t batchSize,
-			SampleReader *sampleReader, RudraRand rand);
+			SampleReader *sampleReader, Sampler *sampler, size_t numBuffers =
+					GPFS_BUFFER_COUNT, size_t numProducers = 1);
 
 	//@Override
 	void getLabelledSamples(float* samples, float* labels);
+	//@Override
+	size_t acquireLabelledSamples(float*& samples, float*& labels);
+	//@Override
+	void releaseLabelledSamples(size_t handle);
+	//@Override
+	size_t getEpoch();
 	size_t getSizePerSample();
 	size_t getSizePerLabel();
 	~GPFSSampleClient();
 protected:
 	void producerThdFunc(void *args);
 private:
+	enum SlotState {
+		SLOT_FREE, SLOT_FILLING, SLOT_READY, SLOT_LENT
+	};
+	struct BatchSlot {
+		float* X; // training data minibatch
+		float* Y; // training label minibatch
+		std::vector<size_t> idx; // file indices of the records in this batch
+		size_t epoch; // epoch of the first record in this batch
+		SlotState state;
+		size_t partsClaimed; // parts handed to producers while FILLING
+		size_t partsDone; // parts read; the batch is READY once all are
+	};
+
 	SampleReader *sampleReader;
-	float* X; // training data minibatch
-	float* Y; // training label minibatch
-	const bool isRandom;
-	RudraRand rand; // PRNG for random sampling
-	size_t cursor; // file cursor for sequential sampling
+	SampleReader *ownedReader; // sharding wrapper around the given reader
+	std::vector<BatchSlot> slots;
+	size_t fillPos; // next slot to be filled by the producer, modulo numBuffers
+	size_t readPos; // next slot to be lent to the consumer, modulo numBuffers
+	size_t numParts; // parts each batch is split into
+	BatchSlot* splitting; // slot with parts left to claim, or NULL
+	Sampler *sampler;
+	size_t currentEpoch; // epoch of the batch most recently lent
 	volatile bool finishedFlag;
-	volatile int count;
 	pthread_cond_t empty;
 	pthread_cond_t fill;
 	pthread_mutex_t mutex;
-	pthread_t producerTID; //producer thread id
-	void startProducerThd();
+	std::vector<pthread_t> producerTIDs; //producer thread ids
+	void startProducerThds();
 	static void* producerThdHook(void *args);
 	void init();
 };
@@ -0,0 +1,125 @@
+/*
+ * MmapSampleReader.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/MmapSampleReader.h"
+#include "rudra/util/Logger.h"
+#include <stdint.h>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace rudra {
+MmapSampleReader::MmapSampleReader(std::string sampleFileName,
+		std::string labelFileName, bool randomAccess) :
+		BinarySampleReader(sampleFileName, labelFileName, false) {
+	dataMap = mapFile(trainingDataFile,
+			binDataOffset(trainingDataFileType, sizePerSample)
+					+ numSamples * sizePerSample
+							* binFileTypeSize(trainingDataFileType),
+			dataMapSize, randomAccess);
+	// labels are small, so fault them all in up front
+	labelMap = mapFile(trainingLabelFile,
+			binDataOffset(trainingLabelFileType, sizePerLabel)
+					+ numSamples * sizePerLabel
+							* binFileTypeSize(trainingLabelFileType),
+			labelMapSize, randomAccess);
+	madvise((void*) labelMap, labelMapSize, MADV_WILLNEED);
+}
+
+MmapSampleReader::~MmapSampleReader() {
+	munmap((void*) dataMap, dataMapSize);
+	munmap((void*) labelMap, labelMapSize);
+}
+
+/**
+ * Map the whole of the named file read-only, checking that it holds at least
+ * expectedSize bytes.
+ */
+const char* MmapSampleReader::mapFile(const std::string& fileName,
+		size_t expectedSize, size_t& mapSize, bool randomAccess) {
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		Logger::logFatal("MmapSampleReader: failed to open " + fileName);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < expectedSize) {
+		close(fd);
+		Logger::logFatal(
+				"MmapSampleReader: " + fileName
+						+ " is shorter than its header says");
+	}
+	mapSize = st.st_size;
+	void* map = mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps its own reference to the file
+	if (map == MAP_FAILED) {
+		Logger::logFatal("MmapSampleReader: failed to map " + fileName);
+	}
+	madvise(map, mapSize, randomAccess ? MADV_RANDOM : MADV_SEQUENTIAL);
+	return (const char*) map;
+}
+
+/**
+ * Copy the chosen records out of the mapping into dst, converting each
+ * element to float (and to host byte order) as it is copied, with the given
+ * mean subtracted and scale applied. Each run of consecutive indices is
+ * converted in one call.
+ */
+void MmapSampleReader::gatherRecords(const char* map, BinFileType type,
+		const std::vector<size_t>& idx, size_t recordSize, float* dst,
+		const float* mean, float scale, const QuantParams* quant) {
+	const size_t recordBytes = recordSize * binFileTypeSize(type);
+	const char* data = map + binDataOffset(type, recordSize);
+	for (size_t i = 0; i < idx.size();) {
+		size_t run = 1;
+		while (i + run < idx.size() && idx[i + run] == idx[i] + run) {
+			++run;
+		}
+		convertRecords(type, data + idx[i] * recordBytes, dst + i * recordSize,
+				run, recordSize, mean, scale, quant);
+		i += run;
+	}
+}
+
+void MmapSampleReader::readLabelledSamples(const std::vector<size_t>& idx,
+		float* X, float* Y) {
+	gatherRecords(dataMap, trainingDataFileType, idx, sizePerSample, X,
+			meanOrNull(), scale, &dataQuant);
+	gatherRecords(labelMap, trainingLabelFileType, idx, sizePerLabel, Y, NULL,
+			1.0f, &labelQuant);
+}
+
+} /* namespace rudra */
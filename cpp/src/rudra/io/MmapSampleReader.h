@@ -0,0 +1,80 @@
+/*
+ * MmapSampleReader.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_MMAPSAMPLEREADER_H_
+#define RUDRA_IO_MMAPSAMPLEREADER_H_
+
+#include "rudra/io/BinarySampleReader.h"
+#include <string>
+#include <vector>
+
+namespace rudra {
+/**
+ * A BinarySampleReader that maps the sample and label files into memory once
+ * at construction, and gathers records straight out of the mappings.
+ * Byte-swapping and conversion to float are done in a single pass from the
+ * mapping into the destination matrices, so no intermediate buffer or
+ * per-record system call is needed. The files are not kept open.
+ * SampleReader::makeReader returns one when RUDRA_MMAP_READER is set to 1.
+ */
+class MmapSampleReader: public BinarySampleReader {
+public:
+	/**
+	 * @param randomAccess true if records will be read in random order,
+	 *   false if they will be read sequentially; used to advise the kernel
+	 *   on read-ahead for the mappings
+	 */
+	MmapSampleReader(std::string sampleFileName, std::string labelFileName,
+			bool randomAccess);
+	virtual ~MmapSampleReader();
+
+	void readLabelledSamples(const std::vector<size_t>& idx, float* X,
+			float* Y);
+
+private:
+	const char* dataMap;
+	size_t dataMapSize;
+	const char* labelMap;
+	size_t labelMapSize;
+
+	static const char* mapFile(const std::string& fileName,
+			size_t expectedSize, size_t& mapSize, bool randomAccess);
+	static void gatherRecords(const char* map, BinFileType type,
+			const std::vector<size_t>& idx, size_t recordSize, float* dst,
+			const float* mean, float scale, const QuantParams* quant);
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_MMAPSAMPLEREADER_H_ */
@@ -0,0 +1,203 @@
+/*
+ * ReadPlanner.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/ReadPlanner.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/Metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace rudra {
+
+static Counter& readCalls = Metrics::counter("rudra_io_read_calls_total",
+		"Read system calls made for sample data");
+static Counter& readBytes = Metrics::counter("rudra_io_read_bytes_total",
+		"Bytes of sample data read, including gaps read through");
+static Histogram& readCallTime = Metrics::histogram(
+		"rudra_io_read_call_seconds", "Time spent in each read system call");
+
+ReadPlanner::ReadPlanner(size_t recordBytes, size_t dataOffset,
+		size_t maxGapBytes) :
+		recordBytes(recordBytes), dataOffset(dataOffset), maxGapRecords(
+				maxGapBytes / recordBytes) {
+}
+
+ReadPlanner::ReadPlanner(size_t recordBytes, size_t dataOffset) :
+		recordBytes(recordBytes), dataOffset(dataOffset), maxGapRecords(
+				defaultMaxReadGap(recordBytes) / recordBytes) {
+}
+
+void ReadPlanner::plan(const std::vector<size_t>& idx,
+		std::vector<ReadExtent>& extents) const {
+	extents.clear();
+	size_t i = 0;
+	while (i < idx.size()) {
+		ReadExtent e;
+		e.first = i;
+		e.firstRecord = idx[i];
+		size_t hi = idx[i];
+		size_t j = i + 1;
+		// extend while records ascend (or repeat) with a small enough gap
+		while (j < idx.size() && idx[j] >= hi
+				&& idx[j] - hi <= maxGapRecords + 1) {
+			hi = idx[j++];
+		}
+		e.last = j;
+		e.numRecords = hi - e.firstRecord + 1;
+		extents.push_back(e);
+		i = j;
+	}
+}
+
+/**
+ * Fill the given iovecs from the file starting at offset, retrying after
+ * short reads.
+ */
+static void preadvFully(int fd, struct iovec* iov, int iovcnt, off_t offset) {
+	while (iovcnt > 0) {
+		const uint64_t start = metricNanos();
+#ifdef RUDRA_NO_PREADV
+		ssize_t n = pread(fd, iov->iov_base, iov->iov_len, offset);
+#else
+		ssize_t n = preadv(fd, iov, iovcnt, offset);
+#endif
+		readCallTime.record(metricNanos() - start);
+		readCalls.add();
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			std::ostringstream msg;
+			msg << "ReadPlanner: read failed at offset " << offset << ": "
+					<< strerror(errno);
+			Logger::logFatal(msg.str());
+		}
+		if (n == 0) {
+			std::ostringstream msg;
+			msg << "ReadPlanner: unexpected end of file at offset " << offset;
+			Logger::logFatal(msg.str());
+		}
+		readBytes.add(n);
+		offset += n;
+		size_t left = n;
+		while (left > 0) {
+			if (left >= iov->iov_len) {
+				left -= iov->iov_len;
+				++iov;
+				--iovcnt;
+			} else {
+				iov->iov_base = (char*) iov->iov_base + left;
+				iov->iov_len -= left;
+				left = 0;
+			}
+		}
+	}
+}
+
+void ReadPlanner::preadFully(int fd, char* dst, size_t bytes, size_t offset) {
+	if (bytes == 0) {
+		return;
+	}
+	struct iovec iov;
+	iov.iov_base = dst;
+	iov.iov_len = bytes;
+	preadvFully(fd, &iov, 1, offset);
+}
+
+void ReadPlanner::readExtent(int fd, const std::vector<size_t>& idx,
+		const ReadExtent& e, char* dst, char* sink) const {
+	std::vector<struct iovec> iov;
+	for (size_t k = e.first; k < e.last; ++k) {
+		if (k > e.first && idx[k] == idx[k - 1]) {
+			continue; // duplicate, copied once the extent has been read
+		}
+		if (k > e.first && idx[k] > idx[k - 1] + 1) {
+			struct iovec gap;
+			gap.iov_base = sink;
+			gap.iov_len = (idx[k] - idx[k - 1] - 1) * recordBytes;
+			iov.push_back(gap);
+		}
+		char* p = dst + k * recordBytes;
+		if (!iov.empty() && iov.back().iov_base != sink
+				&& (char*) iov.back().iov_base + iov.back().iov_len == p) {
+			iov.back().iov_len += recordBytes; // contiguous in dst too
+		} else {
+			struct iovec rec;
+			rec.iov_base = p;
+			rec.iov_len = recordBytes;
+			iov.push_back(rec);
+		}
+	}
+
+	off_t offset = dataOffset + e.firstRecord * recordBytes;
+	for (size_t i = 0; i < iov.size(); i += IOV_MAX) {
+		int n = std::min(iov.size() - i, (size_t) IOV_MAX);
+		size_t bytes = 0;
+		for (int j = 0; j < n; ++j) {
+			bytes += iov[i + j].iov_len;
+		}
+		preadvFully(fd, &iov[i], n, offset);
+		offset += bytes;
+	}
+
+	for (size_t k = e.first + 1; k < e.last; ++k) {
+		if (idx[k] == idx[k - 1]) {
+			memcpy(dst + k * recordBytes, dst + (k - 1) * recordBytes,
+					recordBytes);
+		}
+	}
+}
+
+void ReadPlanner::readRecords(int fd, const std::vector<size_t>& idx,
+		char* dst) const {
+	std::vector<ReadExtent> extents;
+	plan(idx, extents);
+	std::vector<char> sink(maxGapRecords * recordBytes);
+	for (size_t i = 0; i < extents.size(); ++i) {
+		readExtent(fd, idx, extents[i], dst, sink.empty() ? NULL : &sink[0]);
+	}
+}
+
+} /* namespace rudra */
@@ -43,7 +43,27 @@ namespace rudra {
 class SampleClient {
 public:
 	virtual size_t getSizePerLabel() = 0;
+	/** Copy the next minibatch of samples and labels into the given arrays. */
 	virtual void getLabelledSamples(float* samples, float* labels) = 0;
+
+	/**
+	 * Borrow the next minibatch without copying it. On return, samples and
+	 * labels point into a buffer owned by the client, which stays valid
+	 * until the returned handle is passed to releaseLabelledSamples().
+	 * A consumer may hold several minibatches at once, but the client cannot
+	 * refill a buffer until it is released.
+	 */
+	virtual size_t acquireLabelledSamples(float*& samples, float*& labels) = 0;
+
+	/** Return a minibatch borrowed by acquireLabelledSamples to the client. */
+	virtual void releaseLabelledSamples(size_t handle) = 0;
+
+	/**
+	 * The epoch (zero-based pass over the data set) of the minibatch most
+	 * recently returned; a minibatch that straddles two epochs belongs to the
+	 * first.
+	 */
+	virtual size_t getEpoch() = 0;
 	virtual ~SampleClient() {}
 };
 } /* namespace rudra */
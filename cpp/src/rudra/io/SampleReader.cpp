@@ -0,0 +1,86 @@
+/*
+ * SampleReader.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/SampleReader.h"
+#include "rudra/io/BinaryMatrixReader.h"
+#include "rudra/io/BinarySampleReader.h"
+#include "rudra/io/ChunkedSampleReader.h"
+#include "rudra/io/MmapSampleReader.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/MatrixContainer.h"
+#include <cstring>
+
+namespace rudra {
+static bool hasExtension(const std::string& fileName, const std::string& ext) {
+	size_t i = fileName.rfind('.');
+	return i != std::string::npos && fileName.compare(i + 1, ext.size() + 1,
+			ext) == 0;
+}
+
+void SampleReader::setMeanFile(const std::string& fileName) {
+	MatrixContainer<float> m =
+			hasExtension(fileName, "bin") ?
+					readBinMat<float>(fileName) : readMat(fileName);
+	if (m.dimM * m.dimN != sizePerSample) {
+		Logger::logFatal(
+				"SampleReader: mean file " + fileName
+						+ " does not match the sample size");
+	}
+	mean.assign(m.buf, m.buf + sizePerSample);
+	normalizationChanged();
+}
+
+void SampleReader::setScale(float scale) {
+	this->scale = scale;
+	normalizationChanged();
+}
+
+static bool mmapFromEnv() {
+	const char* env = getenv("RUDRA_MMAP_READER");
+	return env != NULL && strcmp(env, "1") == 0;
+}
+
+SampleReader* SampleReader::makeReader(const std::string& sampleFileName,
+		const std::string& labelFileName, bool randomAccess) {
+	if (hasExtension(sampleFileName, "binz")) {
+		return new ChunkedSampleReader(sampleFileName, labelFileName);
+	}
+	if (mmapFromEnv()) {
+		return new MmapSampleReader(sampleFileName, labelFileName,
+				randomAccess);
+	}
+	return new BinarySampleReader(sampleFileName, labelFileName);
+}
+} /* namespace rudra */
@@ -51,13 +51,41 @@ public:
 	size_t sizePerSample;
 	size_t sizePerLabel;
 
-	SampleReader() {
+	SampleReader() :
+			scale(1.0f) {
 	}
 	virtual ~SampleReader() {}
 
+	/**
+	 * Read the samples with the given indices into X, and the corresponding
+	 * labels into Y. Implementations should allow concurrent calls from
+	 * several threads, each reading into its own X and Y.
+	 */
 	virtual void readLabelledSamples(const std::vector<size_t>& idx, float* X,
 			float* Y) = 0;
 
+	/**
+	 * Subtract the per-feature mean read from the given file (binary if its
+	 * extension is "bin", text otherwise) from every sample as it is read.
+	 * The file must hold exactly sizePerSample values.
+	 */
+	void setMeanFile(const std::string& fileName);
+
+	/** Multiply every sample by scale (after mean subtraction) as it is read. */
+	void setScale(float scale);
+
+	/**
+	 * Open a reader for the given sample and label files, choosing the
+	 * implementation from the extension of the sample file. Binary files
+	 * are read with preadv, or through memory mappings (MmapSampleReader)
+	 * if the environment variable RUDRA_MMAP_READER is set to 1.
+	 * @param randomAccess true if minibatches will be drawn in random order
+	 *   (as by a ShuffleSampler), false if the file will be read from front
+	 *   to back; a mapped reader advises the kernel on read-ahead by it
+	 */
+	static SampleReader* makeReader(const std::string& sampleFileName,
+			const std::string& labelFileName, bool randomAccess);
+
 	/**
 	 * Read the number of rows and columns from the header of the given binary
 	 * file.  The number of rows is stored in bytes 0-3 and the number of columns
@@ -90,6 +118,21 @@ public:
 		rows = r1;
 		cols = c1;
 	}
+
+protected:
+	std::vector<float> mean; // per-feature mean, or empty for none
+	float scale;
+
+	/** The mean to pass to the conversion kernels, or NULL if none is set. */
+	const float* meanOrNull() const {
+		return mean.empty() ? NULL : &mean[0];
+	}
+	/**
+	 * Called after setMeanFile or setScale, for readers that precompute
+	 * anything from the mean and scale.
+	 */
+	virtual void normalizationChanged() {
+	}
 };
 } // namespace rudra
 
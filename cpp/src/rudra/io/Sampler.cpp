@@ -0,0 +1,85 @@
+/*
+ * Sampler.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/Sampler.h"
+#include "rudra/util/Logger.h"
+
+namespace rudra {
+Sampler::Sampler(size_t numSamples) :
+		numSamples(numSamples), epoch(0), pos(0), started(false) {
+	if (numSamples == 0) {
+		Logger::logFatal("Sampler: the data set is empty");
+	}
+}
+
+size_t Sampler::nextBatch(std::vector<size_t>& idx) {
+	const size_t first = getEpoch();
+	for (size_t i = 0; i < idx.size(); ++i) {
+		if (!started || pos == numSamples) {
+			epoch = started ? epoch + 1 : 0;
+			started = true;
+			pos = 0;
+			beginEpoch(epoch);
+		}
+		idx[i] = next();
+		++pos;
+	}
+	return first;
+}
+
+size_t Sampler::getEpoch() const {
+	return started && pos == numSamples ? epoch + 1 : epoch;
+}
+
+uint64_t Sampler::randomBits(RudraRand& rand) {
+	return rand.next64() >> 2;
+}
+
+uint64_t Sampler::uniform(RudraRand& rand, uint64_t bound) {
+	return rand.uniform(bound);
+}
+
+SequentialSampler::SequentialSampler(size_t numSamples) :
+		Sampler(numSamples), cursor(0) {
+}
+
+void SequentialSampler::beginEpoch(size_t) {
+	cursor = 0;
+}
+
+size_t SequentialSampler::next() {
+	return cursor++;
+}
+} /* namespace rudra */
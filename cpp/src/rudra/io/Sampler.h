@@ -0,0 +1,123 @@
+/*
+ * Sampler.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_SAMPLER_H_
+#define RUDRA_IO_SAMPLER_H_
+
+#include "rudra/util/RudraRand.h"
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace rudra {
+/**
+ * Chooses the file indices of the records that make up each minibatch.
+ * A sampler visits the records of the data set in some order, one epoch at a
+ * time: every epoch is a single pass over all numSamples records. A
+ * minibatch that straddles the end of an epoch takes its remaining records
+ * from the start of the next one.
+ * Samplers are not thread-safe; GPFSSampleClient only calls them with its
+ * mutex held.
+ */
+class Sampler {
+public:
+	const size_t numSamples;
+
+	Sampler(size_t numSamples);
+	virtual ~Sampler() {
+	}
+
+	/**
+	 * Fill idx with the file indices of the next idx.size() records.
+	 * @return the epoch of the first record in the batch
+	 */
+	size_t nextBatch(std::vector<size_t>& idx);
+
+	/** The epoch to which the next record drawn belongs. */
+	size_t getEpoch() const;
+
+protected:
+	/** Prepare the visiting order for the given epoch. */
+	virtual void beginEpoch(size_t epoch) = 0;
+
+	/** Return the next record in the visiting order of the current epoch. */
+	virtual size_t next() = 0;
+
+	/** Return a uniformly distributed integer in [0, bound). */
+	static uint64_t uniform(RudraRand& rand, uint64_t bound);
+
+	/** Return 62 random bits. */
+	static uint64_t randomBits(RudraRand& rand);
+
+	/**
+	 * Shuffle v in place with a Fisher-Yates shuffle, drawing the random
+	 * words in bulk.
+	 */
+	template<class T>
+	static void shuffle(RudraRand& rand, std::vector<T>& v) {
+		const size_t CHUNK = 1024;
+		uint64_t words[CHUNK];
+		size_t left = 0;
+		for (size_t i = v.size(); i > 1; --i) {
+			if (left == 0) {
+				left = std::min(CHUNK, i - 1);
+				rand.fill(words, left);
+			}
+			std::swap(v[i - 1], v[rand.uniformFrom(words[--left], i)]);
+		}
+	}
+
+private:
+	size_t epoch;
+	size_t pos; // position within the current epoch
+	bool started;
+};
+
+/** Visits the records in file order, every epoch. */
+class SequentialSampler: public Sampler {
+public:
+	SequentialSampler(size_t numSamples);
+
+protected:
+	void beginEpoch(size_t epoch);
+	size_t next();
+
+private:
+	size_t cursor;
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_SAMPLER_H_ */
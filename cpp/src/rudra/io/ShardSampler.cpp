@@ -0,0 +1,71 @@
+/*
+ * ShardSampler.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/ShardSampler.h"
+#include "rudra/io/DataSharding.h"
+#include "rudra/util/Logger.h"
+
+namespace rudra {
+ShardSampler::ShardSampler(size_t numSamples, size_t shardIndex,
+		size_t numShards, Sampler* inner) :
+		Sampler(DataSharding::maxShardRows(numShards, numSamples)), fileSamples(
+				numSamples), shardIndex(shardIndex), numShards(numShards), inner(
+				inner), one(1), begin(0), rows(0) {
+	if (numShards > numSamples) {
+		Logger::logFatal("ShardSampler: more shards than samples");
+	}
+	if (inner->numSamples != this->numSamples) {
+		Logger::logFatal("ShardSampler: inner sampler has the wrong size");
+	}
+}
+
+ShardSampler::~ShardSampler() {
+	delete inner;
+}
+
+void ShardSampler::beginEpoch(size_t epoch) {
+	const size_t shard = (shardIndex + epoch) % numShards;
+	begin = DataSharding::shardBegin(shard, numShards, fileSamples);
+	rows = DataSharding::shardBegin(shard + 1, numShards, fileSamples) - begin;
+}
+
+size_t ShardSampler::next() {
+	// the inner sampler moves to its next epoch in step with this one.
+	// Scale its draw into the shard rather than wrapping it, so that in a
+	// short shard the repeated row is any row, not always the first.
+	inner->nextBatch(one);
+	return begin + (size_t) ((uint64_t) one[0] * rows / numSamples);
+}
+} /* namespace rudra */
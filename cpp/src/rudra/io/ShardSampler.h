@@ -0,0 +1,75 @@
+/*
+ * ShardSampler.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_SHARDSAMPLER_H_
+#define RUDRA_IO_SHARDSAMPLER_H_
+
+#include "rudra/io/Sampler.h"
+#include <vector>
+
+namespace rudra {
+/**
+ * Visits one shard of the data set per epoch, moving to the next shard at
+ * each epoch (see DataSharding). The order within a shard is chosen by an
+ * inner sampler over DataSharding::maxShardRows rows; shards one row short
+ * of the largest repeat one of their rows in that epoch.
+ * Indices returned are rows of the whole file.
+ */
+class ShardSampler: public Sampler {
+public:
+	/**
+	 * @param inner sampler over maxShardRows(numShards, numSamples) rows,
+	 *   which this sampler takes ownership of
+	 */
+	ShardSampler(size_t numSamples, size_t shardIndex, size_t numShards,
+			Sampler* inner);
+	~ShardSampler();
+
+protected:
+	void beginEpoch(size_t epoch);
+	size_t next();
+
+private:
+	const size_t fileSamples;
+	const size_t shardIndex;
+	const size_t numShards;
+	Sampler* inner;
+	std::vector<size_t> one;
+	size_t begin; // first row of the current shard
+	size_t rows; // number of rows in the current shard
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_SHARDSAMPLER_H_ */
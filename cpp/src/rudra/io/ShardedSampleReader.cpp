@@ -0,0 +1,199 @@
+/*
+ * ShardedSampleReader.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/ShardedSampleReader.h"
+#include "rudra/io/DataSharding.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/Metrics.h"
+#include <algorithm>
+#include <cstring>
+
+namespace rudra {
+const size_t ShardedSampleReader::LOAD_CHUNK_ROWS;
+
+static Histogram& shardLoadTime = Metrics::histogram(
+		"rudra_shard_load_seconds", "Time to load one shard into memory");
+
+ShardedSampleReader::ShardedSampleReader(SampleReader* reader,
+		size_t numShards, size_t residentBytes) :
+		reader(reader), numShards(numShards), loadClock(0) {
+	numSamples = reader->numSamples;
+	sizePerSample = reader->sizePerSample;
+	sizePerLabel = reader->sizePerLabel;
+
+	const size_t maxRows = DataSharding::maxShardRows(numShards, numSamples);
+	const size_t shardBytes = maxRows * (sizePerSample + sizePerLabel)
+			* sizeof(float);
+	const size_t numResident = std::min((size_t) 2, residentBytes / shardBytes);
+	if (numResident == 0) {
+		Logger::logWarning(
+				"ShardedSampleReader: shard does not fit in memory, streaming it");
+	}
+	resident.resize(numResident);
+	for (size_t i = 0; i < numResident; ++i) {
+		resident[i].shard = NO_SHARD;
+		resident[i].begin = resident[i].rows = resident[i].loadTime = 0;
+		resident[i].X = new float[maxRows * sizePerSample];
+		resident[i].Y = new float[maxRows * sizePerLabel];
+	}
+	pthread_rwlock_init(&lock, NULL);
+}
+
+ShardedSampleReader::~ShardedSampleReader() {
+	for (size_t i = 0; i < resident.size(); ++i) {
+		delete[] resident[i].X;
+		delete[] resident[i].Y;
+	}
+	pthread_rwlock_destroy(&lock);
+}
+
+const ShardedSampleReader::ResidentShard* ShardedSampleReader::findResident(
+		size_t shard) const {
+	for (size_t i = 0; i < resident.size(); ++i) {
+		if (resident[i].shard == shard) {
+			return &resident[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Load the given shard in place of the oldest resident shard that the
+ * current minibatch does not need. Must be called with the write lock held.
+ */
+void ShardedSampleReader::loadShard(size_t shard,
+		const std::vector<size_t>& needed) {
+	ScopedTimer t(shardLoadTime);
+	ResidentShard* victim = NULL;
+	for (size_t i = 0; i < resident.size(); ++i) {
+		if (std::find(needed.begin(), needed.end(), resident[i].shard)
+				!= needed.end()) {
+			continue;
+		}
+		if (victim == NULL || resident[i].loadTime < victim->loadTime) {
+			victim = &resident[i];
+		}
+	}
+	if (victim == NULL) {
+		return; // no room; the shard's records will be streamed
+	}
+
+	victim->shard = NO_SHARD;
+	victim->begin = DataSharding::shardBegin(shard, numShards, numSamples);
+	victim->rows = DataSharding::shardBegin(shard + 1, numShards, numSamples)
+			- victim->begin;
+	std::vector<size_t> idx;
+	for (size_t r = 0; r < victim->rows; r += LOAD_CHUNK_ROWS) {
+		const size_t n = std::min(LOAD_CHUNK_ROWS, victim->rows - r);
+		idx.resize(n);
+		for (size_t i = 0; i < n; ++i) {
+			idx[i] = victim->begin + r + i;
+		}
+		reader->readLabelledSamples(idx, victim->X + r * sizePerSample,
+				victim->Y + r * sizePerLabel);
+	}
+	victim->shard = shard;
+	victim->loadTime = ++loadClock;
+
+	RUDRA_LOG_INFO("ShardedSampleReader: loaded shard " << shard << " ("
+			<< victim->rows << " rows)");
+}
+
+void ShardedSampleReader::readLabelledSamples(const std::vector<size_t>& idx,
+		float* X, float* Y) {
+	if (resident.empty()) {
+		reader->readLabelledSamples(idx, X, Y);
+		return;
+	}
+
+	std::vector<size_t> needed;
+	for (size_t i = 0; i < idx.size(); ++i) {
+		size_t shard = DataSharding::shardOf(idx[i], numShards, numSamples);
+		if (std::find(needed.begin(), needed.end(), shard) == needed.end()) {
+			needed.push_back(shard);
+		}
+	}
+
+	pthread_rwlock_rdlock(&lock);
+	bool missing = false;
+	for (size_t s = 0; s < needed.size(); ++s) {
+		missing = missing || findResident(needed[s]) == NULL;
+	}
+	if (missing) {
+		pthread_rwlock_unlock(&lock);
+		pthread_rwlock_wrlock(&lock);
+		for (size_t s = 0; s < needed.size(); ++s) {
+			if (findResident(needed[s]) == NULL) {
+				loadShard(needed[s], needed);
+			}
+		}
+		pthread_rwlock_unlock(&lock);
+		pthread_rwlock_rdlock(&lock);
+	}
+
+	// copy what is resident, and stream the rest
+	std::vector<size_t> streamed; // positions in idx
+	for (size_t i = 0; i < idx.size(); ++i) {
+		const ResidentShard* rs = findResident(
+				DataSharding::shardOf(idx[i], numShards, numSamples));
+		if (rs == NULL) {
+			streamed.push_back(i);
+			continue;
+		}
+		const size_t row = idx[i] - rs->begin;
+		memcpy(X + i * sizePerSample, rs->X + row * sizePerSample,
+				sizePerSample * sizeof(float));
+		memcpy(Y + i * sizePerLabel, rs->Y + row * sizePerLabel,
+				sizePerLabel * sizeof(float));
+	}
+	pthread_rwlock_unlock(&lock);
+
+	if (!streamed.empty()) {
+		std::vector<size_t> subIdx(streamed.size());
+		for (size_t i = 0; i < streamed.size(); ++i) {
+			subIdx[i] = idx[streamed[i]];
+		}
+		std::vector<float> subX(streamed.size() * sizePerSample);
+		std::vector<float> subY(streamed.size() * sizePerLabel);
+		reader->readLabelledSamples(subIdx, &subX[0], &subY[0]);
+		for (size_t i = 0; i < streamed.size(); ++i) {
+			memcpy(X + streamed[i] * sizePerSample, &subX[i * sizePerSample],
+					sizePerSample * sizeof(float));
+			memcpy(Y + streamed[i] * sizePerLabel, &subY[i * sizePerLabel],
+					sizePerLabel * sizeof(float));
+		}
+	}
+}
+} /* namespace rudra */
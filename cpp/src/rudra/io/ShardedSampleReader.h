@@ -0,0 +1,91 @@
+/*
+ * ShardedSampleReader.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_SHARDEDSAMPLEREADER_H_
+#define RUDRA_IO_SHARDEDSAMPLEREADER_H_
+
+#include "rudra/io/SampleReader.h"
+#include <vector>
+#include <pthread.h>
+
+namespace rudra {
+/**
+ * A SampleReader that keeps whole shards of another reader's data set
+ * resident in memory (see DataSharding). A shard is loaded with large
+ * sequential reads the first time a minibatch touches it, after which its
+ * records are copied from memory. Up to two shards are kept, so that the
+ * outgoing and incoming shards can both be resident while a minibatch
+ * straddles an epoch boundary; if even one shard does not fit in the memory
+ * budget, records are streamed from the underlying reader instead.
+ */
+class ShardedSampleReader: public SampleReader {
+public:
+	/**
+	 * @param reader the underlying reader, which must outlive this one
+	 * @param numShards the number of shards into which the data is cut
+	 * @param residentBytes memory available for resident shards
+	 */
+	ShardedSampleReader(SampleReader* reader, size_t numShards,
+			size_t residentBytes);
+	virtual ~ShardedSampleReader();
+
+	void readLabelledSamples(const std::vector<size_t>& idx, float* X,
+			float* Y);
+
+private:
+	static const size_t NO_SHARD = (size_t) -1;
+	static const size_t LOAD_CHUNK_ROWS = 4096;
+
+	struct ResidentShard {
+		size_t shard;
+		size_t begin; // first row of the shard
+		size_t rows;
+		size_t loadTime; // for evicting the oldest shard
+		float* X;
+		float* Y;
+	};
+
+	SampleReader* reader;
+	const size_t numShards;
+	std::vector<ResidentShard> resident;
+	size_t loadClock;
+	pthread_rwlock_t lock;
+
+	const ResidentShard* findResident(size_t shard) const;
+	void loadShard(size_t shard, const std::vector<size_t>& needed);
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_SHARDEDSAMPLEREADER_H_ */
@@ -0,0 +1,206 @@
+/*
+ * SyntheticData.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/SyntheticData.h"
+#include "rudra/io/BinarySampleReader.h"
+#include "rudra/util/ConvertKernels.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/RudraRand.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <endian.h>
+#include <vector>
+
+namespace rudra {
+/** Rows generated and written at a time. */
+static const size_t SYNTHETIC_BATCH_ROWS = 256;
+
+/** The element type for the extension of fileName; INVALID means text. */
+static BinFileType typeOf(const std::string& fileName) {
+	const size_t dot = fileName.rfind('.');
+	return dot == std::string::npos ?
+			INVALID : binFileTypeFromExtension(fileName.substr(dot + 1));
+}
+
+static void putBE32(std::vector<char>& buf, size_t i, uint32_t v) {
+	v = htobe32(v);
+	memcpy(&buf[i * sizeof(v)], &v, sizeof(v));
+}
+
+static void putBE16(std::vector<char>& buf, size_t i, uint16_t v) {
+	v = htobe16(v);
+	memcpy(&buf[i * sizeof(v)], &v, sizeof(v));
+}
+
+/**
+ * A binary or text matrix file being written a batch of rows at a time.
+ * Values given to append are stored as they are in the float types and
+ * rounded and clamped to the range of the integer types.
+ */
+class SyntheticFile {
+public:
+	SyntheticFile(const std::string& fileName, size_t rows, size_t cols,
+			float quantScale) :
+			fileName(fileName), type(typeOf(fileName)), cols(cols) {
+		f = fopen(fileName.c_str(), "wb");
+		if (f == NULL) {
+			Logger::logFatal("writeSyntheticData: failed to open " + fileName);
+		}
+		if (type == INVALID) {
+			return;
+		}
+		std::vector<char> header(2 * sizeof(uint32_t));
+		putBE32(header, 0, (uint32_t) rows);
+		putBE32(header, 1, (uint32_t) cols);
+		if (type == QUANT8) {
+			// per-feature scales, then offsets of zero
+			header.resize(binDataOffset(QUANT8, cols));
+			float s = quantScale;
+			uint32_t bits;
+			memcpy(&bits, &s, sizeof(bits));
+			for (size_t j = 0; j < cols; ++j) {
+				putBE32(header, 2 + j, bits);
+			}
+		}
+		write(&header[0], header.size());
+	}
+
+	~SyntheticFile() {
+		if (fclose(f) != 0) {
+			Logger::logFatal("writeSyntheticData: failed to write " + fileName);
+		}
+	}
+
+	void append(const float* values, size_t n) {
+		if (type == INVALID) {
+			appendText(values, n);
+			return;
+		}
+		buf.resize(n * binFileTypeSize(type));
+		for (size_t i = 0; i < n; ++i) {
+			const float v = values[i];
+			switch (type) {
+			case CHAR:
+			case QUANT8:
+				buf[i] = (char) (uint8_t) clamp(v, 255.0f);
+				break;
+			case INT:
+				putBE32(buf, i, (uint32_t) (int32_t) clamp(v, 2147483647.0f));
+				break;
+			case FLOAT:
+				uint32_t bits;
+				memcpy(&bits, &v, sizeof(bits));
+				putBE32(buf, i, bits);
+				break;
+			case HALF:
+				putBE16(buf, i, floatToHalf(v));
+				break;
+			case BFLOAT16:
+				putBE16(buf, i, floatToBfloat16(v));
+				break;
+			default:
+				break;
+			}
+		}
+		write(&buf[0], buf.size());
+	}
+
+	/** True if integer types hold values scaled up to [0, 255]. */
+	bool scalesUp() const {
+		return type == CHAR || type == INT || type == QUANT8;
+	}
+
+private:
+	const std::string fileName;
+	const BinFileType type;
+	const size_t cols;
+	FILE* f;
+	std::vector<char> buf;
+
+	static float clamp(float v, float hi) {
+		const float r = rintf(v);
+		return r < 0 ? 0 : r > hi ? hi : r;
+	}
+
+	void appendText(const float* values, size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			fprintf(f, (i + 1) % cols == 0 ? "%g\n" : "%g,", values[i]);
+		}
+	}
+
+	void write(const char* p, size_t n) {
+		if (fwrite(p, 1, n, f) != n) {
+			Logger::logFatal("writeSyntheticData: failed to write " + fileName);
+		}
+	}
+};
+
+void writeSyntheticData(const std::string& sampleFile,
+		const std::string& labelFile, size_t rows, size_t cols, size_t classes,
+		uint64_t seed) {
+	if (rows == 0 || cols == 0 || classes == 0) {
+		Logger::logFatal(
+				"writeSyntheticData: rows, cols and classes must be positive");
+	}
+	SyntheticFile samples(sampleFile, rows, cols, 1.0f / 255);
+	SyntheticFile labels(labelFile, rows, 1, 1.0f);
+	const float unit = samples.scalesUp() ? 255.0f : 1.0f;
+	// two 23-bit halves sum to a float in [0, 1) exactly
+	const float toUnit = unit / 16777216;
+
+	// stream 0 draws labels and noise; stream 1 + c holds class c's prototype
+	RudraRand rand(seed, 0, 0);
+	std::vector<uint64_t> noise(cols), prototype(cols);
+	std::vector<float> X(SYNTHETIC_BATCH_ROWS * cols);
+	std::vector<float> Y(SYNTHETIC_BATCH_ROWS);
+	for (size_t r = 0; r < rows; r += SYNTHETIC_BATCH_ROWS) {
+		const size_t n = std::min(SYNTHETIC_BATCH_ROWS, rows - r);
+		for (size_t i = 0; i < n; ++i) {
+			const uint64_t label = rand.uniform(classes);
+			RudraRand(seed, 0, 0, 1 + label).fill(&prototype[0], cols);
+			rand.fill(&noise[0], cols);
+			float* x = &X[i * cols];
+			for (size_t j = 0; j < cols; ++j) {
+				x[j] = ((prototype[j] >> 41) + (noise[j] >> 41)) * toUnit;
+			}
+			Y[i] = (float) label;
+		}
+		samples.append(&X[0], n * cols);
+		labels.append(&Y[0], n);
+	}
+}
+} /* namespace rudra */
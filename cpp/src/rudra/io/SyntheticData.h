@@ -0,0 +1,61 @@
+/*
+ * SyntheticData.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_SYNTHETICDATA_H_
+#define RUDRA_IO_SYNTHETICDATA_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+namespace rudra {
+/**
+ * Write a synthetic labelled data set of rows samples with cols features,
+ * for benchmarks and tests. Each file is written in the format chosen by its
+ * extension, as read by SampleReader::makeReader: one of the BinFileTypes
+ * (see BinarySampleReader.h), or comma-separated text for any other
+ * extension. The label file has a single column holding each sample's class
+ * in [0, classes).
+ * Every sample is a mix of a fixed random prototype for its class and
+ * uniform noise, so the data can be learned. Features lie in [0, 1), or in
+ * [0, 255] for the integer types; QUANT8 files decode to [0, 1).
+ * The same seed always gives the same files.
+ */
+void writeSyntheticData(const std::string& sampleFile,
+		const std::string& labelFile, size_t rows, size_t cols, size_t classes,
+		uint64_t seed);
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_SYNTHETICDATA_H_ */
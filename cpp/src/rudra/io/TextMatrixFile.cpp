@@ -0,0 +1,387 @@
+/*
+ * TextMatrixFile.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/TextMatrixFile.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/MatrixContainer.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace rudra {
+
+/** Work for one thread: a byte range to index, or a range of rows to parse. */
+struct TextMatrixFile::Task {
+	const TextMatrixFile* file;
+	size_t begin;
+	size_t end;
+	std::vector<size_t> starts; // row starts found in [begin, end)
+	size_t cpos;
+	size_t c;
+	float* dst;
+};
+
+/** Powers of ten that are exact as doubles. */
+static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+		1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22 };
+
+static inline bool isBlank(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+/**
+ * Parse the number in the field [p, end), which has no surrounding blanks,
+ * giving the same float as atof. Decimals of up to 19 significant digits
+ * with small exponents are converted with a single correctly rounded double
+ * operation; anything else (long mantissas, large exponents, inf, nan, hex)
+ * falls back to strtod. Returns false if the field is not a number.
+ */
+static bool parseFloat(const char* p, const char* end, float& out) {
+	if (p == end) {
+		out = 0.0f; // an empty field reads as zero, as with atof
+		return true;
+	}
+	const char* start = p;
+	bool negative = false;
+	if (*p == '-' || *p == '+') {
+		negative = *p == '-';
+		++p;
+	}
+	uint64_t mantissa = 0;
+	int digits = 0; // significant digits in mantissa
+	int exp10 = 0;
+	bool exact = true;
+	bool any = false;
+	for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+		any = true;
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		} else {
+			++exp10;
+			exact &= *p == '0';
+		}
+	}
+	if (p < end && *p == '.') {
+		for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+			any = true;
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				--exp10;
+			} else {
+				exact &= *p == '0';
+			}
+		}
+	}
+	if (any && p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool negativeExp = false;
+		if (q < end && (*q == '-' || *q == '+')) {
+			negativeExp = *q == '-';
+			++q;
+		}
+		int e = 0;
+		bool expDigits = false;
+		for (; q < end && *q >= '0' && *q <= '9'; ++q) {
+			expDigits = true;
+			e = e < 100000 ? e * 10 + (*q - '0') : e;
+		}
+		if (expDigits) {
+			exp10 += negativeExp ? -e : e;
+			p = q;
+		}
+	}
+	if (any && p == end && exact && mantissa <= (1ULL << 53) && exp10 >= -22
+			&& exp10 <= 22) {
+		double d = (double) mantissa;
+		d = exp10 < 0 ? d / POW10[-exp10] : d * POW10[exp10];
+		out = (float) (negative ? -d : d);
+		return true;
+	}
+
+	// slow path: strtod needs a terminated copy
+	char small[64];
+	std::string large;
+	const size_t len = end - start;
+	char* copy = small;
+	if (len >= sizeof(small)) {
+		large.assign(start, len);
+		copy = &large[0];
+	} else {
+		memcpy(small, start, len);
+		small[len] = '\0';
+	}
+	char* parsed;
+	double d = strtod(copy, &parsed);
+	out = (float) d;
+	return parsed == copy + len;
+}
+
+TextMatrixFile::TextMatrixFile(const std::string& fileName, size_t numThreads) :
+		fileName(fileName), data(NULL), size(0), cols(0), numThreads(
+				numThreads) {
+	if (this->numThreads == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		this->numThreads = cpus > 0 ? cpus : 1;
+	}
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		Logger::logFatal("TextMatrixFile: failed to open " + fileName);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		Logger::logFatal("TextMatrixFile: failed to stat " + fileName);
+	}
+	size = st.st_size;
+	if (size > 0) {
+		void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED) {
+			close(fd);
+			Logger::logFatal("TextMatrixFile: failed to map " + fileName);
+		}
+		madvise(map, size, MADV_SEQUENTIAL);
+		data = (const char*) map;
+	}
+	close(fd); // the mapping keeps its own reference to the file
+
+	// index the rows, each thread taking an equal share of the bytes
+	const size_t chunkBytes = 1 << 20;
+	size_t n = (size + chunkBytes - 1) / chunkBytes;
+	n = n < this->numThreads ? n : this->numThreads;
+	std::vector<Task> tasks(n);
+	for (size_t i = 0; i < n; ++i) {
+		tasks[i].file = this;
+		tasks[i].begin = size * i / n;
+		tasks[i].end = size * (i + 1) / n;
+	}
+	runTasks(tasks, indexChunk);
+	for (size_t i = 0; i < n; ++i) {
+		rowStart.insert(rowStart.end(), tasks[i].starts.begin(),
+				tasks[i].starts.end());
+	}
+
+	if (!rowStart.empty()) {
+		const char* p = data + rowStart[0];
+		const char* eol = (const char*) memchr(p, '\n', data + size - p);
+		cols = 1 + std::count(p, eol ? eol : data + size, ',');
+	}
+}
+
+TextMatrixFile::~TextMatrixFile() {
+	if (data != NULL) {
+		munmap((void*) data, size);
+	}
+}
+
+/**
+ * Record the start of every non-blank line that starts in [begin, end).
+ * A line starts at offset 0 or just after a newline.
+ */
+void* TextMatrixFile::indexChunk(void* arg) {
+	Task& task = *(Task*) arg;
+	const char* data = task.file->data;
+	const size_t size = task.file->size;
+	size_t pos = task.begin;
+	if (pos > 0) {
+		// skip to the first line that starts in this chunk
+		const char* nl = (const char*) memchr(data + pos - 1, '\n',
+				task.end - (pos - 1));
+		pos = nl ? nl - data + 1 : task.end;
+	}
+	while (pos < task.end) {
+		const char* nl = (const char*) memchr(data + pos, '\n', size - pos);
+		const size_t eol = nl ? nl - data : size;
+		size_t p = pos;
+		while (p < eol && isBlank(data[p])) {
+			++p;
+		}
+		if (p < eol) {
+			task.starts.push_back(pos);
+		}
+		pos = eol + 1;
+	}
+	return NULL;
+}
+
+/**
+ * Parse columns [cpos, cpos + c) of the given row into dst, checking that
+ * the row has exactly cols values.
+ */
+void TextMatrixFile::parseRow(size_t row, size_t cpos, size_t c,
+		float* dst) const {
+	const char* p = data + rowStart[row];
+	const char* end = data + size;
+	const char* nl = (const char*) memchr(p, '\n', end - p);
+	const char* eol = nl ? nl : end;
+	size_t j = 0;
+	for (;; ++j) {
+		const char* comma = (const char*) memchr(p, ',', eol - p);
+		const char* fieldEnd = comma ? comma : eol;
+		if (j >= cpos && j < cpos + c) {
+			const char* b = p;
+			const char* e = fieldEnd;
+			while (b < e && isBlank(*b)) {
+				++b;
+			}
+			while (e > b && isBlank(e[-1])) {
+				--e;
+			}
+			if (!parseFloat(b, e, dst[j - cpos])) {
+				std::ostringstream msg;
+				msg << "TextMatrixFile: bad number \"" << std::string(b, e)
+						<< "\" at row " << row << ", column " << j << " of "
+						<< fileName;
+				Logger::logFatal(msg.str());
+			}
+		}
+		if (!comma) {
+			break;
+		}
+		p = comma + 1;
+	}
+	if (j + 1 != cols) {
+		std::ostringstream msg;
+		msg << "TextMatrixFile: row " << row << " of " << fileName << " has "
+				<< j + 1 << " values, expected " << cols;
+		Logger::logFatal(msg.str());
+	}
+}
+
+void* TextMatrixFile::parseRows(void* arg) {
+	Task& task = *(Task*) arg;
+	for (size_t r = task.begin; r < task.end; ++r) {
+		task.file->parseRow(r, task.cpos, task.c,
+				task.dst + (r - task.begin) * task.c);
+	}
+	return NULL;
+}
+
+/** Run each task on its own thread, the first on the calling thread. */
+void TextMatrixFile::runTasks(std::vector<Task>& tasks,
+		void* (*fn)(void*)) const {
+	std::vector<pthread_t> tids(tasks.size());
+	for (size_t i = 1; i < tasks.size(); ++i) {
+		if (pthread_create(&tids[i], NULL, fn, &tasks[i]) != 0) {
+			Logger::logFatal("TextMatrixFile: failed to create thread");
+		}
+	}
+	if (!tasks.empty()) {
+		fn(&tasks[0]);
+	}
+	for (size_t i = 1; i < tasks.size(); ++i) {
+		pthread_join(tids[i], NULL);
+	}
+}
+
+void TextMatrixFile::readSubMatrix(size_t rpos, size_t cpos, size_t r,
+		size_t c, float* dst) const {
+	if (rpos + r > getRows() || cpos + c > cols) {
+		std::ostringstream msg;
+		msg << "TextMatrixFile: " << r << " x " << c << " submatrix at ("
+				<< rpos << ", " << cpos << ") is outside the " << getRows()
+				<< " x " << cols << " matrix in " << fileName;
+		Logger::logFatal(msg.str());
+	}
+	// parse on as many threads as have a few thousand values each
+	const size_t minRowsPerThread = 1 + 4096 / (cols + 1);
+	size_t n = (r + minRowsPerThread - 1) / minRowsPerThread;
+	n = n < numThreads ? n : numThreads;
+	std::vector<Task> tasks(n);
+	for (size_t i = 0; i < n; ++i) {
+		tasks[i].file = this;
+		tasks[i].begin = rpos + r * i / n;
+		tasks[i].end = rpos + r * (i + 1) / n;
+		tasks[i].cpos = cpos;
+		tasks[i].c = c;
+		tasks[i].dst = dst + (r * i / n) * c;
+	}
+	runTasks(tasks, parseRows);
+}
+
+void TextMatrixFile::readRows(size_t first, size_t count, float* dst) const {
+	readSubMatrix(first, 0, count, cols, dst);
+}
+
+//===========================
+// read Matrix
+//===========================
+MatrixContainer<float> readMat(std::string s) {
+	TextMatrixFile file(s);
+	if (file.getRows() == 0) {
+		Logger::logFatal(
+				"Are you trying to read in an empty matrix from " + s + " ?");
+	}
+	MatrixContainer<float> ret(file.getRows(), file.getCols());
+	file.readRows(0, file.getRows(), ret.buf);
+	return ret;
+}
+
+void readMat(float * buf, size_t idx, size_t stride, size_t len,
+		std::string fileName) {
+	// read a stride # of rows starting at idx. len is the size of each row
+	// assuming that size of buffer buf = stride * len * sizeof(float)
+	TextMatrixFile file(fileName);
+	if (idx >= file.getRows()) {
+		std::ostringstream msg;
+		msg << "Matrix::readMat::Number of rows in the matrix = "
+				<< file.getRows();
+		Logger::logFatal(msg.str());
+	}
+	// as before, rows past the end of the file are left untouched
+	const size_t count =
+			stride < file.getRows() - idx ? stride : file.getRows() - idx;
+	file.readSubMatrix(idx, 0, count, len, buf);
+}
+
+MatrixContainer<float> readMat(size_t rpos, size_t cpos, size_t r, size_t c,
+		std::string s) {
+	// read a sub-matrix starting at (rpos,cpos). The size of the sub-matrix is r x c
+	// note: minimum value of rpos and cpos = 0
+	TextMatrixFile file(s);
+	MatrixContainer<float> res(r, c); // every element is parsed
+	file.readSubMatrix(rpos, cpos, r, c, res.buf);
+	return res;
+}
+
+} /* namespace rudra */
@@ -0,0 +1,99 @@
+/*
+ * TextMatrixFile.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_IO_TEXTMATRIXFILE_H_
+#define RUDRA_IO_TEXTMATRIXFILE_H_
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace rudra {
+
+/**
+ * Read access to a text matrix file: one row per line, with values separated
+ * by commas. Blank lines are ignored, and a carriage return before a newline
+ * and spaces or tabs around values are allowed.
+ *
+ * The file is mapped into memory, and the constructor scans it once, in
+ * parallel over line-aligned chunks, to build an index of where each row
+ * starts. Rows are then parsed in parallel straight from the mapping, so a
+ * range of rows can be read without scanning the rows before it.
+ * Safe for concurrent reads.
+ */
+class TextMatrixFile {
+public:
+	/**
+	 * @param numThreads threads to scan and parse with; 0 to use one per
+	 *   online CPU
+	 */
+	TextMatrixFile(const std::string& fileName, size_t numThreads = 0);
+	~TextMatrixFile();
+
+	size_t getRows() const {
+		return rowStart.size();
+	}
+	/** Number of values in the first row, which every row must match. */
+	size_t getCols() const {
+		return cols;
+	}
+
+	/** Parse count rows starting at row first into dst, row by row. */
+	void readRows(size_t first, size_t count, float* dst) const;
+
+	/**
+	 * Parse the r x c submatrix whose top left element is at (rpos, cpos)
+	 * into dst, row by row.
+	 */
+	void readSubMatrix(size_t rpos, size_t cpos, size_t r, size_t c,
+			float* dst) const;
+
+private:
+	std::string fileName;
+	const char* data;
+	size_t size;
+	size_t cols;
+	size_t numThreads;
+	std::vector<size_t> rowStart; // offset of the first byte of each row
+
+	struct Task;
+	static void* indexChunk(void* arg);
+	static void* parseRows(void* arg);
+	void runTasks(std::vector<Task>& tasks, void* (*fn)(void*)) const;
+	void parseRow(size_t row, size_t cpos, size_t c, float* dst) const;
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_IO_TEXTMATRIXFILE_H_ */
@@ -0,0 +1,84 @@
+/*
+ * AlignedAlloc.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/AlignedAlloc.h"
+#include "rudra/util/Logger.h"
+#include <cstring>
+#include <sstream>
+#include <sys/mman.h>
+
+namespace rudra {
+
+static bool hugePagesFromEnv() {
+	const char* env = getenv("RUDRA_HUGEPAGES");
+	return env != NULL && strcmp(env, "1") == 0;
+}
+
+static bool hugePages = hugePagesFromEnv();
+
+void setHugePages(bool enable) {
+	hugePages = enable;
+}
+
+bool getHugePages() {
+	return hugePages;
+}
+
+void* alignedAlloc(size_t bytes) {
+	if (bytes == 0) {
+		return NULL;
+	}
+	const bool huge = hugePages && bytes >= HUGE_PAGE_SIZE;
+	void* p = NULL;
+	if (posix_memalign(&p, huge ? HUGE_PAGE_SIZE : MATRIX_ALIGNMENT, bytes)
+			!= 0) {
+		std::ostringstream msg;
+		msg << "alignedAlloc: failed to allocate " << bytes << " bytes";
+		Logger::logFatal(msg.str());
+	}
+#ifdef MADV_HUGEPAGE
+	if (huge) {
+		// only whole huge pages within the buffer can be promoted
+		madvise(p, bytes & ~(HUGE_PAGE_SIZE - 1), MADV_HUGEPAGE);
+	}
+#endif
+	return p;
+}
+
+void alignedFree(void* p) {
+	free(p);
+}
+
+} /* namespace rudra */
@@ -0,0 +1,71 @@
+/*
+ * AlignedAlloc.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_ALIGNEDALLOC_H_
+#define RUDRA_UTIL_ALIGNEDALLOC_H_
+
+#include <cstdlib>
+
+namespace rudra {
+
+/** Alignment in bytes of matrix buffers: a cache line, and an AVX-512 vector. */
+const size_t MATRIX_ALIGNMENT = 64;
+
+/** Size in bytes of a transparent huge page. */
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+/**
+ * Allocate bytes of uninitialized memory aligned to MATRIX_ALIGNMENT, or
+ * return NULL if bytes is zero. If huge pages are enabled, allocations of at
+ * least HUGE_PAGE_SIZE are aligned to it instead and the kernel is advised
+ * to back them with transparent huge pages. Fatal if out of memory.
+ * Free with alignedFree.
+ */
+void* alignedAlloc(size_t bytes);
+
+/** Free memory allocated by alignedAlloc; does nothing for NULL. */
+void alignedFree(void* p);
+
+/**
+ * Enable or disable huge pages for later large allocations. They are
+ * disabled by default, unless the RUDRA_HUGEPAGES environment variable is
+ * set to 1.
+ */
+void setHugePages(bool enable);
+bool getHugePages();
+
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_ALIGNEDALLOC_H_ */
@@ -0,0 +1,104 @@
+/*
+ * Checksum.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/Checksum.h"
+#include "rudra/util/SimdDispatch.h"
+#include <cstring>
+#ifdef RUDRA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rudra {
+
+static const uint32_t CRC32C_POLY = 0x82f63b78; // reflected
+
+struct Crc32cTable {
+	uint32_t t[256];
+	Crc32cTable() {
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k) {
+				c = (c >> 1) ^ (c & 1 ? CRC32C_POLY : 0);
+			}
+			t[i] = c;
+		}
+	}
+};
+
+static const Crc32cTable table;
+
+static uint32_t crc32cScalar(const uint8_t* p, size_t size, uint32_t c) {
+	for (size_t i = 0; i < size; ++i) {
+		c = table.t[(c ^ p[i]) & 0xff] ^ (c >> 8);
+	}
+	return c;
+}
+
+#ifdef RUDRA_X86_SIMD
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(const uint8_t* p, size_t size, uint32_t c) {
+	uint64_t c64 = c;
+	for (; size >= 8; p += 8, size -= 8) {
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		c64 = _mm_crc32_u64(c64, v);
+	}
+	c = (uint32_t) c64;
+	for (; size > 0; ++p, --size) {
+		c = _mm_crc32_u8(c, *p);
+	}
+	return c;
+}
+
+static bool haveHardwareCrc() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+}
+
+static const bool hardwareCrc = haveHardwareCrc();
+#endif
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+	const uint8_t* p = (const uint8_t*) data;
+	uint32_t c = ~crc;
+#ifdef RUDRA_X86_SIMD
+	if (hardwareCrc && simdLevel() != SIMD_SCALAR) {
+		return ~crc32cHardware(p, size, c);
+	}
+#endif
+	return ~crc32cScalar(p, size, c);
+}
+
+} /* namespace rudra */
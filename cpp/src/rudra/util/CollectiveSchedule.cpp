@@ -0,0 +1,472 @@
+/*
+ * CollectiveSchedule.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/CollectiveSchedule.h"
+#include "rudra/util/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <utility>
+
+namespace rudra {
+const char* collectiveAlgorithmName(CollectiveAlgorithm algorithm) {
+	switch (algorithm) {
+	case COLLECTIVE_RING:
+		return "ring";
+	case COLLECTIVE_HALVING_DOUBLING:
+		return "hd";
+	case COLLECTIVE_TREE:
+		return "tree";
+	default:
+		return "auto";
+	}
+}
+
+/**
+ * Builds the schedules of every rank at once, so that each send can be
+ * told the slot and message number its receive will use: the k-th message
+ * from a to b is matched with the k-th receive from a by b.
+ */
+class ScheduleBuilder {
+public:
+	const size_t n;
+	const int places;
+	const size_t segment;
+	std::vector<std::vector<CollectiveOp> > ops;
+
+	ScheduleBuilder(size_t n, int places, size_t segment) :
+			n(n), places(places), segment(std::max<size_t>(1, segment)), ops(
+					places) {
+	}
+
+	void send(int from, int to, size_t lo, size_t hi) {
+		add(from, COLLECTIVE_SEND, to, lo, hi);
+	}
+
+	void recv(int at, int from, size_t lo, size_t hi, bool sum) {
+		add(at, sum ? COLLECTIVE_RECV_ADD : COLLECTIVE_RECV_COPY, from, lo, hi);
+	}
+
+	/** Number the messages and their slots, and return the largest totals. */
+	void finish(size_t& stagingSize, size_t& messages) {
+		std::map<std::pair<int, int>, std::vector<size_t> > pending;
+		stagingSize = 0;
+		messages = 0;
+		for (int r = 0; r < places; ++r) {
+			size_t slot = 0, msg = 0;
+			for (size_t i = 0; i < ops[r].size(); ++i) {
+				CollectiveOp& op = ops[r][i];
+				if (op.kind == COLLECTIVE_SEND) {
+					continue;
+				}
+				op.slot = slot;
+				op.msg = msg++;
+				slot += op.n;
+				pending[std::make_pair(op.peer, r)].push_back(i);
+			}
+			stagingSize = std::max(stagingSize, slot);
+			messages = std::max(messages, msg);
+		}
+		for (int r = 0; r < places; ++r) {
+			std::map<int, size_t> sent; // per peer
+			for (size_t i = 0; i < ops[r].size(); ++i) {
+				CollectiveOp& op = ops[r][i];
+				if (op.kind != COLLECTIVE_SEND) {
+					continue;
+				}
+				const std::vector<size_t>& recvs = pending[std::make_pair(r,
+						op.peer)];
+				const size_t k = sent[op.peer]++;
+				if (k >= recvs.size()
+						|| ops[op.peer][recvs[k]].n != op.n
+						|| ops[op.peer][recvs[k]].lo != op.lo) {
+					std::ostringstream msg;
+					msg << "CollectiveSchedule: unmatched send from " << r
+							<< " to " << op.peer;
+					Logger::logFatal(msg.str());
+				}
+				op.slot = ops[op.peer][recvs[k]].slot;
+				op.msg = ops[op.peer][recvs[k]].msg;
+			}
+		}
+	}
+
+private:
+	void add(int rank, CollectiveOpKind kind, int peer, size_t lo,
+			size_t hi) {
+		for (size_t s = lo; s < hi; s += segment) {
+			CollectiveOp op;
+			op.kind = kind;
+			op.peer = peer;
+			op.lo = s;
+			op.n = std::min(segment, hi - s);
+			op.slot = 0;
+			op.msg = 0;
+			ops[rank].push_back(op);
+		}
+	}
+};
+
+/** The i-th of p nearly equal parts of n. */
+static size_t part(size_t n, size_t p, size_t i) {
+	return n / p * i + std::min(i, n % p);
+}
+
+static void ring(ScheduleBuilder& b, CollectiveKind kind, int root) {
+	const int P = b.places;
+	const size_t n = b.n;
+	for (int r = 0; r < P; ++r) {
+		const int next = (r + 1) % P, prev = (r + P - 1) % P;
+		const int owned = (r + 1) % P; // after the reduce-scatter
+		if (kind != COLLECTIVE_BCAST) {
+			for (int k = 0; k < P - 1; ++k) {
+				const int s = (r - k + P) % P, t = (r - k - 1 + 2 * P) % P;
+				b.send(r, next, part(n, P, s), part(n, P, s + 1));
+				b.recv(r, prev, part(n, P, t), part(n, P, t + 1), true);
+			}
+		}
+		if (kind == COLLECTIVE_REDUCE) {
+			if (r != root) {
+				b.send(r, root, part(n, P, owned), part(n, P, owned + 1));
+				continue;
+			}
+			for (int q = 0; q < P; ++q) {
+				const int c = (q + 1) % P;
+				if (q != root) {
+					b.recv(r, q, part(n, P, c), part(n, P, c + 1), false);
+				}
+			}
+			continue;
+		}
+		if (kind == COLLECTIVE_BCAST) {
+			if (r == root) {
+				for (int q = 0; q < P; ++q) {
+					const int c = (q + 1) % P;
+					if (q != root) {
+						b.send(r, q, part(n, P, c), part(n, P, c + 1));
+					}
+				}
+			} else {
+				b.recv(r, root, part(n, P, owned), part(n, P, owned + 1),
+						false);
+			}
+		}
+		for (int k = 0; k < P - 1; ++k) {
+			const int s = (r + 1 - k + P) % P, t = (r - k + P) % P;
+			b.send(r, next, part(n, P, s), part(n, P, s + 1));
+			b.recv(r, prev, part(n, P, t), part(n, P, t + 1), false);
+		}
+	}
+}
+
+/**
+ * The ranges of the vector rank v of a power-of-two group holds at each
+ * level of the recursive halving: levels[0] is everything, and the last
+ * entry what v owns once the reduce-scatter is done.
+ */
+static std::vector<std::pair<size_t, size_t> > halvings(size_t n, int pow2,
+		int v) {
+	std::vector<std::pair<size_t, size_t> > levels;
+	size_t lo = 0, hi = n;
+	levels.push_back(std::make_pair(lo, hi));
+	for (int mask = pow2 / 2; mask >= 1; mask /= 2) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if (v & mask) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+		levels.push_back(std::make_pair(lo, hi));
+	}
+	return levels;
+}
+
+static void halvingDoubling(ScheduleBuilder& b, CollectiveKind kind,
+		int root) {
+	const int P = b.places;
+	const size_t n = b.n;
+	int pow2 = 1;
+	while (pow2 * 2 <= P) {
+		pow2 *= 2;
+	}
+	// the even ranks below 2 * rem hand their part to the next odd rank
+	const int rem = P - pow2;
+	struct Group {
+		int pow2, rem;
+		int virtualRank(int r) const {
+			return r < 2 * rem ? (r % 2 ? r / 2 : -1) : r - rem;
+		}
+		int realRank(int v) const {
+			return v < rem ? 2 * v + 1 : v + rem;
+		}
+	} g = { pow2, rem };
+	for (int r = 0; r < P; ++r) {
+		const int v = g.virtualRank(r);
+		if (v < 0) { // folded into r + 1
+			if (kind != COLLECTIVE_BCAST) {
+				b.send(r, r + 1, 0, n);
+			}
+			if (kind == COLLECTIVE_REDUCE && r == root) {
+				for (int u = 0; u < pow2; ++u) {
+					const std::pair<size_t, size_t> own =
+							halvings(n, pow2, u).back();
+					b.recv(r, g.realRank(u), own.first, own.second, false);
+				}
+			}
+			if (kind == COLLECTIVE_BCAST && r == root) {
+				for (int u = 0; u < pow2; ++u) {
+					const std::pair<size_t, size_t> own =
+							halvings(n, pow2, u).back();
+					b.send(r, g.realRank(u), own.first, own.second);
+				}
+			}
+			if (kind != COLLECTIVE_REDUCE && r != root) {
+				b.recv(r, r + 1, 0, n, false);
+			}
+			continue;
+		}
+		const std::vector<std::pair<size_t, size_t> > levels = halvings(n,
+				pow2, v);
+		const std::pair<size_t, size_t> own = levels.back();
+		if (kind != COLLECTIVE_BCAST) {
+			if (r < 2 * rem) {
+				b.recv(r, r - 1, 0, n, true);
+			}
+			for (size_t l = 1; l < levels.size(); ++l) {
+				const int peer = g.realRank(v ^ (pow2 >> l));
+				const std::pair<size_t, size_t>& whole = levels[l - 1];
+				const std::pair<size_t, size_t>& keep = levels[l];
+				if (keep.first == whole.first) {
+					b.send(r, peer, keep.second, whole.second);
+				} else {
+					b.send(r, peer, whole.first, keep.first);
+				}
+				b.recv(r, peer, keep.first, keep.second, true);
+			}
+		}
+		if (kind == COLLECTIVE_REDUCE) {
+			if (r != root) {
+				b.send(r, root, own.first, own.second);
+			} else {
+				for (int u = 0; u < pow2; ++u) {
+					const std::pair<size_t, size_t> o =
+							halvings(n, pow2, u).back();
+					if (g.realRank(u) != r) {
+						b.recv(r, g.realRank(u), o.first, o.second, false);
+					}
+				}
+			}
+			continue;
+		}
+		if (kind == COLLECTIVE_BCAST) {
+			if (r == root) {
+				for (int u = 0; u < pow2; ++u) {
+					const std::pair<size_t, size_t> o =
+							halvings(n, pow2, u).back();
+					if (g.realRank(u) != r) {
+						b.send(r, g.realRank(u), o.first, o.second);
+					}
+				}
+			} else {
+				b.recv(r, root, own.first, own.second, false);
+			}
+		}
+		for (size_t l = levels.size() - 1; l >= 1; --l) {
+			const int peer = g.realRank(v ^ (pow2 >> l));
+			const std::pair<size_t, size_t>& whole = levels[l - 1];
+			const std::pair<size_t, size_t>& mine = levels[l];
+			b.send(r, peer, mine.first, mine.second);
+			if (mine.first == whole.first) {
+				b.recv(r, peer, mine.second, whole.second, false);
+			} else {
+				b.recv(r, peer, whole.first, mine.first, false);
+			}
+		}
+		if (r < 2 * rem && r - 1 != root) {
+			b.send(r, r - 1, 0, n);
+		}
+	}
+}
+
+static void tree(ScheduleBuilder& b, CollectiveKind kind, int root) {
+	const int P = b.places;
+	const size_t n = b.n, seg = b.segment;
+	const size_t segments = (n + seg - 1) / seg;
+	int height = 0;
+	while ((1 << height) <= P) {
+		++height;
+	}
+	// reduce segment s + lag before broadcasting segment s, so that every
+	// level of the tree has work while the root broadcasts
+	const size_t lag = kind == COLLECTIVE_ALLREDUCE ? height : 0;
+	root = std::max(root, 0);
+	for (int r = 0; r < P; ++r) {
+		const int v = (r - root + P) % P;
+		const int parent = v > 0 ? ((v - 1) / 2 + root) % P : -1;
+		int children[2];
+		int nc = 0;
+		for (int c = 2 * v + 1; c <= 2 * v + 2 && c < P; ++c) {
+			children[nc++] = (c + root) % P;
+		}
+		const size_t reduces = kind == COLLECTIVE_BCAST ? 0 : segments;
+		const size_t bcasts = kind == COLLECTIVE_REDUCE ? 0 : segments;
+		size_t up = 0, down = 0;
+		while (up < reduces || down < bcasts) {
+			if (up < reduces && (down >= bcasts || up < down + lag + 1)) {
+				const size_t lo = up * seg, hi = std::min(n, lo + seg);
+				for (int c = 0; c < nc; ++c) {
+					b.recv(r, children[c], lo, hi, true);
+				}
+				if (parent >= 0) {
+					b.send(r, parent, lo, hi);
+				}
+				++up;
+				continue;
+			}
+			const size_t lo = down * seg, hi = std::min(n, lo + seg);
+			if (parent >= 0) {
+				b.recv(r, parent, lo, hi, false);
+			}
+			for (int c = 0; c < nc; ++c) {
+				b.send(r, children[c], lo, hi);
+			}
+			++down;
+		}
+	}
+}
+
+/**
+ * The modelled time of a collective: the messages and bytes along its
+ * critical path, at latency seconds each and bandwidth bytes per second.
+ */
+CollectiveAlgorithm chooseCollective(CollectiveKind kind, size_t n,
+		int places, size_t segment, double latency, double bandwidth) {
+	if (places <= 1) {
+		return COLLECTIVE_RING;
+	}
+	const double P = places, bytes = 4.0 * n;
+	const double seg = std::max<size_t>(1, segment);
+	const double beta = 1.0 / bandwidth;
+	int pow2 = 1, logP = 0;
+	while (pow2 * 2 <= places) {
+		pow2 *= 2;
+		++logP;
+	}
+	const bool folded = pow2 != places;
+	const double segsOf = std::ceil(n / P / seg); // per ring chunk
+	const double segsAll = std::ceil(n / seg);
+	double ring, hd, tree;
+	// the reduce-scatter and the all-gather (or gather, or scatter) each
+	// move (P-1)/P of the vector through every rank's link
+	const double half = (P - 1) * segsOf * latency + (P - 1) / P * bytes * beta;
+	const double hdHalf = logP * latency + (pow2 - 1.0) / pow2 * bytes * beta
+			+ (folded ? segsAll * latency + bytes * beta : 0.0);
+	// each level of the tree passes on one segment at a time, taking it
+	// from, or giving it to, two children
+	const double treeHalf = (segsAll + logP) * 2 * (latency + seg * 4 * beta);
+	if (kind == COLLECTIVE_ALLREDUCE) {
+		ring = 2 * half;
+		hd = 2 * hdHalf;
+		tree = treeHalf + (logP + 1) * 2 * (latency + seg * 4 * beta);
+	} else {
+		// the root takes or gives P-1 chunks one after another
+		ring = 2 * half;
+		hd = hdHalf + (pow2 - 1.0) * latency + (pow2 - 1.0) / pow2 * bytes * beta;
+		tree = treeHalf;
+	}
+	if (tree < ring && tree < hd) {
+		return COLLECTIVE_TREE;
+	}
+	return hd < ring ? COLLECTIVE_HALVING_DOUBLING : COLLECTIVE_RING;
+}
+
+void collectiveSchedule(CollectiveKind kind, CollectiveAlgorithm algorithm,
+		size_t n, int places, int rank, int root, size_t segment,
+		CollectiveSchedule& schedule) {
+	if (places < 1 || rank < 0 || rank >= places
+			|| (kind != COLLECTIVE_ALLREDUCE && (root < 0 || root >= places))) {
+		Logger::logFatal("collectiveSchedule: rank or root out of range");
+	}
+	if (algorithm == COLLECTIVE_AUTO) {
+		algorithm = chooseCollective(kind, n, places, segment);
+	}
+	ScheduleBuilder b(n, places, segment);
+	if (kind == COLLECTIVE_ALLREDUCE) {
+		root = -1; // no rank is special, but the tree still needs a top
+	}
+	if (places > 1 && n > 0) {
+		switch (algorithm) {
+		case COLLECTIVE_HALVING_DOUBLING:
+			halvingDoubling(b, kind, root);
+			break;
+		case COLLECTIVE_TREE:
+			tree(b, kind, root);
+			break;
+		default:
+			ring(b, kind, root);
+			break;
+		}
+	}
+	b.finish(schedule.stagingSize, schedule.messages);
+	schedule.algorithm = algorithm;
+	schedule.ops.swap(b.ops[rank]);
+}
+
+size_t collectiveScheduleLongs(int kind, int algorithm, size_t n, int places,
+		int rank, int root, size_t segment, int64_t* out, size_t capacity) {
+	CollectiveSchedule s;
+	collectiveSchedule((CollectiveKind) kind, (CollectiveAlgorithm) algorithm,
+			n, places, rank, root, segment, s);
+	const size_t size = 4 + 6 * s.ops.size();
+	if (out == NULL || capacity < size) {
+		return size;
+	}
+	out[0] = s.algorithm;
+	out[1] = s.stagingSize;
+	out[2] = s.messages;
+	out[3] = s.ops.size();
+	for (size_t i = 0; i < s.ops.size(); ++i) {
+		int64_t* o = out + 4 + 6 * i;
+		o[0] = s.ops[i].kind;
+		o[1] = s.ops[i].peer;
+		o[2] = s.ops[i].lo;
+		o[3] = s.ops[i].n;
+		o[4] = s.ops[i].slot;
+		o[5] = s.ops[i].msg;
+	}
+	return size;
+}
+} /* namespace rudra */
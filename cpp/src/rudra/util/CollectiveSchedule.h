@@ -0,0 +1,147 @@
+/*
+ * CollectiveSchedule.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_COLLECTIVESCHEDULE_H_
+#define RUDRA_UTIL_COLLECTIVESCHEDULE_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace rudra {
+/*
+ * Schedules for collectives on a vector of n floats held by each of a
+ * group of places, computed rank by rank so that any transport that can
+ * push a range of floats into a peer's memory and tell it so can run
+ * them. X10's CollectiveEngine runs them over X10RT.
+ *
+ * A schedule is a list of operations for one rank, executed in order on a
+ * working buffer of n floats and a staging buffer that peers push into:
+ * a send copies buf[lo, lo+n) into the peer's staging at slot, as the
+ * peer's message msg; a receive waits for message msg, which will be at
+ * slot in the rank's own staging, and adds or copies it to buf[lo, lo+n).
+ * Sends never wait for the peer, so the lists of all ranks can always be
+ * run to the end whatever the timing. Every transfer is cut into segments
+ * of at most segment floats, each its own message, which pipelines the
+ * tree and bounds the size of any one message.
+ */
+enum CollectiveKind {
+	/** Every rank ends with the sum over ranks of buf. */
+	COLLECTIVE_ALLREDUCE,
+	/** The root ends with the sum; the others' buf is left undefined. */
+	COLLECTIVE_REDUCE,
+	/** Every rank ends with the root's buf. */
+	COLLECTIVE_BCAST
+};
+
+enum CollectiveAlgorithm {
+	/** Pick whichever of the others the cost model says is fastest. */
+	COLLECTIVE_AUTO,
+	/**
+	 * Reduce-scatter then all-gather around a ring: 2(P-1) steps, each
+	 * sending n/P floats. Bandwidth-optimal; for reduce and bcast, the ring
+	 * reduce-scatter is followed by a gather to the root, and a scatter
+	 * from the root by the ring all-gather.
+	 */
+	COLLECTIVE_RING,
+	/**
+	 * Recursive halving reduce-scatter then recursive doubling all-gather:
+	 * 2 log P steps of shrinking then growing size. Bandwidth-optimal with
+	 * far fewer messages than the ring; with P not a power of two, the
+	 * first ranks are folded into their neighbours first, at the cost of
+	 * sending the whole vector once more each way.
+	 */
+	COLLECTIVE_HALVING_DOUBLING,
+	/**
+	 * A binary tree, reducing each segment up towards the root while
+	 * broadcasting earlier ones down, so that all levels are busy at once.
+	 * Each link carries the whole vector, but only log P hops deep.
+	 */
+	COLLECTIVE_TREE
+};
+
+enum CollectiveOpKind {
+	COLLECTIVE_SEND, COLLECTIVE_RECV_ADD, COLLECTIVE_RECV_COPY
+};
+
+struct CollectiveOp {
+	CollectiveOpKind kind;
+	int peer;
+	size_t lo, n;
+	/** Where the message goes in the receiver's staging buffer. */
+	size_t slot;
+	/** The number of the message among those the receiver gets. */
+	size_t msg;
+};
+
+struct CollectiveSchedule {
+	CollectiveAlgorithm algorithm; // never COLLECTIVE_AUTO
+	std::vector<CollectiveOp> ops;
+	/**
+	 * The most floats of staging and messages any rank receives, the same
+	 * for every rank so that each can find the others' buffers when they
+	 * are kept for more than one collective at a time.
+	 */
+	size_t stagingSize;
+	size_t messages;
+};
+
+/** The name of the algorithm, as accepted by -collective: auto, ring, hd or tree. */
+const char* collectiveAlgorithmName(CollectiveAlgorithm algorithm);
+
+/**
+ * The algorithm the cost model expects to be fastest for the collective,
+ * with a latency of latency seconds per message and bandwidth bytes per
+ * second on every link.
+ */
+CollectiveAlgorithm chooseCollective(CollectiveKind kind, size_t n,
+		int places, size_t segment, double latency = 20e-6,
+		double bandwidth = 1e9);
+
+/** The schedule for one rank of the collective, rooted at root for reduce and bcast. */
+void collectiveSchedule(CollectiveKind kind, CollectiveAlgorithm algorithm,
+		size_t n, int places, int rank, int root, size_t segment,
+		CollectiveSchedule& schedule);
+
+/**
+ * The schedule flattened for X10: algorithm, stagingSize, messages and the
+ * number of ops, then kind, peer, lo, n, slot and msg for each op. Returns
+ * the number of values, which are only written if capacity is enough.
+ */
+size_t collectiveScheduleLongs(int kind, int algorithm, size_t n, int places,
+		int rank, int root, size_t segment, int64_t* out, size_t capacity);
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_COLLECTIVESCHEDULE_H_ */
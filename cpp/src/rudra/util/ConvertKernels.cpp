@@ -0,0 +1,670 @@
+/*
+ * ConvertKernels.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/ConvertKernels.h"
+#include "rudra/util/SimdDispatch.h"
+#include <cstring>
+#include <endian.h>
+#ifdef RUDRA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rudra {
+
+/*
+ * Each kernel variant converts elements [j, n) of a single record, and
+ * returns the index of the first element it did not convert; the scalar
+ * variant then finishes the record. A variant that reads its whole block of
+ * input before storing any output may be used in place, with the input at
+ * the tail of the output.
+ */
+typedef size_t (*MeanKernel)(const char* src, float* dst, size_t j, size_t n,
+		const float* mean, float scale);
+typedef size_t (*AffineKernel)(const char* src, float* dst, size_t j,
+		size_t n, const float* mul, const float* add);
+
+static inline uint32_t loadBE32(const char* p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return be32toh(v);
+}
+
+static inline uint16_t loadBE16(const char* p) {
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return be16toh(v);
+}
+
+static inline float bitsToFloat(uint32_t v) {
+	float f;
+	memcpy(&f, &v, sizeof(f));
+	return f;
+}
+
+static inline uint32_t floatToBits(float f) {
+	uint32_t v;
+	memcpy(&v, &f, sizeof(v));
+	return v;
+}
+
+float halfToFloat(uint16_t h) {
+	const uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+	const uint32_t exp = (h >> 10) & 0x1f;
+	uint32_t mant = h & 0x3ff;
+	uint32_t bits;
+	if (exp == 0x1f) {
+		bits = sign | 0x7f800000 | (mant << 13) | (mant ? 0x400000 : 0);
+	} else if (exp != 0) {
+		bits = sign | ((exp + 112) << 23) | (mant << 13);
+	} else if (mant == 0) {
+		bits = sign;
+	} else {
+		// subnormal: normalize the mantissa
+		uint32_t e = 113;
+		do {
+			--e;
+			mant <<= 1;
+		} while (!(mant & 0x400));
+		bits = sign | (e << 23) | ((mant & 0x3ff) << 13);
+	}
+	return bitsToFloat(bits);
+}
+
+uint16_t floatToHalf(float f) {
+	const uint32_t bits = floatToBits(f);
+	const uint16_t sign = (bits >> 16) & 0x8000;
+	const uint32_t absBits = bits & 0x7fffffff;
+	if (absBits >= 0x7f800000) {
+		// infinity, or a quiet NaN keeping the top of the payload
+		return sign | 0x7c00
+				| (absBits > 0x7f800000 ? 0x200 | (absBits & 0x7fffff) >> 13 : 0);
+	}
+	if (absBits >= 0x477ff000) {
+		return sign | 0x7c00; // rounds to more than the largest half
+	}
+	if (absBits < 0x38800000) {
+		// subnormal or zero in half precision: add 0.5 to align the
+		// mantissa, letting the FPU round to nearest even
+		float r = bitsToFloat(absBits) + 0.5f;
+		return sign | (uint16_t) (floatToBits(r) - 0x3f000000);
+	}
+	// normal: rebias the exponent and round the mantissa to nearest even
+	uint32_t v = absBits - ((uint32_t) (127 - 15) << 23);
+	v += 0xfff + ((v >> 13) & 1);
+	return sign | (uint16_t) (v >> 13);
+}
+
+uint16_t floatToBfloat16(float f) {
+	const uint32_t bits = floatToBits(f);
+	if ((bits & 0x7fffffff) > 0x7f800000) {
+		return (bits >> 16) | 0x40; // keep NaNs NaN
+	}
+	return (bits + 0x7fff + ((bits >> 16) & 1)) >> 16;
+}
+
+static size_t swapScalar(const char* src, char* dst, size_t j, size_t n) {
+	for (; j < n; ++j) {
+		uint32_t v = loadBE32(src + j * 4);
+		memcpy(dst + j * 4, &v, sizeof(v));
+	}
+	return j;
+}
+
+static size_t bswapScalar(const char* src, float* dst, size_t j, size_t n,
+		const float* mean, float scale) {
+	for (; j < n; ++j) {
+		float x = bitsToFloat(loadBE32(src + j * 4));
+		dst[j] = (x - (mean ? mean[j] : 0.0f)) * scale;
+	}
+	return j;
+}
+
+static size_t u8Scalar(const char* src, float* dst, size_t j, size_t n,
+		const float* mean, float scale) {
+	const uint8_t* in = (const uint8_t*) src;
+	for (; j < n; ++j) {
+		float x = in[j];
+		dst[j] = (x - (mean ? mean[j] : 0.0f)) * scale;
+	}
+	return j;
+}
+
+static size_t i32Scalar(const char* src, float* dst, size_t j, size_t n,
+		const float* mean, float scale) {
+	for (; j < n; ++j) {
+		float x = (float) (int32_t) loadBE32(src + j * 4);
+		dst[j] = (x - (mean ? mean[j] : 0.0f)) * scale;
+	}
+	return j;
+}
+
+static size_t halfScalar(const char* src, float* dst, size_t j, size_t n,
+		const float* mean, float scale) {
+	for (; j < n; ++j) {
+		float x = halfToFloat(loadBE16(src + j * 2));
+		dst[j] = (x - (mean ? mean[j] : 0.0f)) * scale;
+	}
+	return j;
+}
+
+static size_t bf16Scalar(const char* src, float* dst, size_t j, size_t n,
+		const float* mean, float scale) {
+	for (; j < n; ++j) {
+		float x = bitsToFloat((uint32_t) loadBE16(src + j * 2) << 16);
+		dst[j] = (x - (mean ? mean[j] : 0.0f)) * scale;
+	}
+	return j;
+}
+
+static size_t affineScalar(const char* src, float* dst, size_t j, size_t n,
+		const float* mul, const float* add) {
+	const uint8_t* in = (const uint8_t*) src;
+	for (; j < n; ++j) {
+		float x = in[j];
+		dst[j] = x * mul[j] + add[j];
+	}
+	return j;
+}
+
+static size_t toHalfScalar(const float* src, uint16_t* dst, size_t j,
+		size_t n) {
+	for (; j < n; ++j) {
+		dst[j] = floatToHalf(src[j]);
+	}
+	return j;
+}
+
+static size_t fromHalfScalar(const uint16_t* src, float* dst, size_t j,
+		size_t n) {
+	for (; j < n; ++j) {
+		dst[j] = halfToFloat(src[j]);
+	}
+	return j;
+}
+
+#ifdef RUDRA_X86_SIMD
+/*
+ * The vector variants. Each loads a block of input, converts it to a vector
+ * of floats x, and stores (x - mean) * scale, or x * mul + add.
+ */
+#define SSE_TARGET __attribute__((target("sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2,f16c")))
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw")))
+
+SSE_TARGET static inline void storeSSE(float* dst, size_t j, __m128 x,
+		const float* mean, __m128 s) {
+	__m128 m = mean ? _mm_loadu_ps(mean + j) : _mm_setzero_ps();
+	_mm_storeu_ps(dst + j, _mm_mul_ps(_mm_sub_ps(x, m), s));
+}
+
+AVX2_TARGET static inline void storeAVX2(float* dst, size_t j, __m256 x,
+		const float* mean, __m256 s) {
+	__m256 m = mean ? _mm256_loadu_ps(mean + j) : _mm256_setzero_ps();
+	_mm256_storeu_ps(dst + j, _mm256_mul_ps(_mm256_sub_ps(x, m), s));
+}
+
+AVX512_TARGET static inline void storeAVX512(float* dst, size_t j, __m512 x,
+		const float* mean, __m512 s) {
+	__m512 m = mean ? _mm512_loadu_ps(mean + j) : _mm512_setzero_ps();
+	_mm512_storeu_ps(dst + j, _mm512_mul_ps(_mm512_sub_ps(x, m), s));
+}
+
+SSE_TARGET static inline __m128i swap32SSE() {
+	return _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+}
+
+SSE_TARGET static inline __m128i swap16SSE() {
+	return _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+}
+
+AVX2_TARGET static inline __m256i swap32AVX2() {
+	return _mm256_broadcastsi128_si256(
+			_mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2,
+					3));
+}
+
+AVX512_TARGET static inline __m512i swap32AVX512() {
+	return _mm512_broadcast_i32x4(
+			_mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2,
+					3));
+}
+
+SSE_TARGET static size_t swapSSE(const char* src, char* dst, size_t j,
+		size_t n) {
+	const __m128i shuf = swap32SSE();
+	for (; j + 4 <= n; j += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j * 4));
+		_mm_storeu_si128((__m128i *) (dst + j * 4), _mm_shuffle_epi8(v, shuf));
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t swapAVX2(const char* src, char* dst, size_t j,
+		size_t n) {
+	const __m256i shuf = swap32AVX2();
+	for (; j + 8 <= n; j += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (src + j * 4));
+		_mm256_storeu_si256((__m256i *) (dst + j * 4),
+				_mm256_shuffle_epi8(v, shuf));
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t swapAVX512(const char* src, char* dst, size_t j,
+		size_t n) {
+	const __m512i shuf = swap32AVX512();
+	for (; j + 16 <= n; j += 16) {
+		__m512i v = _mm512_loadu_si512((const void *) (src + j * 4));
+		_mm512_storeu_si512((void *) (dst + j * 4), _mm512_shuffle_epi8(v, shuf));
+	}
+	return j;
+}
+
+SSE_TARGET static size_t bswapSSE(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m128i shuf = swap32SSE();
+	const __m128 s = _mm_set1_ps(scale);
+	for (; j + 4 <= n; j += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j * 4));
+		storeSSE(dst, j, _mm_castsi128_ps(_mm_shuffle_epi8(v, shuf)), mean, s);
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t bswapAVX2(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m256i shuf = swap32AVX2();
+	const __m256 s = _mm256_set1_ps(scale);
+	for (; j + 8 <= n; j += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (src + j * 4));
+		storeAVX2(dst, j, _mm256_castsi256_ps(_mm256_shuffle_epi8(v, shuf)),
+				mean, s);
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t bswapAVX512(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m512i shuf = swap32AVX512();
+	const __m512 s = _mm512_set1_ps(scale);
+	for (; j + 16 <= n; j += 16) {
+		__m512i v = _mm512_loadu_si512((const void *) (src + j * 4));
+		storeAVX512(dst, j, _mm512_castsi512_ps(_mm512_shuffle_epi8(v, shuf)),
+				mean, s);
+	}
+	return j;
+}
+
+SSE_TARGET static size_t i32SSE(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m128i shuf = swap32SSE();
+	const __m128 s = _mm_set1_ps(scale);
+	for (; j + 4 <= n; j += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j * 4));
+		storeSSE(dst, j, _mm_cvtepi32_ps(_mm_shuffle_epi8(v, shuf)), mean, s);
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t i32AVX2(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m256i shuf = swap32AVX2();
+	const __m256 s = _mm256_set1_ps(scale);
+	for (; j + 8 <= n; j += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (src + j * 4));
+		storeAVX2(dst, j, _mm256_cvtepi32_ps(_mm256_shuffle_epi8(v, shuf)),
+				mean, s);
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t i32AVX512(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m512i shuf = swap32AVX512();
+	const __m512 s = _mm512_set1_ps(scale);
+	for (; j + 16 <= n; j += 16) {
+		__m512i v = _mm512_loadu_si512((const void *) (src + j * 4));
+		storeAVX512(dst, j, _mm512_cvtepi32_ps(_mm512_shuffle_epi8(v, shuf)),
+				mean, s);
+	}
+	return j;
+}
+
+SSE_TARGET static size_t u8SSE(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m128 s = _mm_set1_ps(scale);
+	for (; j + 16 <= n; j += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j));
+		__m128 x0 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+		__m128 x1 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4)));
+		__m128 x2 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+		__m128 x3 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12)));
+		storeSSE(dst, j, x0, mean, s);
+		storeSSE(dst, j + 4, x1, mean, s);
+		storeSSE(dst, j + 8, x2, mean, s);
+		storeSSE(dst, j + 12, x3, mean, s);
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t u8AVX2(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m256 s = _mm256_set1_ps(scale);
+	for (; j + 16 <= n; j += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j));
+		__m256 x0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+		__m256 x1 = _mm256_cvtepi32_ps(
+				_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+		storeAVX2(dst, j, x0, mean, s);
+		storeAVX2(dst, j + 8, x1, mean, s);
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t u8AVX512(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m512 s = _mm512_set1_ps(scale);
+	for (; j + 16 <= n; j += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j));
+		storeAVX512(dst, j, _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(v)), mean,
+				s);
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t halfAVX2(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m128i shuf = swap16SSE();
+	const __m256 s = _mm256_set1_ps(scale);
+	for (; j + 8 <= n; j += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j * 2));
+		storeAVX2(dst, j, _mm256_cvtph_ps(_mm_shuffle_epi8(v, shuf)), mean, s);
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t halfAVX512(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m256i shuf = _mm256_broadcastsi128_si256(swap16SSE());
+	const __m512 s = _mm512_set1_ps(scale);
+	for (; j + 16 <= n; j += 16) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (src + j * 2));
+		storeAVX512(dst, j, _mm512_cvtph_ps(_mm256_shuffle_epi8(v, shuf)),
+				mean, s);
+	}
+	return j;
+}
+
+SSE_TARGET static size_t bf16SSE(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m128i shuf = swap16SSE();
+	const __m128 s = _mm_set1_ps(scale);
+	for (; j + 8 <= n; j += 8) {
+		__m128i v = _mm_shuffle_epi8(
+				_mm_loadu_si128((const __m128i *) (src + j * 2)), shuf);
+		__m128i lo = _mm_unpacklo_epi16(_mm_setzero_si128(), v);
+		__m128i hi = _mm_unpackhi_epi16(_mm_setzero_si128(), v);
+		storeSSE(dst, j, _mm_castsi128_ps(lo), mean, s);
+		storeSSE(dst, j + 4, _mm_castsi128_ps(hi), mean, s);
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t bf16AVX2(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m128i shuf = swap16SSE();
+	const __m256 s = _mm256_set1_ps(scale);
+	for (; j + 8 <= n; j += 8) {
+		__m128i v = _mm_shuffle_epi8(
+				_mm_loadu_si128((const __m128i *) (src + j * 2)), shuf);
+		__m256i x = _mm256_slli_epi32(_mm256_cvtepu16_epi32(v), 16);
+		storeAVX2(dst, j, _mm256_castsi256_ps(x), mean, s);
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t bf16AVX512(const char* src, float* dst, size_t j,
+		size_t n, const float* mean, float scale) {
+	const __m256i shuf = _mm256_broadcastsi128_si256(swap16SSE());
+	const __m512 s = _mm512_set1_ps(scale);
+	for (; j + 16 <= n; j += 16) {
+		__m256i v = _mm256_shuffle_epi8(
+				_mm256_loadu_si256((const __m256i *) (src + j * 2)), shuf);
+		__m512i x = _mm512_slli_epi32(_mm512_cvtepu16_epi32(v), 16);
+		storeAVX512(dst, j, _mm512_castsi512_ps(x), mean, s);
+	}
+	return j;
+}
+
+SSE_TARGET static size_t affineSSE(const char* src, float* dst, size_t j,
+		size_t n, const float* mul, const float* add) {
+	for (; j + 16 <= n; j += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j));
+		__m128 x[4];
+		x[0] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+		x[1] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4)));
+		x[2] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+		x[3] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12)));
+		for (int k = 0; k < 4; ++k) {
+			const size_t i = j + 4 * k;
+			_mm_storeu_ps(dst + i,
+					_mm_add_ps(_mm_mul_ps(x[k], _mm_loadu_ps(mul + i)),
+							_mm_loadu_ps(add + i)));
+		}
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t affineAVX2(const char* src, float* dst, size_t j,
+		size_t n, const float* mul, const float* add) {
+	for (; j + 16 <= n; j += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j));
+		__m256 x0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+		__m256 x1 = _mm256_cvtepi32_ps(
+				_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+		_mm256_storeu_ps(dst + j,
+				_mm256_add_ps(_mm256_mul_ps(x0, _mm256_loadu_ps(mul + j)),
+						_mm256_loadu_ps(add + j)));
+		_mm256_storeu_ps(dst + j + 8,
+				_mm256_add_ps(_mm256_mul_ps(x1, _mm256_loadu_ps(mul + j + 8)),
+						_mm256_loadu_ps(add + j + 8)));
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t affineAVX512(const char* src, float* dst,
+		size_t j, size_t n, const float* mul, const float* add) {
+	for (; j + 16 <= n; j += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + j));
+		__m512 x = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(v));
+		_mm512_storeu_ps(dst + j,
+				_mm512_add_ps(_mm512_mul_ps(x, _mm512_loadu_ps(mul + j)),
+						_mm512_loadu_ps(add + j)));
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t toHalfAVX2(const float* src, uint16_t* dst,
+		size_t j, size_t n) {
+	for (; j + 8 <= n; j += 8) {
+		_mm_storeu_si128((__m128i *) (dst + j),
+				_mm256_cvtps_ph(_mm256_loadu_ps(src + j),
+						_MM_FROUND_TO_NEAREST_INT));
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t toHalfAVX512(const float* src, uint16_t* dst,
+		size_t j, size_t n) {
+	for (; j + 16 <= n; j += 16) {
+		_mm256_storeu_si256((__m256i *) (dst + j),
+				_mm512_cvtps_ph(_mm512_loadu_ps(src + j),
+						_MM_FROUND_TO_NEAREST_INT));
+	}
+	return j;
+}
+
+AVX2_TARGET static size_t fromHalfAVX2(const uint16_t* src, float* dst,
+		size_t j, size_t n) {
+	for (; j + 8 <= n; j += 8) {
+		_mm256_storeu_ps(dst + j,
+				_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (src + j))));
+	}
+	return j;
+}
+
+AVX512_TARGET static size_t fromHalfAVX512(const uint16_t* src, float* dst,
+		size_t j, size_t n) {
+	for (; j + 16 <= n; j += 16) {
+		_mm512_storeu_ps(dst + j,
+				_mm512_cvtph_ps(
+						_mm256_loadu_si256((const __m256i *) (src + j))));
+	}
+	return j;
+}
+#endif
+
+/** Choose the variant of a kernel for the current SIMD level, if any. */
+template<class K>
+static K pick(K avx512, K avx2, K sse) {
+#ifdef RUDRA_X86_SIMD
+	switch (simdLevel()) {
+	case SIMD_AVX512:
+		return avx512;
+	case SIMD_AVX2:
+		return avx2;
+	case SIMD_SSE:
+		return sse;
+	default:
+		break;
+	}
+#endif
+	return NULL;
+}
+
+#ifdef RUDRA_X86_SIMD
+#define PICK(name) pick(name##AVX512, name##AVX2, name##SSE)
+#define PICK_AVX(name) \
+	pick(name##AVX512, name##AVX2, (decltype(&name##AVX2)) NULL)
+#else
+#define PICK(name) NULL
+#define PICK_AVX(name) NULL
+#endif
+
+/**
+ * Convert numRecords records of elemSize-byte elements, one record at a
+ * time, with the vector variant (if any) followed by the scalar variant.
+ */
+static void convertRecords(MeanKernel vec, MeanKernel scalar,
+		const char* src, size_t elemSize, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean, float scale) {
+	for (size_t r = 0; r < numRecords; ++r) {
+		const char* in = src + r * recordSize * elemSize;
+		float* out = dst + r * recordSize;
+		size_t j = vec ? vec(in, out, 0, recordSize, mean, scale) : 0;
+		scalar(in, out, j, recordSize, mean, scale);
+	}
+}
+
+void bigEndianToHost32(const void* src, void* dst, size_t count) {
+	typedef size_t (*SwapKernel)(const char*, char*, size_t, size_t);
+	SwapKernel vec = PICK(swap);
+	const char* in = (const char*) src;
+	char* out = (char*) dst;
+	size_t j = vec ? vec(in, out, 0, count) : 0;
+	swapScalar(in, out, j, count);
+}
+
+void convertBigEndianFloats(const void* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean, float scale) {
+	if (mean == NULL && scale == 1.0f) {
+		bigEndianToHost32(src, dst, numRecords * recordSize);
+		return;
+	}
+	convertRecords(PICK(bswap), bswapScalar, (const char*) src, 4, dst,
+			numRecords, recordSize, mean, scale);
+}
+
+void convertUint8(const uint8_t* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean, float scale) {
+	convertRecords(PICK(u8), u8Scalar, (const char*) src, 1, dst, numRecords,
+			recordSize, mean, scale);
+}
+
+void convertBigEndianInt32(const void* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean, float scale) {
+	convertRecords(PICK(i32), i32Scalar, (const char*) src, 4, dst,
+			numRecords, recordSize, mean, scale);
+}
+
+void convertBigEndianHalfs(const void* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean, float scale) {
+	// F16C needs AVX, so there is no SSE variant
+	convertRecords(PICK_AVX(half), halfScalar, (const char*) src, 2, dst,
+			numRecords, recordSize, mean, scale);
+}
+
+void convertBigEndianBfloat16s(const void* src, float* dst,
+		size_t numRecords, size_t recordSize, const float* mean, float scale) {
+	convertRecords(PICK(bf16), bf16Scalar, (const char*) src, 2, dst,
+			numRecords, recordSize, mean, scale);
+}
+
+void convertUint8Affine(const uint8_t* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mul, const float* add) {
+	AffineKernel vec = PICK(affine);
+	for (size_t r = 0; r < numRecords; ++r) {
+		const char* in = (const char*) src + r * recordSize;
+		float* out = dst + r * recordSize;
+		size_t j = vec ? vec(in, out, 0, recordSize, mul, add) : 0;
+		affineScalar(in, out, j, recordSize, mul, add);
+	}
+}
+
+void floatsToHalfs(const float* src, uint16_t* dst, size_t count) {
+	typedef size_t (*ToHalfKernel)(const float*, uint16_t*, size_t, size_t);
+	ToHalfKernel vec = PICK_AVX(toHalf);
+	size_t j = vec ? vec(src, dst, 0, count) : 0;
+	toHalfScalar(src, dst, j, count);
+}
+
+void halfsToFloats(const uint16_t* src, float* dst, size_t count) {
+	typedef size_t (*FromHalfKernel)(const uint16_t*, float*, size_t, size_t);
+	FromHalfKernel vec = PICK_AVX(fromHalf);
+	size_t j = vec ? vec(src, dst, 0, count) : 0;
+	fromHalfScalar(src, dst, j, count);
+}
+
+} /* namespace rudra */
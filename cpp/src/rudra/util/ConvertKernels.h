@@ -0,0 +1,126 @@
+/*
+ * ConvertKernels.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_CONVERTKERNELS_H_
+#define RUDRA_UTIL_CONVERTKERNELS_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace rudra {
+
+/*
+ * Kernels that convert records read from a binary data file into the float
+ * matrices handed to a learner. Each converts, optionally subtracts a
+ * per-feature mean and scales in a single pass, so every input byte is
+ * touched once:
+ *     dst[r * recordSize + j] = (x[r * recordSize + j] - mean[j]) * scale
+ * where x is the converted input and mean may be NULL (no subtraction).
+ * The vector paths produce results identical to the scalar path.
+ */
+
+/**
+ * Convert count big-endian 32-bit values to host byte order, without
+ * interpreting them. src and dst may be the same buffer.
+ */
+void bigEndianToHost32(const void* src, void* dst, size_t count);
+
+/**
+ * Convert big-endian floats to host-order floats.
+ * src and dst may be the same buffer.
+ */
+void convertBigEndianFloats(const void* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean = NULL, float scale = 1.0f);
+
+/**
+ * Widen unsigned bytes to floats.
+ * src may lie within the last numRecords * recordSize bytes of dst, so raw
+ * bytes can be read into the tail of the destination and widened in place.
+ */
+void convertUint8(const uint8_t* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean = NULL, float scale = 1.0f);
+
+/**
+ * Convert big-endian signed 32-bit integers to floats.
+ * src and dst may be the same buffer.
+ */
+void convertBigEndianInt32(const void* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean = NULL, float scale = 1.0f);
+
+/**
+ * Convert big-endian IEEE half-precision values to floats.
+ * src may lie within the last 2 * numRecords * recordSize bytes of dst.
+ */
+void convertBigEndianHalfs(const void* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mean = NULL, float scale = 1.0f);
+
+/**
+ * Convert big-endian bfloat16 values (the top half of a float) to floats.
+ * src may lie within the last 2 * numRecords * recordSize bytes of dst.
+ */
+void convertBigEndianBfloat16s(const void* src, float* dst,
+		size_t numRecords, size_t recordSize, const float* mean = NULL,
+		float scale = 1.0f);
+
+/**
+ * Dequantize unsigned bytes with a per-feature affine map:
+ *     dst[r * recordSize + j] = src[r * recordSize + j] * mul[j] + add[j]
+ * Mean subtraction and scaling can be folded into mul and add.
+ * src may lie within the last numRecords * recordSize bytes of dst.
+ */
+void convertUint8Affine(const uint8_t* src, float* dst, size_t numRecords,
+		size_t recordSize, const float* mul, const float* add);
+
+/**
+ * Round count host-order floats to host-order IEEE half-precision values,
+ * as floatToHalf does.
+ */
+void floatsToHalfs(const float* src, uint16_t* dst, size_t count);
+
+/** Convert count host-order IEEE half-precision values to floats exactly. */
+void halfsToFloats(const uint16_t* src, float* dst, size_t count);
+
+/** Round a float to the nearest IEEE half-precision value (ties to even). */
+uint16_t floatToHalf(float f);
+
+/** Convert a half-precision value to a float exactly, quieting NaNs as F16C does. */
+float halfToFloat(uint16_t h);
+
+/** Round a float to the nearest bfloat16 value (ties to even). */
+uint16_t floatToBfloat16(float f);
+
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_CONVERTKERNELS_H_ */
@@ -0,0 +1,140 @@
+/*
+ * EventCount.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_EVENTCOUNT_H_
+#define RUDRA_UTIL_EVENTCOUNT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+namespace rudra {
+
+/** Size of a cache line, used to keep hot atomics from sharing one. */
+const size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * Number of times a waiting thread polls before blocking in the kernel:
+ * HANDOFF_SPINS, or none on a machine with a single CPU, where the thread it
+ * waits for cannot run while it spins.
+ */
+const int HANDOFF_SPINS = 256;
+int handoffSpins();
+
+/** Hint to the CPU that the caller is busy-waiting. */
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Lets threads block until a condition they poll may have changed, without
+ * a lock. The state is one futex word: an epoch, advanced by each
+ * notification that finds a waiter, with the low bit set while some thread
+ * may be waiting. Notification is a fence and a load when that bit is clear,
+ * so the lock-free handoffs built on this only enter the kernel when a
+ * consumer finds them empty or a producer finds them full, and then only
+ * once per wait rather than once per value.
+ * A waiter polls its condition as follows:
+ *
+ *     while (!condition()) {
+ *         uint32_t key = ec.prepareWait();
+ *         if (condition()) {
+ *             break;
+ *         }
+ *         ec.wait(key);
+ *     }
+ *
+ * and a notifier makes the condition true, then calls ec.notifyAll().
+ */
+class EventCount {
+public:
+	EventCount() :
+			state(0) {
+	}
+
+	uint32_t prepareWait() {
+		return state.fetch_or(WAITING, std::memory_order_seq_cst) | WAITING;
+	}
+
+	/** Block until notified after prepareWait returned key. */
+	void wait(uint32_t key);
+
+	void notifyAll() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint32_t s = state.load(std::memory_order_relaxed);
+		while (s & WAITING) {
+			if (state.compare_exchange_weak(s, (s + 2) & ~WAITING,
+					std::memory_order_seq_cst)) {
+				wake();
+				return;
+			}
+		}
+	}
+
+private:
+	static const uint32_t WAITING = 1;
+	std::atomic<uint32_t> state;
+
+	EventCount(const EventCount&);
+	EventCount& operator=(const EventCount&);
+
+	void wake();
+};
+
+/**
+ * Poll cond up to handoffSpins() times, then block on ec until it holds.
+ */
+template<class Cond>
+void awaitCondition(EventCount& ec, Cond cond) {
+	const int spins = handoffSpins();
+	for (int i = 0; i < spins; ++i) {
+		if (cond()) {
+			return;
+		}
+		cpuRelax();
+	}
+	while (!cond()) {
+		uint32_t key = ec.prepareWait();
+		if (cond()) {
+			return;
+		}
+		ec.wait(key);
+	}
+}
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_EVENTCOUNT_H_ */
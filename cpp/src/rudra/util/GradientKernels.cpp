@@ -0,0 +1,440 @@
+/*
+ * GradientKernels.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/GradientKernels.h"
+#include "rudra/util/SimdDispatch.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef RUDRA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rudra {
+
+/*
+ * Each variant processes elements [lo, hi); vector variants finish any tail
+ * with the scalar variant. Work is split into BLOCK-element blocks, which
+ * are the unit both of OpenMP scheduling and of partial reductions.
+ */
+static const size_t BLOCK = 1 << 16;
+
+static void axpyScalar(float a, const float* x, float* y, size_t lo,
+		size_t hi) {
+	for (size_t i = lo; i < hi; ++i) {
+		y[i] += a * x[i];
+	}
+}
+
+static void addScalar(const float* x, float* y, size_t lo, size_t hi) {
+	for (size_t i = lo; i < hi; ++i) {
+		y[i] += x[i];
+	}
+}
+
+static void scaledAddScalar(float a, const float* x, float b, float* y,
+		size_t lo, size_t hi) {
+	for (size_t i = lo; i < hi; ++i) {
+		y[i] = a * x[i] + b * y[i];
+	}
+}
+
+static double sumScalar(const float* x, size_t lo, size_t hi) {
+	double s = 0;
+	for (size_t i = lo; i < hi; ++i) {
+		s += x[i];
+	}
+	return s;
+}
+
+static double sumSquaresScalar(const float* x, size_t lo, size_t hi) {
+	double s = 0;
+	for (size_t i = lo; i < hi; ++i) {
+		s += (double) x[i] * x[i];
+	}
+	return s;
+}
+
+static float maxAbsScalar(const float* x, size_t lo, size_t hi, float m) {
+	for (size_t i = lo; i < hi; ++i) {
+		const float v = fabsf(x[i]);
+		m = v > m ? v : m;
+	}
+	return m;
+}
+
+static size_t accumulateCountScalar(const float* x, float* y, size_t lo,
+		size_t hi) {
+	size_t count = 0;
+	for (size_t i = lo; i < hi; ++i) {
+		y[i] += x[i];
+		count += x[i] != 0.0f;
+	}
+	return count;
+}
+
+#ifdef RUDRA_X86_SIMD
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw")))
+
+AVX2_TARGET static void axpyAVX2(float a, const float* x, float* y,
+		size_t lo, size_t hi) {
+	const __m256 va = _mm256_set1_ps(a);
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		__m256 p = _mm256_mul_ps(va, _mm256_loadu_ps(x + i));
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), p));
+	}
+	axpyScalar(a, x, y, i, hi);
+}
+
+AVX512_TARGET static void axpyAVX512(float a, const float* x, float* y,
+		size_t lo, size_t hi) {
+	const __m512 va = _mm512_set1_ps(a);
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		__m512 p = _mm512_mul_ps(va, _mm512_loadu_ps(x + i));
+		_mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(y + i), p));
+	}
+	axpyScalar(a, x, y, i, hi);
+}
+
+AVX2_TARGET static void addAVX2(const float* x, float* y, size_t lo,
+		size_t hi) {
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		_mm256_storeu_ps(y + i,
+				_mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+	}
+	addScalar(x, y, i, hi);
+}
+
+AVX512_TARGET static void addAVX512(const float* x, float* y, size_t lo,
+		size_t hi) {
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		_mm512_storeu_ps(y + i,
+				_mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i)));
+	}
+	addScalar(x, y, i, hi);
+}
+
+AVX2_TARGET static void scaledAddAVX2(float a, const float* x, float b,
+		float* y, size_t lo, size_t hi) {
+	const __m256 va = _mm256_set1_ps(a);
+	const __m256 vb = _mm256_set1_ps(b);
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		__m256 p = _mm256_mul_ps(va, _mm256_loadu_ps(x + i));
+		__m256 q = _mm256_mul_ps(vb, _mm256_loadu_ps(y + i));
+		_mm256_storeu_ps(y + i, _mm256_add_ps(p, q));
+	}
+	scaledAddScalar(a, x, b, y, i, hi);
+}
+
+AVX512_TARGET static void scaledAddAVX512(float a, const float* x, float b,
+		float* y, size_t lo, size_t hi) {
+	const __m512 va = _mm512_set1_ps(a);
+	const __m512 vb = _mm512_set1_ps(b);
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		__m512 p = _mm512_mul_ps(va, _mm512_loadu_ps(x + i));
+		__m512 q = _mm512_mul_ps(vb, _mm512_loadu_ps(y + i));
+		_mm512_storeu_ps(y + i, _mm512_add_ps(p, q));
+	}
+	scaledAddScalar(a, x, b, y, i, hi);
+}
+
+/** Horizontal sum of four doubles, in a fixed order. */
+AVX2_TARGET static inline double hsumAVX2(__m256d v) {
+	__m128d s = _mm_add_pd(_mm256_castpd256_pd128(v),
+			_mm256_extractf128_pd(v, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+AVX2_TARGET static double sumAVX2(const float* x, size_t lo, size_t hi) {
+	// four independent accumulators hide the latency of the adds
+	__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+	__m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		s0 = _mm256_add_pd(s0, _mm256_cvtps_pd(_mm_loadu_ps(x + i)));
+		s1 = _mm256_add_pd(s1, _mm256_cvtps_pd(_mm_loadu_ps(x + i + 4)));
+		s2 = _mm256_add_pd(s2, _mm256_cvtps_pd(_mm_loadu_ps(x + i + 8)));
+		s3 = _mm256_add_pd(s3, _mm256_cvtps_pd(_mm_loadu_ps(x + i + 12)));
+	}
+	return hsumAVX2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)))
+			+ sumScalar(x, i, hi);
+}
+
+AVX512_TARGET static double sumAVX512(const float* x, size_t lo,
+		size_t hi) {
+	__m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+	__m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+	size_t i = lo;
+	for (; i + 32 <= hi; i += 32) {
+		s0 = _mm512_add_pd(s0, _mm512_cvtps_pd(_mm256_loadu_ps(x + i)));
+		s1 = _mm512_add_pd(s1, _mm512_cvtps_pd(_mm256_loadu_ps(x + i + 8)));
+		s2 = _mm512_add_pd(s2, _mm512_cvtps_pd(_mm256_loadu_ps(x + i + 16)));
+		s3 = _mm512_add_pd(s3, _mm512_cvtps_pd(_mm256_loadu_ps(x + i + 24)));
+	}
+	return _mm512_reduce_add_pd(
+			_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)))
+			+ sumScalar(x, i, hi);
+}
+
+AVX2_TARGET static double sumSquaresAVX2(const float* x, size_t lo,
+		size_t hi) {
+	__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+	__m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		__m256d d0 = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+		__m256d d1 = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 4));
+		__m256d d2 = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 8));
+		__m256d d3 = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 12));
+		s0 = _mm256_add_pd(s0, _mm256_mul_pd(d0, d0));
+		s1 = _mm256_add_pd(s1, _mm256_mul_pd(d1, d1));
+		s2 = _mm256_add_pd(s2, _mm256_mul_pd(d2, d2));
+		s3 = _mm256_add_pd(s3, _mm256_mul_pd(d3, d3));
+	}
+	return hsumAVX2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)))
+			+ sumSquaresScalar(x, i, hi);
+}
+
+AVX512_TARGET static double sumSquaresAVX512(const float* x, size_t lo,
+		size_t hi) {
+	__m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+	__m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+	size_t i = lo;
+	for (; i + 32 <= hi; i += 32) {
+		__m512d d0 = _mm512_cvtps_pd(_mm256_loadu_ps(x + i));
+		__m512d d1 = _mm512_cvtps_pd(_mm256_loadu_ps(x + i + 8));
+		__m512d d2 = _mm512_cvtps_pd(_mm256_loadu_ps(x + i + 16));
+		__m512d d3 = _mm512_cvtps_pd(_mm256_loadu_ps(x + i + 24));
+		s0 = _mm512_add_pd(s0, _mm512_mul_pd(d0, d0));
+		s1 = _mm512_add_pd(s1, _mm512_mul_pd(d1, d1));
+		s2 = _mm512_add_pd(s2, _mm512_mul_pd(d2, d2));
+		s3 = _mm512_add_pd(s3, _mm512_mul_pd(d3, d3));
+	}
+	return _mm512_reduce_add_pd(
+			_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)))
+			+ sumSquaresScalar(x, i, hi);
+}
+
+AVX2_TARGET static float maxAbsAVX2(const float* x, size_t lo, size_t hi,
+		float m) {
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 vm = _mm256_set1_ps(m);
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		__m256 v = _mm256_and_ps(_mm256_loadu_ps(x + i), absMask);
+		vm = _mm256_max_ps(v, vm); // returns vm if v is NaN
+	}
+	float lanes[8];
+	_mm256_storeu_ps(lanes, vm);
+	return maxAbsScalar(x, i, hi, maxAbsScalar(lanes, 0, 8, m));
+}
+
+AVX512_TARGET static float maxAbsAVX512(const float* x, size_t lo,
+		size_t hi, float m) {
+	__m512 vm = _mm512_set1_ps(m);
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		__m512 v = _mm512_abs_ps(_mm512_loadu_ps(x + i));
+		vm = _mm512_max_ps(v, vm); // returns vm if v is NaN
+	}
+	float lanes[16];
+	_mm512_storeu_ps(lanes, vm);
+	return maxAbsScalar(x, i, hi, maxAbsScalar(lanes, 0, 16, m));
+}
+
+AVX2_TARGET static size_t accumulateCountAVX2(const float* x, float* y,
+		size_t lo, size_t hi) {
+	const __m256 zero = _mm256_setzero_ps();
+	size_t count = 0;
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		__m256 v = _mm256_loadu_ps(x + i);
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), v));
+		count += __builtin_popcount(
+				_mm256_movemask_ps(_mm256_cmp_ps(v, zero, _CMP_NEQ_UQ)));
+	}
+	return count + accumulateCountScalar(x, y, i, hi);
+}
+
+AVX512_TARGET static size_t accumulateCountAVX512(const float* x, float* y,
+		size_t lo, size_t hi) {
+	const __m512 zero = _mm512_setzero_ps();
+	size_t count = 0;
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		__m512 v = _mm512_loadu_ps(x + i);
+		_mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(y + i), v));
+		count += __builtin_popcount(
+				_mm512_cmp_ps_mask(v, zero, _CMP_NEQ_UQ));
+	}
+	return count + accumulateCountScalar(x, y, i, hi);
+}
+#endif
+
+/** Choose the variant of a kernel for the current SIMD level. */
+template<class K>
+static K pick(K avx512, K avx2, K scalar) {
+#ifdef RUDRA_X86_SIMD
+	switch (simdLevel()) {
+	case SIMD_AVX512:
+		return avx512;
+	case SIMD_AVX2:
+		return avx2;
+	default:
+		break;
+	}
+#endif
+	return scalar;
+}
+
+#ifdef RUDRA_X86_SIMD
+#define PICK(name) pick(name##AVX512, name##AVX2, name##Scalar)
+#else
+#define PICK(name) name##Scalar
+#endif
+
+static inline size_t numBlocks(size_t n) {
+	return (n + BLOCK - 1) / BLOCK;
+}
+
+static inline size_t blockEnd(size_t b, size_t n) {
+	return (b + 1) * BLOCK < n ? (b + 1) * BLOCK : n;
+}
+
+void axpy(float a, const float* x, float* y, size_t n) {
+	void (*k)(float, const float*, float*, size_t, size_t) = PICK(axpy);
+	const long blocks = numBlocks(n);
+#pragma omp parallel for schedule(static) if (n >= KERNEL_PARALLEL_THRESHOLD)
+	for (long b = 0; b < blocks; ++b) {
+		k(a, x, y, b * BLOCK, blockEnd(b, n));
+	}
+}
+
+void addInto(const float* x, float* y, size_t n) {
+	void (*k)(const float*, float*, size_t, size_t) = PICK(add);
+	const long blocks = numBlocks(n);
+#pragma omp parallel for schedule(static) if (n >= KERNEL_PARALLEL_THRESHOLD)
+	for (long b = 0; b < blocks; ++b) {
+		k(x, y, b * BLOCK, blockEnd(b, n));
+	}
+}
+
+void scaledAdd(float a, const float* x, float b, float* y, size_t n) {
+	void (*k)(float, const float*, float, float*, size_t, size_t) = PICK(
+			scaledAdd);
+	const long blocks = numBlocks(n);
+#pragma omp parallel for schedule(static) if (n >= KERNEL_PARALLEL_THRESHOLD)
+	for (long i = 0; i < blocks; ++i) {
+		k(a, x, b, y, i * BLOCK, blockEnd(i, n));
+	}
+}
+
+void zero(float* y, size_t n) {
+	// one large memset per thread, rather than one per block, lets the C
+	// library use streaming stores
+#pragma omp parallel if (n >= KERNEL_PARALLEL_THRESHOLD)
+	{
+		size_t lo = 0, hi = n;
+#ifdef _OPENMP
+		const size_t t = omp_get_thread_num(), T = omp_get_num_threads();
+		lo = n * t / T;
+		hi = n * (t + 1) / T;
+#endif
+		memset(y + lo, 0, (hi - lo) * sizeof(float));
+	}
+}
+
+/** Sum a per-block reduction, combining the blocks in order. */
+static double blockedSum(double (*k)(const float*, size_t, size_t),
+		const float* x, size_t n) {
+	const long blocks = numBlocks(n);
+	std::vector<double> partial(blocks);
+#pragma omp parallel for schedule(static) if (n >= KERNEL_PARALLEL_THRESHOLD)
+	for (long b = 0; b < blocks; ++b) {
+		partial[b] = k(x, b * BLOCK, blockEnd(b, n));
+	}
+	double s = 0;
+	for (long b = 0; b < blocks; ++b) {
+		s += partial[b];
+	}
+	return s;
+}
+
+double sum(const float* x, size_t n) {
+	return blockedSum(PICK(sum), x, n);
+}
+
+double l2Norm(const float* x, size_t n) {
+	return sqrt(blockedSum(PICK(sumSquares), x, n));
+}
+
+float maxAbs(const float* x, size_t n) {
+	float (*k)(const float*, size_t, size_t, float) = PICK(maxAbs);
+	const long blocks = numBlocks(n);
+	std::vector<float> partial(blocks);
+#pragma omp parallel for schedule(static) if (n >= KERNEL_PARALLEL_THRESHOLD)
+	for (long b = 0; b < blocks; ++b) {
+		partial[b] = k(x, b * BLOCK, blockEnd(b, n), 0.0f);
+	}
+	float m = 0.0f;
+	for (long b = 0; b < blocks; ++b) {
+		m = partial[b] > m ? partial[b] : m;
+	}
+	return m;
+}
+
+size_t accumulateCount(const float* x, float* y, size_t n) {
+	size_t (*k)(const float*, float*, size_t, size_t) = PICK(
+			accumulateCount);
+	const long blocks = numBlocks(n);
+	size_t count = 0;
+#pragma omp parallel for schedule(static) reduction(+:count) if (n >= KERNEL_PARALLEL_THRESHOLD)
+	for (long b = 0; b < blocks; ++b) {
+		count += k(x, y, b * BLOCK, blockEnd(b, n));
+	}
+	return count;
+}
+
+} /* namespace rudra */
@@ -0,0 +1,86 @@
+/*
+ * GradientKernels.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_GRADIENTKERNELS_H_
+#define RUDRA_UTIL_GRADIENTKERNELS_H_
+
+#include <cstdlib>
+
+namespace rudra {
+/*
+ * Kernels over gradient and weight vectors of n floats, with AVX2 and
+ * AVX-512 variants chosen by simdLevel(). Vectors of at least
+ * KERNEL_PARALLEL_THRESHOLD elements are split across OpenMP threads (set
+ * OMP_NUM_THREADS to limit them).
+ *
+ * The elementwise kernels give bit-identical results at every SIMD level
+ * and thread count. The reductions accumulate in double over fixed blocks,
+ * so for a given SIMD level their result does not depend on the number of
+ * threads either.
+ */
+
+/** Vectors shorter than this are processed on the calling thread. */
+const size_t KERNEL_PARALLEL_THRESHOLD = 1 << 20;
+
+/** y[i] += a * x[i] */
+void axpy(float a, const float* x, float* y, size_t n);
+
+/** y[i] += x[i] */
+void addInto(const float* x, float* y, size_t n);
+
+/** y[i] = a * x[i] + b * y[i] */
+void scaledAdd(float a, const float* x, float b, float* y, size_t n);
+
+/** y[i] = 0 */
+void zero(float* y, size_t n);
+
+/** the sum of x[i] */
+double sum(const float* x, size_t n);
+
+/** the Euclidean norm of x */
+double l2Norm(const float* x, size_t n);
+
+/** the largest |x[i]|, ignoring NaNs; 0 if n is 0 */
+float maxAbs(const float* x, size_t n);
+
+/**
+ * y[i] += x[i], returning the number of elements of x that are not zero
+ * (NaNs included), e.g. to see how sparse an incoming gradient was.
+ */
+size_t accumulateCount(const float* x, float* y, size_t n);
+
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_GRADIENTKERNELS_H_ */
@@ -0,0 +1,766 @@
+/*
+ * GradientWire.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/GradientWire.h"
+#include "rudra/util/ConvertKernels.h"
+#include "rudra/util/GradientKernels.h"
+#include "rudra/util/SimdDispatch.h"
+#include <cmath>
+#include <cstring>
+#ifdef RUDRA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rudra {
+
+/*
+ * Each kernel processes values [lo, hi) of the whole vector, reading and
+ * writing at the matching offsets of the encoded buffer; vector variants
+ * finish any tail with the scalar variant, and give bit-identical results.
+ * Work is split into BLOCK-value blocks for OpenMP, a multiple of
+ * WIRE_INT8_BLOCK so no int8 block straddles two of them.
+ */
+static const size_t BLOCK = 1 << 16;
+
+static inline uint32_t floatBits(float f) {
+	uint32_t v;
+	memcpy(&v, &f, sizeof(v));
+	return v;
+}
+
+static inline float bitsFloat(uint32_t v) {
+	float f;
+	memcpy(&f, &v, sizeof(f));
+	return f;
+}
+
+/**
+ * A well-mixed 32-bit hash (Wellons' lowbias32), applied twice under the
+ * two halves of the key to give the random bits for value i.
+ */
+static inline uint32_t mix32(uint32_t h) {
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+static inline uint32_t randomBits(uint32_t i, uint32_t k0, uint32_t k1) {
+	return mix32(mix32(i + k0) ^ k1);
+}
+
+/** A uniform float in [0, 1) from the top 24 random bits. */
+static inline float uniform24(uint32_t r) {
+	return (float) (r >> 8) * (1.0f / 16777216.0f);
+}
+
+/** The smallest normal half, as float bits. */
+static const uint32_t HALF_MIN_NORMAL = 0x38800000u;
+/** The largest finite half, 65504, as float bits. */
+static const uint32_t HALF_MAX = 0x477fe000u;
+/** The largest finite bfloat16, as float bits. */
+static const uint32_t BF16_MAX = 0x7f7f0000u;
+
+/*
+ * Stochastic rounding to bfloat16 adds 16 random bits below the kept half
+ * and truncates; a carry out of them rounds the magnitude up, with
+ * probability equal to the fraction dropped. Half precision does the same
+ * with 13 bits for normal halves; below them the spacing is a fixed 2^-24,
+ * so the value is scaled to units of that, dithered with a uniform in
+ * [0, 1) and truncated.
+ */
+
+static inline uint16_t bf16Round(float x, uint32_t r) {
+	const uint32_t b = floatBits(x);
+	const uint32_t a = b & 0x7fffffff;
+	if (a > 0x7f800000) {
+		return (b >> 16) | 0x40; // keep NaNs NaN
+	}
+	if (a >= BF16_MAX && a < 0x7f800000) {
+		return ((b & 0x80000000) | BF16_MAX) >> 16; // do not round up to infinity
+	}
+	return (b + (r & 0xffff)) >> 16;
+}
+
+static inline uint16_t halfRound(float x, uint32_t r) {
+	const uint32_t b = floatBits(x);
+	const uint32_t sign = (b >> 16) & 0x8000;
+	const uint32_t a = b & 0x7fffffff;
+	uint32_t h;
+	if (a > 0x7f800000) {
+		h = 0x7e00;
+	} else if (a == 0x7f800000) {
+		h = 0x7c00;
+	} else if (a >= HALF_MAX) {
+		h = 0x7bff;
+	} else if (a >= HALF_MIN_NORMAL) {
+		h = (a + (r & 0x1fff) - ((uint32_t) (127 - 15) << 23)) >> 13;
+	} else {
+		h = (uint32_t) (bitsFloat(a) * 16777216.0f + uniform24(r));
+	}
+	return sign | h;
+}
+
+static inline uint8_t* int8Block(uint8_t* dst, size_t i) {
+	return dst + i / WIRE_INT8_BLOCK * (WIRE_INT8_BLOCK + sizeof(float));
+}
+
+static inline const uint8_t* int8Block(const uint8_t* src, size_t i) {
+	return src + i / WIRE_INT8_BLOCK * (WIRE_INT8_BLOCK + sizeof(float));
+}
+
+/**
+ * The scale of an int8 block whose largest magnitude is m, and its
+ * inverse. A non-finite block gets a NaN scale and zero bytes.
+ */
+static inline void int8Scale(float m, bool finite, float& scale,
+		float& inverse) {
+	if (!finite) {
+		scale = bitsFloat(0x7fc00000);
+		inverse = 0.0f;
+	} else if (m == 0.0f) {
+		scale = inverse = 0.0f;
+	} else {
+		scale = m / 127.0f;
+		inverse = 127.0f / m;
+	}
+}
+
+static inline int8_t int8Round(float x, float inverse, uint32_t r) {
+	int32_t q = (int32_t) floorf(x * inverse + uniform24(r));
+	q = q > 127 ? 127 : q;
+	return q < -127 ? -127 : q;
+}
+
+static void bf16EncodeScalar(const float* src, uint8_t* dst, size_t lo,
+		size_t hi, uint32_t k0, uint32_t k1) {
+	for (size_t i = lo; i < hi; ++i) {
+		const uint16_t h = bf16Round(src[i], randomBits(i, k0, k1));
+		memcpy(dst + 2 * i, &h, sizeof(h));
+	}
+}
+
+static void halfEncodeScalar(const float* src, uint8_t* dst, size_t lo,
+		size_t hi, uint32_t k0, uint32_t k1) {
+	for (size_t i = lo; i < hi; ++i) {
+		const uint16_t h = halfRound(src[i], randomBits(i, k0, k1));
+		memcpy(dst + 2 * i, &h, sizeof(h));
+	}
+}
+
+/** Encode the int8 block starting at lo and ending at hi. */
+static void int8EncodeBlockScalar(const float* src, uint8_t* dst, size_t lo,
+		size_t hi, uint32_t k0, uint32_t k1) {
+	float m = 0.0f;
+	bool finite = true;
+	for (size_t i = lo; i < hi; ++i) {
+		const float a = fabsf(src[i]);
+		finite &= a < __builtin_inff();
+		m = a > m ? a : m;
+	}
+	float scale, inverse;
+	int8Scale(m, finite, scale, inverse);
+	uint8_t* p = int8Block(dst, lo);
+	memcpy(p, &scale, sizeof(scale));
+	int8_t* q = (int8_t*) (p + sizeof(scale)) - lo;
+	for (size_t i = lo; i < hi; ++i) {
+		q[i] = int8Round(src[i], inverse, randomBits(i, k0, k1));
+	}
+}
+
+/** lo must start a block. */
+template<void (*BlockKernel)(const float*, uint8_t*, size_t, size_t,
+		uint32_t, uint32_t)>
+static void int8Encode(const float* src, uint8_t* dst, size_t lo, size_t hi,
+		uint32_t k0, uint32_t k1) {
+	for (size_t i = lo; i < hi; i += WIRE_INT8_BLOCK) {
+		BlockKernel(src, dst, i,
+				i + WIRE_INT8_BLOCK < hi ? i + WIRE_INT8_BLOCK : hi, k0, k1);
+	}
+}
+
+template<bool ADD>
+static inline void put(float* dst, size_t i, float x) {
+	dst[i] = ADD ? dst[i] + x : x;
+}
+
+template<bool ADD>
+static void bf16DecodeScalar(const uint8_t* src, float* dst, size_t lo,
+		size_t hi) {
+	for (size_t i = lo; i < hi; ++i) {
+		uint16_t h;
+		memcpy(&h, src + 2 * i, sizeof(h));
+		put<ADD>(dst, i, bitsFloat((uint32_t) h << 16));
+	}
+}
+
+template<bool ADD>
+static void halfDecodeScalar(const uint8_t* src, float* dst, size_t lo,
+		size_t hi) {
+	for (size_t i = lo; i < hi; ++i) {
+		uint16_t h;
+		memcpy(&h, src + 2 * i, sizeof(h));
+		put<ADD>(dst, i, halfToFloat(h));
+	}
+}
+
+template<bool ADD>
+static void int8DecodeBlockScalar(const uint8_t* src, float* dst, size_t lo,
+		size_t hi) {
+	const uint8_t* p = int8Block(src, lo);
+	float scale;
+	memcpy(&scale, p, sizeof(scale));
+	const int8_t* q = (const int8_t*) (p + sizeof(scale)) - lo;
+	for (size_t i = lo; i < hi; ++i) {
+		put<ADD>(dst, i, q[i] * scale);
+	}
+}
+
+/** src need not be aligned, so each value is copied out. */
+template<bool ADD>
+static void fp32DecodeScalar(const uint8_t* src, float* dst, size_t lo,
+		size_t hi) {
+	for (size_t i = lo; i < hi; ++i) {
+		float x;
+		memcpy(&x, src + 4 * i, sizeof(x));
+		put<ADD>(dst, i, x);
+	}
+}
+
+template<void (*BlockKernel)(const uint8_t*, float*, size_t, size_t)>
+static void int8Decode(const uint8_t* src, float* dst, size_t lo,
+		size_t hi) {
+	for (size_t i = lo; i < hi; i += WIRE_INT8_BLOCK) {
+		BlockKernel(src, dst, i,
+				i + WIRE_INT8_BLOCK < hi ? i + WIRE_INT8_BLOCK : hi);
+	}
+}
+
+#ifdef RUDRA_X86_SIMD
+#define AVX2_TARGET __attribute__((target("avx2,f16c")))
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+AVX2_TARGET static inline __m256i mix32AVX2(__m256i h) {
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+	h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x7feb352d));
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+	h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x846ca68b));
+	return _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+}
+
+/** Random bits for values i..i+7. */
+AVX2_TARGET static inline __m256i randomAVX2(size_t i, uint32_t k0,
+		uint32_t k1) {
+	const __m256i idx = _mm256_add_epi32(_mm256_set1_epi32((uint32_t) i),
+			_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	const __m256i h = mix32AVX2(
+			_mm256_add_epi32(idx, _mm256_set1_epi32(k0)));
+	return mix32AVX2(_mm256_xor_si256(h, _mm256_set1_epi32(k1)));
+}
+
+AVX2_TARGET static inline __m256 uniformAVX2(__m256i r) {
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(r, 8)),
+			_mm256_set1_ps(1.0f / 16777216.0f));
+}
+
+/** Store the low halves of the 16 lanes of a and b, in order. */
+AVX2_TARGET static inline void store16AVX2(uint8_t* dst, __m256i a,
+		__m256i b) {
+	// every lane is below 2^16, so the unsigned saturation is exact
+	_mm256_storeu_si256((__m256i*) dst,
+			_mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8));
+}
+
+AVX2_TARGET static inline __m256i bf16RoundAVX2(__m256 x, __m256i r) {
+	const __m256i b = _mm256_castps_si256(x);
+	const __m256i a = _mm256_and_si256(b, _mm256_set1_epi32(0x7fffffff));
+	const __m256i nan = _mm256_cmpgt_epi32(a, _mm256_set1_epi32(0x7f800000));
+	const __m256i rounded = _mm256_srli_epi32(
+			_mm256_add_epi32(b,
+					_mm256_and_si256(r, _mm256_set1_epi32(0xffff))), 16);
+	const __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(b, 16),
+			_mm256_set1_epi32(0x40));
+	const __m256i big = _mm256_and_si256(
+			_mm256_cmpgt_epi32(a, _mm256_set1_epi32(BF16_MAX - 1)),
+			_mm256_cmpgt_epi32(_mm256_set1_epi32(0x7f800000), a));
+	const __m256i saturated = _mm256_or_si256(
+			_mm256_srli_epi32(b, 16), _mm256_set1_epi32(0x7f7f));
+	return _mm256_blendv_epi8(_mm256_blendv_epi8(rounded, saturated, big),
+			quiet, nan);
+}
+
+AVX2_TARGET static void bf16EncodeAVX2(const float* src, uint8_t* dst,
+		size_t lo, size_t hi, uint32_t k0, uint32_t k1) {
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		store16AVX2(dst + 2 * i,
+				bf16RoundAVX2(_mm256_loadu_ps(src + i), randomAVX2(i, k0, k1)),
+				bf16RoundAVX2(_mm256_loadu_ps(src + i + 8),
+						randomAVX2(i + 8, k0, k1)));
+	}
+	bf16EncodeScalar(src, dst, i, hi, k0, k1);
+}
+
+AVX2_TARGET static inline __m256i halfRoundAVX2(__m256 x, __m256i r) {
+	const __m256i b = _mm256_castps_si256(x);
+	const __m256i a = _mm256_and_si256(b, _mm256_set1_epi32(0x7fffffff));
+	const __m256i normal = _mm256_srli_epi32(
+			_mm256_sub_epi32(
+					_mm256_add_epi32(a,
+							_mm256_and_si256(r, _mm256_set1_epi32(0x1fff))),
+					_mm256_set1_epi32((127 - 15) << 23)), 13);
+	const __m256i subnormal = _mm256_cvttps_epi32(
+			_mm256_add_ps(
+					_mm256_mul_ps(_mm256_castsi256_ps(a),
+							_mm256_set1_ps(16777216.0f)), uniformAVX2(r)));
+	// a is non-negative, so signed compares order it correctly
+	__m256i h = _mm256_blendv_epi8(normal, subnormal,
+			_mm256_cmpgt_epi32(_mm256_set1_epi32(HALF_MIN_NORMAL), a));
+	h = _mm256_blendv_epi8(h, _mm256_set1_epi32(0x7bff),
+			_mm256_cmpgt_epi32(a, _mm256_set1_epi32(HALF_MAX - 1)));
+	h = _mm256_blendv_epi8(h, _mm256_set1_epi32(0x7c00),
+			_mm256_cmpeq_epi32(a, _mm256_set1_epi32(0x7f800000)));
+	h = _mm256_blendv_epi8(h, _mm256_set1_epi32(0x7e00),
+			_mm256_cmpgt_epi32(a, _mm256_set1_epi32(0x7f800000)));
+	return _mm256_or_si256(h,
+			_mm256_and_si256(_mm256_srli_epi32(b, 16),
+					_mm256_set1_epi32(0x8000)));
+}
+
+AVX2_TARGET static void halfEncodeAVX2(const float* src, uint8_t* dst,
+		size_t lo, size_t hi, uint32_t k0, uint32_t k1) {
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		store16AVX2(dst + 2 * i,
+				halfRoundAVX2(_mm256_loadu_ps(src + i), randomAVX2(i, k0, k1)),
+				halfRoundAVX2(_mm256_loadu_ps(src + i + 8),
+						randomAVX2(i + 8, k0, k1)));
+	}
+	halfEncodeScalar(src, dst, i, hi, k0, k1);
+}
+
+AVX2_TARGET static inline __m256i int8RoundAVX2(__m256 x, __m256 inverse,
+		__m256i r) {
+	const __m256 t = _mm256_floor_ps(
+			_mm256_add_ps(_mm256_mul_ps(x, inverse), uniformAVX2(r)));
+	const __m256i q = _mm256_cvtps_epi32(t);
+	return _mm256_max_epi32(_mm256_min_epi32(q, _mm256_set1_epi32(127)),
+			_mm256_set1_epi32(-127));
+}
+
+AVX2_TARGET static void int8EncodeBlockAVX2(const float* src, uint8_t* dst,
+		size_t lo, size_t hi, uint32_t k0, uint32_t k1) {
+	if (hi - lo != WIRE_INT8_BLOCK) {
+		int8EncodeBlockScalar(src, dst, lo, hi, k0, k1);
+		return;
+	}
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	const __m256 inf = _mm256_set1_ps(__builtin_inff());
+	__m256 m = _mm256_setzero_ps(), notFinite = _mm256_setzero_ps();
+	for (size_t i = lo; i < hi; i += 8) {
+		const __m256 a = _mm256_and_ps(_mm256_loadu_ps(src + i), absMask);
+		notFinite = _mm256_or_ps(notFinite, _mm256_cmp_ps(a, inf, _CMP_NLT_UQ));
+		m = _mm256_max_ps(m, a);
+	}
+	m = _mm256_max_ps(m, _mm256_permute2f128_ps(m, m, 1));
+	m = _mm256_max_ps(m, _mm256_shuffle_ps(m, m, 0x4e));
+	m = _mm256_max_ps(m, _mm256_shuffle_ps(m, m, 0xb1));
+	float scale, inverse;
+	int8Scale(_mm256_cvtss_f32(m), _mm256_movemask_ps(notFinite) == 0, scale,
+			inverse);
+	uint8_t* p = int8Block(dst, lo);
+	memcpy(p, &scale, sizeof(scale));
+	p += sizeof(scale);
+	const __m256 inv = _mm256_set1_ps(inverse);
+	// packing interleaves the 128-bit lanes of the four vectors
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	for (size_t i = lo; i < hi; i += 32) {
+		const __m256i a = int8RoundAVX2(_mm256_loadu_ps(src + i), inv,
+				randomAVX2(i, k0, k1));
+		const __m256i b = int8RoundAVX2(_mm256_loadu_ps(src + i + 8), inv,
+				randomAVX2(i + 8, k0, k1));
+		const __m256i c = int8RoundAVX2(_mm256_loadu_ps(src + i + 16), inv,
+				randomAVX2(i + 16, k0, k1));
+		const __m256i d = int8RoundAVX2(_mm256_loadu_ps(src + i + 24), inv,
+				randomAVX2(i + 24, k0, k1));
+		const __m256i q = _mm256_packs_epi16(_mm256_packs_epi32(a, b),
+				_mm256_packs_epi32(c, d));
+		_mm256_storeu_si256((__m256i*) (p + i - lo),
+				_mm256_permutevar8x32_epi32(q, order));
+	}
+}
+
+template<bool ADD>
+AVX2_TARGET static inline void putAVX2(float* dst, size_t i, __m256 x) {
+	_mm256_storeu_ps(dst + i,
+			ADD ? _mm256_add_ps(_mm256_loadu_ps(dst + i), x) : x);
+}
+
+template<bool ADD>
+AVX2_TARGET static void bf16DecodeAVX2(const uint8_t* src, float* dst,
+		size_t lo, size_t hi) {
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		const __m256i h = _mm256_cvtepu16_epi32(
+				_mm_loadu_si128((const __m128i*) (src + 2 * i)));
+		putAVX2<ADD>(dst, i, _mm256_castsi256_ps(_mm256_slli_epi32(h, 16)));
+	}
+	bf16DecodeScalar<ADD>(src, dst, i, hi);
+}
+
+template<bool ADD>
+AVX2_TARGET static void halfDecodeAVX2(const uint8_t* src, float* dst,
+		size_t lo, size_t hi) {
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		putAVX2<ADD>(dst, i,
+				_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (src + 2 * i))));
+	}
+	halfDecodeScalar<ADD>(src, dst, i, hi);
+}
+
+template<bool ADD>
+AVX2_TARGET static void int8DecodeBlockAVX2(const uint8_t* src, float* dst,
+		size_t lo, size_t hi) {
+	const uint8_t* p = int8Block(src, lo);
+	float scale;
+	memcpy(&scale, p, sizeof(scale));
+	p += sizeof(scale);
+	const __m256 s = _mm256_set1_ps(scale);
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		const __m256i q = _mm256_cvtepi8_epi32(
+				_mm_loadl_epi64((const __m128i*) (p + i - lo)));
+		putAVX2<ADD>(dst, i, _mm256_mul_ps(_mm256_cvtepi32_ps(q), s));
+	}
+	const int8_t* q = (const int8_t*) p - lo;
+	for (; i < hi; ++i) {
+		put<ADD>(dst, i, q[i] * scale);
+	}
+}
+
+AVX512_TARGET static inline __m512i mix32AVX512(__m512i h) {
+	h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+	h = _mm512_mullo_epi32(h, _mm512_set1_epi32(0x7feb352d));
+	h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 15));
+	h = _mm512_mullo_epi32(h, _mm512_set1_epi32(0x846ca68b));
+	return _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+}
+
+/** Random bits for values i..i+15. */
+AVX512_TARGET static inline __m512i randomAVX512(size_t i, uint32_t k0,
+		uint32_t k1) {
+	const __m512i idx = _mm512_add_epi32(_mm512_set1_epi32((uint32_t) i),
+			_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+					14, 15));
+	const __m512i h = mix32AVX512(
+			_mm512_add_epi32(idx, _mm512_set1_epi32(k0)));
+	return mix32AVX512(_mm512_xor_si512(h, _mm512_set1_epi32(k1)));
+}
+
+AVX512_TARGET static inline __m512 uniformAVX512(__m512i r) {
+	return _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(r, 8)),
+			_mm512_set1_ps(1.0f / 16777216.0f));
+}
+
+AVX512_TARGET static void bf16EncodeAVX512(const float* src, uint8_t* dst,
+		size_t lo, size_t hi, uint32_t k0, uint32_t k1) {
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		const __m512i b = _mm512_castps_si512(_mm512_loadu_ps(src + i));
+		const __m512i a = _mm512_and_si512(b, _mm512_set1_epi32(0x7fffffff));
+		const __mmask16 nan = _mm512_cmpgt_epi32_mask(a,
+				_mm512_set1_epi32(0x7f800000));
+		const __mmask16 big = _mm512_cmpge_epi32_mask(a,
+				_mm512_set1_epi32(BF16_MAX)) & ~nan
+				& _mm512_cmpneq_epi32_mask(a, _mm512_set1_epi32(0x7f800000));
+		const __m512i r = randomAVX512(i, k0, k1);
+		__m512i h = _mm512_srli_epi32(
+				_mm512_add_epi32(b,
+						_mm512_and_si512(r, _mm512_set1_epi32(0xffff))), 16);
+		h = _mm512_mask_or_epi32(h, nan, _mm512_srli_epi32(b, 16),
+				_mm512_set1_epi32(0x40));
+		h = _mm512_mask_or_epi32(h, big, _mm512_srli_epi32(b, 16),
+				_mm512_set1_epi32(0x7f7f));
+		_mm256_storeu_si256((__m256i*) (dst + 2 * i), _mm512_cvtepi32_epi16(h));
+	}
+	bf16EncodeScalar(src, dst, i, hi, k0, k1);
+}
+
+AVX512_TARGET static void halfEncodeAVX512(const float* src, uint8_t* dst,
+		size_t lo, size_t hi, uint32_t k0, uint32_t k1) {
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		const __m512i b = _mm512_castps_si512(_mm512_loadu_ps(src + i));
+		const __m512i a = _mm512_and_si512(b, _mm512_set1_epi32(0x7fffffff));
+		const __m512i r = randomAVX512(i, k0, k1);
+		__m512i h = _mm512_srli_epi32(
+				_mm512_sub_epi32(
+						_mm512_add_epi32(a,
+								_mm512_and_si512(r, _mm512_set1_epi32(0x1fff))),
+						_mm512_set1_epi32((127 - 15) << 23)), 13);
+		h = _mm512_mask_mov_epi32(h,
+				_mm512_cmplt_epi32_mask(a, _mm512_set1_epi32(HALF_MIN_NORMAL)),
+				_mm512_cvttps_epi32(
+						_mm512_add_ps(
+								_mm512_mul_ps(_mm512_castsi512_ps(a),
+										_mm512_set1_ps(16777216.0f)),
+								uniformAVX512(r))));
+		h = _mm512_mask_mov_epi32(h,
+				_mm512_cmpge_epi32_mask(a, _mm512_set1_epi32(HALF_MAX)),
+				_mm512_set1_epi32(0x7bff));
+		h = _mm512_mask_mov_epi32(h,
+				_mm512_cmpeq_epi32_mask(a, _mm512_set1_epi32(0x7f800000)),
+				_mm512_set1_epi32(0x7c00));
+		h = _mm512_mask_mov_epi32(h,
+				_mm512_cmpgt_epi32_mask(a, _mm512_set1_epi32(0x7f800000)),
+				_mm512_set1_epi32(0x7e00));
+		h = _mm512_or_si512(h,
+				_mm512_and_si512(_mm512_srli_epi32(b, 16),
+						_mm512_set1_epi32(0x8000)));
+		_mm256_storeu_si256((__m256i*) (dst + 2 * i), _mm512_cvtepi32_epi16(h));
+	}
+	halfEncodeScalar(src, dst, i, hi, k0, k1);
+}
+
+AVX512_TARGET static void int8EncodeBlockAVX512(const float* src,
+		uint8_t* dst, size_t lo, size_t hi, uint32_t k0, uint32_t k1) {
+	if (hi - lo != WIRE_INT8_BLOCK) {
+		int8EncodeBlockScalar(src, dst, lo, hi, k0, k1);
+		return;
+	}
+	const __m512 inf = _mm512_set1_ps(__builtin_inff());
+	__m512 m = _mm512_setzero_ps();
+	__mmask16 notFinite = 0;
+	for (size_t i = lo; i < hi; i += 16) {
+		const __m512 a = _mm512_abs_ps(_mm512_loadu_ps(src + i));
+		notFinite |= _mm512_cmp_ps_mask(a, inf, _CMP_NLT_UQ);
+		m = _mm512_max_ps(m, a);
+	}
+	float scale, inverse;
+	int8Scale(_mm512_reduce_max_ps(m), notFinite == 0, scale, inverse);
+	uint8_t* p = int8Block(dst, lo);
+	memcpy(p, &scale, sizeof(scale));
+	p += sizeof(scale);
+	const __m512 inv = _mm512_set1_ps(inverse);
+	for (size_t i = lo; i < hi; i += 16) {
+		const __m512 t = _mm512_floor_ps(
+				_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src + i), inv),
+						uniformAVX512(randomAVX512(i, k0, k1))));
+		__m512i q = _mm512_cvtps_epi32(t);
+		q = _mm512_max_epi32(_mm512_min_epi32(q, _mm512_set1_epi32(127)),
+				_mm512_set1_epi32(-127));
+		_mm_storeu_si128((__m128i*) (p + i - lo), _mm512_cvtepi32_epi8(q));
+	}
+}
+
+template<bool ADD>
+AVX512_TARGET static inline void putAVX512(float* dst, size_t i, __m512 x) {
+	_mm512_storeu_ps(dst + i,
+			ADD ? _mm512_add_ps(_mm512_loadu_ps(dst + i), x) : x);
+}
+
+template<bool ADD>
+AVX512_TARGET static void bf16DecodeAVX512(const uint8_t* src, float* dst,
+		size_t lo, size_t hi) {
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		const __m512i h = _mm512_cvtepu16_epi32(
+				_mm256_loadu_si256((const __m256i*) (src + 2 * i)));
+		putAVX512<ADD>(dst, i, _mm512_castsi512_ps(_mm512_slli_epi32(h, 16)));
+	}
+	bf16DecodeScalar<ADD>(src, dst, i, hi);
+}
+
+template<bool ADD>
+AVX512_TARGET static void halfDecodeAVX512(const uint8_t* src, float* dst,
+		size_t lo, size_t hi) {
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		putAVX512<ADD>(dst, i,
+				_mm512_cvtph_ps(
+						_mm256_loadu_si256((const __m256i*) (src + 2 * i))));
+	}
+	halfDecodeScalar<ADD>(src, dst, i, hi);
+}
+
+template<bool ADD>
+AVX512_TARGET static void int8DecodeBlockAVX512(const uint8_t* src,
+		float* dst, size_t lo, size_t hi) {
+	const uint8_t* p = int8Block(src, lo);
+	float scale;
+	memcpy(&scale, p, sizeof(scale));
+	p += sizeof(scale);
+	const __m512 s = _mm512_set1_ps(scale);
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		const __m512i q = _mm512_cvtepi8_epi32(
+				_mm_loadu_si128((const __m128i*) (p + i - lo)));
+		putAVX512<ADD>(dst, i, _mm512_mul_ps(_mm512_cvtepi32_ps(q), s));
+	}
+	const int8_t* q = (const int8_t*) p - lo;
+	for (; i < hi; ++i) {
+		put<ADD>(dst, i, q[i] * scale);
+	}
+}
+#endif
+
+typedef void (*EncodeKernel)(const float*, uint8_t*, size_t, size_t,
+		uint32_t, uint32_t);
+typedef void (*DecodeKernel)(const uint8_t*, float*, size_t, size_t);
+
+/** Choose the variant of a kernel for the current SIMD level. */
+template<class K>
+static K pick(K avx512, K avx2, K scalar) {
+#ifdef RUDRA_X86_SIMD
+	switch (simdLevel()) {
+	case SIMD_AVX512:
+		return avx512;
+	case SIMD_AVX2:
+		return avx2;
+	default:
+		break;
+	}
+#endif
+	return scalar;
+}
+
+#ifdef RUDRA_X86_SIMD
+#define PICK(name) pick(name##AVX512, name##AVX2, name##Scalar)
+#define PICK_INT8_ENCODE() pick(int8Encode<int8EncodeBlockAVX512>, \
+		int8Encode<int8EncodeBlockAVX2>, int8Encode<int8EncodeBlockScalar>)
+#define PICK_DECODE(name, ADD) pick(name##AVX512<ADD>, name##AVX2<ADD>, \
+		name##Scalar<ADD>)
+#define PICK_INT8_DECODE(ADD) pick(int8Decode<int8DecodeBlockAVX512<ADD> >, \
+		int8Decode<int8DecodeBlockAVX2<ADD> >, \
+		int8Decode<int8DecodeBlockScalar<ADD> >)
+#else
+#define PICK(name) name##Scalar
+#define PICK_INT8_ENCODE() int8Encode<int8EncodeBlockScalar>
+#define PICK_DECODE(name, ADD) name##Scalar<ADD>
+#define PICK_INT8_DECODE(ADD) int8Decode<int8DecodeBlockScalar<ADD> >
+#endif
+
+static EncodeKernel pickEncode(WireFormat format) {
+	switch (format) {
+	case WIRE_FP16:
+		return PICK(halfEncode);
+	case WIRE_BF16:
+		return PICK(bf16Encode);
+	default:
+		return PICK_INT8_ENCODE();
+	}
+}
+
+template<bool ADD>
+static DecodeKernel pickDecode(WireFormat format) {
+	switch (format) {
+	case WIRE_FP16:
+		return PICK_DECODE(halfDecode, ADD);
+	case WIRE_BF16:
+		return PICK_DECODE(bf16Decode, ADD);
+	case WIRE_INT8:
+		return PICK_INT8_DECODE(ADD);
+	default:
+		return fp32DecodeScalar<ADD>;
+	}
+}
+
+static inline size_t numBlocks(size_t n) {
+	return (n + BLOCK - 1) / BLOCK;
+}
+
+static inline size_t blockEnd(size_t b, size_t n) {
+	return (b + 1) * BLOCK < n ? (b + 1) * BLOCK : n;
+}
+
+const char* wireFormatName(WireFormat format) {
+	switch (format) {
+	case WIRE_FP16:
+		return "fp16";
+	case WIRE_BF16:
+		return "bf16";
+	case WIRE_INT8:
+		return "int8";
+	default:
+		return "fp32";
+	}
+}
+
+void encodeWire(WireFormat format, const float* src, size_t n, uint64_t seed,
+		void* dst) {
+	if (format == WIRE_FP32) {
+		memcpy(dst, src, n * sizeof(float));
+		return;
+	}
+	// spread the seed over both halves of the key (the SplitMix64 finalizer)
+	seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+	seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+	seed ^= seed >> 31;
+	const uint32_t k0 = (uint32_t) seed, k1 = (uint32_t) (seed >> 32);
+	const EncodeKernel k = pickEncode(format);
+	const long blocks = numBlocks(n);
+#pragma omp parallel for schedule(static) if (n >= KERNEL_PARALLEL_THRESHOLD)
+	for (long b = 0; b < blocks; ++b) {
+		k(src, (uint8_t*) dst, b * BLOCK, blockEnd(b, n), k0, k1);
+	}
+}
+
+template<bool ADD>
+static void decode(WireFormat format, const void* src, size_t n, float* dst) {
+	const DecodeKernel k = pickDecode<ADD>(format);
+	const long blocks = numBlocks(n);
+#pragma omp parallel for schedule(static) if (n >= KERNEL_PARALLEL_THRESHOLD)
+	for (long b = 0; b < blocks; ++b) {
+		k((const uint8_t*) src, dst, b * BLOCK, blockEnd(b, n));
+	}
+}
+
+void decodeWire(WireFormat format, const void* src, size_t n, float* dst) {
+	if (format == WIRE_FP32) {
+		memcpy(dst, src, n * sizeof(float));
+	} else {
+		decode<false>(format, src, n, dst);
+	}
+}
+
+void decodeAddWire(WireFormat format, const void* src, size_t n,
+		float* dst) {
+	decode<true>(format, src, n, dst);
+}
+
+} /* namespace rudra */
@@ -0,0 +1,115 @@
+/*
+ * GradientWire.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_GRADIENTWIRE_H_
+#define RUDRA_UTIL_GRADIENTWIRE_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace rudra {
+/*
+ * Reduced-precision wire formats for gradients sent between places. A
+ * vector of n floats is encoded into wireBytes(format, n) bytes before it
+ * is sent, and decoded (or decoded and added) back into floats on receipt,
+ * so all arithmetic stays in fp32. Encoding rounds stochastically: each
+ * value is rounded up or down to a neighbouring representable value with
+ * probabilities that make the expected result equal to the input, so the
+ * rounding error averages out over steps and places instead of biasing
+ * small updates towards zero.
+ *
+ * The random bits for element i are a keyed hash of i and the seed, so the
+ * result depends only on (src, n, seed), not on the SIMD level or the
+ * number of threads. Callers should pass a different seed for every vector
+ * they encode, e.g. mixing the step, the place and the chunk.
+ *
+ * Encoded buffers carry no alignment requirement, and include no header:
+ * the format and n must be known to the receiver. Anything that must
+ * survive exactly, such as the load count of a TimedGradient, has to be
+ * sent alongside, not through, the encoding.
+ */
+enum WireFormat {
+	/** 4 bytes per value, sent as is. */
+	WIRE_FP32,
+	/**
+	 * IEEE half precision, 2 bytes per value. Finite values beyond the half
+	 * range saturate to +-65504.
+	 */
+	WIRE_FP16,
+	/**
+	 * bfloat16, the top half of a float, 2 bytes per value. Finite values
+	 * saturate to the largest finite bfloat16.
+	 */
+	WIRE_BF16,
+	/**
+	 * Signed bytes scaled per block of WIRE_INT8_BLOCK values: each block
+	 * is a float scale s (the block's largest magnitude / 127) followed by
+	 * one byte q per value, standing for q * s. A NaN or infinity makes its
+	 * whole block NaN.
+	 */
+	WIRE_INT8
+};
+
+/** Values per scale in WIRE_INT8. */
+const size_t WIRE_INT8_BLOCK = 256;
+
+/** Bytes taken by n values in the given format. */
+inline size_t wireBytes(WireFormat format, size_t n) {
+	switch (format) {
+	case WIRE_FP16:
+	case WIRE_BF16:
+		return 2 * n;
+	case WIRE_INT8:
+		return n + sizeof(float) * ((n + WIRE_INT8_BLOCK - 1) / WIRE_INT8_BLOCK);
+	default:
+		return 4 * n;
+	}
+}
+
+/** The name of the format, as accepted by -gradWire: fp32, fp16, bf16 or int8. */
+const char* wireFormatName(WireFormat format);
+
+/** Encode the n floats of src into dst. */
+void encodeWire(WireFormat format, const float* src, size_t n, uint64_t seed,
+		void* dst);
+
+/** dst[i] = the i-th value encoded in src */
+void decodeWire(WireFormat format, const void* src, size_t n, float* dst);
+
+/** dst[i] += the i-th value encoded in src */
+void decodeAddWire(WireFormat format, const void* src, size_t n, float* dst);
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_GRADIENTWIRE_H_ */
@@ -0,0 +1,68 @@
+/*
+ * LockFreeHandoff.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_LOCKFREEHANDOFF_H_
+#define RUDRA_UTIL_LOCKFREEHANDOFF_H_
+
+#include "rudra/util/MpscQueue.h"
+#include "rudra/util/SpscQueue.h"
+#include "rudra/util/SwapSlot.h"
+#include <stdint.h>
+
+namespace rudra {
+
+/*
+ * Entry points for the X10 bindings in rudra/util/LockFreeSwapBuffer.x10 and
+ * LockFreeQueue.x10, which hold a native SwapSlot, SpscRing or MpscRing by
+ * its address and keep the values themselves in X10 storage, where the
+ * garbage collector can see them. Positions are returned as signed values,
+ * with -1 meaning that a try call failed.
+ */
+
+template<class Ring>
+inline int64_t ringTryBeginPush(int64_t ring) {
+	uint64_t pos;
+	return ((Ring*) ring)->tryBeginPush(pos) ? (int64_t) pos : -1;
+}
+
+template<class Ring>
+inline int64_t ringTryBeginPop(int64_t ring) {
+	uint64_t pos;
+	return ((Ring*) ring)->tryBeginPop(pos) ? (int64_t) pos : -1;
+}
+
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_LOCKFREEHANDOFF_H_ */
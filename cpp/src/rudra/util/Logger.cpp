@@ -34,53 +34,462 @@
  */
 
 #include "rudra/util/Logger.h"
+#include "rudra/util/SpscQueue.h"
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
-#include <iostream>
-
-static LogLevel LOG_LEVEL = WARNING;
+#include <cstring>
+#include <ctime>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <strings.h>
+#include <vector>
 
 namespace rudra {
+namespace {
+/** Records in each thread's ring; a thread waits if it fills its ring. */
+const size_t LOG_RING_RECORDS = 1024;
+/** The background writer drains the rings at least this often. */
+const long WRITER_INTERVAL_MS = 20;
+const size_t LOG_RECORD_TEXT = 244;
+
+/**
+ * A fixed-size piece of a message in a thread's ring. Messages longer than
+ * LOG_RECORD_TEXT are split over consecutive records.
+ */
+struct LogRecord {
+	uint64_t nanos;
+	uint8_t level;
+	uint8_t more; // 1 if the message continues in the next record
+	uint16_t len;
+	char text[LOG_RECORD_TEXT];
+};
+
+/**
+ * The ring a thread queues its messages in. Only the writer thread reads
+ * it, and deletes it once the thread has exited and the ring is empty.
+ */
+struct ThreadLog {
+	SpscRing ring;
+	std::vector<LogRecord> records;
+	std::atomic<bool> closed;
+	std::atomic<bool> wakePending; // set once the writer has been asked to drain
+	// the start of a message whose last record has not been published yet
+	std::string partial;
+	uint64_t partialNanos;
+	int partialLevel;
+
+	ThreadLog() :
+			ring(LOG_RING_RECORDS), records(ring.capacity()), closed(false),
+			wakePending(false), partialNanos(0), partialLevel(0) {
+	}
+};
+
+/** Per-thread logging state, deleted when the thread exits. */
+struct ThreadState {
+	LogLine::Buffer buf;
+	std::ostream os;
+	bool busy; // true while a LogLine is using buf
+	ThreadLog* log;
+
+	ThreadState() :
+			os(&buf), busy(false), log(NULL) {
+	}
+};
+
+/** A message drained by the writer, whose text is held in a shared pool. */
+struct Message {
+	uint64_t nanos;
+	int level;
+	size_t offset;
+	size_t len;
+
+	bool operator<(const Message& m) const {
+		return nanos < m.nanos;
+	}
+};
+
+__thread ThreadState* threadState = NULL;
+pthread_key_t threadKey;
+pthread_once_t threadKeyOnce = PTHREAD_ONCE_INIT;
+pthread_once_t atexitOnce = PTHREAD_ONCE_INIT;
+
+// serializes output to the console and the log file
+pthread_mutex_t outputMutex = PTHREAD_MUTEX_INITIALIZER;
+FILE* logFile = NULL;
+
+pthread_mutex_t ringsMutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<ThreadLog*> rings;
+
+std::atomic<bool> asyncOn(false);
+pthread_t writerThread;
+// guards the writer's wakeups, flush requests and shutdown
+pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t wakeCond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t flushCond = PTHREAD_COND_INITIALIZER;
+bool wakeRequested = false;
+bool stopRequested = false;
+uint64_t flushRequested = 0;
+uint64_t flushDone = 0;
+
+uint64_t nowNanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+const char* levelName(int level) {
+	static const char* const NAMES[] = { "TRACE", "INFO", "WARNING", "ERROR",
+			"FATAL" };
+	return NAMES[level];
+}
+
+/** Write one message to its destinations; the caller holds outputMutex. */
+void emit(int level, uint64_t nanos, const char* text, size_t len) {
+	if (logFile != NULL) {
+		// "YYYY-mm-dd HH:MM:SS.uuuuuu LEVEL   ", with the date and time
+		// formatted once a second
+		static time_t lastSecond = -1;
+		static char prefix[] = "0000-00-00 00:00:00.000000         ";
+		const time_t second = nanos / 1000000000ull;
+		if (second != lastSecond) {
+			struct tm tm;
+			localtime_r(&second, &tm);
+			strftime(prefix, 20, "%Y-%m-%d %H:%M:%S", &tm);
+			prefix[19] = '.';
+			lastSecond = second;
+		}
+		unsigned micros = nanos % 1000000000ull / 1000;
+		for (int i = 25; i >= 20; --i, micros /= 10) {
+			prefix[i] = '0' + micros % 10;
+		}
+		const char* name = levelName(level);
+		const size_t nameLen = strlen(name);
+		memcpy(prefix + 27, name, nameLen);
+		memset(prefix + 27 + nameLen, ' ', 8 - nameLen);
+		fwrite(prefix, 1, sizeof(prefix) - 1, logFile);
+		fwrite(text, 1, len, logFile);
+		fputc('\n', logFile);
+	}
+	if (level >= ERROR) {
+		fwrite(text, 1, len, stderr);
+		fputc('\n', stderr);
+	} else if (logFile == NULL) {
+		fwrite(text, 1, len, stdout);
+		fputc('\n', stdout);
+	}
+}
+
+void flushOutputs() {
+	fflush(stdout);
+	if (logFile != NULL) {
+		fflush(logFile);
+	}
+}
+
+void destroyThreadState(void* p) {
+	ThreadState* t = (ThreadState*) p;
+	if (t->log != NULL) {
+		// the writer frees the ring once it has drained it
+		t->log->closed.store(true, std::memory_order_release);
+	}
+	delete t;
+}
+
+void createThreadKey() {
+	pthread_key_create(&threadKey, destroyThreadState);
+}
+
+ThreadState* getThreadState() {
+	if (threadState == NULL) {
+		pthread_once(&threadKeyOnce, createThreadKey);
+		threadState = new ThreadState();
+		pthread_setspecific(threadKey, threadState);
+	}
+	return threadState;
+}
+
+void wakeWriter() {
+	pthread_mutex_lock(&writerMutex);
+	wakeRequested = true;
+	pthread_cond_signal(&wakeCond);
+	pthread_mutex_unlock(&writerMutex);
+}
+
+/** Copy a message into the calling thread's ring. */
+void enqueue(int level, const char* text, size_t len) {
+	ThreadState* t = getThreadState();
+	if (t->log == NULL) {
+		t->log = new ThreadLog();
+		pthread_mutex_lock(&ringsMutex);
+		rings.push_back(t->log);
+		pthread_mutex_unlock(&ringsMutex);
+	}
+	ThreadLog& log = *t->log;
+	const uint64_t nanos = nowNanos();
+	do {
+		const size_t n = std::min(len, LOG_RECORD_TEXT);
+		uint64_t pos = log.ring.beginPush();
+		LogRecord& r = log.records[log.ring.slot(pos)];
+		r.nanos = nanos;
+		r.level = level;
+		r.more = n < len;
+		r.len = n;
+		memcpy(r.text, text, n);
+		log.ring.endPush(pos);
+		text += n;
+		len -= n;
+	} while (len > 0);
+	if (log.ring.sizeApprox() >= log.ring.capacity() / 2
+			&& !log.wakePending.exchange(true, std::memory_order_relaxed)) {
+		wakeWriter();
+	}
+}
+
+/**
+ * Pop every complete message from the rings into batch, with their text
+ * appended to pool, and free the rings of threads that have exited.
+ */
+void drainRings(std::vector<Message>& batch, std::string& pool) {
+	pthread_mutex_lock(&ringsMutex);
+	std::vector<ThreadLog*> current(rings);
+	pthread_mutex_unlock(&ringsMutex);
+
+	std::vector<ThreadLog*> finished;
+	for (size_t i = 0; i < current.size(); ++i) {
+		ThreadLog& log = *current[i];
+		// read before draining: once set, the thread pushes nothing more
+		const bool closed = log.closed.load(std::memory_order_acquire);
+		log.wakePending.store(false, std::memory_order_relaxed);
+		uint64_t pos;
+		while (log.ring.tryBeginPop(pos)) {
+			const LogRecord& r = log.records[log.ring.slot(pos)];
+			if (r.more || !log.partial.empty()) {
+				if (log.partial.empty()) {
+					log.partialNanos = r.nanos;
+					log.partialLevel = r.level;
+				}
+				log.partial.append(r.text, r.len);
+				if (!r.more) {
+					Message m = { log.partialNanos, log.partialLevel,
+							pool.size(), log.partial.size() };
+					pool.append(log.partial);
+					batch.push_back(m);
+					log.partial.clear();
+				}
+			} else {
+				Message m = { r.nanos, r.level, pool.size(), r.len };
+				pool.append(r.text, r.len);
+				batch.push_back(m);
+			}
+			log.ring.endPop(pos);
+		}
+		if (closed) {
+			finished.push_back(current[i]);
+		}
+	}
+
+	if (!finished.empty()) {
+		pthread_mutex_lock(&ringsMutex);
+		for (size_t i = 0; i < finished.size(); ++i) {
+			rings.erase(std::find(rings.begin(), rings.end(), finished[i]));
+			delete finished[i];
+		}
+		pthread_mutex_unlock(&ringsMutex);
+	}
+}
+
+void* writerMain(void*) {
+	std::vector<Message> batch;
+	std::string pool;
+	while (true) {
+		pthread_mutex_lock(&writerMutex);
+		const uint64_t ticket = flushRequested;
+		const bool stopping = stopRequested;
+		wakeRequested = false;
+		pthread_mutex_unlock(&writerMutex);
+
+		batch.clear();
+		pool.clear();
+		drainRings(batch, pool);
+		// each ring is in time order; merge them
+		std::stable_sort(batch.begin(), batch.end());
+		pthread_mutex_lock(&outputMutex);
+		for (size_t i = 0; i < batch.size(); ++i) {
+			emit(batch[i].level, batch[i].nanos, pool.data() + batch[i].offset,
+					batch[i].len);
+		}
+		flushOutputs();
+		pthread_mutex_unlock(&outputMutex);
+
+		pthread_mutex_lock(&writerMutex);
+		if (ticket > flushDone) {
+			flushDone = ticket;
+			pthread_cond_broadcast(&flushCond);
+		}
+		if (stopping) {
+			pthread_mutex_unlock(&writerMutex);
+			return NULL;
+		}
+		if (!wakeRequested && !stopRequested && flushRequested == ticket) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += WRITER_INTERVAL_MS * 1000000;
+			if (deadline.tv_nsec >= 1000000000) {
+				deadline.tv_sec += 1;
+				deadline.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&wakeCond, &writerMutex, &deadline);
+		}
+		pthread_mutex_unlock(&writerMutex);
+	}
+}
+
+void stopAsyncAtExit() {
+	Logger::stopAsync();
+}
+
+void registerAtexit() {
+	atexit(stopAsyncAtExit);
+}
+
+int parseLevel(const char* s) {
+	static const char* const NAMES[] = { "trace", "info", "warning", "error",
+			"fatal" };
+	for (int i = TRACE; i <= FATAL; ++i) {
+		if (strcasecmp(s, NAMES[i]) == 0) {
+			return i;
+		}
+	}
+	return WARNING;
+}
+
+int initialLevel() {
+	const char* s = getenv("RUDRA_LOG_LEVEL");
+	return s == NULL ? WARNING : parseLevel(s);
+}
+
+/** Applies RUDRA_LOG_FILE and RUDRA_LOG_ASYNC when the library is loaded. */
+struct EnvironmentSettings {
+	EnvironmentSettings() {
+		const char* file = getenv("RUDRA_LOG_FILE");
+		if (file != NULL && *file != '\0') {
+			Logger::setLogFile(file);
+		}
+		const char* async = getenv("RUDRA_LOG_ASYNC");
+		if (async != NULL && strcmp(async, "1") == 0) {
+			Logger::startAsync();
+		}
+	}
+};
+} /* namespace */
+
+std::atomic<int> Logger::minLevel(initialLevel());
+static EnvironmentSettings environmentSettings;
+
 void Logger::setLogFile(std::string f) {
-	// TODO allow logging to file
-	/*
-	 std::string fName = f;
-	 std::cout << "Opening log file " << f << std::endl;
-	 _output.open(fName.c_str(), std::ios::trunc);
-	 if (_output.bad()) {
-	 std::cerr << "Error opening log file: " << fName << std::endl;
-	 exit(1);
-	 }
-	 */
+	FILE* file = fopen(f.c_str(), "a");
+	if (file == NULL) {
+		logFatal("Logger: failed to open log file " + f);
+	}
+	pthread_mutex_lock(&outputMutex);
+	if (logFile != NULL) {
+		fclose(logFile);
+	}
+	logFile = file;
+	pthread_mutex_unlock(&outputMutex);
 }
 
 void Logger::setLoggingLevel(int i) {
 	switch (i) {
+	case -1:
+		setLevel(TRACE);
+		break;
 	case 1:
-		LOG_LEVEL = INFO;
+		setLevel(WARNING);
 		break;
 	case 2:
-		LOG_LEVEL = WARNING;
+		setLevel(ERROR);
 		break;
 	case 3:
-		LOG_LEVEL = ERROR;
-		break;
-	case 4:
-		LOG_LEVEL = FATAL;
+		setLevel(FATAL);
 		break;
 	default:
-		LOG_LEVEL = INFO;
+		setLevel(INFO);
 		break;
 	}
 
 }
 
+void Logger::setLevel(LogLevel level) {
+	minLevel.store(level, std::memory_order_relaxed);
+}
+
+void Logger::startAsync() {
+	pthread_once(&atexitOnce, registerAtexit);
+	pthread_mutex_lock(&writerMutex);
+	if (!asyncOn.load(std::memory_order_relaxed)) {
+		stopRequested = false;
+		if (pthread_create(&writerThread, NULL, writerMain, NULL) != 0) {
+			pthread_mutex_unlock(&writerMutex);
+			logFatal("Logger: failed to create writer thread");
+		}
+		asyncOn.store(true, std::memory_order_release);
+	}
+	pthread_mutex_unlock(&writerMutex);
+}
+
+void Logger::stopAsync() {
+	pthread_mutex_lock(&writerMutex);
+	if (!asyncOn.load(std::memory_order_relaxed)) {
+		pthread_mutex_unlock(&writerMutex);
+		return;
+	}
+	asyncOn.store(false, std::memory_order_release);
+	stopRequested = true;
+	pthread_cond_signal(&wakeCond);
+	pthread_mutex_unlock(&writerMutex);
+	pthread_join(writerThread, NULL);
+}
+
+bool Logger::isAsync() {
+	return asyncOn.load(std::memory_order_acquire);
+}
+
+void Logger::flush() {
+	pthread_mutex_lock(&writerMutex);
+	if (asyncOn.load(std::memory_order_relaxed)) {
+		const uint64_t ticket = ++flushRequested;
+		pthread_cond_signal(&wakeCond);
+		while (flushDone < ticket && asyncOn.load(std::memory_order_relaxed)) {
+			pthread_cond_wait(&flushCond, &writerMutex);
+		}
+	}
+	pthread_mutex_unlock(&writerMutex);
+}
+
 void Logger::log(std::string msg, LogLevel level) {
-	if (LOG_LEVEL <= level) {
-		// TODO: prefix with level?
-		std::cout << msg << std::endl;
+	if (enabled(level)) {
+		log(level, msg.data(), msg.size());
+	}
+}
+
+void Logger::log(LogLevel level, const char* text, size_t len) {
+	if (asyncOn.load(std::memory_order_acquire)) {
+		enqueue(level, text, len);
+	} else {
+		pthread_mutex_lock(&outputMutex);
+		emit(level, nowNanos(), text, len);
+		flushOutputs();
+		pthread_mutex_unlock(&outputMutex);
 	}
 }
 
+void Logger::logTrace(std::string msg) {
+	log(msg, TRACE);
+}
+
 void Logger::logInfo(std::string msg) {
 	log(msg, INFO);
 }
@@ -90,17 +499,13 @@ void Logger::logWarning(std::string msg) {
 }
 
 void Logger::logError(std::string msg) {
-	// TODO copy to log file
-	//log(msg, ERROR);
-	if (LOG_LEVEL <= ERROR) {
-		std::cerr << msg << std::endl;
-	}
+	log(msg, ERROR);
 }
 
 void Logger::logFatal(std::string msg) {
-	// TODO copy to log file
-	//log(msg, FATAL);
-	std::cerr << msg << std::endl;
+	// write out everything queued before the message that explains the exit
+	stopAsync();
+	log(FATAL, msg.data(), msg.size());
 	exit(EXIT_FAILURE);
 }
 
@@ -119,4 +524,53 @@ void Logger::dumpTable(std::string fileName, float **table, int m, int n) {
 	}
 	f1.close();
 }
+
+LogLine::Buffer::Buffer() :
+		text(256, '\0') {
+	setp(&text[0], &text[0] + text.size());
+}
+
+LogLine::Buffer::int_type LogLine::Buffer::overflow(int_type c) {
+	if (traits_type::eq_int_type(c, traits_type::eof())) {
+		return traits_type::not_eof(c);
+	}
+	const size_t n = size();
+	text.resize(2 * text.size());
+	setp(&text[0], &text[0] + text.size());
+	pbump(n);
+	*pptr() = traits_type::to_char_type(c);
+	pbump(1);
+	return c;
+}
+
+LogLine::LogLine(LogLevel level) :
+		level(level) {
+	ThreadState* t = getThreadState();
+	if (t->busy) {
+		// logging from within another message's stream expression
+		buf = new Buffer();
+		os = new std::ostream(buf);
+		owned = true;
+	} else {
+		t->busy = true;
+		buf = &t->buf;
+		os = &t->os;
+		owned = false;
+		buf->clear();
+		os->clear();
+		os->flags(std::ios_base::skipws | std::ios_base::dec);
+		os->precision(6);
+		os->fill(' ');
+	}
+}
+
+LogLine::~LogLine() {
+	Logger::log(level, buf->data(), buf->size());
+	if (owned) {
+		delete os;
+		delete buf;
+	} else {
+		getThreadState()->busy = false;
+	}
+}
 } /* namespace rudra */
@@ -35,26 +35,136 @@
 
 #ifndef RUDRA_UTIL_LOGGER_H_
 #define RUDRA_UTIL_LOGGER_H_
+#include <atomic>
 #include <fstream>
+#include <ostream>
+#include <streambuf>
+#include <string>
 
 enum LogLevel {
-	INFO, WARNING, ERROR, FATAL
+	TRACE, INFO, WARNING, ERROR, FATAL
 };
 
 namespace rudra {
+/**
+ * Process-wide logging. Messages below the current level are dropped; the
+ * RUDRA_LOG macros below check the level before their message is formatted,
+ * so a filtered message costs one relaxed load.
+ * By default each message is written synchronously, to standard output (or
+ * standard error for errors), or to the log file if one is set. In async
+ * mode each thread instead copies its messages into its own lock-free ring,
+ * and a background thread drains the rings, merging them in time order, and
+ * writes them in batches, flushing whenever it runs out of work. A thread
+ * only waits if its ring is full.
+ * The initial level, log file and mode may be given by the environment
+ * variables RUDRA_LOG_LEVEL (trace, info, warning, error or fatal),
+ * RUDRA_LOG_FILE and RUDRA_LOG_ASYNC (1 to start in async mode).
+ */
 class Logger {
 public:
+	/**
+	 * Write all further messages to the named file, each prefixed with its
+	 * time and level; errors are also copied to standard error.
+	 */
 	static void setLogFile(std::string fname);
+	/**
+	 * Set the level by the number -ln takes: -1 (TRACE), 0 (INFO),
+	 * 1 (WARNING), 2 (ERROR) or 3 (FATAL); anything else is INFO.
+	 */
 	static void setLoggingLevel(int i);
+	static void setLevel(LogLevel level);
+	static LogLevel getLevel() {
+		return (LogLevel) minLevel.load(std::memory_order_relaxed);
+	}
+	/** True if messages at the given level are currently logged. */
+	static bool enabled(LogLevel level) {
+		return level >= minLevel.load(std::memory_order_relaxed);
+	}
+
+	/** Start the background writer; messages logged from now on are queued. */
+	static void startAsync();
+	/** Write out every queued message and stop the background writer. */
+	static void stopAsync();
+	static bool isAsync();
+	/** Block until every message logged before the call has been written. */
+	static void flush();
+
 	/** log message at chosen level of severity */
 	static void log(std::string msg, LogLevel level);
+	static void log(LogLevel level, const char* text, size_t len);
+	static void logTrace(std::string msg);
 	static void logInfo(std::string msg);
 	static void logWarning(std::string msg);
 	static void logError(std::string msg);
 	/** log error and terminate the program */
 	static void logFatal(std::string msg);
 	static void dumpTable(std::string fileName, float **table, int m, int n);
+
+private:
+	static std::atomic<int> minLevel;
+};
+
+/**
+ * Formats one message for the RUDRA_LOG macros, into a per-thread buffer that
+ * is reused from message to message, and logs it when destroyed.
+ */
+class LogLine {
+public:
+	explicit LogLine(LogLevel level);
+	~LogLine();
+
+	std::ostream& stream() {
+		return *os;
+	}
+
+	/** A streambuf that collects text into a growable buffer. */
+	class Buffer: public std::streambuf {
+	public:
+		Buffer();
+		const char* data() const {
+			return pbase();
+		}
+		size_t size() const {
+			return pptr() - pbase();
+		}
+		void clear() {
+			setp(pbase(), epptr());
+		}
+
+	protected:
+		int_type overflow(int_type c);
+
+	private:
+		std::string text;
+	};
+
+private:
+	LogLevel level;
+	Buffer* buf;
+	std::ostream* os;
+	bool owned; // true if buf and os belong to this line, not to the thread
+
+	LogLine(const LogLine&);
+	LogLine& operator=(const LogLine&);
 };
 
 } /* namespace rudra */
+
+/**
+ * Log the values streamed in expr at the given level, e.g.
+ *     RUDRA_LOG_INFO("loaded shard " << shard << " (" << rows << " rows)");
+ * expr is not evaluated if the level is filtered out.
+ */
+#define RUDRA_LOG(level, expr) \
+	do { \
+		if (rudra::Logger::enabled(level)) { \
+			rudra::LogLine rudraLogLine_(level); \
+			rudraLogLine_.stream() << expr; \
+		} \
+	} while (0)
+#define RUDRA_LOG_TRACE(expr) RUDRA_LOG(TRACE, expr)
+#define RUDRA_LOG_INFO(expr) RUDRA_LOG(INFO, expr)
+#define RUDRA_LOG_WARNING(expr) RUDRA_LOG(WARNING, expr)
+#define RUDRA_LOG_ERROR(expr) RUDRA_LOG(ERROR, expr)
+
 #endif /* RUDRA_UTIL_LOGGER_H_ */
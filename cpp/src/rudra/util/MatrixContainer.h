@@ -36,6 +36,7 @@
 #ifndef RUDRA_UTIL_MATRIXCONTAINER_H_
 #define RUDRA_UTIL_MATRIXCONTAINER_H_
 
+#include <algorithm>
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
@@ -45,6 +46,13 @@
 #include <sstream>
 
 #include <pthread.h>
+#include "rudra/util/AlignedAlloc.h"
+#include "rudra/util/MatrixView.h"
+
+#if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
+#define RUDRA_HAVE_RVALUE_REFS 1
+#endif
+
 // vj do not support initialization with random numbers
 enum matInit_t {
 	_ZEROS, _ONES,
@@ -53,6 +61,13 @@ enum matInit_t {
 };
 
 namespace rudra {
+/**
+ * An M x N row-major matrix that owns its buffer. Buffers are allocated
+ * with alignedAlloc (64-byte aligned, optionally on huge pages), so T must
+ * be a plain numeric type. Matrices are moved, not copied, when returned by
+ * value or assigned from a temporary; use view() to pass one down without
+ * giving up ownership.
+ */
 template<class T>
 class MatrixContainer {
 
@@ -64,13 +79,21 @@ public:
 	/* constructors */
 	MatrixContainer();
 	~MatrixContainer();
-	/** create an empty matrix */
+	/** create an uninitialized matrix */
 	MatrixContainer(size_t M_in, size_t N_in);
+	/**
+	 * adopt a buffer allocated with new T[], which is freed with delete[];
+	 * use MatrixView to wrap memory owned by someone else
+	 */
 	MatrixContainer(size_t M_in, size_t N_in, T *buf_in);
 	/** create a new matrix of zeros or ones or randu or randn */
 	MatrixContainer(size_t M_in, size_t N_in, matInit_t s);
 	/** copy constructor for deep copy. */
 	MatrixContainer(const MatrixContainer<T>& mat);
+#ifdef RUDRA_HAVE_RVALUE_REFS
+	/** move constructor: takes the buffer, leaving mat empty */
+	MatrixContainer(MatrixContainer<T>&& mat);
+#endif
 
 	/** template copy constructor */
 	template<class U>
@@ -80,26 +103,59 @@ public:
 
 	/* assignment operators */
 	MatrixContainer<T>& operator=(const MatrixContainer<T>& rhs); // assignment operator
+#ifdef RUDRA_HAVE_RVALUE_REFS
+	MatrixContainer<T>& operator=(MatrixContainer<T>&& rhs); // move assignment operator
+#endif
 	template<class U>
 	MatrixContainer<T>& operator=(const MatrixContainer<U>& rhs); // template assignment operator
 
+	/** exchange contents with mat without copying */
+	void swap(MatrixContainer<T>& mat);
+
+	/** set every element to value */
+	void fill(T value);
+
+	/** a non-owning view of this matrix */
+	MatrixView<T> view() {
+		return MatrixView<T>(dimM, dimN, buf);
+	}
+	MatrixView<const T> view() const {
+		return MatrixView<const T>(dimM, dimN, buf);
+	}
+
 	/*matrix IO*/
 	const T& operator()(size_t r, size_t c) const;
 	T& operator()(size_t r, size_t c);
 	void writeMat(std::string s) const;
+	/** Write in the big-endian binary format read by readBinMat. */
 	void writeBinMat(std::string s) const;
 
+private:
+	bool adopted; // buf came from new T[] rather than alignedAlloc
+
+	void allocate(size_t M_in, size_t N_in);
+	void release();
 };
 
+/*
+ * Text matrix files are read through TextMatrixFile; these are defined in
+ * rudra/io/TextMatrixFile.cpp.
+ */
+/** read a whole comma-separated text matrix */
 MatrixContainer<float> readMat(std::string s);
 /** return a submatrix of size (r x c) starting at position (rpos,cpos) */
-MatrixContainer<float> readMat(int rpos, int cpos, int r, int c, std::string s);
+MatrixContainer<float> readMat(size_t rpos, size_t cpos, size_t r, size_t c,
+		std::string s);
 
+/** read stride rows of len values starting at row idx into buf */
 void readMat(float * buf, size_t idx, size_t stride, size_t len,
 		std::string fileName);
 
 template<class T>
 MatrixContainer<T> readBinMat(std::string s);
+/** read a binary matrix into existing memory of the same dimensions */
+template<class T>
+void readBinMat(std::string s, MatrixView<T> dst);
 
 template<class T>
 void readBinMat(T * buf, size_t idx, size_t stride, size_t len,
@@ -111,22 +167,37 @@ void MatrixContainer<T>::defaultInit() {
 	buf = NULL;
 	dimM = 0;
 	dimN = 0;
+	adopted = false;
 }
 
+// Allocate an uninitialized, aligned buffer for an M x N matrix
 template<class T>
-MatrixContainer<T>::MatrixContainer() {
-	defaultInit();
+void MatrixContainer<T>::allocate(size_t M_in, size_t N_in) {
+	dimM = M_in;
+	dimN = N_in;
+	buf = (T*) alignedAlloc(M_in * N_in * sizeof(T));
+	adopted = false;
 }
 
+// Free the buffer, leaving an empty matrix
 template<class T>
-MatrixContainer<T>::~MatrixContainer() {
-
-	if (buf) {
+void MatrixContainer<T>::release() {
+	if (adopted) {
 		delete[] buf;
+	} else {
+		alignedFree(buf);
 	}
+	defaultInit();
+}
 
+template<class T>
+MatrixContainer<T>::MatrixContainer() {
 	defaultInit();
+}
 
+template<class T>
+MatrixContainer<T>::~MatrixContainer() {
+	release();
 }
 
 template<class T>
@@ -136,9 +207,7 @@ MatrixContainer<T>::MatrixContainer(size_t M_in, size_t N_in) {
 		std::cout << "Error! Matrix dimension cannot be zero" << std::endl;
 		exit(EXIT_FAILURE);
 	}
-	dimM = M_in;
-	dimN = N_in;
-	buf = new T[M_in * N_in];
+	allocate(M_in, N_in);
 }
 
 template<class T>
@@ -146,6 +215,7 @@ MatrixContainer<T>::MatrixContainer(size_t M_in, size_t N_in, T* buf_in) {
 	dimM = M_in;
 	dimN = N_in;
 	buf = buf_in;
+	adopted = true;
 }
 
 template<class T>
@@ -157,30 +227,19 @@ MatrixContainer<T>::MatrixContainer(size_t M_in, size_t N_in, matInit_t s) {
 		std::cout << "Error! Matrix dimension cannot be zero" << std::endl;
 		exit(EXIT_FAILURE);
 	}
-	dimM = M_in;
-	dimN = N_in;
-	size_t numElements = M_in * N_in;
-	buf = new T[numElements];
+	allocate(M_in, N_in);
 	switch (s) {
 
-	case _ZEROS:
-		// initialize to a matrix of all zeros
-		for (size_t i = 0; i < M_in * N_in; ++i) {
-			buf[i] = 0;
-		}
-		break;
-
 	case _ONES:
 		// initialize to a matrix of all ones
-		for (size_t i = 0; i < M_in * N_in; ++i) {
-			buf[i] = 1;
-		}
+		fill(T(1));
 		break;
+
+	case _ZEROS:
 	default:
-		// default case: initialize to all zeros
-		for (size_t i = 0; i < M_in * N_in; ++i) {
-			buf[i] = 0;
-		}
+		// initialize to a matrix of all zeros; all-zero bits are zero for
+		// the numeric types stored here
+		memset(buf, 0, M_in * N_in * sizeof(T));
 		break;
 	}
 }
@@ -195,13 +254,19 @@ MatrixContainer<T>::MatrixContainer(const MatrixContainer<T>& mat) {
 	}
 
 	// allocate new memory
-	this->dimM = mat.dimM;
-	this->dimN = mat.dimN;
-	this->buf = new T[dimM * dimN];
+	allocate(mat.dimM, mat.dimN);
 	// copy data
 	memcpy(this->buf, mat.buf, (dimM * dimN) * sizeof(T));
 }
 
+#ifdef RUDRA_HAVE_RVALUE_REFS
+template<class T>
+MatrixContainer<T>::MatrixContainer(MatrixContainer<T>&& mat) {
+	defaultInit();
+	swap(mat);
+}
+#endif
+
 template<class T>
 template<class U>
 MatrixContainer<T>::MatrixContainer(const MatrixContainer<U>& mat) {
@@ -213,9 +278,7 @@ MatrixContainer<T>::MatrixContainer(const MatrixContainer<U>& mat) {
 	}
 
 	//allocate new memory
-	this->dimM = mat.dimM;
-	this->dimN = mat.dimN;
-	this->buf = new T[dimM * dimN];
+	allocate(mat.dimM, mat.dimN);
 
 	//convert (U -> T) and copy data
 	for (size_t i = 0; i < dimN * dimM; ++i) {
@@ -239,18 +302,28 @@ MatrixContainer<T>& MatrixContainer<T>::operator=(
 		if (rhs.dimM != this->dimM || rhs.dimN != this->dimN) {
 
 			//deallocate existing memory
-			if (this->buf != NULL) {
-				this->~MatrixContainer();
-			}
-			this->dimM = rhs.dimM;
-			this->dimN = rhs.dimN;
-			this->buf = new T[numElements];
+			release();
+			allocate(rhs.dimM, rhs.dimN);
 		}
 		memcpy(this->buf, rhs.buf, numElements * sizeof(T));
 	}
 	return (*this);
 }
 
+#ifdef RUDRA_HAVE_RVALUE_REFS
+//==============================
+// Move assignment operator
+//==============================
+template<class T>
+MatrixContainer<T>& MatrixContainer<T>::operator=(MatrixContainer<T>&& rhs) {
+	if (this != &rhs) {
+		release();
+		swap(rhs);
+	}
+	return (*this);
+}
+#endif
+
 //==============================
 // Template assignment operator
 //==============================
@@ -259,21 +332,11 @@ template<class U>
 MatrixContainer<T>& MatrixContainer<T>::operator=(
 		const MatrixContainer<U>& rhs) {
 
-	// check if dimensions match
-	if (rhs.dimM != this->dimM || rhs.dimN != this->dimN) {
-		//	std::cout << "Warning: Dimension mismatch" << std::endl;
-		//	exit(EXIT_FAILURE);
-	}
-
 	// no need to check for self-copy -- since datatype U needs to be converted to T
 
 	//deallocate existing memory
-	if (this->buf != NULL && dimM * dimN != 0) {
-		this->~MatrixContainer();
-	}
-	this->dimM = rhs.dimM;
-	this->dimN = rhs.dimN;
-	this->buf = new T[dimM * dimN];
+	release();
+	allocate(rhs.dimM, rhs.dimN);
 
 	for (size_t i = 0; i < dimN * dimM; ++i) {
 		this->buf[i] = T(rhs.buf[i]);
@@ -282,6 +345,19 @@ MatrixContainer<T>& MatrixContainer<T>::operator=(
 
 }
 
+template<class T>
+void MatrixContainer<T>::swap(MatrixContainer<T>& mat) {
+	std::swap(buf, mat.buf);
+	std::swap(dimM, mat.dimM);
+	std::swap(dimN, mat.dimN);
+	std::swap(adopted, mat.adopted);
+}
+
+template<class T>
+void MatrixContainer<T>::fill(T value) {
+	std::fill(buf, buf + dimM * dimN, value);
+}
+
 //==============================
 // Misc. functions
 //==============================
@@ -322,6 +398,7 @@ template<class T>
 void MatrixContainer<T>::writeBinMat(std::string s) const {
 	// binary file format : [uint32_t][uint32_t][data	]
 	//			[rows  ][cols  ][	]	
+	// all big-endian, as read by readBinMat
 	std::ofstream f1(s.c_str(),
 			std::ios::out | std::ios::trunc | std::ios::binary); // open in binary mode, discard e
 	if (!f1) {
@@ -330,187 +407,35 @@ void MatrixContainer<T>::writeBinMat(std::string s) const {
 		exit(EXIT_FAILURE);
 	}
 
-	f1.write((char*) &this->dimM, sizeof(uint32_t));	// write number of rows
-	f1.write((char*) &this->dimN, sizeof(uint32_t));	// write number of cols
-
-	f1.write((char*) this->buf, sizeof(T) * dimM * dimN); // write the buffer
-
-	f1.close();
-
-}
-//===========================
-// read Matrix
-//===========================
-inline MatrixContainer<float> readMat(std::string s) {
-	std::ifstream f1(s.c_str(), std::ios::in); //open file for reading
-	if (!f1) {
-		std::cout << "Error! failed to open file " << s << " " << std::endl;
-		exit(EXIT_FAILURE);
-	}
-
-	std::string line;
-	std::stringstream ss;
-	std::string temp;
-
-	int r = 0;
-	int c = 0;
-
-	// figure out the dimensions of the resulting matrix
-
-	// figure out # of rows
-	getline(f1, line, '\n');
-	while (!f1.eof()) {
-		r++;
-		getline(f1, line, '\n');
-	}
-
-	if (r == 0) {
-		std::cout << "Are you trying to read in an empty matrix from " << s
-				<< " ?" << std::endl;
-		exit(EXIT_FAILURE);
-	}
-	f1.clear();					// clear eof flags
-	f1.seekg(0, std::ios::beg); // move the beginning of the file
-
-	//figure out # of columns
-	getline(f1, line, '\n');		// read one line.
-	ss << line;
-	while (!ss.eof()) {
-		getline(ss, temp, ',');
-		c++;
-	}
-
-	// now read in all the elements
-	ss.clear();
-	f1.clear();					// clear eof flags
-	f1.seekg(0, std::ios::beg); // move the beginning of the file
-
-	int ii = 0;
-	int jj = 0;
-	MatrixContainer<float> ret(r, c, _ZEROS);
-	getline(f1, line, '\n');
-	while (!f1.eof()) {
-		ss << line;
-		while (!ss.eof()) {
-			getline(ss, temp, ',');
-			ret.buf[ii] = std::atof(temp.c_str()); //string to float
-			ii++;
-		}
-		ss.clear();
-		jj++;
-		getline(f1, line, '\n');
-	}
-
-	return ret;
-}
-inline void readMat(float * buf, size_t idx, size_t stride, size_t len,
-		std::string fileName) {
-	// read a stride # of rows starting at idx. len is the size of each row
-	// assuming that size of buffer buf = stride * len * sizeof(float)
-
-	size_t r_t = 0; // number of rows parsed so far
-
-	std::ifstream f1(fileName.c_str(), std::ios::in); //open file for reading
-	if (!f1) {
-		std::cout << "Matrix::readMat::Error! failed to open file: " << fileName
-				<< std::endl;
-		exit(EXIT_FAILURE);
-	}
-
-	std::string line;
-	std::stringstream ss;
-	std::string temp;
-
-	// seek to the row number:rpos
-	getline(f1, line, '\n');
-	while (!f1.eof() && r_t != idx) {
-		r_t++;
-		getline(f1, line, '\n');
-	}
-
-	if (r_t != idx) {
-		// we reached end of file.
-		std::cout << "Matrix::readMat::Number of rows in the matrix = " << r_t
-				<< std::endl;
-		exit(EXIT_FAILURE);
-	}
-
-	size_t ii = 0;
-	size_t jj = 0;
-
-	while (!f1.eof() && jj < stride) {
-		ss << line;
-		ii = 0;
-		while (!ss.eof()) {
-			getline(ss, temp, ',');
-
-			buf[jj * len + ii] = std::atof(temp.c_str()); //string to float
-			ii++;
+	uint32_t dims[2] = { htobe32((uint32_t) dimM), htobe32((uint32_t) dimN) };
+	f1.write((char*) dims, sizeof(dims));	// write number of rows and cols
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (sizeof(T) == 2 || sizeof(T) == 4) {
+		// swap a block at a time into a staging buffer
+		const size_t BLOCK = 1 << 14;
+		const size_t len = dimM * dimN;
+		char staging[BLOCK * sizeof(T)];
+		for (size_t i = 0; i < len; i += BLOCK) {
+			const size_t n = len - i < BLOCK ? len - i : BLOCK;
+			memcpy(staging, this->buf + i, n * sizeof(T));
+			for (size_t j = 0; j < n; ++j) {
+				char* e = staging + j * sizeof(T);
+				std::reverse(e, e + sizeof(T));
+			}
+			f1.write(staging, n * sizeof(T));
 		}
+	} else
+#endif
+	f1.write((char*) this->buf, sizeof(T) * dimM * dimN); // write the buffer
 
-		ss.clear();
-		jj++; 	// keeps track of number of rows parsed so far
-		getline(f1, line, '\n');
-	}
-
-}
-;
-inline MatrixContainer<float> readMat(size_t rpos, size_t cpos, size_t r,
-		size_t c, std::string s) {
-	// read a sub-matrix starting at (rpos,cpos). The size of the sub-matrix is r x c
-	// note: minimum value of rpos and cpos = 0
-
-	MatrixContainer<float> res(r, c, _ZEROS);
-
-	size_t r_t = 0; // number of rows parsed so far
-
-	std::ifstream f1(s.c_str(), std::ios::in); //open file for reading
 	if (!f1) {
-		std::cout << "Matrix::readMat::Error! failed to open file: " << s
-				<< std::endl;
-		exit(EXIT_FAILURE);
-	}
-
-	std::string line;
-	std::stringstream ss;
-	std::string temp;
-
-	// seek to the row number:rpos
-	getline(f1, line, '\n');
-	while (!f1.eof() && r_t != rpos) {
-
-		getline(f1, line, '\n');
-		++r_t;
-	}
-
-	if (r_t != rpos) {
-		// we reached end of file.
-		std::cout << "Matrix::readMat::Number of rows in the matrix = " << r_t
+		std::cout << "Matrix::writeBinMat::Error! failed to write file: " << s
 				<< std::endl;
 		exit(EXIT_FAILURE);
 	}
+	f1.close();
 
-	size_t ii = 0;
-	size_t jj = 0;
-
-	while (!f1.eof() && jj < r) {
-		ss << line;
-		ii = 0;
-		while (!ss.eof()) {
-			getline(ss, temp, ',');
-
-			if (ii > cpos - 1 && ii < cpos + c) {
-				res.buf[jj * c + ii - cpos] = std::atof(temp.c_str()); //string to float
-
-			}
-			ii++;
-		}
-		ss.clear();
-		jj++; 	// keeps track of number of rows parsed so far
-		getline(f1, line, '\n');
-	}
-	return res;
 }
-
 } /* namespace rudra */
 #endif /* RUDRA_UTIL_MATRIXCONTAINER_H_ */
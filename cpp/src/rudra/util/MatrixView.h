@@ -0,0 +1,93 @@
+/*
+ * MatrixView.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_MATRIXVIEW_H_
+#define RUDRA_UTIL_MATRIXVIEW_H_
+
+#include <cassert>
+#include <cstdlib>
+
+namespace rudra {
+/**
+ * A non-owning, row-major view of an M x N matrix held in memory that
+ * belongs to someone else: an X10 Rail, a mapped file, or a
+ * MatrixContainer. Copying a view copies the pointer, not the data, and the
+ * memory must outlive every view of it.
+ */
+template<class T>
+class MatrixView {
+public:
+	T* buf; // pointer to the first element; not freed by the view
+	size_t dimM; // number of rows
+	size_t dimN; // number of columns
+
+	MatrixView() :
+			buf(NULL), dimM(0), dimN(0) {
+	}
+
+	MatrixView(size_t M_in, size_t N_in, T* buf_in) :
+			buf(buf_in), dimM(M_in), dimN(N_in) {
+	}
+
+	/** a view of the same memory through a const element type */
+	template<class U>
+	MatrixView(const MatrixView<U>& v) :
+			buf(v.buf), dimM(v.dimM), dimN(v.dimN) {
+	}
+
+	size_t size() const {
+		return dimM * dimN;
+	}
+
+	T& operator()(size_t r, size_t c) const {
+		assert(r < dimM);
+		assert(c < dimN);
+		return buf[r * dimN + c];
+	}
+
+	/** pointer to the first element of row r */
+	T* row(size_t r) const {
+		return buf + r * dimN;
+	}
+
+	/** a view of count rows starting at row first */
+	MatrixView<T> rows(size_t first, size_t count) const {
+		assert(first + count <= dimM);
+		return MatrixView<T>(count, dimN, buf + first * dimN);
+	}
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_MATRIXVIEW_H_ */
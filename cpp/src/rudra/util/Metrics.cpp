@@ -0,0 +1,505 @@
+/*
+ * Metrics.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/Metrics.h"
+#include "rudra/util/AlignedAlloc.h"
+#include "rudra/util/Logger.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <pthread.h>
+#include <sys/time.h>
+
+namespace rudra {
+
+__thread int metricShardIndex = -1;
+
+int assignMetricShard() {
+	static std::atomic<int> nextShard(0);
+	metricShardIndex = nextShard.fetch_add(1, std::memory_order_relaxed)
+			% METRIC_SHARDS;
+	return metricShardIndex;
+}
+
+namespace {
+enum MetricType {
+	COUNTER, GAUGE, HISTOGRAM
+};
+
+struct Entry {
+	std::string name;
+	std::string help;
+	MetricType type;
+	void* metric;
+};
+
+/** The registered metrics, in the order they were created. */
+struct Registry {
+	pthread_mutex_t mutex;
+	std::vector<Entry> entries;
+	std::map<std::string, size_t> byName;
+	std::vector<std::pair<std::string, std::string> > labels;
+
+	Registry() {
+		pthread_mutex_init(&mutex, NULL);
+	}
+};
+
+Registry& registry() {
+	static Registry* r = new Registry(); // never destroyed, so usable at exit
+	return *r;
+}
+
+const char* typeName(MetricType type) {
+	static const char* const NAMES[] = { "counter", "gauge", "histogram" };
+	return NAMES[type];
+}
+
+/** The entries and labels, copied so they can be exported without the lock. */
+void copyRegistry(std::vector<Entry>& entries,
+		std::vector<std::pair<std::string, std::string> >& labels) {
+	Registry& r = registry();
+	pthread_mutex_lock(&r.mutex);
+	entries = r.entries;
+	labels = r.labels;
+	pthread_mutex_unlock(&r.mutex);
+}
+
+std::string formatDouble(double v) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.9g", v);
+	return buf;
+}
+
+std::string jsonString(const std::string& s) {
+	std::string out = "\"";
+	for (size_t i = 0; i < s.size(); ++i) {
+		const char c = s[i];
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if ((unsigned char) c < 0x20) {
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			out += buf;
+		} else {
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+/** The Prometheus label set, with an extra label if key is not empty. */
+std::string promLabels(
+		const std::vector<std::pair<std::string, std::string> >& labels,
+		const std::string& key = "", const std::string& value = "") {
+	std::string out;
+	for (size_t i = 0; i < labels.size(); ++i) {
+		out += (out.empty() ? "" : ",") + labels[i].first + "="
+				+ jsonString(labels[i].second);
+	}
+	if (!key.empty()) {
+		out += (out.empty() ? "" : ",") + key + "=" + jsonString(value);
+	}
+	return out.empty() ? out : "{" + out + "}";
+}
+
+const double SECONDS_PER_NANO = 1e-9;
+
+// the periodic exporter
+pthread_mutex_t exportMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t exportCond = PTHREAD_COND_INITIALIZER;
+pthread_once_t atexitOnce = PTHREAD_ONCE_INIT;
+bool exporting = false;
+bool stopRequested = false;
+pthread_t exportThread;
+std::string exportFile;
+long exportIntervalMs = 0;
+
+void* exportMain(void*) {
+	pthread_mutex_lock(&exportMutex);
+	while (!stopRequested) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += exportIntervalMs / 1000;
+		deadline.tv_nsec += exportIntervalMs % 1000 * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec += 1;
+			deadline.tv_nsec -= 1000000000;
+		}
+		while (!stopRequested
+				&& pthread_cond_timedwait(&exportCond, &exportMutex, &deadline)
+						== 0) {
+		}
+		const std::string fileName = exportFile;
+		pthread_mutex_unlock(&exportMutex);
+		Metrics::writeFile(fileName);
+		pthread_mutex_lock(&exportMutex);
+	}
+	pthread_mutex_unlock(&exportMutex);
+	return NULL;
+}
+
+void stopExportAtExit() {
+	Metrics::stopExport();
+}
+
+void registerAtexit() {
+	atexit(stopExportAtExit);
+}
+
+/** Starts exporting to RUDRA_METRICS_FILE when the library is loaded. */
+struct EnvironmentSettings {
+	EnvironmentSettings() {
+		const char* file = getenv("RUDRA_METRICS_FILE");
+		if (file != NULL && *file != '\0') {
+			const char* interval = getenv("RUDRA_METRICS_INTERVAL_MS");
+			Metrics::startExport(file, interval != NULL ? atol(interval) : 10000);
+		}
+	}
+};
+} /* namespace */
+
+static EnvironmentSettings environmentSettings;
+
+Counter::Counter() {
+	for (int i = 0; i < METRIC_SHARDS; ++i) {
+		cells[i].value.store(0, std::memory_order_relaxed);
+	}
+}
+
+uint64_t Counter::value() const {
+	uint64_t v = 0;
+	for (int i = 0; i < METRIC_SHARDS; ++i) {
+		v += cells[i].value.load(std::memory_order_relaxed);
+	}
+	return v;
+}
+
+Gauge::Gauge() :
+		value(0.0) {
+}
+
+void Gauge::add(double d) {
+	double v = value.load(std::memory_order_relaxed);
+	while (!value.compare_exchange_weak(v, v + d, std::memory_order_relaxed)) {
+	}
+}
+
+Histogram::Histogram() {
+	for (int i = 0; i < METRIC_SHARDS; ++i) {
+		shards[i].sum.store(0, std::memory_order_relaxed);
+		for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+			shards[i].buckets[b].store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+uint64_t Histogram::bucketLimit(int bucket) {
+	if (bucket < 4) {
+		return bucket + 1;
+	}
+	const int e = bucket / 4 + 1;
+	return (uint64_t) (5 + bucket % 4) << (e - 2);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+	Snapshot s;
+	s.count = 0;
+	s.sum = 0;
+	s.buckets.assign(HISTOGRAM_BUCKETS, 0);
+	for (int i = 0; i < METRIC_SHARDS; ++i) {
+		s.sum += shards[i].sum.load(std::memory_order_relaxed);
+		for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+			s.buckets[b] += shards[i].buckets[b].load(std::memory_order_relaxed);
+		}
+	}
+	for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+		s.count += s.buckets[b];
+	}
+	return s;
+}
+
+double Histogram::Snapshot::quantile(double q) const {
+	if (count == 0) {
+		return 0.0;
+	}
+	const double rank = q * count;
+	uint64_t below = 0;
+	for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+		if (buckets[b] > 0 && below + buckets[b] >= rank) {
+			const double lo = b == 0 ? 0.0 : (double) bucketLimit(b - 1);
+			const double hi = (double) bucketLimit(b);
+			return lo + (hi - lo) * (rank - below) / buckets[b];
+		}
+		below += buckets[b];
+	}
+	return (double) bucketLimit(HISTOGRAM_BUCKETS - 1);
+}
+
+/**
+ * Find the named metric, or create it with placement new in cache-line
+ * aligned memory, which is never freed.
+ */
+template<class M>
+M& Metrics::lookup(const std::string& rawName, const std::string& help,
+		int type) {
+	const std::string name = Metrics::sanitizeName(rawName);
+	Registry& r = registry();
+	pthread_mutex_lock(&r.mutex);
+	std::map<std::string, size_t>::iterator it = r.byName.find(name);
+	if (it != r.byName.end()) {
+		const Entry& e = r.entries[it->second];
+		pthread_mutex_unlock(&r.mutex);
+		if (e.type != type) {
+			Logger::logFatal(
+					"Metrics: " + name + " is already registered as a "
+							+ typeName(e.type));
+		}
+		return *(M*) e.metric;
+	}
+	Entry e;
+	e.name = name;
+	e.help = help;
+	e.type = (MetricType) type;
+	e.metric = new (alignedAlloc(sizeof(M))) M();
+	r.byName[name] = r.entries.size();
+	r.entries.push_back(e);
+	pthread_mutex_unlock(&r.mutex);
+	return *(M*) e.metric;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help) {
+	return lookup<Counter>(name, help, COUNTER);
+}
+
+Gauge& Metrics::gauge(const std::string& name, const std::string& help) {
+	return lookup<Gauge>(name, help, GAUGE);
+}
+
+Histogram& Metrics::histogram(const std::string& name,
+		const std::string& help) {
+	return lookup<Histogram>(name, help, HISTOGRAM);
+}
+
+void Metrics::setLabel(const std::string& key, const std::string& value) {
+	Registry& r = registry();
+	const std::string k = sanitizeName(key);
+	pthread_mutex_lock(&r.mutex);
+	size_t i = 0;
+	while (i < r.labels.size() && r.labels[i].first != k) {
+		++i;
+	}
+	if (i == r.labels.size()) {
+		r.labels.push_back(std::make_pair(k, value));
+	} else {
+		r.labels[i].second = value;
+	}
+	pthread_mutex_unlock(&r.mutex);
+}
+
+void Metrics::writePrometheus(std::ostream& out) {
+	std::vector<Entry> entries;
+	std::vector<std::pair<std::string, std::string> > labels;
+	copyRegistry(entries, labels);
+	const std::string ls = promLabels(labels);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		const Entry& e = entries[i];
+		if (!e.help.empty()) {
+			out << "# HELP " << e.name << " " << e.help << "\n";
+		}
+		out << "# TYPE " << e.name << " " << typeName(e.type) << "\n";
+		if (e.type == COUNTER) {
+			out << e.name << ls << " " << ((Counter*) e.metric)->value() << "\n";
+		} else if (e.type == GAUGE) {
+			out << e.name << ls << " "
+					<< formatDouble(((Gauge*) e.metric)->get()) << "\n";
+		} else {
+			const Histogram::Snapshot s = ((Histogram*) e.metric)->snapshot();
+			// only the buckets from the first to the last used one, as
+			// cumulative counts up to each bucket's limit in seconds
+			int first = 0;
+			int last = HISTOGRAM_BUCKETS - 2;
+			while (first <= last && s.buckets[first] == 0) {
+				++first;
+			}
+			while (last >= first && s.buckets[last] == 0) {
+				--last;
+			}
+			uint64_t cumulative = 0;
+			for (int b = 0; b < first; ++b) {
+				cumulative += s.buckets[b];
+			}
+			for (int b = first; b <= last; ++b) {
+				cumulative += s.buckets[b];
+				out << e.name << "_bucket"
+						<< promLabels(labels, "le",
+								formatDouble(
+										Histogram::bucketLimit(b)
+												* SECONDS_PER_NANO)) << " "
+						<< cumulative << "\n";
+			}
+			out << e.name << "_bucket" << promLabels(labels, "le", "+Inf")
+					<< " " << s.count << "\n";
+			out << e.name << "_sum" << ls << " "
+					<< formatDouble(s.sum * SECONDS_PER_NANO) << "\n";
+			out << e.name << "_count" << ls << " " << s.count << "\n";
+		}
+	}
+}
+
+void Metrics::writeJson(std::ostream& out) {
+	std::vector<Entry> entries;
+	std::vector<std::pair<std::string, std::string> > labels;
+	copyRegistry(entries, labels);
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	char timestamp[32];
+	snprintf(timestamp, sizeof(timestamp), "%ld.%06ld", (long) now.tv_sec,
+			(long) now.tv_usec);
+	out << "{\"timestamp\": " << timestamp << ",\n \"labels\": {";
+	for (size_t i = 0; i < labels.size(); ++i) {
+		out << (i > 0 ? ", " : "") << jsonString(labels[i].first) << ": "
+				<< jsonString(labels[i].second);
+	}
+	out << "}";
+	for (int type = COUNTER; type <= HISTOGRAM; ++type) {
+		out << ",\n \"" << typeName((MetricType) type) << "s\": {";
+		bool firstEntry = true;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			const Entry& e = entries[i];
+			if (e.type != type) {
+				continue;
+			}
+			out << (firstEntry ? "\n  " : ",\n  ") << jsonString(e.name) << ": ";
+			firstEntry = false;
+			if (e.type == COUNTER) {
+				out << ((Counter*) e.metric)->value();
+			} else if (e.type == GAUGE) {
+				out << formatDouble(((Gauge*) e.metric)->get());
+			} else {
+				const Histogram::Snapshot s =
+						((Histogram*) e.metric)->snapshot();
+				out << "{\"count\": " << s.count << ", \"sum\": "
+						<< formatDouble(s.sum * SECONDS_PER_NANO)
+						<< ", \"mean\": "
+						<< formatDouble(
+								s.count > 0 ?
+										s.sum * SECONDS_PER_NANO / s.count :
+										0.0);
+				static const double QS[] = { 0.5, 0.9, 0.99, 0.999 };
+				static const char* const QNAMES[] = { "p50", "p90", "p99",
+						"p999" };
+				for (int q = 0; q < 4; ++q) {
+					out << ", \"" << QNAMES[q] << "\": "
+							<< formatDouble(s.quantile(QS[q]) * SECONDS_PER_NANO);
+				}
+				out << "}";
+			}
+		}
+		out << (firstEntry ? "}" : "\n }");
+	}
+	out << "}\n";
+}
+
+void Metrics::writeFile(const std::string& fileName) {
+	const std::string tmpName = fileName + ".tmp";
+	std::ofstream out(tmpName.c_str(), std::ios::trunc);
+	const size_t n = fileName.size();
+	if (n >= 5 && fileName.compare(n - 5, 5, ".json") == 0) {
+		writeJson(out);
+	} else {
+		writePrometheus(out);
+	}
+	out.close();
+	if (!out || rename(tmpName.c_str(), fileName.c_str()) != 0) {
+		// metrics are not worth stopping the job for
+		Logger::logWarning("Metrics: failed to write " + fileName);
+	}
+}
+
+void Metrics::startExport(const std::string& fileName, long intervalMs) {
+	pthread_once(&atexitOnce, registerAtexit);
+	stopExport();
+	pthread_mutex_lock(&exportMutex);
+	exportFile = fileName;
+	exportIntervalMs = intervalMs > 0 ? intervalMs : 1;
+	stopRequested = false;
+	if (pthread_create(&exportThread, NULL, exportMain, NULL) != 0) {
+		pthread_mutex_unlock(&exportMutex);
+		Logger::logFatal("Metrics: failed to create export thread");
+	}
+	exporting = true;
+	pthread_mutex_unlock(&exportMutex);
+}
+
+void Metrics::stopExport() {
+	pthread_mutex_lock(&exportMutex);
+	if (!exporting) {
+		pthread_mutex_unlock(&exportMutex);
+		return;
+	}
+	exporting = false;
+	stopRequested = true;
+	pthread_cond_signal(&exportCond);
+	const std::string fileName = exportFile;
+	pthread_mutex_unlock(&exportMutex);
+	pthread_join(exportThread, NULL);
+	writeFile(fileName);
+}
+
+std::string Metrics::sanitizeName(const std::string& name) {
+	std::string out;
+	for (size_t i = 0; i < name.size(); ++i) {
+		const char c = name[i];
+		if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == ':') {
+			out += c;
+		} else if (c >= 'A' && c <= 'Z') {
+			out += c - 'A' + 'a';
+		} else if (out.empty() || out[out.size() - 1] != '_') {
+			out += '_';
+		}
+	}
+	while (out.size() > 1 && out[out.size() - 1] == '_') {
+		out.erase(out.size() - 1);
+	}
+	if (out.empty() || (out[0] >= '0' && out[0] <= '9')) {
+		out = "_" + out;
+	}
+	return out;
+}
+} /* namespace rudra */
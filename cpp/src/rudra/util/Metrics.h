@@ -0,0 +1,240 @@
+/*
+ * Metrics.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_METRICS_H_
+#define RUDRA_UTIL_METRICS_H_
+
+#include "rudra/util/EventCount.h"
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace rudra {
+
+/**
+ * Number of shards each counter and histogram is split into. Each thread
+ * updates one shard, chosen when it first records a value, so threads
+ * only share a cache line when there are more of them than shards.
+ */
+const int METRIC_SHARDS = 32;
+
+/**
+ * Histogram buckets: one for each value below 4, then four per power of two
+ * (so a bucket spans at most 25% of its lower bound) up to 2^41 ns, about 37
+ * minutes; larger values go in the last bucket.
+ */
+const int HISTOGRAM_BUCKETS = 160;
+
+extern __thread int metricShardIndex;
+int assignMetricShard();
+
+/** The calling thread's shard. */
+inline int metricShard() {
+	int s = metricShardIndex;
+	return s >= 0 ? s : assignMetricShard();
+}
+
+/** The metrics clock, in nanoseconds from CLOCK_MONOTONIC. */
+inline uint64_t metricNanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/** A count that only goes up, such as a number of events or bytes. */
+class Counter {
+public:
+	void add(uint64_t n = 1) {
+		cells[metricShard()].value.fetch_add(n, std::memory_order_relaxed);
+	}
+	/** The sum over all shards, which may miss concurrent additions. */
+	uint64_t value() const;
+
+private:
+	friend class Metrics;
+	struct Cell {
+		std::atomic<uint64_t> value;
+		char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+	};
+	Cell cells[METRIC_SHARDS];
+
+	Counter();
+	Counter(const Counter&);
+	Counter& operator=(const Counter&);
+};
+
+/** A value that may go up or down, such as a queue depth. */
+class Gauge {
+public:
+	void set(double v) {
+		value.store(v, std::memory_order_relaxed);
+	}
+	void add(double d);
+	double get() const {
+		return value.load(std::memory_order_relaxed);
+	}
+
+private:
+	friend class Metrics;
+	std::atomic<double> value;
+
+	Gauge();
+	Gauge(const Gauge&);
+	Gauge& operator=(const Gauge&);
+};
+
+/** A distribution of durations in nanoseconds, in log-spaced buckets. */
+class Histogram {
+public:
+	void record(uint64_t nanos) {
+		Shard& s = shards[metricShard()];
+		s.buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+		s.sum.fetch_add(nanos, std::memory_order_relaxed);
+	}
+
+	/** Index of the bucket holding the given value. */
+	static int bucketOf(uint64_t v) {
+		if (v < 4) {
+			return (int) v;
+		}
+		const int e = 63 - __builtin_clzll(v); // 2^e <= v < 2^(e+1)
+		const int b = (e - 1) * 4 + (int) ((v >> (e - 2)) & 3);
+		return b < HISTOGRAM_BUCKETS ? b : HISTOGRAM_BUCKETS - 1;
+	}
+	/** The smallest value that falls in a bucket after the given one. */
+	static uint64_t bucketLimit(int bucket);
+
+	/** The counts summed over all shards at one moment. */
+	struct Snapshot {
+		uint64_t count;
+		uint64_t sum;
+		std::vector<uint64_t> buckets;
+
+		/**
+		 * The value below which the given fraction of the recorded values
+		 * fall, interpolated within its bucket; 0 if nothing was recorded.
+		 */
+		double quantile(double q) const;
+	};
+	Snapshot snapshot() const;
+
+private:
+	friend class Metrics;
+	struct Shard {
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+		char pad[CACHE_LINE_SIZE
+				- (HISTOGRAM_BUCKETS + 1) * sizeof(uint64_t) % CACHE_LINE_SIZE];
+	};
+	Shard shards[METRIC_SHARDS];
+
+	Histogram();
+	Histogram(const Histogram&);
+	Histogram& operator=(const Histogram&);
+};
+
+/** Records the time from its construction to its destruction in a histogram. */
+class ScopedTimer {
+public:
+	explicit ScopedTimer(Histogram& h) :
+			h(h), start(metricNanos()) {
+	}
+	~ScopedTimer() {
+		h.record(metricNanos() - start);
+	}
+
+private:
+	Histogram& h;
+	const uint64_t start;
+
+	ScopedTimer(const ScopedTimer&);
+	ScopedTimer& operator=(const ScopedTimer&);
+};
+
+/**
+ * The process-wide registry of named metrics. Metrics are created on first
+ * lookup and live until the process exits, so callers on hot paths should
+ * look a metric up once and keep the reference, e.g. in a function-local
+ * static. Names are converted to Prometheus form: lower case, with runs of
+ * other characters than letters, digits and ':' replaced by '_'. By
+ * convention counters end in _total and histograms in _seconds; histograms
+ * record nanoseconds and are exported in seconds.
+ * The registry can be written out in Prometheus text format or as JSON,
+ * and periodically to a file by a background thread. The export file and
+ * interval may also be given by the environment variables
+ * RUDRA_METRICS_FILE and RUDRA_METRICS_INTERVAL_MS.
+ */
+class Metrics {
+public:
+	static Counter& counter(const std::string& name,
+			const std::string& help = "");
+	static Gauge& gauge(const std::string& name, const std::string& help = "");
+	static Histogram& histogram(const std::string& name,
+			const std::string& help = "");
+
+	/** Attach a label, such as the place id, to every exported metric. */
+	static void setLabel(const std::string& key, const std::string& value);
+
+	static void writePrometheus(std::ostream& out);
+	static void writeJson(std::ostream& out);
+	/**
+	 * Write the registry to the named file, as JSON if its name ends in
+	 * ".json" and in Prometheus text format otherwise. The file is replaced
+	 * atomically, so readers never see a partial export.
+	 */
+	static void writeFile(const std::string& fileName);
+
+	/**
+	 * Write the registry to the named file every intervalMs milliseconds
+	 * from a background thread, and once more when stopExport is called
+	 * or the process exits.
+	 */
+	static void startExport(const std::string& fileName, long intervalMs);
+	static void stopExport();
+
+	/** The given name in Prometheus form. */
+	static std::string sanitizeName(const std::string& name);
+
+private:
+	template<class M>
+	static M& lookup(const std::string& name, const std::string& help,
+			int type);
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_METRICS_H_ */
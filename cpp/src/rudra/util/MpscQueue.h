@@ -0,0 +1,226 @@
+/*
+ * MpscQueue.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_MPSCQUEUE_H_
+#define RUDRA_UTIL_MPSCQUEUE_H_
+
+#include "rudra/util/EventCount.h"
+#include "rudra/util/SpscQueue.h"
+#include <cstddef>
+#include <vector>
+
+namespace rudra {
+
+/**
+ * The positions of a bounded lock-free ring shared by any number of
+ * producers and one consumer, used as SpscRing is. Producers claim
+ * positions with a compare-and-swap on the tail; each element carries a
+ * sequence number that says whether it is free for the producer of a given
+ * position, or has been published for the consumer. A producer that claims
+ * a position and is then descheduled holds up the consumer at that
+ * position, but not the other producers. Producers blocked on a full ring
+ * are woken once it is half empty.
+ */
+class MpscRing {
+public:
+	explicit MpscRing(size_t capacity) :
+			mask(ringCapacity(capacity) - 1), seq(mask + 1), tail(0), head(0) {
+		for (size_t i = 0; i <= mask; ++i) {
+			seq[i].store(i, std::memory_order_relaxed);
+		}
+	}
+
+	size_t capacity() const {
+		return mask + 1;
+	}
+	size_t slot(uint64_t pos) const {
+		return pos & mask;
+	}
+	/** Number of elements claimed but not yet popped, which may be stale. */
+	size_t sizeApprox() const {
+		return tail.load(std::memory_order_acquire)
+				- head.load(std::memory_order_acquire);
+	}
+
+	bool tryBeginPush(uint64_t& pos) {
+		pos = tail.load(std::memory_order_relaxed);
+		while (true) {
+			const uint64_t s = seq[pos & mask].load(std::memory_order_acquire);
+			const int64_t diff = (int64_t) (s - pos);
+			if (diff == 0) {
+				if (tail.compare_exchange_weak(pos, pos + 1,
+						std::memory_order_relaxed)) {
+					return true;
+				}
+			} else if (diff < 0) {
+				return false; // full
+			} else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	uint64_t beginPush() {
+		uint64_t pos;
+		while (!tryBeginPush(pos)) {
+			awaitCondition(notFull, HasSpace(*this));
+		}
+		return pos;
+	}
+
+	void endPush(uint64_t pos) {
+		seq[pos & mask].store(pos + 1, std::memory_order_release);
+		notEmpty.notifyAll();
+	}
+
+	/** Only the consumer may call the pop methods. */
+	bool tryBeginPop(uint64_t& pos) {
+		pos = head.load(std::memory_order_relaxed);
+		return seq[pos & mask].load(std::memory_order_acquire) == pos + 1;
+	}
+
+	uint64_t beginPop() {
+		uint64_t pos;
+		if (!tryBeginPop(pos)) {
+			awaitCondition(notEmpty, HasValue(*this));
+		}
+		return pos;
+	}
+
+	void endPop(uint64_t pos) {
+		seq[pos & mask].store(pos + mask + 1, std::memory_order_release);
+		head.store(pos + 1, std::memory_order_release);
+		// blocked producers are woken once the ring is half empty
+		if (tail.load(std::memory_order_relaxed) - (pos + 1) <= mask / 2) {
+			notFull.notifyAll();
+		}
+	}
+
+private:
+	struct HasSpace {
+		const MpscRing& r;
+		HasSpace(const MpscRing& r) :
+				r(r) {
+		}
+		bool operator()() const {
+			// the element at the tail is free for its producer
+			const uint64_t pos = r.tail.load(std::memory_order_relaxed);
+			return r.seq[pos & r.mask].load(std::memory_order_acquire) >= pos;
+		}
+	};
+	struct HasValue {
+		MpscRing& r;
+		HasValue(MpscRing& r) :
+				r(r) {
+		}
+		bool operator()() const {
+			uint64_t pos;
+			return r.tryBeginPop(pos);
+		}
+	};
+
+	const size_t mask;
+	std::vector<std::atomic<uint64_t> > seq;
+	char pad0[CACHE_LINE_SIZE];
+	std::atomic<uint64_t> tail; // next position to be claimed by a producer
+	char pad1[CACHE_LINE_SIZE];
+	std::atomic<uint64_t> head; // next position the consumer will take
+	char pad2[CACHE_LINE_SIZE];
+	EventCount notEmpty;
+	char pad3[CACHE_LINE_SIZE];
+	EventCount notFull;
+	char pad4[CACHE_LINE_SIZE];
+
+	MpscRing(const MpscRing&);
+	MpscRing& operator=(const MpscRing&);
+};
+
+/** A bounded lock-free queue of values of type T, for many producers and one consumer. */
+template<class T>
+class MpscQueue {
+public:
+	explicit MpscQueue(size_t capacity) :
+			ring(capacity), data(ring.capacity()) {
+	}
+
+	size_t capacity() const {
+		return ring.capacity();
+	}
+	size_t sizeApprox() const {
+		return ring.sizeApprox();
+	}
+
+	bool tryPush(const T& t) {
+		uint64_t pos;
+		if (!ring.tryBeginPush(pos)) {
+			return false;
+		}
+		data[ring.slot(pos)] = t;
+		ring.endPush(pos);
+		return true;
+	}
+
+	/** Append t, waiting while the queue is full. */
+	void push(const T& t) {
+		uint64_t pos = ring.beginPush();
+		data[ring.slot(pos)] = t;
+		ring.endPush(pos);
+	}
+
+	bool tryPop(T& t) {
+		uint64_t pos;
+		if (!ring.tryBeginPop(pos)) {
+			return false;
+		}
+		t = data[ring.slot(pos)];
+		ring.endPop(pos);
+		return true;
+	}
+
+	/** Remove the oldest value, waiting while the queue is empty. */
+	T pop() {
+		uint64_t pos = ring.beginPop();
+		T t = data[ring.slot(pos)];
+		ring.endPop(pos);
+		return t;
+	}
+
+private:
+	MpscRing ring;
+	std::vector<T> data;
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_MPSCQUEUE_H_ */
@@ -34,34 +34,273 @@
  */
 
 #include "rudra/util/RudraRand.h"
+#include "rudra/util/SimdDispatch.h"
+#include <atomic>
+#include <pthread.h>
 #include <sys/time.h>
-#include <iostream>
+#include <unistd.h>
+#ifdef RUDRA_X86_SIMD
+#include <immintrin.h>
+#endif
+
 namespace rudra {
+
+// Philox4x32 multipliers and Weyl key increments
+static const uint32_t PHILOX_M0 = 0xD2511F53;
+static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+static const uint32_t PHILOX_W0 = 0x9E3779B9;
+static const uint32_t PHILOX_W1 = 0xBB67AE85;
+static const int PHILOX_ROUNDS = 10;
+
+/** The splitmix64 finalizer, used to spread the seed and stream over the key. */
+static uint64_t mix64(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static pthread_once_t defaultSeedOnce = PTHREAD_ONCE_INIT;
+static std::atomic<uint64_t> defaultSeed(0);
+
+static void initDefaultSeed() {
+	const char* s = getenv("RUDRA_SEED");
+	if (s != NULL && *s != '\0') {
+		defaultSeed.store(strtoull(s, NULL, 0));
+		return;
+	}
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	defaultSeed.store(
+			mix64(now.tv_sec * 1000000ULL + now.tv_usec) ^ getpid());
+}
+
+void RudraRand::setDefaultSeed(uint64_t seed) {
+	pthread_once(&defaultSeedOnce, initDefaultSeed);
+	defaultSeed.store(seed);
+}
+
+uint64_t RudraRand::getDefaultSeed() {
+	pthread_once(&defaultSeedOnce, initDefaultSeed);
+	return defaultSeed.load();
+}
+
+void RudraRand::philox(const uint32_t ctr[4], const uint32_t key[2],
+		uint32_t out[4]) {
+	uint32_t x0 = ctr[0], x1 = ctr[1], x2 = ctr[2], x3 = ctr[3];
+	uint32_t k0 = key[0], k1 = key[1];
+	for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+		const uint64_t p0 = (uint64_t) PHILOX_M0 * x0;
+		const uint64_t p1 = (uint64_t) PHILOX_M1 * x2;
+		x0 = (uint32_t) (p1 >> 32) ^ x1 ^ k0;
+		x1 = (uint32_t) p1;
+		x2 = (uint32_t) (p0 >> 32) ^ x3 ^ k1;
+		x3 = (uint32_t) p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+	out[0] = x0;
+	out[1] = x1;
+	out[2] = x2;
+	out[3] = x3;
+}
+
+/**
+ * Generate blocks [first, first + n) for the given key, place and thread,
+ * writing the two words of each block to dst in order.
+ */
+static void philoxBlocksScalar(const uint32_t key[2], uint32_t place,
+		uint32_t thread, uint64_t first, size_t n, uint64_t* dst) {
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t block = first + i;
+		const uint32_t ctr[4] = { (uint32_t) block, (uint32_t) (block >> 32),
+				place, thread };
+		uint32_t out[4];
+		RudraRand::philox(ctr, key, out);
+		dst[2 * i] = out[0] | (uint64_t) out[1] << 32;
+		dst[2 * i + 1] = out[2] | (uint64_t) out[3] << 32;
+	}
+}
+
+#ifdef RUDRA_X86_SIMD
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw")))
+
+/*
+ * The vector variants hold one 32-bit word of the counter of each block in
+ * the low half of a 64-bit lane, where _mm*_mul_epu32 takes its operands,
+ * and compute four (AVX2) or eight (AVX-512) blocks at a time. The high
+ * halves of the lanes are left dirty between rounds, as the multiplies
+ * ignore them, and are cleared when the words are assembled.
+ */
+AVX2_TARGET static void philoxBlocksAVX2(const uint32_t key[2],
+		uint32_t place, uint32_t thread, uint64_t first, size_t n,
+		uint64_t* dst) {
+	const __m256i m0 = _mm256_set1_epi64x(PHILOX_M0);
+	const __m256i m1 = _mm256_set1_epi64x(PHILOX_M1);
+	const __m256i low = _mm256_set1_epi64x(0xffffffffULL);
+	const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+	__m256i k0[PHILOX_ROUNDS], k1[PHILOX_ROUNDS];
+	for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+		k0[r] = _mm256_set1_epi64x((uint32_t) (key[0] + r * PHILOX_W0));
+		k1[r] = _mm256_set1_epi64x((uint32_t) (key[1] + r * PHILOX_W1));
+	}
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m256i block = _mm256_add_epi64(_mm256_set1_epi64x(first + i),
+				lanes);
+		__m256i x0 = block;
+		__m256i x1 = _mm256_srli_epi64(block, 32);
+		__m256i x2 = _mm256_set1_epi64x(place);
+		__m256i x3 = _mm256_set1_epi64x(thread);
+		for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+			const __m256i p0 = _mm256_mul_epu32(x0, m0);
+			const __m256i p1 = _mm256_mul_epu32(x2, m1);
+			x0 = _mm256_xor_si256(
+					_mm256_xor_si256(_mm256_srli_epi64(p1, 32), x1), k0[r]);
+			x1 = p1;
+			x2 = _mm256_xor_si256(
+					_mm256_xor_si256(_mm256_srli_epi64(p0, 32), x3), k1[r]);
+			x3 = p0;
+		}
+		const __m256i w0 = _mm256_or_si256(_mm256_and_si256(x0, low),
+				_mm256_slli_epi64(x1, 32));
+		const __m256i w1 = _mm256_or_si256(_mm256_and_si256(x2, low),
+				_mm256_slli_epi64(x3, 32));
+		// interleave to block order: w0[0] w1[0] w0[1] w1[1] ...
+		const __m256i lo = _mm256_unpacklo_epi64(w0, w1);
+		const __m256i hi = _mm256_unpackhi_epi64(w0, w1);
+		_mm256_storeu_si256((__m256i*) (dst + 2 * i),
+				_mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*) (dst + 2 * i + 4),
+				_mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	philoxBlocksScalar(key, place, thread, first + i, n - i, dst + 2 * i);
+}
+
+AVX512_TARGET static void philoxBlocksAVX512(const uint32_t key[2],
+		uint32_t place, uint32_t thread, uint64_t first, size_t n,
+		uint64_t* dst) {
+	const __m512i m0 = _mm512_set1_epi64(PHILOX_M0);
+	const __m512i m1 = _mm512_set1_epi64(PHILOX_M1);
+	const __m512i low = _mm512_set1_epi64(0xffffffffULL);
+	const __m512i lanes = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m512i firstHalf = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+	const __m512i secondHalf = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+	__m512i k0[PHILOX_ROUNDS], k1[PHILOX_ROUNDS];
+	for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+		k0[r] = _mm512_set1_epi64((uint32_t) (key[0] + r * PHILOX_W0));
+		k1[r] = _mm512_set1_epi64((uint32_t) (key[1] + r * PHILOX_W1));
+	}
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m512i block = _mm512_add_epi64(_mm512_set1_epi64(first + i),
+				lanes);
+		__m512i x0 = block;
+		__m512i x1 = _mm512_srli_epi64(block, 32);
+		__m512i x2 = _mm512_set1_epi64(place);
+		__m512i x3 = _mm512_set1_epi64(thread);
+		for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+			const __m512i p0 = _mm512_mul_epu32(x0, m0);
+			const __m512i p1 = _mm512_mul_epu32(x2, m1);
+			x0 = _mm512_xor_si512(
+					_mm512_xor_si512(_mm512_srli_epi64(p1, 32), x1), k0[r]);
+			x1 = p1;
+			x2 = _mm512_xor_si512(
+					_mm512_xor_si512(_mm512_srli_epi64(p0, 32), x3), k1[r]);
+			x3 = p0;
+		}
+		const __m512i w0 = _mm512_or_si512(_mm512_and_si512(x0, low),
+				_mm512_slli_epi64(x1, 32));
+		const __m512i w1 = _mm512_or_si512(_mm512_and_si512(x2, low),
+				_mm512_slli_epi64(x3, 32));
+		const __m512i lo = _mm512_unpacklo_epi64(w0, w1);
+		const __m512i hi = _mm512_unpackhi_epi64(w0, w1);
+		_mm512_storeu_si512(dst + 2 * i,
+				_mm512_permutex2var_epi64(lo, firstHalf, hi));
+		_mm512_storeu_si512(dst + 2 * i + 8,
+				_mm512_permutex2var_epi64(lo, secondHalf, hi));
+	}
+	philoxBlocksScalar(key, place, thread, first + i, n - i, dst + 2 * i);
+}
+#endif
+
+typedef void (*PhiloxBlocks)(const uint32_t*, uint32_t, uint32_t, uint64_t,
+		size_t, uint64_t*);
+
+static PhiloxBlocks pickPhiloxBlocks() {
+#ifdef RUDRA_X86_SIMD
+	switch (simdLevel()) {
+	case SIMD_AVX512:
+		return philoxBlocksAVX512;
+	case SIMD_AVX2:
+		return philoxBlocksAVX2;
+	default:
+		break;
+	}
+#endif
+	return philoxBlocksScalar;
+}
+
+RudraRand::RudraRand() {
+	init(getDefaultSeed(), 0, 0, 0);
+	rank = 0;
+	threadid = 0;
+}
+
 RudraRand::RudraRand(int rank, int threadid) :
 		rank(rank), threadid(threadid) {
-	struct timeval start;
-	gettimeofday(&start, NULL);
+	init(getDefaultSeed(), rank, threadid, 0);
+}
+
+RudraRand::RudraRand(uint64_t seed, uint32_t place, uint32_t thread,
+		uint32_t stream) :
+		rank(place), threadid(thread) {
+	init(seed, place, thread, stream);
+}
+
+void RudraRand::init(uint64_t seed, uint32_t place, uint32_t thread,
+		uint32_t stream) {
+	const uint64_t k = mix64(seed ^ mix64(stream + 0x9e3779b97f4a7c15ULL));
+	key[0] = (uint32_t) k;
+	key[1] = (uint32_t) (k >> 32);
+	this->place = place;
+	this->thread = thread;
+	counter = 0;
+	pos = BUFFERED_WORDS;
+}
 
-	unsigned int seed = (unsigned int) ((float) start.tv_usec
-			/ (float) ((rank + 1) * (rank + 1)));
-	srand48_r(seed, &dd);
+void RudraRand::refill() {
+	pickPhiloxBlocks()(key, place, thread, counter, BUFFERED_WORDS / 2,
+			buffered);
+	counter += BUFFERED_WORDS / 2;
+	pos = 0;
 }
 
-RudraRand::RudraRand(const RudraRand& rr) {
-	this->rank = rr.rank;
-	this->threadid = rr.threadid;
-	struct timeval start;
-	gettimeofday(&start, NULL);
+void RudraRand::fill(uint64_t* dst, size_t n) {
+	while (n > 0 && pos < BUFFERED_WORDS) {
+		*dst++ = buffered[pos++];
+		--n;
+	}
+	const size_t blocks = n / 2;
+	if (blocks > 0) {
+		pickPhiloxBlocks()(key, place, thread, counter, blocks, dst);
+		counter += blocks;
+	}
+	if (n % 2 != 0) {
+		dst[n - 1] = next64();
+	}
+}
 
-	unsigned int seed = (unsigned int) ((float) start.tv_usec
-			/ (float) ((rank + 1) * (rank + 1)));
-	srand48_r(seed, &dd);
+void RudraRand::fillUniform(uint64_t* dst, size_t n, uint64_t bound) {
+	fill(dst, n);
+	for (size_t i = 0; i < n; ++i) {
+		dst[i] = uniformFrom(dst[i], bound);
+	}
 }
 
-long RudraRand::getLong() {
-	long result;
-	lrand48_r(&dd, &result);
-	return result;
+void RudraRand::seek(uint64_t block) {
+	counter = block;
+	pos = BUFFERED_WORDS;
 }
 
 RudraRand::~RudraRand() {
@@ -36,23 +36,118 @@
 #ifndef __RUDRA_UTIL_RAND_H_
 #define __RUDRA_UTIL_RAND_H_
 
+#include <cstddef>
 #include <cstdlib>
+#include <stdint.h>
 
 namespace rudra {
+/**
+ * A counter-based random number generator: Philox4x32-10 (Salmon et al.,
+ * "Parallel random numbers: as easy as 1, 2, 3", SC11). The n-th block of
+ * output is a keyed bijection of n, so a generator is fully described by its
+ * key and its position, and any block can be computed independently of the
+ * others; fill uses this to generate several blocks at once in vector
+ * registers. Each block holds two 64-bit words.
+ * The key is derived from (seed, stream) and the place and thread go in the
+ * upper half of the counter, so generators that differ in any of the four
+ * never overlap. Copies continue the same sequence as the original.
+ */
 class RudraRand {
 public:
-	// vj TODO: conditionalize this to use nrand48 for macos and drand48 where it exists
-	drand48_data dd;
 	int rank;
 	int threadid;
-	long getLong();
 
-	RudraRand() {
-	}
+	/** A generator keyed by the default seed, for place 0 and thread 0. */
+	RudraRand();
+	/** A generator keyed by the default seed, for the given place and thread. */
 	RudraRand(int rank, int threadid);
-	RudraRand(const RudraRand& rr);
+	RudraRand(uint64_t seed, uint32_t place, uint32_t thread,
+			uint32_t stream = 0);
+
+	/** 31 random bits, as returned by lrand48. */
+	long getLong() {
+		return (long) (next64() >> 33);
+	}
+
+	uint64_t next64() {
+		if (pos == BUFFERED_WORDS) {
+			refill();
+		}
+		return buffered[pos++];
+	}
+
+	/** A uniformly distributed double in [0, 1). */
+	double nextDouble() {
+		return (next64() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	/** A uniformly distributed integer in [0, bound); bound must be > 0. */
+	uint64_t uniform(uint64_t bound) {
+		return uniformFrom(next64(), bound);
+	}
+
+	/**
+	 * Map the random word x to a uniformly distributed integer in
+	 * [0, bound), by taking the high word of x * bound (Lemire, "Fast random
+	 * integer generation in an interval", 2019). The few values of x that
+	 * would bias the result are rejected, and replaced by words drawn from
+	 * this generator.
+	 */
+	uint64_t uniformFrom(uint64_t x, uint64_t bound) {
+		unsigned __int128 m = (unsigned __int128) x * bound;
+		if ((uint64_t) m < bound) {
+			const uint64_t threshold = -bound % bound;
+			while ((uint64_t) m < threshold) {
+				m = (unsigned __int128) next64() * bound;
+			}
+		}
+		return (uint64_t) (m >> 64);
+	}
+
+	/**
+	 * Fill dst with the next n words of the sequence, the same words n calls
+	 * to next64 would return.
+	 */
+	void fill(uint64_t* dst, size_t n);
+
+	/** Fill dst with n uniformly distributed integers in [0, bound). */
+	void fillUniform(uint64_t* dst, size_t n, uint64_t bound);
+
+	/**
+	 * Continue from the start of the given block of the sequence, dropping
+	 * any words already generated but not yet returned.
+	 */
+	void seek(uint64_t block);
+
+	/**
+	 * Set the seed used by generators constructed without one. If it is
+	 * never set, the RUDRA_SEED environment variable is used, or failing
+	 * that a seed drawn from the clock once per process.
+	 */
+	static void setDefaultSeed(uint64_t seed);
+	static uint64_t getDefaultSeed();
+
+	/**
+	 * One Philox4x32-10 block: encrypt the counter ctr under key, into out.
+	 */
+	static void philox(const uint32_t ctr[4], const uint32_t key[2],
+			uint32_t out[4]);
 
 	~RudraRand();
+
+private:
+	// next64 draws from a buffer refilled several blocks at a time
+	static const size_t BUFFERED_WORDS = 16;
+
+	uint32_t key[2];
+	uint32_t place;
+	uint32_t thread;
+	uint64_t counter; // the next block to generate
+	uint64_t buffered[BUFFERED_WORDS];
+	size_t pos; // the next word of buffered to return
+
+	void init(uint64_t seed, uint32_t place, uint32_t thread, uint32_t stream);
+	void refill();
 };
 } // namespace rudra
 
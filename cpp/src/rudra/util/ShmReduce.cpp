@@ -0,0 +1,220 @@
+/*
+ * ShmReduce.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/ShmReduce.h"
+#include "rudra/util/EventCount.h"
+#include "rudra/util/GradientKernels.h"
+#include "rudra/util/Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <sstream>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace rudra {
+/**
+ * The start of the segment. The barrier's counters sit on cache lines of
+ * their own, away from the sizes, which are only read.
+ */
+struct ShmReduceHeader {
+	std::atomic<uint64_t> magic; // stored last by the creator
+	uint64_t members;
+	uint64_t capacity;
+	char pad0[CACHE_LINE_SIZE - 3 * sizeof(uint64_t)];
+	std::atomic<uint32_t> arrived; // members at the barrier
+	char pad1[CACHE_LINE_SIZE - sizeof(uint32_t)];
+	std::atomic<uint32_t> generation; // barriers passed, a shared futex
+	char pad2[CACHE_LINE_SIZE - sizeof(uint32_t)];
+};
+
+static const uint64_t SHM_REDUCE_MAGIC = 0x7275647261736d31ULL; // "rudrasm1"
+
+/** Round n up to a multiple of the floats in a cache line. */
+static size_t roundUpToLine(size_t n) {
+	const size_t line = CACHE_LINE_SIZE / sizeof(float);
+	return (n + line - 1) / line * line;
+}
+
+ShmReduce::ShmReduce(const std::string& name, int members, int member,
+		size_t capacity) :
+		name(name), numMembers(members), me(member), maxCount(capacity), header(
+				NULL), slots(NULL), resultData(NULL) {
+	if (members < 1 || member < 0 || member >= members) {
+		std::ostringstream msg;
+		msg << "ShmReduce: no member " << member << " of " << members;
+		Logger::logFatal(msg.str());
+	}
+	piece = roundUpToLine(std::max<size_t>(1,
+			std::min(SHM_REDUCE_PIECE, capacity)));
+	mapSize = sizeof(ShmReduceHeader)
+			+ (members * piece + roundUpToLine(capacity)) * sizeof(float);
+}
+
+ShmReduce* ShmReduce::create(const std::string& name, int members,
+		size_t capacity) {
+	shm_unlink(name.c_str()); // left by a run that died
+	const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) {
+		Logger::logFatal("ShmReduce: failed to create " + name);
+	}
+	ShmReduce* r = new ShmReduce(name, members, 0, capacity);
+	if (ftruncate(fd, r->mapSize) != 0) {
+		close(fd);
+		shm_unlink(name.c_str());
+		Logger::logFatal("ShmReduce: failed to size " + name);
+	}
+	r->map(fd);
+	ShmReduceHeader* h = new (r->header) ShmReduceHeader();
+	h->members = members;
+	h->capacity = capacity;
+	h->arrived.store(0, std::memory_order_relaxed);
+	h->generation.store(0, std::memory_order_relaxed);
+	h->magic.store(SHM_REDUCE_MAGIC, std::memory_order_release);
+	return r;
+}
+
+ShmReduce* ShmReduce::attach(const std::string& name, int members,
+		int member, size_t capacity) {
+	const int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0) {
+		Logger::logFatal("ShmReduce: failed to open " + name);
+	}
+	ShmReduce* r = new ShmReduce(name, members, member, capacity);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size != r->mapSize) {
+		close(fd);
+		Logger::logFatal("ShmReduce: " + name + " was made for other sizes");
+	}
+	r->map(fd);
+	const ShmReduceHeader* h = r->header;
+	if (h->magic.load(std::memory_order_acquire) != SHM_REDUCE_MAGIC
+			|| h->members != (uint64_t) members
+			|| h->capacity != capacity) {
+		Logger::logFatal("ShmReduce: " + name + " was made for other sizes");
+	}
+	return r;
+}
+
+void ShmReduce::map(int fd) {
+	void* p = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps its own reference
+	if (p == MAP_FAILED) {
+		Logger::logFatal("ShmReduce: failed to map " + name);
+	}
+	header = (ShmReduceHeader*) p;
+	slots = (float*) (header + 1);
+	resultData = slots + numMembers * piece;
+}
+
+ShmReduce::~ShmReduce() {
+	munmap(header, mapSize);
+}
+
+void ShmReduce::unlink() {
+	shm_unlink(name.c_str());
+}
+
+void ShmReduce::reduce(const float* src, size_t count) {
+	if (count > maxCount) {
+		std::ostringstream msg;
+		msg << "ShmReduce::reduce: " << count << " floats, but " << name
+				<< " holds " << maxCount;
+		Logger::logFatal(msg.str());
+	}
+	const size_t line = CACHE_LINE_SIZE / sizeof(float);
+	for (size_t lo = 0; lo < count; lo += piece) {
+		const size_t n = std::min(piece, count - lo);
+		memcpy(slots + me * piece, src + lo, n * sizeof(float));
+		barrier();
+		// this member's share, in whole cache lines
+		const size_t lines = (n + line - 1) / line;
+		const size_t a = std::min(n, lines * me / numMembers * line);
+		const size_t b = std::min(n, lines * (me + 1) / numMembers * line);
+		if (a < b) {
+			float* out = resultData + lo + a;
+			memcpy(out, slots + a, (b - a) * sizeof(float));
+			for (int m = 1; m < numMembers; ++m) {
+				addInto(slots + m * piece + a, out, b - a);
+			}
+		}
+		barrier(); // the piece is summed, and the slots are free again
+	}
+}
+
+void ShmReduce::readResult(float* dst, size_t count) const {
+	memcpy(dst, resultData, count * sizeof(float));
+}
+
+void ShmReduce::writeResult(const float* src, size_t count) {
+	memcpy(resultData, src, count * sizeof(float));
+}
+
+/*
+ * The last member to arrive resets the count and advances the generation;
+ * the others wait for it to change. The futex calls are not private, as
+ * the word is shared between processes.
+ */
+void ShmReduce::barrier() {
+	std::atomic<uint32_t>& generation = header->generation;
+	const uint32_t g = generation.load(std::memory_order_acquire);
+	if (header->arrived.fetch_add(1, std::memory_order_acq_rel) + 1
+			== (uint32_t) numMembers) {
+		header->arrived.store(0, std::memory_order_relaxed);
+		generation.store(g + 1, std::memory_order_release);
+		syscall(SYS_futex, (uint32_t*) &generation, FUTEX_WAKE, INT_MAX, NULL,
+				NULL, 0);
+		return;
+	}
+	const int spins = handoffSpins();
+	for (int i = 0;
+			i < spins && generation.load(std::memory_order_acquire) == g;
+			++i) {
+		cpuRelax();
+	}
+	while (generation.load(std::memory_order_acquire) == g) {
+		// returns at once if the generation has moved on
+		syscall(SYS_futex, (uint32_t*) &generation, FUTEX_WAIT, g, NULL, NULL,
+				0);
+	}
+}
+} /* namespace rudra */
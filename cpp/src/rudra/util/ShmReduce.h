@@ -0,0 +1,144 @@
+/*
+ * ShmReduce.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_SHMREDUCE_H_
+#define RUDRA_UTIL_SHMREDUCE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace rudra {
+struct ShmReduceHeader;
+
+/** The most floats of each member reduced at once. */
+const size_t SHM_REDUCE_PIECE = 1 << 20;
+
+/**
+ * Sums float vectors across the processes of one host through a POSIX
+ * shared-memory segment, e.g. the places Rudra runs on one node. Each of
+ * the members copies its vector into its own slot, then sums its share of
+ * all the slots, 1/members of them, into a shared result, so the members
+ * reduce in parallel, each with the SIMD gradient kernels. Vectors longer
+ * than a slot go through in pieces, so the segment holds members slots of
+ * SHM_REDUCE_PIECE floats besides the result.
+ *
+ * The members of a ShmReduce synchronize with a barrier in the segment,
+ * spinning briefly and then blocking on a shared futex. Every member must
+ * make the same sequence of reduce and barrier calls; a member that dies
+ * leaves the others blocked.
+ *
+ * Member 0 creates the segment, and the others attach to it by name once
+ * it exists; after that it may be unlinked, leaving it mapped until every
+ * member is destroyed. Names are POSIX shm names such as "/rudra-job-42".
+ */
+class ShmReduce {
+public:
+	/**
+	 * Create the segment called name for members members and sums of up to
+	 * capacity floats, replacing any stale segment of that name, as
+	 * member 0. Fatal on failure.
+	 */
+	static ShmReduce* create(const std::string& name, int members,
+			size_t capacity);
+
+	/**
+	 * Attach to the segment created as name as the given member, 1 to
+	 * members-1. Fatal if it does not exist, or was made for other sizes.
+	 */
+	static ShmReduce* attach(const std::string& name, int members,
+			int member, size_t capacity);
+
+	~ShmReduce();
+
+	/** Remove the name, so that the segment goes with the last member. */
+	void unlink();
+
+	int members() const {
+		return numMembers;
+	}
+
+	int member() const {
+		return me;
+	}
+
+	size_t capacity() const {
+		return maxCount;
+	}
+
+	/**
+	 * Sum the count floats at src of every member into result(), and return
+	 * once all of it is there. Collective: every member must call it with
+	 * the same count. The result stays until the next reduce.
+	 */
+	void reduce(const float* src, size_t count);
+
+	/**
+	 * The sum of the last reduce. Any member may change it, e.g. to add the
+	 * sums of other hosts, but must then call barrier before the others
+	 * read it.
+	 */
+	float* result() const {
+		return resultData;
+	}
+
+	/** Copy the first count floats of result() to dst. */
+	void readResult(float* dst, size_t count) const;
+
+	/** Replace the first count floats of result() with those at src. */
+	void writeResult(const float* src, size_t count);
+
+	/** Block until every member has called barrier. */
+	void barrier();
+
+private:
+	std::string name;
+	int numMembers;
+	int me;
+	size_t maxCount;
+	size_t mapSize;
+	ShmReduceHeader* header;
+	size_t piece; // floats per slot, at most SHM_REDUCE_PIECE
+	float* slots; // numMembers slots of piece floats
+	float* resultData;
+
+	ShmReduce(const std::string& name, int members, int member,
+			size_t capacity);
+	void map(int fd);
+	ShmReduce(const ShmReduce&);
+	ShmReduce& operator=(const ShmReduce&);
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_SHMREDUCE_H_ */
@@ -0,0 +1,95 @@
+/*
+ * SimdDispatch.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/SimdDispatch.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace rudra {
+
+static SimdLevel levelFromEnv(SimdLevel best) {
+	const char* env = getenv("RUDRA_SIMD");
+	if (env == NULL) {
+		return best;
+	}
+	for (int l = SIMD_SCALAR; l <= SIMD_AVX512; ++l) {
+		if (strcmp(env, simdLevelName((SimdLevel) l)) == 0) {
+			return (SimdLevel) l < best ? (SimdLevel) l : best;
+		}
+	}
+	return best;
+}
+
+static SimdLevel currentLevel = levelFromEnv(detectSimdLevel());
+
+SimdLevel detectSimdLevel() {
+#ifdef RUDRA_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+		return SIMD_AVX512;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+		return SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports("sse4.1")) {
+		return SIMD_SSE;
+	}
+#endif
+	return SIMD_SCALAR;
+}
+
+SimdLevel simdLevel() {
+	return currentLevel;
+}
+
+void setSimdLevel(SimdLevel level) {
+	SimdLevel best = detectSimdLevel();
+	currentLevel = level < best ? level : best;
+}
+
+const char* simdLevelName(SimdLevel level) {
+	switch (level) {
+	case SIMD_SSE:
+		return "sse";
+	case SIMD_AVX2:
+		return "avx2";
+	case SIMD_AVX512:
+		return "avx512";
+	default:
+		return "scalar";
+	}
+}
+
+} /* namespace rudra */
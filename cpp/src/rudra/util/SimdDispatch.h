@@ -0,0 +1,81 @@
+/*
+ * SimdDispatch.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_SIMDDISPATCH_H_
+#define RUDRA_UTIL_SIMDDISPATCH_H_
+
+/*
+ * Kernels with x86 vector paths are compiled with per-function target
+ * attributes, so librudra itself is built for the baseline ISA and the best
+ * path is chosen when the kernel runs. On other platforms only the scalar
+ * paths are built, and are left to the compiler to auto-vectorize.
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) \
+	&& (__GNUC__ >= 5) && !defined(RUDRA_NO_SIMD)
+#define RUDRA_X86_SIMD 1
+#endif
+
+namespace rudra {
+
+/**
+ * Vector instruction set levels, in increasing order of capability:
+ * SSE4.1, AVX2 with F16C, and AVX-512 F and BW.
+ */
+enum SimdLevel {
+	SIMD_SCALAR, SIMD_SSE, SIMD_AVX2, SIMD_AVX512
+};
+
+/**
+ * The vector instruction set level used by the kernels. Defaults to the
+ * best level supported by this CPU, capped by the environment variable
+ * RUDRA_SIMD (scalar, sse, avx2 or avx512) if set.
+ */
+SimdLevel simdLevel();
+
+/** The best vector instruction set level supported by this CPU. */
+SimdLevel detectSimdLevel();
+
+/**
+ * Use the given level for all subsequent kernel calls, or the best supported
+ * level if that is lower. Intended for benchmarks and testing.
+ */
+void setSimdLevel(SimdLevel level);
+
+/** Name of the given level, as accepted in RUDRA_SIMD. */
+const char* simdLevelName(SimdLevel level);
+
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_SIMDDISPATCH_H_ */
@@ -0,0 +1,326 @@
+/*
+ * SparseGradient.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/util/SparseGradient.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/SimdDispatch.h"
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <vector>
+#ifdef RUDRA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rudra {
+
+/*
+ * The selection compares magnitudes as integers: for non-negative floats
+ * the order of the bit patterns is the order of the values (and NaNs sort
+ * above infinity, so they are always sent). A sample of the keys gives a
+ * cutoff that about k entries should pass; one vectorized pass adds the
+ * gradient into the residual and collects the index and value of every
+ * entry at or above the cutoff, and the exact top k are then chosen from
+ * those candidates alone. If the sample was unlucky and too few entries
+ * pass, the cutoff is lowered and the pass repeated.
+ */
+
+/**
+ * The sample is SAMPLE_RUNS runs of SAMPLE_RUN consecutive keys, spread
+ * evenly over the vector: runs cost far fewer cache misses than a stride,
+ * and there are enough of them to see every layer of a network in
+ * proportion to its size.
+ */
+static const size_t SAMPLE_RUNS = 256;
+static const size_t SAMPLE_RUN = 64;
+
+/** Collect about this many times k candidates, so one pass is enough. */
+static const double SAMPLE_MARGIN = 1.5;
+
+/** Ranks in the sample below this are too noisy to aim for. */
+static const size_t SAMPLE_MIN_RANK = 32;
+
+static inline uint32_t magnitudeKey(float x) {
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return bits & 0x7fffffffu;
+}
+
+/**
+ * For lo <= i < hi, first x[i] += g[i] if g is not NULL, then append the
+ * index and value of x[i] to idx and val if its key is at least cutoff;
+ * both must have room for hi - lo more. Returns the new number of
+ * candidates.
+ */
+static size_t collectScalar(const float* g, float* x, size_t lo, size_t hi,
+		uint32_t cutoff, uint32_t* idx, float* val, size_t count) {
+	for (size_t i = lo; i < hi; ++i) {
+		if (g != NULL) {
+			x[i] += g[i];
+		}
+		idx[count] = i;
+		val[count] = x[i];
+		count += magnitudeKey(x[i]) >= cutoff;
+	}
+	return count;
+}
+
+#ifdef RUDRA_X86_SIMD
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+AVX2_TARGET static size_t collectAVX2(const float* g, float* x, size_t lo,
+		size_t hi, uint32_t cutoff, uint32_t* idx, float* val, size_t count) {
+	const __m256i mask = _mm256_set1_epi32(0x7fffffff);
+	// keys are below 2^31, so a signed compare is enough; cutoff is >= 1
+	const __m256i below = _mm256_set1_epi32(cutoff - 1);
+	size_t i = lo;
+	for (; i + 8 <= hi; i += 8) {
+		__m256 v = _mm256_loadu_ps(x + i);
+		if (g != NULL) {
+			v = _mm256_add_ps(v, _mm256_loadu_ps(g + i));
+			_mm256_storeu_ps(x + i, v);
+		}
+		const __m256i key = _mm256_and_si256(_mm256_castps_si256(v), mask);
+		unsigned m = _mm256_movemask_ps(
+				_mm256_castsi256_ps(_mm256_cmpgt_epi32(key, below)));
+		while (m) {
+			const size_t j = i + __builtin_ctz(m);
+			idx[count] = j;
+			val[count++] = x[j];
+			m &= m - 1;
+		}
+	}
+	return collectScalar(g, x, i, hi, cutoff, idx, val, count);
+}
+
+/**
+ * Compressing into a register and storing all 16 lanes is much faster than
+ * a compressing store; the lanes past the candidates are overwritten later.
+ */
+AVX512_TARGET static size_t collectAVX512(const float* g, float* x,
+		size_t lo, size_t hi, uint32_t cutoff, uint32_t* idx, float* val,
+		size_t count) {
+	const __m512i mask = _mm512_set1_epi32(0x7fffffff);
+	const __m512i cut = _mm512_set1_epi32(cutoff);
+	const __m512i step = _mm512_set1_epi32(16);
+	__m512i index = _mm512_add_epi32(_mm512_set1_epi32(lo),
+			_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+					15));
+	size_t i = lo;
+	for (; i + 16 <= hi; i += 16) {
+		__m512 v = _mm512_loadu_ps(x + i);
+		if (g != NULL) {
+			v = _mm512_add_ps(v, _mm512_loadu_ps(g + i));
+			_mm512_storeu_ps(x + i, v);
+		}
+		const __m512i key = _mm512_and_si512(_mm512_castps_si512(v), mask);
+		const __mmask16 m = _mm512_cmpge_epu32_mask(key, cut);
+		if (m) {
+			_mm512_storeu_si512(idx + count,
+					_mm512_maskz_compress_epi32(m, index));
+			_mm512_storeu_ps(val + count, _mm512_maskz_compress_ps(m, v));
+			count += __builtin_popcount(m);
+		}
+		index = _mm512_add_epi32(index, step);
+	}
+	return collectScalar(g, x, i, hi, cutoff, idx, val, count);
+}
+
+/** AVX-512 scatter is safe here because the indices are distinct. */
+AVX512_TARGET static void unpackAVX512(const float* pairs, size_t count,
+		float* dense) {
+	const __m512i evens = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18,
+			20, 22, 24, 26, 28, 30);
+	const __m512i odds = _mm512_add_epi32(evens, _mm512_set1_epi32(1));
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		// split 16 interleaved (index, value) pairs
+		const __m512i lo = _mm512_loadu_si512(pairs + 2 * i);
+		const __m512i hi = _mm512_loadu_si512(pairs + 2 * i + 16);
+		const __m512i where = _mm512_permutex2var_epi32(lo, evens, hi);
+		const __m512 v = _mm512_castsi512_ps(
+				_mm512_permutex2var_epi32(lo, odds, hi));
+		const __m512 old = _mm512_i32gather_ps(where, dense, 4);
+		_mm512_i32scatter_ps(dense, where, _mm512_add_ps(old, v), 4);
+	}
+	for (; i < count; ++i) {
+		uint32_t j;
+		memcpy(&j, &pairs[2 * i], sizeof(j));
+		dense[j] += pairs[2 * i + 1];
+	}
+}
+#endif
+
+typedef size_t (*CollectKernel)(const float*, float*, size_t, size_t,
+		uint32_t, uint32_t*, float*, size_t);
+
+static CollectKernel pickCollect() {
+#ifdef RUDRA_X86_SIMD
+	switch (simdLevel()) {
+	case SIMD_AVX512:
+		return collectAVX512;
+	case SIMD_AVX2:
+		return collectAVX2;
+	default:
+		break;
+	}
+#endif
+	return collectScalar;
+}
+
+static inline uint32_t sumKey(const float* g, const float* x, size_t i) {
+	return magnitudeKey(g != NULL ? x[i] + g[i] : x[i]);
+}
+
+/**
+ * A key that about want of the n keys of x + g (or of x, if g is NULL) are
+ * at least, estimated from a sample; 0 if want is close to n.
+ */
+static uint32_t sampleCutoff(const float* g, const float* x, size_t n,
+		double want) {
+	std::vector<uint32_t> sample;
+	if (n <= SAMPLE_RUNS * SAMPLE_RUN) {
+		for (size_t i = 0; i < n; ++i) {
+			sample.push_back(sumKey(g, x, i));
+		}
+	} else {
+		const size_t gap = n / SAMPLE_RUNS;
+		for (size_t r = 0; r < SAMPLE_RUNS; ++r) {
+			for (size_t i = r * gap; i < r * gap + SAMPLE_RUN; ++i) {
+				sample.push_back(sumKey(g, x, i));
+			}
+		}
+	}
+	const size_t rank = std::max((size_t) (want * sample.size() / n),
+			SAMPLE_MIN_RANK);
+	if (rank >= sample.size()) {
+		return 0;
+	}
+	std::nth_element(sample.begin(), sample.begin() + rank, sample.end(),
+			std::greater<uint32_t>());
+	return sample[rank];
+}
+
+size_t packTopK(const float* grad, float* residual, size_t n, size_t k,
+		float threshold, float* packed) {
+	if ((uint64_t) n >> 32) {
+		Logger::logFatal("packTopK: too many elements for 32-bit indices");
+	}
+	// zeros are never sent, whatever the threshold
+	const uint32_t floor = std::max(magnitudeKey(threshold), 1u);
+	const CollectKernel collect = pickCollect();
+	std::vector<uint32_t> idx;
+	std::vector<float> val;
+	size_t count = 0;
+	double want = SAMPLE_MARGIN * k;
+	for (;;) {
+		// the first pass also adds the gradient into the residual
+		const uint32_t cutoff = std::max(
+				sampleCutoff(grad, residual, n, want), floor);
+		// bound the candidates by collecting a block at a time
+		const size_t BLOCK = 1 << 16;
+		count = 0;
+		for (size_t lo = 0; lo < n; lo += BLOCK) {
+			const size_t hi = std::min(lo + BLOCK, n);
+			if (idx.size() < count + (hi - lo)) {
+				idx.resize(count + (hi - lo) + 2 * k);
+				val.resize(idx.size());
+			}
+			count = collect(grad, residual, lo, hi, cutoff, &idx[0], &val[0],
+					count);
+		}
+		grad = NULL;
+		if (count >= k || cutoff == floor) {
+			break;
+		}
+		want *= 4; // the sample overestimated the cutoff
+	}
+	if (count > k) {
+		// select on (key, candidate) words, which sort without indirection
+		std::vector<uint64_t> keyed(count);
+		for (size_t i = 0; i < count; ++i) {
+			keyed[i] = (uint64_t) magnitudeKey(val[i]) << 32 | i;
+		}
+		std::nth_element(keyed.begin(), keyed.begin() + k, keyed.end(),
+				std::greater<uint64_t>());
+		std::vector<uint32_t> chosen(k);
+		std::vector<float> values(k);
+		for (size_t i = 0; i < k; ++i) {
+			chosen[i] = idx[(uint32_t) keyed[i]];
+			values[i] = val[(uint32_t) keyed[i]];
+		}
+		idx.swap(chosen);
+		val.swap(values);
+		count = k;
+	}
+
+	float* pairs = packed + SPARSE_HEADER;
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t j = idx[i];
+		memcpy(&pairs[2 * i], &j, sizeof(j));
+		pairs[2 * i + 1] = val[i];
+		residual[j] = 0.0f;
+	}
+	packed[0] = (float) count;
+	return count;
+}
+
+void unpackAdd(const float* packed, float* dense, size_t n) {
+	const size_t count = (size_t) packed[0];
+	const float* pairs = packed + SPARSE_HEADER;
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t j;
+		memcpy(&j, &pairs[2 * i], sizeof(j));
+		if (j >= n) {
+			Logger::logFatal("unpackAdd: index out of range");
+		}
+	}
+#ifdef RUDRA_X86_SIMD
+	// gathers take signed 32-bit indices
+	if (simdLevel() >= SIMD_AVX512 && n <= 0x7fffffffu) {
+		unpackAVX512(pairs, count, dense);
+		return;
+	}
+#endif
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t j;
+		memcpy(&j, &pairs[2 * i], sizeof(j));
+		dense[j] += pairs[2 * i + 1];
+	}
+}
+
+} /* namespace rudra */
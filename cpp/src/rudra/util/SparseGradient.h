@@ -0,0 +1,81 @@
+/*
+ * SparseGradient.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_SPARSEGRADIENT_H_
+#define RUDRA_UTIL_SPARSEGRADIENT_H_
+
+#include <cstddef>
+
+namespace rudra {
+/*
+ * Top-k gradient sparsification with error feedback. Each place adds its
+ * gradient into a local residual, and sends only the k entries of the
+ * residual with the largest magnitudes, which are then removed from it;
+ * whatever is not sent stays in the residual and is sent in a later step.
+ *
+ * A packed sparse gradient is a rail of floats:
+ *   [0]   the number of entries, count
+ *   [1]   left for the caller, e.g. the number of minibatches summed
+ *   [2..] count (index, value) pairs, each index stored as the bits of a
+ *         uint32 in a float, so it must be copied, never computed with
+ * so a buffer for up to k entries holds sparsePackedSize(k) floats.
+ */
+
+/** Floats before the first (index, value) pair of a packed gradient. */
+const size_t SPARSE_HEADER = 2;
+
+inline size_t sparsePackedSize(size_t k) {
+	return SPARSE_HEADER + 2 * k;
+}
+
+/**
+ * residual[i] += grad[i] (unless grad is NULL), then move the entries of
+ * residual with the k largest magnitudes that are also at least threshold
+ * (0 for pure top-k) into packed, zeroing them in residual. Fewer than k
+ * entries are sent if fewer are non-zero and above the threshold. Returns
+ * the number of entries packed; packed[1] is not touched.
+ * n must be less than 2^32.
+ */
+size_t packTopK(const float* grad, float* residual, size_t n, size_t k,
+		float threshold, float* packed);
+
+/**
+ * dense[index] += value for each pair in packed. The indices of one packed
+ * gradient are distinct, and must be less than n.
+ */
+void unpackAdd(const float* packed, float* dense, size_t n);
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_SPARSEGRADIENT_H_ */
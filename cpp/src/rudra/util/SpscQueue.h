@@ -0,0 +1,234 @@
+/*
+ * SpscQueue.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_SPSCQUEUE_H_
+#define RUDRA_UTIL_SPSCQUEUE_H_
+
+#include "rudra/util/EventCount.h"
+#include <cstddef>
+#include <vector>
+
+namespace rudra {
+
+/** Round n up to a power of two, with a minimum of 2. */
+inline size_t ringCapacity(size_t n) {
+	size_t c = 2;
+	while (c < n) {
+		c <<= 1;
+	}
+	return c;
+}
+
+/**
+ * The positions of a bounded lock-free ring shared by one producer and one
+ * consumer. The producer claims the next position with beginPush, fills
+ * element slot(pos) of its own storage and publishes it with endPush; the
+ * consumer does the same with beginPop and endPop. The try variants fail
+ * instead of waiting; the others spin briefly, then block until the ring is
+ * no longer full (or empty).
+ * Each side keeps its index on its own cache line, along with a cached copy
+ * of the other side's index, so the two only share a line when the ring
+ * looks full or empty. A producer blocked on a full ring is woken once the
+ * ring is half empty.
+ */
+class SpscRing {
+public:
+	explicit SpscRing(size_t capacity) :
+			mask(ringCapacity(capacity) - 1), tail(0), cachedHead(0), head(0),
+			cachedTail(0) {
+	}
+
+	size_t capacity() const {
+		return mask + 1;
+	}
+	size_t slot(uint64_t pos) const {
+		return pos & mask;
+	}
+	/** Number of elements published but not yet popped, which may be stale. */
+	size_t sizeApprox() const {
+		return tail.load(std::memory_order_acquire)
+				- head.load(std::memory_order_acquire);
+	}
+
+	bool tryBeginPush(uint64_t& pos) {
+		pos = tail.load(std::memory_order_relaxed);
+		if (pos - cachedHead > mask) {
+			cachedHead = head.load(std::memory_order_acquire);
+			if (pos - cachedHead > mask) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint64_t beginPush() {
+		uint64_t pos;
+		if (!tryBeginPush(pos)) {
+			awaitCondition(notFull, HasSpace(*this));
+			pos = tail.load(std::memory_order_relaxed);
+		}
+		return pos;
+	}
+
+	void endPush(uint64_t pos) {
+		tail.store(pos + 1, std::memory_order_release);
+		notEmpty.notifyAll();
+	}
+
+	bool tryBeginPop(uint64_t& pos) {
+		pos = head.load(std::memory_order_relaxed);
+		if (pos == cachedTail) {
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (pos == cachedTail) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint64_t beginPop() {
+		uint64_t pos;
+		if (!tryBeginPop(pos)) {
+			awaitCondition(notEmpty, HasValue(*this));
+			pos = head.load(std::memory_order_relaxed);
+		}
+		return pos;
+	}
+
+	void endPop(uint64_t pos) {
+		head.store(pos + 1, std::memory_order_release);
+		// a blocked producer is woken once the ring is half empty, so it
+		// refills it in one go instead of being woken for every pop
+		if (cachedTail - (pos + 1) <= mask / 2) {
+			notFull.notifyAll();
+		}
+	}
+
+private:
+	struct HasSpace {
+		SpscRing& r;
+		HasSpace(SpscRing& r) :
+				r(r) {
+		}
+		bool operator()() const {
+			uint64_t pos;
+			return r.tryBeginPush(pos);
+		}
+	};
+	struct HasValue {
+		SpscRing& r;
+		HasValue(SpscRing& r) :
+				r(r) {
+		}
+		bool operator()() const {
+			uint64_t pos;
+			return r.tryBeginPop(pos);
+		}
+	};
+
+	const size_t mask;
+	char pad0[CACHE_LINE_SIZE];
+	std::atomic<uint64_t> tail; // next position the producer will fill
+	uint64_t cachedHead;
+	char pad1[CACHE_LINE_SIZE];
+	std::atomic<uint64_t> head; // next position the consumer will take
+	uint64_t cachedTail;
+	char pad2[CACHE_LINE_SIZE];
+	EventCount notEmpty;
+	char pad3[CACHE_LINE_SIZE];
+	EventCount notFull;
+	char pad4[CACHE_LINE_SIZE];
+
+	SpscRing(const SpscRing&);
+	SpscRing& operator=(const SpscRing&);
+};
+
+/** A bounded lock-free queue of values of type T, for one producer and one consumer. */
+template<class T>
+class SpscQueue {
+public:
+	explicit SpscQueue(size_t capacity) :
+			ring(capacity), data(ring.capacity()) {
+	}
+
+	size_t capacity() const {
+		return ring.capacity();
+	}
+	size_t sizeApprox() const {
+		return ring.sizeApprox();
+	}
+
+	bool tryPush(const T& t) {
+		uint64_t pos;
+		if (!ring.tryBeginPush(pos)) {
+			return false;
+		}
+		data[ring.slot(pos)] = t;
+		ring.endPush(pos);
+		return true;
+	}
+
+	/** Append t, waiting while the queue is full. */
+	void push(const T& t) {
+		uint64_t pos = ring.beginPush();
+		data[ring.slot(pos)] = t;
+		ring.endPush(pos);
+	}
+
+	bool tryPop(T& t) {
+		uint64_t pos;
+		if (!ring.tryBeginPop(pos)) {
+			return false;
+		}
+		t = data[ring.slot(pos)];
+		ring.endPop(pos);
+		return true;
+	}
+
+	/** Remove the oldest value, waiting while the queue is empty. */
+	T pop() {
+		uint64_t pos = ring.beginPop();
+		T t = data[ring.slot(pos)];
+		ring.endPop(pos);
+		return t;
+	}
+
+private:
+	SpscRing ring;
+	std::vector<T> data;
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_SPSCQUEUE_H_ */
@@ -0,0 +1,104 @@
+/*
+ * SwapSlot.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_UTIL_SWAPSLOT_H_
+#define RUDRA_UTIL_SWAPSLOT_H_
+
+#include "rudra/util/EventCount.h"
+
+namespace rudra {
+
+/**
+ * The handshake of a one-place swap buffer between a single producer and a
+ * single consumer: a flag saying whether the place holds a value that has
+ * not yet been taken. The value itself is kept by the caller, who swaps it
+ * after awaitEmpty (producer) or awaitFull (consumer) and then hands the
+ * place over with setFull or setEmpty. Those calls release, and the awaits
+ * acquire, everything written to the value in between.
+ */
+class SwapSlot {
+public:
+	explicit SwapSlot(bool full = false) :
+			state(full ? FULL : EMPTY) {
+	}
+
+	bool isFull() const {
+		return state.load(std::memory_order_acquire) == FULL;
+	}
+
+	void setFull() {
+		state.store(FULL, std::memory_order_release);
+		changed.notifyAll();
+	}
+
+	void setEmpty() {
+		state.store(EMPTY, std::memory_order_release);
+		changed.notifyAll();
+	}
+
+	void awaitFull() {
+		awaitCondition(changed, IsState(state, FULL));
+	}
+
+	void awaitEmpty() {
+		awaitCondition(changed, IsState(state, EMPTY));
+	}
+
+private:
+	enum {
+		EMPTY, FULL
+	};
+	struct IsState {
+		const std::atomic<uint32_t>& state;
+		uint32_t want;
+		IsState(const std::atomic<uint32_t>& state, uint32_t want) :
+				state(state), want(want) {
+		}
+		bool operator()() const {
+			return state.load(std::memory_order_acquire) == want;
+		}
+	};
+
+	char pad0[CACHE_LINE_SIZE];
+	std::atomic<uint32_t> state;
+	EventCount changed;
+	char pad1[CACHE_LINE_SIZE];
+
+	SwapSlot(const SwapSlot&);
+	SwapSlot& operator=(const SwapSlot&);
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_UTIL_SWAPSLOT_H_ */
@@ -0,0 +1,102 @@
+/*
+ * bin2binz.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/BinarySampleReader.h"
+#include "rudra/io/ChunkedMatrixFile.h"
+#include "rudra/io/SampleReader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Convert a binary matrix file (any type but .binq8) to a chunked,
+ * compressed matrix file (.binz), without changing its elements.
+ * Usage: bin2binz input output.binz [rowsPerChunk] [codec] [shuffle]
+ * where codec is one of rlz (the default), lz4, zstd or none, and shuffle
+ * (default 1) enables byte shuffling of multi-byte elements.
+ */
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		fprintf(stderr,
+				"usage: %s input output.binz [rowsPerChunk] [codec] [shuffle]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	const std::string input = argv[1];
+	const size_t rowsPerChunk = argc > 3 ? atol(argv[3]) : 256;
+	const ChunkCodecType codec = codecFromName(argc > 4 ? argv[4] : "rlz");
+	const bool shuffle = argc > 5 ? atoi(argv[5]) != 0 : true;
+
+	const size_t dot = input.rfind('.');
+	const std::string ext =
+			dot == std::string::npos ? "" : input.substr(dot + 1);
+	BinFileType type = binFileTypeFromExtension(ext);
+	if (type == INVALID || type == QUANT8) {
+		fprintf(stderr, "%s: unsupported input extension %s\n", argv[0],
+				ext.c_str());
+		return EXIT_FAILURE;
+	}
+
+	size_t rows, cols;
+	SampleReader::readHeader(input, rows, cols);
+	std::ifstream in(input.c_str(), std::ios::in | std::ios::binary);
+	in.seekg(2 * sizeof(uint32_t));
+
+	ChunkedMatrixWriter writer(argv[2], type, cols, rowsPerChunk, codec,
+			shuffle);
+	const size_t rowBytes = cols * binFileTypeSize(type);
+	std::vector<char> buf(rowsPerChunk * rowBytes);
+	for (size_t r = 0; r < rows; r += rowsPerChunk) {
+		const size_t n = rows - r < rowsPerChunk ? rows - r : rowsPerChunk;
+		if (!in.read(&buf[0], n * rowBytes)) {
+			fprintf(stderr, "%s: %s is shorter than its header says\n",
+					argv[0], input.c_str());
+			return EXIT_FAILURE;
+		}
+		writer.appendRows(&buf[0], n);
+	}
+	writer.close();
+
+	const double rawBytes = (double) rows * rowBytes;
+	printf("%s: %zu x %zu, %zu rows per chunk, %s%s: %.0f -> %zu bytes (%.2fx)\n",
+			argv[2], rows, cols, rowsPerChunk, codecName(codec),
+			shuffle ? "+shuffle" : "", rawBytes, writer.getStoredBytes(),
+			rawBytes / writer.getStoredBytes());
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+/*
+ * bingen.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/SyntheticData.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace rudra;
+
+/**
+ * Generate a synthetic labelled data set of rows x cols samples, in the
+ * format chosen by the extension of each output file (.bin, .bin8, .bin32,
+ * .bin16, .binbf16, .binq8, or text for any other); see SyntheticData.h.
+ * Usage: bingen samples labels rows cols [classes=10] [seed=1]
+ */
+int main(int argc, char** argv) {
+	if (argc < 5) {
+		fprintf(stderr,
+				"usage: %s samples labels rows cols [classes] [seed]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	const size_t rows = atol(argv[3]);
+	const size_t cols = atol(argv[4]);
+	const size_t classes = argc > 5 ? atol(argv[5]) : 10;
+	const uint64_t seed = argc > 6 ? strtoull(argv[6], NULL, 0) : 1;
+	writeSyntheticData(argv[1], argv[2], rows, cols, classes, seed);
+	printf("%s, %s: %zu x %zu, %zu classes, seed %llu\n", argv[1], argv[2],
+			rows, cols, classes, (unsigned long long) seed);
+	return EXIT_SUCCESS;
+}
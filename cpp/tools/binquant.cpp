@@ -0,0 +1,184 @@
+/*
+ * binquant.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/BinaryMatrixReader.h"
+#include "rudra/io/BinarySampleReader.h"
+#include "rudra/io/SampleReader.h"
+#include "rudra/util/ConvertKernels.h"
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <endian.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Convert a float binary matrix file (.bin) to a narrower storage type,
+ * chosen by the extension of the output file: .bin16 (half precision),
+ * .binbf16 (bfloat16) or .binq8 (uint8 with a per-feature affine map
+ * covering each feature's range of values). Halves and bfloat16s are rounded
+ * to nearest even.
+ * Usage: binquant input.bin output.{bin16,binbf16,binq8}
+ */
+static void putBE32(std::ofstream& out, uint32_t v) {
+	v = htobe32(v);
+	out.write((const char*) &v, sizeof(v));
+}
+
+static void putFloat(std::ofstream& out, float f) {
+	uint32_t v;
+	memcpy(&v, &f, sizeof(v));
+	putBE32(out, v);
+}
+
+static void putBE16(std::vector<char>& buf, size_t i, uint16_t v) {
+	v = htobe16(v);
+	memcpy(&buf[i * sizeof(v)], &v, sizeof(v));
+}
+
+/** Read the next n rows of floats from in, in host byte order. */
+static bool readRows(std::ifstream& in, std::vector<float>& rows, size_t n,
+		size_t cols) {
+	rows.resize(n * cols);
+	if (!in.read((char*) &rows[0], n * cols * sizeof(float))) {
+		return false;
+	}
+	bigEndianToHost32(&rows[0], &rows[0], n * cols);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s input.bin output.{bin16,binbf16,binq8}\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	const std::string input = argv[1];
+	const std::string output = argv[2];
+	const size_t dot = output.rfind('.');
+	const BinFileType type = binFileTypeFromExtension(
+			dot == std::string::npos ? "" : output.substr(dot + 1));
+	if (type != HALF && type != BFLOAT16 && type != QUANT8) {
+		fprintf(stderr, "%s: output must be .bin16, .binbf16 or .binq8\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	size_t rows, cols;
+	SampleReader::readHeader(input, rows, cols);
+	std::ifstream in(input.c_str(), std::ios::in | std::ios::binary);
+	std::ofstream out(output.c_str(), std::ios::out | std::ios::binary);
+	if (!out) {
+		fprintf(stderr, "%s: failed to open %s\n", argv[0], output.c_str());
+		return EXIT_FAILURE;
+	}
+	putBE32(out, (uint32_t) rows);
+	putBE32(out, (uint32_t) cols);
+
+	const size_t batchRows = 1024;
+	std::vector<float> batch;
+	std::vector<float> scale(cols, 1.0f), offset(cols, 0.0f);
+	if (type == QUANT8) {
+		// a first pass finds the range of each feature
+		std::vector<float> lo(cols, INFINITY), hi(cols, -INFINITY);
+		in.seekg(HEADER_SIZE);
+		for (size_t r = 0; r < rows; r += batchRows) {
+			const size_t n = rows - r < batchRows ? rows - r : batchRows;
+			if (!readRows(in, batch, n, cols)) {
+				fprintf(stderr, "%s: %s is shorter than its header says\n",
+						argv[0], input.c_str());
+				return EXIT_FAILURE;
+			}
+			for (size_t i = 0; i < n * cols; ++i) {
+				lo[i % cols] = std::min(lo[i % cols], batch[i]);
+				hi[i % cols] = std::max(hi[i % cols], batch[i]);
+			}
+		}
+		for (size_t j = 0; j < cols; ++j) {
+			offset[j] = rows > 0 ? lo[j] : 0.0f;
+			scale[j] = hi[j] > lo[j] ? (hi[j] - lo[j]) / 255 : 1.0f;
+			putFloat(out, scale[j]);
+		}
+		for (size_t j = 0; j < cols; ++j) {
+			putFloat(out, offset[j]);
+		}
+	}
+
+	in.clear();
+	in.seekg(HEADER_SIZE);
+	const size_t elemSize = binFileTypeSize(type);
+	std::vector<char> buf;
+	double sqErr = 0;
+	for (size_t r = 0; r < rows; r += batchRows) {
+		const size_t n = rows - r < batchRows ? rows - r : batchRows;
+		if (!readRows(in, batch, n, cols)) {
+			fprintf(stderr, "%s: %s is shorter than its header says\n",
+					argv[0], input.c_str());
+			return EXIT_FAILURE;
+		}
+		buf.resize(n * cols * elemSize);
+		for (size_t i = 0; i < n * cols; ++i) {
+			const size_t j = i % cols;
+			if (type == HALF) {
+				putBE16(buf, i, floatToHalf(batch[i]));
+			} else if (type == BFLOAT16) {
+				putBE16(buf, i, floatToBfloat16(batch[i]));
+			} else {
+				float q = rintf((batch[i] - offset[j]) / scale[j]);
+				q = q < 0 ? 0 : q > 255 ? 255 : q;
+				buf[i] = (char) (uint8_t) q;
+				const float e = q * scale[j] + offset[j] - batch[i];
+				sqErr += (double) e * e;
+			}
+		}
+		out.write(&buf[0], buf.size());
+	}
+	if (!out) {
+		fprintf(stderr, "%s: failed to write %s\n", argv[0], output.c_str());
+		return EXIT_FAILURE;
+	}
+	printf("%s: %zu x %zu, element size %zu", output.c_str(), rows, cols,
+			elemSize);
+	if (type == QUANT8 && rows * cols > 0) {
+		printf(", rms quantization error %g", sqrt(sqErr / (rows * cols)));
+	}
+	printf("\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/*
+ * csv2bin.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/io/TextMatrixFile.h"
+#include "rudra/util/ConvertKernels.h"
+#include <cstdio>
+#include <cstdlib>
+#include <endian.h>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Convert a comma-separated text matrix to a float binary matrix file
+ * (.bin), parsing blocks of rows in parallel.
+ * Usage: csv2bin input.csv output.bin [numThreads]
+ */
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s input.csv output.bin [numThreads]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	TextMatrixFile in(argv[1], argc > 3 ? atol(argv[3]) : 0);
+	const size_t rows = in.getRows();
+	const size_t cols = in.getCols();
+	if (rows > UINT32_MAX || cols > UINT32_MAX) {
+		fprintf(stderr, "%s: %zu x %zu is too large for the binary header\n",
+				argv[0], rows, cols);
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream out(argv[2],
+			std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!out) {
+		fprintf(stderr, "%s: failed to open %s\n", argv[0], argv[2]);
+		return EXIT_FAILURE;
+	}
+	uint32_t header[2] = { htobe32((uint32_t) rows), htobe32((uint32_t) cols) };
+	out.write((const char*) header, sizeof(header));
+
+	// about 64MB of floats per block
+	const size_t blockRows = 1 + (16 << 20) / (cols + 1);
+	std::vector<float> block;
+	for (size_t r = 0; r < rows; r += blockRows) {
+		const size_t n = rows - r < blockRows ? rows - r : blockRows;
+		block.resize(n * cols);
+		in.readRows(r, n, &block[0]);
+		bigEndianToHost32(&block[0], &block[0], n * cols); // its own inverse
+		out.write((const char*) &block[0], n * cols * sizeof(float));
+	}
+	out.close();
+	if (!out) {
+		fprintf(stderr, "%s: failed to write %s\n", argv[0], argv[2]);
+		return EXIT_FAILURE;
+	}
+	printf("%s: %zu x %zu\n", argv[2], rows, cols);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/*
+ * ConfigBlocks.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ConfigBlocks.h"
+#include "rudra/util/Logger.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace rudra {
+static std::string trim(const std::string& s) {
+	const size_t first = s.find_first_not_of(" \t\r");
+	if (first == std::string::npos) {
+		return "";
+	}
+	return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool ConfigBlock::has(const std::string& key) const {
+	return values.find(key) != values.end();
+}
+
+std::string ConfigBlock::get(const std::string& key) const {
+	std::map<std::string, std::string>::const_iterator i = values.find(key);
+	if (i == values.end()) {
+		Logger::logFatal(
+				fileName + ": " + get("layerName", "block") + " has no "
+						+ key);
+	}
+	return i->second;
+}
+
+std::string ConfigBlock::get(const std::string& key,
+		const std::string& def) const {
+	std::map<std::string, std::string>::const_iterator i = values.find(key);
+	return i == values.end() ? def : i->second;
+}
+
+float ConfigBlock::getFloat(const std::string& key, float def) const {
+	return has(key) ? (float) atof(get(key).c_str()) : def;
+}
+
+std::vector<size_t> ConfigBlock::getDims(const std::string& key,
+		size_t n) const {
+	std::istringstream in(get(key));
+	std::vector<size_t> dims;
+	long d;
+	while (in >> d) {
+		if (d < 0 || dims.size() == n) {
+			Logger::logFatal(
+					fileName + ": bad " + key + " in "
+							+ get("layerName", "block"));
+		}
+		dims.push_back(d);
+	}
+	if (dims.empty()) {
+		Logger::logFatal(
+				fileName + ": empty " + key + " in "
+						+ get("layerName", "block"));
+	}
+	dims.resize(n, 1);
+	return dims;
+}
+
+std::vector<size_t> ConfigBlock::getDims(const std::string& key, size_t n,
+		size_t def) const {
+	return has(key) ? getDims(key, n) : std::vector<size_t>(n, def);
+}
+
+std::vector<ConfigBlock> readConfigBlocks(const std::string& fileName) {
+	std::ifstream in(fileName.c_str());
+	if (!in) {
+		Logger::logFatal("failed to open configuration file " + fileName);
+	}
+	std::vector<ConfigBlock> blocks;
+	bool inBlock = false;
+	std::string line;
+	size_t lineNo = 0;
+	while (std::getline(in, line)) {
+		++lineNo;
+		const size_t hash = line.find('#');
+		if (hash != std::string::npos) {
+			line.erase(hash);
+		}
+		// braces may share a line with a key, or with each other
+		size_t open;
+		while ((open = line.find('{')) != std::string::npos) {
+			if (inBlock || !trim(line.substr(0, open)).empty()) {
+				break;
+			}
+			blocks.push_back(ConfigBlock());
+			blocks.back().fileName = fileName;
+			inBlock = true;
+			line.erase(0, open + 1);
+		}
+		const size_t close = line.find('}');
+		const std::string body = trim(line.substr(0, close));
+		if (!body.empty()) {
+			const size_t eq = body.find('=');
+			if (!inBlock || eq == std::string::npos) {
+				std::ostringstream msg;
+				msg << fileName << ":" << lineNo << ": expected key = value"
+						<< " inside { }";
+				Logger::logFatal(msg.str());
+			}
+			blocks.back().values[trim(body.substr(0, eq))] = trim(
+					body.substr(eq + 1));
+		}
+		if (close != std::string::npos) {
+			inBlock = false;
+		}
+	}
+	return blocks;
+}
+} /* namespace rudra */
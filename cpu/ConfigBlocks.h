@@ -0,0 +1,74 @@
+/*
+ * ConfigBlocks.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_CPU_CONFIGBLOCKS_H_
+#define RUDRA_CPU_CONFIGBLOCKS_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rudra {
+/**
+ * One { ... } block of a Rudra configuration file: the .cfg job file holds
+ * a single block, and a .cnn network file holds one block per layer. Each
+ * line of a block is "key = value"; anything after a '#' is a comment.
+ */
+class ConfigBlock {
+public:
+	std::string fileName; // for error messages
+	std::map<std::string, std::string> values;
+
+	bool has(const std::string& key) const;
+	/** The value for key, or fatal if it is missing. */
+	std::string get(const std::string& key) const;
+	std::string get(const std::string& key, const std::string& def) const;
+	float getFloat(const std::string& key, float def) const;
+	/**
+	 * The whitespace-separated sizes for key (such as "dimInput = 28 28 1"),
+	 * which must number between 1 and n; missing trailing sizes are 1.
+	 * Fatal if key is missing.
+	 */
+	std::vector<size_t> getDims(const std::string& key, size_t n) const;
+	std::vector<size_t> getDims(const std::string& key, size_t n,
+			size_t def) const;
+};
+
+/** Read all the blocks in the named file. Fatal if it cannot be read. */
+std::vector<ConfigBlock> readConfigBlocks(const std::string& fileName);
+} /* namespace rudra */
+
+#endif /* RUDRA_CPU_CONFIGBLOCKS_H_ */
@@ -0,0 +1,252 @@
+/*
+ * Gemm.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Gemm.h"
+#include "rudra/util/AlignedAlloc.h"
+#include "rudra/util/SimdDispatch.h"
+#include <cstring>
+#ifdef RUDRA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rudra {
+// register block of the inner kernel, and cache blocks of the packed panels
+static const size_t MR = 6;
+static const size_t NR = 16;
+static const size_t MC = 120;
+static const size_t KC = 256;
+static const size_t NC = 2048;
+
+/** Packing buffers, allocated once for each thread that calls sgemm. */
+static __thread float* packedA = NULL;
+static __thread float* packedB = NULL;
+
+/**
+ * Pack the mc x kc block of alpha * op(A) into slivers of MR rows, each
+ * stored column by column, padding the last sliver with zeros.
+ * Element (i, k) of op(A) is at a[i * rs + k * cs].
+ */
+static void packA(const float* a, size_t rs, size_t cs, size_t mc, size_t kc,
+		float alpha, float* dst) {
+	for (size_t i0 = 0; i0 < mc; i0 += MR) {
+		const size_t mr = mc - i0 < MR ? mc - i0 : MR;
+		for (size_t k = 0; k < kc; ++k) {
+			for (size_t r = 0; r < mr; ++r) {
+				dst[r] = alpha * a[(i0 + r) * rs + k * cs];
+			}
+			for (size_t r = mr; r < MR; ++r) {
+				dst[r] = 0.0f;
+			}
+			dst += MR;
+		}
+	}
+}
+
+/**
+ * Pack the kc x nc block of op(B) into slivers of NR columns, each stored
+ * row by row, padding the last sliver with zeros.
+ * Element (k, j) of op(B) is at b[k * rs + j * cs].
+ */
+static void packB(const float* b, size_t rs, size_t cs, size_t kc, size_t nc,
+		float* dst) {
+	for (size_t j0 = 0; j0 < nc; j0 += NR) {
+		const size_t nr = nc - j0 < NR ? nc - j0 : NR;
+		for (size_t k = 0; k < kc; ++k) {
+			const float* row = b + k * rs + j0 * cs;
+			if (cs == 1) {
+				memcpy(dst, row, nr * sizeof(float));
+			} else {
+				for (size_t c = 0; c < nr; ++c) {
+					dst[c] = row[c * cs];
+				}
+			}
+			for (size_t c = nr; c < NR; ++c) {
+				dst[c] = 0.0f;
+			}
+			dst += NR;
+		}
+	}
+}
+
+/** Add the mr x nr top left corner of an MR x NR tile into C. */
+static void addTile(const float* tile, size_t mr, size_t nr, float* c,
+		size_t ldc) {
+	for (size_t r = 0; r < mr; ++r) {
+		for (size_t j = 0; j < nr; ++j) {
+			c[r * ldc + j] += tile[r * NR + j];
+		}
+	}
+}
+
+/** C[mr x nr] += packed A sliver * packed B sliver, over kc. */
+static void kernelScalar(size_t kc, const float* a, const float* b, float* c,
+		size_t ldc, size_t mr, size_t nr) {
+	float tile[MR * NR];
+	memset(tile, 0, sizeof(tile));
+	for (size_t k = 0; k < kc; ++k) {
+		for (size_t r = 0; r < MR; ++r) {
+			const float ar = a[k * MR + r];
+			for (size_t j = 0; j < NR; ++j) {
+				tile[r * NR + j] += ar * b[k * NR + j];
+			}
+		}
+	}
+	addTile(tile, mr, nr, c, ldc);
+}
+
+#ifdef RUDRA_X86_SIMD
+/**
+ * The AVX2 kernel keeps the 6 x 16 tile in twelve ymm registers, and for
+ * each k broadcasts six elements of A against two vectors of B.
+ */
+__attribute__((target("avx2,fma"))) static void kernelAVX2(size_t kc,
+		const float* a, const float* b, float* c, size_t ldc, size_t mr,
+		size_t nr) {
+	__m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+	__m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+	__m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+	__m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+	__m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+	__m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+	for (size_t k = 0; k < kc; ++k) {
+		const __m256 b0 = _mm256_load_ps(b);
+		const __m256 b1 = _mm256_load_ps(b + 8);
+		__m256 ar = _mm256_broadcast_ss(a);
+		c00 = _mm256_fmadd_ps(ar, b0, c00);
+		c01 = _mm256_fmadd_ps(ar, b1, c01);
+		ar = _mm256_broadcast_ss(a + 1);
+		c10 = _mm256_fmadd_ps(ar, b0, c10);
+		c11 = _mm256_fmadd_ps(ar, b1, c11);
+		ar = _mm256_broadcast_ss(a + 2);
+		c20 = _mm256_fmadd_ps(ar, b0, c20);
+		c21 = _mm256_fmadd_ps(ar, b1, c21);
+		ar = _mm256_broadcast_ss(a + 3);
+		c30 = _mm256_fmadd_ps(ar, b0, c30);
+		c31 = _mm256_fmadd_ps(ar, b1, c31);
+		ar = _mm256_broadcast_ss(a + 4);
+		c40 = _mm256_fmadd_ps(ar, b0, c40);
+		c41 = _mm256_fmadd_ps(ar, b1, c41);
+		ar = _mm256_broadcast_ss(a + 5);
+		c50 = _mm256_fmadd_ps(ar, b0, c50);
+		c51 = _mm256_fmadd_ps(ar, b1, c51);
+		a += MR;
+		b += NR;
+	}
+	const __m256 acc[MR][2] = { { c00, c01 }, { c10, c11 }, { c20, c21 }, {
+			c30, c31 }, { c40, c41 }, { c50, c51 } };
+	if (mr == MR && nr == NR) {
+		for (size_t r = 0; r < MR; ++r) {
+			float* row = c + r * ldc;
+			_mm256_storeu_ps(row,
+					_mm256_add_ps(_mm256_loadu_ps(row), acc[r][0]));
+			_mm256_storeu_ps(row + 8,
+					_mm256_add_ps(_mm256_loadu_ps(row + 8), acc[r][1]));
+		}
+	} else {
+		float tile[MR * NR] __attribute__((aligned(32)));
+		for (size_t r = 0; r < MR; ++r) {
+			_mm256_store_ps(tile + r * NR, acc[r][0]);
+			_mm256_store_ps(tile + r * NR + 8, acc[r][1]);
+		}
+		addTile(tile, mr, nr, c, ldc);
+	}
+}
+#endif
+
+typedef void (*Kernel)(size_t, const float*, const float*, float*, size_t,
+		size_t, size_t);
+
+static Kernel pickKernel() {
+#ifdef RUDRA_X86_SIMD
+	if (simdLevel() >= SIMD_AVX2 && __builtin_cpu_supports("fma")) {
+		return kernelAVX2;
+	}
+#endif
+	return kernelScalar;
+}
+
+const char* sgemmKernelName() {
+	return pickKernel() == kernelScalar ? "scalar" : "avx2";
+}
+
+void sgemm(bool transA, bool transB, size_t M, size_t N, size_t K,
+		float alpha, const float* A, size_t lda, const float* B, size_t ldb,
+		float beta, float* C, size_t ldc) {
+	if (M == 0 || N == 0) {
+		return;
+	}
+	for (size_t i = 0; i < M; ++i) {
+		float* row = C + i * ldc;
+		if (beta == 0.0f) {
+			memset(row, 0, N * sizeof(float));
+		} else if (beta != 1.0f) {
+			for (size_t j = 0; j < N; ++j) {
+				row[j] *= beta;
+			}
+		}
+	}
+	if (K == 0 || alpha == 0.0f) {
+		return;
+	}
+	if (packedA == NULL) {
+		packedA = (float*) alignedAlloc(MC * KC * sizeof(float));
+		packedB = (float*) alignedAlloc(KC * NC * sizeof(float));
+	}
+	const Kernel kernel = pickKernel();
+	// strides of op(A) and op(B) by (row, column)
+	const size_t rsA = transA ? 1 : lda, csA = transA ? lda : 1;
+	const size_t rsB = transB ? 1 : ldb, csB = transB ? ldb : 1;
+	for (size_t jc = 0; jc < N; jc += NC) {
+		const size_t nc = N - jc < NC ? N - jc : NC;
+		for (size_t pc = 0; pc < K; pc += KC) {
+			const size_t kc = K - pc < KC ? K - pc : KC;
+			packB(B + pc * rsB + jc * csB, rsB, csB, kc, nc, packedB);
+			for (size_t ic = 0; ic < M; ic += MC) {
+				const size_t mc = M - ic < MC ? M - ic : MC;
+				packA(A + ic * rsA + pc * csA, rsA, csA, mc, kc, alpha,
+						packedA);
+				for (size_t jr = 0; jr < nc; jr += NR) {
+					const size_t nr = nc - jr < NR ? nc - jr : NR;
+					for (size_t ir = 0; ir < mc; ir += MR) {
+						const size_t mr = mc - ir < MR ? mc - ir : MR;
+						kernel(kc, packedA + ir * kc, packedB + jr * kc,
+								C + (ic + ir) * ldc + jc + jr, ldc, mr, nr);
+					}
+				}
+			}
+		}
+	}
+}
+} /* namespace rudra */
@@ -0,0 +1,60 @@
+/*
+ * Gemm.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_CPU_GEMM_H_
+#define RUDRA_CPU_GEMM_H_
+
+#include <cstddef>
+
+namespace rudra {
+/**
+ * C = alpha * op(A) * op(B) + beta * C, for row-major matrices, where op(A)
+ * is M x K (A is K x M if transA) and op(B) is K x N (B is N x K if
+ * transB). lda, ldb and ldc are the row strides of A, B and C as stored.
+ * If beta is 0, C need not be initialized.
+ * Blocked for the caches, with both operands packed into panels so that
+ * transposes cost nothing extra, and an AVX2/FMA register-blocked inner
+ * kernel where the CPU supports it. Single-threaded: callers split the work
+ * over threads, e.g. over the samples of a minibatch.
+ */
+void sgemm(bool transA, bool transB, size_t M, size_t N, size_t K,
+		float alpha, const float* A, size_t lda, const float* B, size_t ldb,
+		float beta, float* C, size_t ldc);
+
+/** Name of the inner kernel in use: "avx2" or "scalar". */
+const char* sgemmKernelName();
+} /* namespace rudra */
+
+#endif /* RUDRA_CPU_GEMM_H_ */
@@ -0,0 +1,764 @@
+/*
+ * Layers.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Layers.h"
+#include "Gemm.h"
+#include "rudra/util/Logger.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <omp.h>
+#include <sstream>
+
+namespace rudra {
+Activation activationFromName(const std::string& name) {
+	if (name == "identity" || name == "linear" || name == "none") {
+		return ACT_IDENTITY;
+	}
+	if (name == "relu") {
+		return ACT_RELU;
+	}
+	if (name == "sigmoid" || name == "logistic") {
+		return ACT_SIGMOID;
+	}
+	if (name == "tanh") {
+		return ACT_TANH;
+	}
+	if (name == "softmax") {
+		return ACT_SOFTMAX;
+	}
+	Logger::logFatal("unknown actFunc " + name);
+	return ACT_IDENTITY;
+}
+
+static size_t product(const std::vector<size_t>& dims) {
+	size_t p = 1;
+	for (size_t i = 0; i < dims.size(); ++i) {
+		p *= dims[i];
+	}
+	return p;
+}
+
+/** Fatal unless the given dimension, as computed, matches the .cnn file. */
+static void checkDim(const ConfigBlock& block, const char* what,
+		size_t computed, size_t given) {
+	if (computed != given) {
+		std::ostringstream msg;
+		msg << block.fileName << ": " << block.get("layerName", "?") << ": "
+				<< what << " should be " << computed << ", not " << given;
+		Logger::logFatal(msg.str());
+	}
+}
+
+Layer::Layer(const std::string& name, size_t inSize, size_t outSize) :
+		name(name), inSize(inSize), outSize(outSize), act(ACT_IDENTITY), activationFused(
+				false), initWmean(0), initWstd(0), initBmean(0), initBstd(0) {
+	memset(&weightBlock, 0, sizeof(weightBlock));
+	memset(&biasBlock, 0, sizeof(biasBlock));
+}
+
+Layer* Layer::create(const ConfigBlock& block) {
+	const std::string type = block.get("layerType");
+	if (type == "input" || type == "bridge") {
+		return new ReshapeLayer(block);
+	}
+	if (type == "activation") {
+		return new ActivationLayer(block);
+	}
+	if (type == "conv") {
+		return new ConvLayer(block);
+	}
+	if (type == "pool") {
+		return new PoolLayer(block);
+	}
+	if (type == "rnorm") {
+		return new RnormLayer(block);
+	}
+	if (type == "fully-connected") {
+		return new FullyConnectedLayer(block);
+	}
+	Logger::logFatal(block.fileName + ": unknown layerType " + type);
+	return NULL;
+}
+
+void Layer::readHyperParams(const ConfigBlock& block) {
+	weightBlock.alpha = block.getFloat("alphaW", 0.01f);
+	weightBlock.lambda = block.getFloat("lambdaW", 0.0f);
+	weightBlock.mom = block.getFloat("momW", 0.0f);
+	biasBlock.alpha = block.getFloat("alphaB", weightBlock.alpha);
+	biasBlock.lambda = block.getFloat("lambdaB", 0.0f);
+	biasBlock.mom = block.getFloat("momB", weightBlock.mom);
+	initWmean = block.getFloat("initWmean", 0.0f);
+	initWstd = block.getFloat("initWstd", 0.01f);
+	initBmean = block.getFloat("initBmean", 0.0f);
+	initBstd = block.getFloat("initBstd", 0.0f);
+}
+
+void Layer::fillNormal(RudraRand& rand, float* p, size_t n, float mean,
+		float std) {
+	for (size_t i = 0; i < n; i += 2) {
+		// Box-Muller; 1 - u is in (0, 1], so the log is finite
+		const double r = sqrt(-2.0 * log(1.0 - rand.nextDouble()));
+		const double theta = 2.0 * M_PI * rand.nextDouble();
+		p[i] = mean + std * (float) (r * cos(theta));
+		if (i + 1 < n) {
+			p[i + 1] = mean + std * (float) (r * sin(theta));
+		}
+	}
+}
+
+void Layer::activate(float* out, size_t batch) const {
+	const long n = (long) (batch * outSize);
+	switch (act) {
+	case ACT_RELU:
+#pragma omp parallel for schedule(static)
+		for (long i = 0; i < n; ++i) {
+			out[i] = out[i] > 0.0f ? out[i] : 0.0f;
+		}
+		break;
+	case ACT_SIGMOID:
+#pragma omp parallel for schedule(static)
+		for (long i = 0; i < n; ++i) {
+			out[i] = 1.0f / (1.0f + expf(-out[i]));
+		}
+		break;
+	case ACT_TANH:
+#pragma omp parallel for schedule(static)
+		for (long i = 0; i < n; ++i) {
+			out[i] = tanhf(out[i]);
+		}
+		break;
+	case ACT_SOFTMAX:
+#pragma omp parallel for schedule(static)
+		for (long s = 0; s < (long) batch; ++s) {
+			float* y = out + s * outSize;
+			const float top = *std::max_element(y, y + outSize);
+			float total = 0.0f;
+			for (size_t i = 0; i < outSize; ++i) {
+				y[i] = expf(y[i] - top);
+				total += y[i];
+			}
+			for (size_t i = 0; i < outSize; ++i) {
+				y[i] /= total;
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void Layer::deactivate(const float* out, float* dOut, size_t batch) const {
+	if (activationFused) {
+		return;
+	}
+	const long n = (long) (batch * outSize);
+	switch (act) {
+	case ACT_RELU:
+#pragma omp parallel for schedule(static)
+		for (long i = 0; i < n; ++i) {
+			dOut[i] = out[i] > 0.0f ? dOut[i] : 0.0f;
+		}
+		break;
+	case ACT_SIGMOID:
+#pragma omp parallel for schedule(static)
+		for (long i = 0; i < n; ++i) {
+			dOut[i] *= out[i] * (1.0f - out[i]);
+		}
+		break;
+	case ACT_TANH:
+#pragma omp parallel for schedule(static)
+		for (long i = 0; i < n; ++i) {
+			dOut[i] *= 1.0f - out[i] * out[i];
+		}
+		break;
+	case ACT_SOFTMAX:
+#pragma omp parallel for schedule(static)
+		for (long s = 0; s < (long) batch; ++s) {
+			const float* y = out + s * outSize;
+			float* d = dOut + s * outSize;
+			float dot = 0.0f;
+			for (size_t i = 0; i < outSize; ++i) {
+				dot += d[i] * y[i];
+			}
+			for (size_t i = 0; i < outSize; ++i) {
+				d[i] = y[i] * (d[i] - dot);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+//===========================
+// input and bridge
+//===========================
+ReshapeLayer::ReshapeLayer(const ConfigBlock& block) :
+		Layer(block.get("layerName"), product(block.getDims("dimInput", 3)),
+				product(
+						block.has("dimOutput") ?
+								block.getDims("dimOutput", 3) :
+								block.getDims("dimInput", 3))) {
+	checkDim(block, "the size of dimOutput", inSize, outSize);
+}
+
+void ReshapeLayer::forward(const float* in, float* out, size_t batch) {
+	memcpy(out, in, batch * inSize * sizeof(float));
+}
+
+void ReshapeLayer::backward(const float* in, const float* out, float* dOut,
+		float* dIn, size_t batch) {
+	if (dIn != NULL) {
+		memcpy(dIn, dOut, batch * inSize * sizeof(float));
+	}
+}
+
+//===========================
+// activation
+//===========================
+ActivationLayer::ActivationLayer(const ConfigBlock& block) :
+		Layer(block.get("layerName"), product(block.getDims("dimInput", 3)),
+				product(
+						block.has("dimOutput") ?
+								block.getDims("dimOutput", 3) :
+								block.getDims("dimInput", 3))) {
+	checkDim(block, "the size of dimOutput", inSize, outSize);
+	act = activationFromName(block.get("actFunc"));
+}
+
+void ActivationLayer::forward(const float* in, float* out, size_t batch) {
+	memcpy(out, in, batch * inSize * sizeof(float));
+	activate(out, batch);
+}
+
+void ActivationLayer::backward(const float* in, const float* out, float* dOut,
+		float* dIn, size_t batch) {
+	deactivate(out, dOut, batch);
+	if (dIn != NULL) {
+		memcpy(dIn, dOut, batch * inSize * sizeof(float));
+	}
+}
+
+//===========================
+// convolution
+//===========================
+ConvLayer::ConvLayer(const ConfigBlock& block) :
+		Layer(block.get("layerName"), product(block.getDims("dimInput", 3)),
+				product(block.getDims("dimOutput", 3))), W(NULL), b(NULL), gW(
+				NULL), gb(NULL) {
+	const std::vector<size_t> in = block.getDims("dimInput", 3);
+	const std::vector<size_t> out = block.getDims("dimOutput", 3);
+	const std::vector<size_t> kernel = block.getDims("dimKernel", 2);
+	const std::vector<size_t> pad = block.getDims("dimInputPad", 2, 0);
+	const std::vector<size_t> stride = block.getDims("dimStride", 2, 1);
+	inW = in[0], inH = in[1], inC = in[2];
+	outW = out[0], outH = out[1], outC = out[2];
+	kW = kernel[0], kH = kernel[1];
+	padW = pad[0], padH = pad[1];
+	strideW = stride[0], strideH = stride[1];
+	if (kW == 0 || kH == 0 || strideW == 0 || strideH == 0
+			|| kW > inW + 2 * padW || kH > inH + 2 * padH) {
+		Logger::logFatal(block.fileName + ": bad kernel in " + name);
+	}
+	checkDim(block, "the output width", (inW + 2 * padW - kW) / strideW + 1,
+			outW);
+	checkDim(block, "the output height", (inH + 2 * padH - kH) / strideH + 1,
+			outH);
+	colRows = inC * kH * kW;
+	act = activationFromName(block.get("actFunc", "identity"));
+	readHyperParams(block);
+}
+
+size_t ConvLayer::numParams() const {
+	return outC * colRows + outC;
+}
+
+void ConvLayer::bindParams(float* w, float* g, size_t offset,
+		std::vector<ParamBlock>& blocks) {
+	W = w;
+	b = w + outC * colRows;
+	gW = g;
+	gb = g + outC * colRows;
+	weightBlock.offset = offset;
+	weightBlock.size = outC * colRows;
+	biasBlock.offset = offset + weightBlock.size;
+	biasBlock.size = outC;
+	blocks.push_back(weightBlock);
+	blocks.push_back(biasBlock);
+}
+
+void ConvLayer::initParams(RudraRand& rand) {
+	fillNormal(rand, W, outC * colRows, initWmean, initWstd);
+	fillNormal(rand, b, outC, initBmean, initBstd);
+}
+
+/** A 1x1 convolution with unit stride needs no im2col. */
+bool ConvLayer::directInput() const {
+	return kH == 1 && kW == 1 && padH == 0 && padW == 0 && strideH == 1
+			&& strideW == 1;
+}
+
+/**
+ * Expand one sample into col, a colRows x (outH * outW) matrix whose column
+ * for each output position holds the input window it is computed from.
+ */
+void ConvLayer::im2col(const float* in, float* col) const {
+	for (size_t c = 0; c < inC; ++c) {
+		for (size_t ky = 0; ky < kH; ++ky) {
+			for (size_t kx = 0; kx < kW; ++kx) {
+				for (size_t oy = 0; oy < outH; ++oy) {
+					const long y = (long) (oy * strideH + ky) - (long) padH;
+					if (y < 0 || y >= (long) inH) {
+						memset(col, 0, outW * sizeof(float));
+						col += outW;
+						continue;
+					}
+					const float* row = in + (c * inH + y) * inW;
+					for (size_t ox = 0; ox < outW; ++ox) {
+						const long x = (long) (ox * strideW + kx) - (long) padW;
+						*col++ = x >= 0 && x < (long) inW ? row[x] : 0.0f;
+					}
+				}
+			}
+		}
+	}
+}
+
+/** Sum the columns of col back into the input positions they came from. */
+void ConvLayer::col2im(const float* col, float* in) const {
+	memset(in, 0, inSize * sizeof(float));
+	for (size_t c = 0; c < inC; ++c) {
+		for (size_t ky = 0; ky < kH; ++ky) {
+			for (size_t kx = 0; kx < kW; ++kx) {
+				for (size_t oy = 0; oy < outH; ++oy) {
+					const long y = (long) (oy * strideH + ky) - (long) padH;
+					if (y < 0 || y >= (long) inH) {
+						col += outW;
+						continue;
+					}
+					float* row = in + (c * inH + y) * inW;
+					for (size_t ox = 0; ox < outW; ++ox, ++col) {
+						const long x = (long) (ox * strideW + kx) - (long) padW;
+						if (x >= 0 && x < (long) inW) {
+							row[x] += *col;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void ConvLayer::forward(const float* in, float* out, size_t batch) {
+	const size_t hw = outH * outW;
+	colBuf.resize(omp_get_max_threads());
+#pragma omp parallel for schedule(static)
+	for (long s = 0; s < (long) batch; ++s) {
+		const float* x = in + s * inSize;
+		float* y = out + s * outSize;
+		const float* col = x;
+		if (!directInput()) {
+			std::vector<float>& buf = colBuf[omp_get_thread_num()];
+			buf.resize(colRows * hw);
+			im2col(x, &buf[0]);
+			col = &buf[0];
+		}
+		sgemm(false, false, outC, hw, colRows, 1.0f, W, colRows, col, hw,
+				0.0f, y, hw);
+		for (size_t k = 0; k < outC; ++k) {
+			for (size_t i = 0; i < hw; ++i) {
+				y[k * hw + i] += b[k];
+			}
+		}
+	}
+	activate(out, batch);
+}
+
+void ConvLayer::backward(const float* in, const float* out, float* dOut,
+		float* dIn, size_t batch) {
+	deactivate(out, dOut, batch);
+	const size_t hw = outH * outW;
+	const size_t nParams = numParams();
+	const int threads = omp_get_max_threads();
+	colBuf.resize(threads);
+	gradBuf.resize(threads);
+	for (int t = 0; t < threads; ++t) {
+		gradBuf[t].assign(nParams, 0.0f);
+	}
+#pragma omp parallel for schedule(static)
+	for (long s = 0; s < (long) batch; ++s) {
+		const int t = omp_get_thread_num();
+		const float* x = in + s * inSize;
+		const float* dy = dOut + s * outSize;
+		float* acc = &gradBuf[t][0];
+		std::vector<float>& buf = colBuf[t];
+		const float* col = x;
+		if (!directInput()) {
+			buf.resize(colRows * hw);
+			im2col(x, &buf[0]);
+			col = &buf[0];
+		}
+		// weights += dy * col', biases += row sums of dy
+		sgemm(false, true, outC, colRows, hw, 1.0f, dy, hw, col, hw, 1.0f,
+				acc, colRows);
+		for (size_t k = 0; k < outC; ++k) {
+			float total = 0.0f;
+			for (size_t i = 0; i < hw; ++i) {
+				total += dy[k * hw + i];
+			}
+			acc[outC * colRows + k] += total;
+		}
+		if (dIn == NULL) {
+			continue;
+		}
+		float* dx = dIn + s * inSize;
+		if (directInput()) {
+			sgemm(true, false, colRows, hw, outC, 1.0f, W, colRows, dy, hw,
+					0.0f, dx, hw);
+		} else {
+			// col is no longer needed, so its buffer takes W' * dy
+			sgemm(true, false, colRows, hw, outC, 1.0f, W, colRows, dy, hw,
+					0.0f, &buf[0], hw);
+			col2im(&buf[0], dx);
+		}
+	}
+#pragma omp parallel for schedule(static)
+	for (long i = 0; i < (long) nParams; ++i) {
+		float total = 0.0f;
+		for (int t = 0; t < threads; ++t) {
+			total += gradBuf[t][i];
+		}
+		gW[i] = total; // gb follows gW
+	}
+}
+
+//===========================
+// pooling
+//===========================
+/** Number of pooling windows along a dimension, as Caffe computes it. */
+static size_t poolOutputs(size_t in, size_t pool, size_t stride) {
+	if (in <= pool) {
+		return 1;
+	}
+	size_t n = (in - pool + stride - 1) / stride + 1;
+	if ((n - 1) * stride >= in) {
+		--n; // the last window must start inside the input
+	}
+	return n;
+}
+
+PoolLayer::PoolLayer(const ConfigBlock& block) :
+		Layer(block.get("layerName"), product(block.getDims("dimInput", 3)),
+				product(block.getDims("dimOutput", 3))) {
+	const std::vector<size_t> in = block.getDims("dimInput", 3);
+	const std::vector<size_t> out = block.getDims("dimOutput", 3);
+	const std::vector<size_t> pool = block.getDims("dimPool", 2);
+	const std::vector<size_t> stride = block.getDims("dimStride", 2, 0);
+	const std::string func = block.get("poolFunc", "max");
+	if (func != "max" && func != "avg") {
+		Logger::logFatal(block.fileName + ": unknown poolFunc " + func);
+	}
+	isMax = func == "max";
+	inW = in[0], inH = in[1], C = in[2];
+	poolW = pool[0], poolH = pool[1];
+	strideW = stride[0] ? stride[0] : poolW;
+	strideH = stride[1] ? stride[1] : poolH;
+	if (poolW == 0 || poolH == 0) {
+		Logger::logFatal(block.fileName + ": bad dimPool in " + name);
+	}
+	outW = poolOutputs(inW, poolW, strideW);
+	outH = poolOutputs(inH, poolH, strideH);
+	checkDim(block, "the output width", outW, out[0]);
+	checkDim(block, "the output height", outH, out[1]);
+	checkDim(block, "the number of output channels", C, out[2]);
+}
+
+void PoolLayer::forward(const float* in, float* out, size_t batch) {
+	if (isMax) {
+		argMax.resize(batch * outSize);
+	}
+	const long planes = (long) (batch * C);
+#pragma omp parallel for schedule(static)
+	for (long p = 0; p < planes; ++p) {
+		const float* x = in + p * inH * inW;
+		float* y = out + p * outH * outW;
+		unsigned* arg = isMax ? &argMax[p * outH * outW] : NULL;
+		for (size_t oy = 0; oy < outH; ++oy) {
+			const size_t y0 = oy * strideH, y1 = std::min(y0 + poolH, inH);
+			for (size_t ox = 0; ox < outW; ++ox) {
+				const size_t x0 = ox * strideW, x1 = std::min(x0 + poolW, inW);
+				if (isMax) {
+					float best = -FLT_MAX;
+					unsigned where = y0 * inW + x0;
+					for (size_t iy = y0; iy < y1; ++iy) {
+						for (size_t ix = x0; ix < x1; ++ix) {
+							if (x[iy * inW + ix] > best) {
+								best = x[iy * inW + ix];
+								where = iy * inW + ix;
+							}
+						}
+					}
+					y[oy * outW + ox] = best;
+					arg[oy * outW + ox] = where;
+				} else {
+					float total = 0.0f;
+					for (size_t iy = y0; iy < y1; ++iy) {
+						for (size_t ix = x0; ix < x1; ++ix) {
+							total += x[iy * inW + ix];
+						}
+					}
+					y[oy * outW + ox] = total / ((y1 - y0) * (x1 - x0));
+				}
+			}
+		}
+	}
+}
+
+void PoolLayer::backward(const float* in, const float* out, float* dOut,
+		float* dIn, size_t batch) {
+	if (dIn == NULL) {
+		return;
+	}
+	const long planes = (long) (batch * C);
+#pragma omp parallel for schedule(static)
+	for (long p = 0; p < planes; ++p) {
+		const float* dy = dOut + p * outH * outW;
+		float* dx = dIn + p * inH * inW;
+		memset(dx, 0, inH * inW * sizeof(float));
+		if (isMax) {
+			const unsigned* arg = &argMax[p * outH * outW];
+			for (size_t i = 0; i < outH * outW; ++i) {
+				dx[arg[i]] += dy[i];
+			}
+			continue;
+		}
+		for (size_t oy = 0; oy < outH; ++oy) {
+			const size_t y0 = oy * strideH, y1 = std::min(y0 + poolH, inH);
+			for (size_t ox = 0; ox < outW; ++ox) {
+				const size_t x0 = ox * strideW, x1 = std::min(x0 + poolW, inW);
+				const float share = dy[oy * outW + ox]
+						/ ((y1 - y0) * (x1 - x0));
+				for (size_t iy = y0; iy < y1; ++iy) {
+					for (size_t ix = x0; ix < x1; ++ix) {
+						dx[iy * inW + ix] += share;
+					}
+				}
+			}
+		}
+	}
+}
+
+//===========================
+// response normalization
+//===========================
+RnormLayer::RnormLayer(const ConfigBlock& block) :
+		Layer(block.get("layerName"), product(block.getDims("dimInput", 3)),
+				product(
+						block.has("dimOutput") ?
+								block.getDims("dimOutput", 3) :
+								block.getDims("dimInput", 3))) {
+	const std::vector<size_t> in = block.getDims("dimInput", 3);
+	const std::vector<size_t> norm = block.getDims("dimNorm", 2);
+	checkDim(block, "the size of dimOutput", inSize, outSize);
+	W = in[0], H = in[1], C = in[2];
+	normW = norm[0], normH = norm[1];
+	if (normW % 2 == 0 || normH % 2 == 0) {
+		Logger::logFatal(
+				block.fileName + ": dimNorm must be odd in " + name);
+	}
+	alpha = block.getFloat("alpha", 1e-4f);
+	beta = block.getFloat("beta", 0.75f);
+}
+
+/** sum = the sum of x over the window centred on each position of a plane. */
+void RnormLayer::windowSum(const float* x, float* sum) const {
+	const long hy = (long) normH / 2, hx = (long) normW / 2;
+	for (long y = 0; y < (long) H; ++y) {
+		const long y0 = std::max(0L, y - hy), y1 = std::min((long) H, y + hy + 1);
+		for (long xx = 0; xx < (long) W; ++xx) {
+			const long x0 = std::max(0L, xx - hx);
+			const long x1 = std::min((long) W, xx + hx + 1);
+			float total = 0.0f;
+			for (long iy = y0; iy < y1; ++iy) {
+				for (long ix = x0; ix < x1; ++ix) {
+					total += x[iy * W + ix];
+				}
+			}
+			sum[y * W + xx] = total;
+		}
+	}
+}
+
+void RnormLayer::forward(const float* in, float* out, size_t batch) {
+	scale.resize(batch * inSize);
+	ratio.resize(batch * inSize);
+	const size_t plane = H * W;
+	const float a = alpha / (normH * normW);
+	const long planes = (long) (batch * C);
+#pragma omp parallel for schedule(static)
+	for (long p = 0; p < planes; ++p) {
+		const float* x = in + p * plane;
+		float* sq = &ratio[p * plane];
+		float* s = &scale[p * plane];
+		for (size_t i = 0; i < plane; ++i) {
+			sq[i] = x[i] * x[i];
+		}
+		windowSum(sq, s);
+		float* y = out + p * plane;
+		for (size_t i = 0; i < plane; ++i) {
+			s[i] = 1.0f + a * s[i];
+			y[i] = x[i] * powf(s[i], -beta);
+		}
+	}
+}
+
+void RnormLayer::backward(const float* in, const float* out, float* dOut,
+		float* dIn, size_t batch) {
+	if (dIn == NULL) {
+		return;
+	}
+	const size_t plane = H * W;
+	const float coef = 2.0f * alpha * beta / (normH * normW);
+	const long planes = (long) (batch * C);
+#pragma omp parallel for schedule(static)
+	for (long p = 0; p < planes; ++p) {
+		const float* x = in + p * plane;
+		const float* y = out + p * plane;
+		const float* dy = dOut + p * plane;
+		const float* s = &scale[p * plane];
+		float* r = &ratio[p * plane];
+		float* dx = dIn + p * plane;
+		for (size_t i = 0; i < plane; ++i) {
+			r[i] = dy[i] * y[i] / s[i];
+		}
+		// the windows are symmetric, so each value's window holds exactly
+		// the values whose windows hold it
+		windowSum(r, dx);
+		for (size_t i = 0; i < plane; ++i) {
+			dx[i] = dy[i] * powf(s[i], -beta) - coef * x[i] * dx[i];
+		}
+	}
+}
+
+//===========================
+// fully-connected
+//===========================
+FullyConnectedLayer::FullyConnectedLayer(const ConfigBlock& block) :
+		Layer(block.get("layerName"), product(block.getDims("dimInput", 3)),
+				product(block.getDims("dimOutput", 3))), W(NULL), b(NULL), gW(
+				NULL), gb(NULL) {
+	act = activationFromName(block.get("actFunc", "identity"));
+	readHyperParams(block);
+}
+
+size_t FullyConnectedLayer::numParams() const {
+	return outSize * inSize + outSize;
+}
+
+void FullyConnectedLayer::bindParams(float* w, float* g, size_t offset,
+		std::vector<ParamBlock>& blocks) {
+	W = w;
+	b = w + outSize * inSize;
+	gW = g;
+	gb = g + outSize * inSize;
+	weightBlock.offset = offset;
+	weightBlock.size = outSize * inSize;
+	biasBlock.offset = offset + weightBlock.size;
+	biasBlock.size = outSize;
+	blocks.push_back(weightBlock);
+	blocks.push_back(biasBlock);
+}
+
+void FullyConnectedLayer::initParams(RudraRand& rand) {
+	fillNormal(rand, W, outSize * inSize, initWmean, initWstd);
+	fillNormal(rand, b, outSize, initBmean, initBstd);
+}
+
+/** Split n rows into about one contiguous chunk per thread. */
+static size_t chunkRows(size_t n) {
+	const size_t threads = omp_get_max_threads();
+	return (n + threads - 1) / threads;
+}
+
+void FullyConnectedLayer::forward(const float* in, float* out, size_t batch) {
+	const size_t rows = chunkRows(batch);
+#pragma omp parallel for schedule(static)
+	for (long r0 = 0; r0 < (long) batch; r0 += rows) {
+		const size_t n = std::min(rows, batch - r0);
+		float* y = out + r0 * outSize;
+		sgemm(false, true, n, outSize, inSize, 1.0f, in + r0 * inSize, inSize,
+				W, inSize, 0.0f, y, outSize);
+		for (size_t s = 0; s < n; ++s) {
+			for (size_t o = 0; o < outSize; ++o) {
+				y[s * outSize + o] += b[o];
+			}
+		}
+	}
+	activate(out, batch);
+}
+
+void FullyConnectedLayer::backward(const float* in, const float* out,
+		float* dOut, float* dIn, size_t batch) {
+	deactivate(out, dOut, batch);
+	// weights = dOut' * in, split over the outputs
+	const size_t outs = chunkRows(outSize);
+#pragma omp parallel for schedule(static)
+	for (long o0 = 0; o0 < (long) outSize; o0 += outs) {
+		const size_t n = std::min(outs, outSize - o0);
+		sgemm(true, false, n, inSize, batch, 1.0f, dOut + o0, outSize, in,
+				inSize, 0.0f, gW + o0 * inSize, inSize);
+		for (size_t o = o0; o < o0 + n; ++o) {
+			float total = 0.0f;
+			for (size_t s = 0; s < batch; ++s) {
+				total += dOut[s * outSize + o];
+			}
+			gb[o] = total;
+		}
+	}
+	if (dIn == NULL) {
+		return;
+	}
+	// dIn = dOut * weights, split over the samples
+	const size_t rows = chunkRows(batch);
+#pragma omp parallel for schedule(static)
+	for (long r0 = 0; r0 < (long) batch; r0 += rows) {
+		const size_t n = std::min(rows, batch - r0);
+		sgemm(false, false, n, inSize, outSize, 1.0f, dOut + r0 * outSize,
+				outSize, W, inSize, 0.0f, dIn + r0 * inSize, inSize);
+	}
+}
+} /* namespace rudra */
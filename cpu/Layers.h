@@ -0,0 +1,237 @@
+/*
+ * Layers.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_CPU_LAYERS_H_
+#define RUDRA_CPU_LAYERS_H_
+
+#include "ConfigBlocks.h"
+#include "rudra/util/RudraRand.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace rudra {
+enum Activation {
+	ACT_IDENTITY, ACT_RELU, ACT_SIGMOID, ACT_TANH, ACT_SOFTMAX
+};
+
+/** The activation named by actFunc in a .cnn file; fatal if unknown. */
+Activation activationFromName(const std::string& name);
+
+/**
+ * A contiguous range of the network's parameters that share learning
+ * hyperparameters (the weights or the biases of one layer).
+ */
+struct ParamBlock {
+	size_t offset;
+	size_t size;
+	float alpha; // learning rate
+	float lambda; // weight decay
+	float mom; // momentum, for SGD
+};
+
+/**
+ * A layer of a feed-forward network, working on a minibatch at a time.
+ * Activations are stored sample by sample, and within a sample channel by
+ * channel, then row by row (C x H x W). Layers that have an actFunc apply it
+ * to their output; the network may take over the backward step of a
+ * softmax, combining it with a cross-entropy loss.
+ */
+class Layer {
+public:
+	const std::string name;
+	const size_t inSize; // per sample
+	const size_t outSize;
+	Activation act;
+	bool activationFused; // dOut is already with respect to pre-activations
+
+	Layer(const std::string& name, size_t inSize, size_t outSize);
+	virtual ~Layer() {
+	}
+
+	virtual size_t numParams() const {
+		return 0;
+	}
+
+	/**
+	 * Use the numParams() weights at w and their gradients at g, which start
+	 * at offset in the network's parameter vector, and describe them in
+	 * blocks.
+	 */
+	virtual void bindParams(float* w, float* g, size_t offset,
+			std::vector<ParamBlock>& blocks) {
+	}
+
+	virtual void initParams(RudraRand& rand) {
+	}
+
+	/** Compute out (batch x outSize) from in (batch x inSize). */
+	virtual void forward(const float* in, float* out, size_t batch) = 0;
+
+	/**
+	 * Given in and out from the last forward pass and dOut, the gradient of
+	 * the loss with respect to out, store the gradients of this layer's
+	 * parameters and, if dIn is not NULL, the gradient with respect to in.
+	 * dOut may be overwritten.
+	 */
+	virtual void backward(const float* in, const float* out, float* dOut,
+			float* dIn, size_t batch) = 0;
+
+	/** Make the layer described by block, which the network has checked. */
+	static Layer* create(const ConfigBlock& block);
+
+protected:
+	/** Apply act to out in place. */
+	void activate(float* out, size_t batch) const;
+	/** Turn dOut into the gradient with respect to pre-activations. */
+	void deactivate(const float* out, float* dOut, size_t batch) const;
+	/** Fill p with n samples of a normal distribution. */
+	static void fillNormal(RudraRand& rand, float* p, size_t n, float mean,
+			float std);
+	/** Read the hyperparameters for the weights and biases of block. */
+	void readHyperParams(const ConfigBlock& block);
+
+	ParamBlock weightBlock;
+	ParamBlock biasBlock;
+	float initWmean, initWstd, initBmean, initBstd;
+};
+
+/** input and bridge layers, which pass their input through. */
+class ReshapeLayer: public Layer {
+public:
+	ReshapeLayer(const ConfigBlock& block);
+	void forward(const float* in, float* out, size_t batch);
+	void backward(const float* in, const float* out, float* dOut, float* dIn,
+			size_t batch);
+};
+
+/** An elementwise activation function. */
+class ActivationLayer: public Layer {
+public:
+	ActivationLayer(const ConfigBlock& block);
+	void forward(const float* in, float* out, size_t batch);
+	void backward(const float* in, const float* out, float* dOut, float* dIn,
+			size_t batch);
+};
+
+/**
+ * A convolution, computed sample by sample as a matrix product of the
+ * kernels and the im2col expansion of the (padded) input, in parallel over
+ * the samples of the batch.
+ */
+class ConvLayer: public Layer {
+public:
+	ConvLayer(const ConfigBlock& block);
+	size_t numParams() const;
+	void bindParams(float* w, float* g, size_t offset,
+			std::vector<ParamBlock>& blocks);
+	void initParams(RudraRand& rand);
+	void forward(const float* in, float* out, size_t batch);
+	void backward(const float* in, const float* out, float* dOut, float* dIn,
+			size_t batch);
+
+private:
+	size_t inC, inH, inW, outC, outH, outW;
+	size_t kH, kW, padH, padW, strideH, strideW;
+	size_t colRows; // inC * kH * kW
+	float* W;
+	float* b;
+	float* gW;
+	float* gb;
+	std::vector<std::vector<float> > colBuf; // per thread
+	std::vector<std::vector<float> > gradBuf; // per thread, weights then biases
+
+	bool directInput() const;
+	void im2col(const float* in, float* col) const;
+	void col2im(const float* col, float* in) const;
+};
+
+/** Max or average pooling, over windows clipped to the input. */
+class PoolLayer: public Layer {
+public:
+	PoolLayer(const ConfigBlock& block);
+	void forward(const float* in, float* out, size_t batch);
+	void backward(const float* in, const float* out, float* dOut, float* dIn,
+			size_t batch);
+
+private:
+	bool isMax;
+	size_t C, inH, inW, outH, outW, poolH, poolW, strideH, strideW;
+	std::vector<unsigned> argMax; // input offset of each output's maximum
+};
+
+/**
+ * Local response normalization within each channel, as Caffe's
+ * WITHIN_CHANNEL LRN: each value is divided by
+ * (1 + alpha / n * (sum of squares over the n = normH x normW window
+ * around it)) ^ beta.
+ */
+class RnormLayer: public Layer {
+public:
+	RnormLayer(const ConfigBlock& block);
+	void forward(const float* in, float* out, size_t batch);
+	void backward(const float* in, const float* out, float* dOut, float* dIn,
+			size_t batch);
+
+private:
+	size_t C, H, W, normH, normW;
+	float alpha, beta;
+	std::vector<float> scale; // the denominator before the power, per value
+	std::vector<float> ratio; // dOut * out / scale, per value
+
+	void windowSum(const float* x, float* sum) const;
+};
+
+/** A fully-connected layer, computed as one matrix product per batch. */
+class FullyConnectedLayer: public Layer {
+public:
+	FullyConnectedLayer(const ConfigBlock& block);
+	size_t numParams() const;
+	void bindParams(float* w, float* g, size_t offset,
+			std::vector<ParamBlock>& blocks);
+	void initParams(RudraRand& rand);
+	void forward(const float* in, float* out, size_t batch);
+	void backward(const float* in, const float* out, float* dOut, float* dIn,
+			size_t batch);
+
+private:
+	float* W; // outSize x inSize
+	float* b;
+	float* gW;
+	float* gb;
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_CPU_LAYERS_H_ */
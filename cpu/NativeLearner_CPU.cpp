@@ -0,0 +1,484 @@
+/*
+ * NativeLearner_CPU.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rudra/NativeLearner.h"
+#include "ConfigBlocks.h"
+#include "Network.h"
+#include "Solver.h"
+#include "rudra/io/CheckpointFile.h"
+#include "rudra/io/GPFSSampleClient.h"
+#include "rudra/io/SampleReader.h"
+#include "rudra/util/GradientKernels.h"
+#include "rudra/util/Logger.h"
+#include "rudra/util/MatrixContainer.h"
+#include "rudra/util/RudraRand.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <pthread.h>
+#include <sstream>
+#include <time.h>
+#include <vector>
+
+namespace rudra {
+/** Settings shared by every learner in the process, set by the statics. */
+static struct {
+	std::string layerCfgFile;
+	std::string meanFile;
+	float inputScale;
+	float momentum; // negative to use the momentum of each layer
+	float adaDeltaRho;
+	float adaDeltaEpsilon;
+	uint64_t seed;
+	std::string jobID;
+} settings = { "", "", 1.0f, -1.0f, 0.95f, 1e-6f, 0, "" };
+
+/**
+ * The state of one NativeLearner: its network, and either a solver and a
+ * training data client or a reader for the test data.
+ *
+ * A minibatch started with startMiniBatch runs on a worker thread, created
+ * on first use and kept for the learner's lifetime so that its OpenMP
+ * threads are too. The worker publishes backprop's progress in ready under
+ * lock, and signals changed whenever it or done moves.
+ */
+class NativeLearnerImpl: public GradientObserver {
+public:
+	Network net;
+	Solver* solver;
+	SampleReader* reader;
+	GPFSSampleClient* client;
+	size_t batchSize;
+	long pid;
+	double trainSeconds;
+
+	NativeLearnerImpl(long id) :
+			net(settings.layerCfgFile), solver(NULL), reader(NULL), client(
+					NULL), batchSize(0), pid(id), trainSeconds(0.0), started(
+					false), running(false), done(false), quit(false), ready(
+					0), error(0.0f) {
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&changed, NULL);
+	}
+
+	~NativeLearnerImpl() {
+		if (started) {
+			pthread_mutex_lock(&lock);
+			quit = true;
+			pthread_cond_broadcast(&changed);
+			pthread_mutex_unlock(&lock);
+			pthread_join(worker, NULL);
+		}
+		pthread_cond_destroy(&changed);
+		pthread_mutex_destroy(&lock);
+		delete client; // before the reader its producers use
+		delete reader;
+		delete solver;
+	}
+
+	void openReader(const std::string& data, const std::string& labels,
+			size_t batch, bool randomAccess) {
+		reader = SampleReader::makeReader(data, labels, randomAccess);
+		if (reader->sizePerSample != net.inputSize) {
+			std::ostringstream msg;
+			msg << data << " has " << reader->sizePerSample
+					<< " values per sample, but the network takes "
+					<< net.inputSize;
+			Logger::logFatal(msg.str());
+		}
+		if (!settings.meanFile.empty()) {
+			reader->setMeanFile(settings.meanFile);
+		}
+		reader->setScale(settings.inputScale);
+		batchSize = batch;
+	}
+
+	/** Train with the next minibatch and return the training error. */
+	float train(GradientObserver* observer) {
+		const size_t labelSize = reader->sizePerLabel;
+		const double start = seconds();
+		float* X;
+		float* Y;
+		const size_t handle = client->acquireLabelledSamples(X, Y);
+		net.forward(X, batchSize);
+		const size_t errors = net.countErrors(Y, labelSize, batchSize);
+		const float loss = net.backward(X, Y, labelSize, batchSize,
+				observer);
+		trainSeconds = seconds() - start;
+		client->releaseLabelledSamples(handle);
+		RUDRA_LOG_INFO(
+				"NativeLearner " << pid << ": loss " << loss << ", " << errors << "/" << batchSize << " wrong");
+		return (float) errors / batchSize;
+	}
+
+	void start() {
+		pthread_mutex_lock(&lock);
+		if (running || done) {
+			pthread_mutex_unlock(&lock);
+			Logger::logFatal(
+					"NativeLearner::startMiniBatch: the last minibatch is not finished");
+		}
+		if (!started) {
+			if (pthread_create(&worker, NULL, workerMain, this) != 0) {
+				pthread_mutex_unlock(&lock);
+				Logger::logFatal(
+						"NativeLearner: failed to start the training thread");
+			}
+			started = true;
+		}
+		ready = 0;
+		running = true;
+		pthread_cond_broadcast(&changed);
+		pthread_mutex_unlock(&lock);
+	}
+
+	int waitLayers(int seen) {
+		const int all = net.getLayerOffsets().size() - 1;
+		pthread_mutex_lock(&lock);
+		if (!running && !done) {
+			pthread_mutex_unlock(&lock);
+			Logger::logFatal(
+					"NativeLearner::waitGradientLayers: no minibatch started");
+		}
+		while (!done && (int) ready <= seen) {
+			pthread_cond_wait(&changed, &lock);
+		}
+		const int r = done ? all : (int) ready;
+		pthread_mutex_unlock(&lock);
+		return r;
+	}
+
+	float finish() {
+		pthread_mutex_lock(&lock);
+		if (!running && !done) {
+			pthread_mutex_unlock(&lock);
+			Logger::logFatal(
+					"NativeLearner::finishMiniBatch: no minibatch started");
+		}
+		while (!done) {
+			pthread_cond_wait(&changed, &lock);
+		}
+		done = false;
+		const float e = error;
+		pthread_mutex_unlock(&lock);
+		return e;
+	}
+
+	/** Fatal if a minibatch is in flight: what needs the learner to itself. */
+	void checkIdle(const char* what) {
+		pthread_mutex_lock(&lock);
+		const bool busy = running || done;
+		pthread_mutex_unlock(&lock);
+		if (busy) {
+			Logger::logFatal(
+					std::string("NativeLearner::") + what
+							+ ": a minibatch is in flight");
+		}
+	}
+
+	/** Fatal if gradients is the bound gradient array. */
+	void checkUnbound(const float* gradients, const char* what) {
+		if (gradients == net.getGradients()) {
+			Logger::logFatal(
+					std::string("NativeLearner::") + what
+							+ ": cannot sum the gradients into themselves");
+		}
+	}
+
+	void layersReady(size_t n) {
+		pthread_mutex_lock(&lock);
+		ready = n;
+		pthread_cond_broadcast(&changed);
+		pthread_mutex_unlock(&lock);
+	}
+
+	static double seconds() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+
+private:
+	pthread_t worker;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	bool started; // worker exists
+	bool running; // a minibatch has been started and has not yet finished
+	bool done; // it has finished, and finishMiniBatch has not yet seen it
+	bool quit;
+	size_t ready;
+	float error;
+
+	static void* workerMain(void* arg) {
+		NativeLearnerImpl* self = (NativeLearnerImpl*) arg;
+		pthread_mutex_lock(&self->lock);
+		for (;;) {
+			while (!self->running && !self->quit) {
+				pthread_cond_wait(&self->changed, &self->lock);
+			}
+			if (self->quit) {
+				break;
+			}
+			pthread_mutex_unlock(&self->lock);
+			const float e = self->train(self);
+			pthread_mutex_lock(&self->lock);
+			self->error = e;
+			self->running = false;
+			self->done = true;
+			pthread_cond_broadcast(&self->changed);
+		}
+		pthread_mutex_unlock(&self->lock);
+		return NULL;
+	}
+};
+
+/** Resolve a file named in a .cfg file relative to the .cfg's directory. */
+static std::string relativeTo(const std::string& cfgName,
+		const std::string& fileName) {
+	const size_t slash = cfgName.rfind('/');
+	if (fileName.empty() || fileName[0] == '/' || slash == std::string::npos) {
+		return fileName;
+	}
+	std::ifstream f(fileName.c_str());
+	return f ? fileName : cfgName.substr(0, slash + 1) + fileName;
+}
+
+NativeLearner::NativeLearner(long id) :
+		pimpl_(new NativeLearnerImpl(id)), pid(id) {
+	pimpl_->net.initParams(settings.seed);
+	RUDRA_LOG_INFO(
+			"NativeLearner " << id << ": " << pimpl_->net.numParams() << " parameters from " << settings.layerCfgFile);
+}
+
+void NativeLearner::cleanup() {
+	delete pimpl_;
+	pimpl_ = NULL;
+}
+
+void NativeLearner::setLoggingLevel(int level) {
+	Logger::setLoggingLevel(level);
+}
+
+void NativeLearner::setMeanFile(std::string fileName) {
+	settings.meanFile = fileName;
+}
+
+void NativeLearner::setAdaDeltaParams(float rho, float epsilon, float drho,
+		float depsilon) {
+	settings.adaDeltaRho = rho;
+	settings.adaDeltaEpsilon = epsilon;
+}
+
+void NativeLearner::setSeed(long id, int seed, int defaultSeed) {
+	if (seed != defaultSeed) {
+		RudraRand::setDefaultSeed(seed);
+	}
+	settings.seed = RudraRand::getDefaultSeed();
+}
+
+void NativeLearner::setMoM(float mom) {
+	settings.momentum = mom;
+}
+
+void NativeLearner::setJobID(std::string jobID) {
+	settings.jobID = jobID;
+}
+
+void NativeLearner::initFromCFGFile(std::string confName) {
+	const std::vector<ConfigBlock> blocks = readConfigBlocks(confName);
+	if (blocks.size() != 1) {
+		Logger::logFatal(confName + ": expected a single { ... } block");
+	}
+	settings.layerCfgFile = relativeTo(confName,
+			blocks[0].get("layerCfgFile"));
+	settings.inputScale = blocks[0].getFloat("inputScale", 1.0f);
+}
+
+void NativeLearner::initAsLearner(std::string trainData,
+		std::string trainLabels, size_t batchSize, std::string weightsFile,
+		std::string solverType) {
+	Network& net = pimpl_->net;
+	// the client shuffles the training set; the tester reads in order
+	pimpl_->openReader(trainData, trainLabels, batchSize, true);
+	pimpl_->client = new GPFSSampleClient("train", batchSize, pimpl_->reader,
+			RudraRand(settings.seed, pid, 0));
+	pimpl_->solver = new Solver(solverType.empty() ? "sgd" : solverType,
+			net.getParamBlocks(), net.numParams(), settings.momentum,
+			settings.adaDeltaRho, settings.adaDeltaEpsilon);
+	if (weightsFile.empty()) {
+		return;
+	}
+	if (CheckpointFile::isCheckpointFile(weightsFile)) {
+		readCheckpoint(weightsFile, net.getWeights(), net.numParams());
+		return;
+	}
+	MatrixContainer<float> w = readBinMat<float>(weightsFile);
+	if (w.dimM * w.dimN != net.numParams()) {
+		Logger::logFatal(weightsFile + " does not match the network size");
+	}
+	memcpy(net.getWeights(), w.buf, net.numParams() * sizeof(float));
+}
+
+void NativeLearner::initAsTester(std::string testData, std::string testLabels,
+		size_t batchSize, std::string solverType) {
+	pimpl_->openReader(testData, testLabels, batchSize, false);
+}
+
+int NativeLearner::getNetworkSize() {
+	return pimpl_->net.numParams();
+}
+
+float NativeLearner::trainMiniBatch() {
+	return pimpl_->train(NULL);
+}
+
+bool NativeLearner::supportsLayerGradients() {
+	return true;
+}
+
+int NativeLearner::getNumGradientLayers() {
+	return pimpl_->net.getLayerOffsets().size() - 1;
+}
+
+void NativeLearner::getGradientLayerOffsets(long* offsets) {
+	const std::vector<size_t>& o = pimpl_->net.getLayerOffsets();
+	std::copy(o.begin(), o.end(), offsets);
+}
+
+void NativeLearner::startMiniBatch() {
+	pimpl_->start();
+}
+
+int NativeLearner::waitGradientLayers(int ready) {
+	return pimpl_->waitLayers(ready);
+}
+
+float NativeLearner::finishMiniBatch() {
+	return pimpl_->finish();
+}
+
+void NativeLearner::getGradientRange(float* gradients, long lo, long hi) {
+	if (gradients != pimpl_->net.getGradients()) {
+		memcpy(gradients + lo, pimpl_->net.getGradients() + lo,
+				(hi - lo) * sizeof(float));
+	}
+}
+
+void NativeLearner::accumulateGradientRange(float* gradients, long lo,
+		long hi) {
+	pimpl_->checkUnbound(gradients, "accumulateGradientRange");
+	addInto(pimpl_->net.getGradients() + lo, gradients + lo, hi - lo);
+}
+
+double NativeLearner::getTrainSeconds() {
+	return pimpl_->trainSeconds;
+}
+
+void NativeLearner::getGradients(float* gradients) {
+	if (gradients != pimpl_->net.getGradients()) {
+		memcpy(gradients, pimpl_->net.getGradients(),
+				pimpl_->net.numParams() * sizeof(float));
+	}
+}
+
+void NativeLearner::accumulateGradients(float* gradients) {
+	pimpl_->checkUnbound(gradients, "accumulateGradients");
+	addInto(pimpl_->net.getGradients(), gradients, pimpl_->net.numParams());
+}
+
+void NativeLearner::checkpoint(std::string outputFileName) {
+	writeCheckpoint(outputFileName, pimpl_->net.getWeights(),
+			pimpl_->net.numParams());
+}
+
+void NativeLearner::serializeWeights(float* weights) {
+	if (weights != pimpl_->net.getWeights()) {
+		memcpy(weights, pimpl_->net.getWeights(),
+				pimpl_->net.numParams() * sizeof(float));
+	}
+}
+
+void NativeLearner::deserializeWeights(float* weights) {
+	if (weights != pimpl_->net.getWeights()) {
+		memcpy(pimpl_->net.getWeights(), weights,
+				pimpl_->net.numParams() * sizeof(float));
+	}
+}
+
+bool NativeLearner::supportsZeroCopy() {
+	return true;
+}
+
+void NativeLearner::bindWeights(float* weights) {
+	pimpl_->checkIdle("bindWeights");
+	pimpl_->net.useWeights(weights);
+}
+
+void NativeLearner::bindGradients(float* gradients) {
+	pimpl_->checkIdle("bindGradients");
+	pimpl_->net.useGradients(gradients);
+}
+
+void NativeLearner::setLearningRateMultiplier(float lrMultiplier) {
+	pimpl_->solver->setLearningRateMultiplier(lrMultiplier);
+}
+
+void NativeLearner::acceptGradients(float* gradients, const float multiplier) {
+	pimpl_->solver->update(pimpl_->net.getWeights(), gradients, multiplier);
+}
+
+float NativeLearner::testOneEpoch(float* weights) {
+	Network& net = pimpl_->net;
+	SampleReader* reader = pimpl_->reader;
+	deserializeWeights(weights);
+	// read the test set straight through, so every sample is scored once
+	const size_t batch = pimpl_->batchSize;
+	std::vector<float> X(batch * reader->sizePerSample);
+	std::vector<float> Y(batch * reader->sizePerLabel);
+	std::vector<size_t> idx;
+	size_t errors = 0;
+	for (size_t first = 0; first < reader->numSamples; first += batch) {
+		const size_t n = std::min(batch, reader->numSamples - first);
+		idx.resize(n);
+		for (size_t i = 0; i < n; ++i) {
+			idx[i] = first + i;
+		}
+		reader->readLabelledSamples(idx, &X[0], &Y[0]);
+		net.forward(&X[0], n);
+		errors += net.countErrors(&Y[0], reader->sizePerLabel, n);
+	}
+	return reader->numSamples ? (float) errors / reader->numSamples : 0.0f;
+}
+} // namespace rudra
@@ -0,0 +1,238 @@
+/*
+ * Network.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Network.h"
+#include "rudra/util/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace rudra {
+Network::Network(const std::string& cnnFileName) :
+		inputSize(0), outputSize(0), loss(LOSS_CROSS_ENTROPY), firstTrained(
+				0), lastBatch(0) {
+	const std::vector<ConfigBlock> blocks = readConfigBlocks(cnnFileName);
+	if (blocks.size() < 2) {
+		Logger::logFatal(
+				cnnFileName + ": a network needs a layer and an output");
+	}
+	for (size_t i = 0; i + 1 < blocks.size(); ++i) {
+		Layer* layer = Layer::create(blocks[i]);
+		if (!layers.empty() && layers.back()->outSize != layer->inSize) {
+			std::ostringstream msg;
+			msg << cnnFileName << ": " << layer->name << " takes "
+					<< layer->inSize << " inputs, but " << layers.back()->name
+					<< " has " << layers.back()->outSize << " outputs";
+			Logger::logFatal(msg.str());
+		}
+		layers.push_back(layer);
+	}
+
+	const ConfigBlock& out = blocks.back();
+	if (out.get("layerType") != "output") {
+		Logger::logFatal(cnnFileName + ": the last layer must be the output");
+	}
+	const std::vector<size_t> dims = out.getDims("dimInput", 3);
+	if (layers.back()->outSize != dims[0] * dims[1] * dims[2]) {
+		Logger::logFatal(
+				cnnFileName + ": the output size does not match the last layer");
+	}
+	inputSize = layers.front()->inSize;
+	outputSize = layers.back()->outSize;
+	const std::string errFunc = out.get("errFunc", "cross-entropy");
+	if (errFunc == "cross-entropy") {
+		loss = LOSS_CROSS_ENTROPY;
+		// softmax followed by cross-entropy has the simple delta p - t
+		layers.back()->activationFused = layers.back()->act == ACT_SOFTMAX;
+	} else if (errFunc == "squared") {
+		loss = LOSS_SQUARED;
+	} else {
+		Logger::logFatal(cnnFileName + ": unknown errFunc " + errFunc);
+	}
+
+	size_t total = 0;
+	for (size_t i = 0; i < layers.size(); ++i) {
+		total += layers[i]->numParams();
+	}
+	weights.resize(total);
+	gradients.resize(total);
+	weightStore = &weights[0];
+	gradientStore = &gradients[0];
+	firstTrained = layers.size();
+	size_t offset = 0;
+	for (size_t i = 0; i < layers.size(); ++i) {
+		if (layers[i]->numParams() == 0) {
+			continue;
+		}
+		firstTrained = std::min(firstTrained, i);
+		layers[i]->bindParams(&weights[offset], &gradients[offset], offset,
+				paramBlocks);
+		layerOffsets.push_back(offset);
+		offset += layers[i]->numParams();
+	}
+	layerOffsets.push_back(offset);
+	outputs.resize(layers.size());
+	deltas.resize(layers.size());
+}
+
+void Network::bindLayers() {
+	std::vector<ParamBlock> blocks; // the same as paramBlocks
+	for (size_t i = firstTrained, l = 0; i < layers.size(); ++i) {
+		if (layers[i]->numParams() == 0) {
+			continue;
+		}
+		const size_t offset = layerOffsets[l++];
+		layers[i]->bindParams(weightStore + offset, gradientStore + offset,
+				offset, blocks);
+	}
+}
+
+void Network::useWeights(float* w) {
+	float* store = w != NULL ? w : &weights[0];
+	if (store != weightStore) {
+		std::copy(weightStore, weightStore + numParams(), store);
+		weightStore = store;
+		bindLayers();
+	}
+}
+
+void Network::useGradients(float* g) {
+	float* store = g != NULL ? g : &gradients[0];
+	if (store != gradientStore) {
+		gradientStore = store;
+		bindLayers();
+	}
+}
+
+Network::~Network() {
+	for (size_t i = 0; i < layers.size(); ++i) {
+		delete layers[i];
+	}
+}
+
+void Network::initParams(uint64_t seed) {
+	for (size_t i = 0; i < layers.size(); ++i) {
+		// one stream per layer, so adding a layer does not change the others
+		RudraRand rand(seed, 0, 0, i + 1);
+		layers[i]->initParams(rand);
+	}
+}
+
+const float* Network::forward(const float* X, size_t batch) {
+	const float* in = X;
+	for (size_t i = 0; i < layers.size(); ++i) {
+		outputs[i].resize(batch * layers[i]->outSize);
+		layers[i]->forward(in, &outputs[i][0], batch);
+		in = &outputs[i][0];
+	}
+	lastBatch = batch;
+	return in;
+}
+
+size_t Network::targetClass(const float* y, size_t labelSize) {
+	if (labelSize == 1) {
+		return (size_t) y[0];
+	}
+	return std::max_element(y, y + labelSize) - y;
+}
+
+size_t Network::countErrors(const float* Y, size_t labelSize,
+		size_t n) const {
+	const float* out = &outputs.back()[0];
+	size_t errors = 0;
+	for (size_t s = 0; s < n && s < lastBatch; ++s) {
+		const float* p = out + s * outputSize;
+		const size_t guess = std::max_element(p, p + outputSize) - p;
+		if (guess != targetClass(Y + s * labelSize, labelSize)) {
+			++errors;
+		}
+	}
+	return errors;
+}
+
+float Network::backward(const float* X, const float* Y, size_t labelSize,
+		size_t batch, GradientObserver* observer) {
+	if (batch != lastBatch) {
+		Logger::logFatal("Network::backward: not the batch of forward()");
+	}
+	if (labelSize != 1 && labelSize != outputSize) {
+		Logger::logFatal("Network::backward: labels do not match the output");
+	}
+	const float* out = &outputs.back()[0];
+	std::vector<float>& delta = deltas.back();
+	delta.resize(batch * outputSize);
+	const float inv = 1.0f / batch;
+	double total = 0.0;
+	for (size_t s = 0; s < batch; ++s) {
+		const float* p = out + s * outputSize;
+		const float* y = Y + s * labelSize;
+		const size_t cls = labelSize == 1 ? (size_t) y[0] : outputSize;
+		if (labelSize == 1 && cls >= outputSize) {
+			Logger::logFatal("Network::backward: label out of range");
+		}
+		float* d = &delta[s * outputSize];
+		for (size_t i = 0; i < outputSize; ++i) {
+			const float t = labelSize == 1 ? (i == cls ? 1.0f : 0.0f) : y[i];
+			if (loss == LOSS_SQUARED) {
+				total += 0.5 * (p[i] - t) * (p[i] - t);
+				d[i] = (p[i] - t) * inv;
+				continue;
+			}
+			const float q = std::max(p[i], 1e-10f);
+			if (t != 0.0f) {
+				total -= t * log(q);
+			}
+			d[i] = layers.back()->activationFused ?
+					(p[i] - t) * inv : -t / q * inv;
+		}
+	}
+
+	// layers before the first with parameters need no input gradient
+	size_t ready = 0;
+	for (size_t i = layers.size(); i-- > firstTrained;) {
+		const float* in = i == 0 ? X : &outputs[i - 1][0];
+		float* dIn = NULL;
+		if (i > firstTrained) {
+			deltas[i - 1].resize(batch * layers[i]->inSize);
+			dIn = &deltas[i - 1][0];
+		}
+		layers[i]->backward(in, &outputs[i][0], &deltas[i][0], dIn, batch);
+		if (observer != NULL && layers[i]->numParams() > 0) {
+			observer->layersReady(++ready);
+		}
+	}
+	return (float) (total * inv);
+}
+} /* namespace rudra */
@@ -0,0 +1,166 @@
+/*
+ * Network.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_CPU_NETWORK_H_
+#define RUDRA_CPU_NETWORK_H_
+
+#include "Layers.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace rudra {
+/**
+ * Told by Network::backward() as it finishes the gradients of each layer
+ * with parameters. Layers finish last first, so the ready gradients are
+ * always a suffix of the parameter vector.
+ */
+class GradientObserver {
+public:
+	virtual ~GradientObserver() {
+	}
+
+	/**
+	 * The gradients of the last ready layers with parameters are final.
+	 * Called on the thread running backward(), so it should return quickly.
+	 */
+	virtual void layersReady(size_t ready) = 0;
+};
+
+/**
+ * A feed-forward network read from a .cnn file: a chain of layers whose
+ * parameters live in one contiguous vector, in layer order and with each
+ * layer's weights before its biases, so that the whole model can be handed
+ * to Rudra as a flat array. The last block of the file must be the output
+ * layer, which names the loss (errFunc) rather than computing anything.
+ *
+ * Gradients are those of the mean loss over the minibatch, without weight
+ * decay, which is left to the Solver.
+ */
+class Network {
+public:
+	/** The number of values per sample and label the network expects. */
+	size_t inputSize;
+	size_t outputSize;
+
+	Network(const std::string& cnnFileName);
+	~Network();
+
+	size_t numParams() const {
+		return weights.size();
+	}
+
+	float* getWeights() {
+		return weightStore;
+	}
+
+	const float* getGradients() const {
+		return gradientStore;
+	}
+
+	/**
+	 * Keep the weights in the numParams() floats at w from now on, starting
+	 * from the current weights, which are copied there; NULL goes back to
+	 * the network's own storage, copying them back. w must outlive its use.
+	 */
+	void useWeights(float* w);
+
+	/**
+	 * Have backward() write the gradients to the numParams() floats at g
+	 * from now on, or to the network's own storage if g is NULL. Nothing is
+	 * copied: the gradients are only defined after the next backward().
+	 */
+	void useGradients(float* g);
+
+	const std::vector<ParamBlock>& getParamBlocks() const {
+		return paramBlocks;
+	}
+
+	/**
+	 * Where the parameters of each layer that has any start, in layer order,
+	 * followed by numParams().
+	 */
+	const std::vector<size_t>& getLayerOffsets() const {
+		return layerOffsets;
+	}
+
+	/** Draw the initial weights of each layer from its init* parameters. */
+	void initParams(uint64_t seed);
+
+	/** Compute and return the output for a minibatch of samples. */
+	const float* forward(const float* X, size_t batch);
+
+	/**
+	 * The number of the first n samples of the last forward() whose most
+	 * likely class is not the one in their labels. A label is either a
+	 * class index (labelSize 1) or a vector of outputSize targets.
+	 */
+	size_t countErrors(const float* Y, size_t labelSize, size_t n) const;
+
+	/**
+	 * Compute the gradients for the minibatch of the last forward(), which
+	 * must have been given X, and return the mean loss. If observer is not
+	 * NULL it is told as each layer's gradients become final.
+	 */
+	float backward(const float* X, const float* Y, size_t labelSize,
+			size_t batch, GradientObserver* observer = NULL);
+
+private:
+	enum Loss {
+		LOSS_CROSS_ENTROPY, LOSS_SQUARED
+	};
+
+	std::vector<Layer*> layers;
+	Loss loss;
+	std::vector<float> weights;
+	std::vector<float> gradients;
+	float* weightStore; // &weights[0], or the caller's storage
+	float* gradientStore;
+	std::vector<ParamBlock> paramBlocks;
+	std::vector<size_t> layerOffsets;
+	std::vector<std::vector<float> > outputs; // per layer, batch * outSize
+	std::vector<std::vector<float> > deltas; // gradient wrt each output
+	size_t firstTrained; // index of the first layer with parameters
+	size_t lastBatch;
+
+	static size_t targetClass(const float* y, size_t labelSize);
+	/** Point each layer at its parameters in weightStore, gradientStore. */
+	void bindLayers();
+	Network(const Network&);
+	Network& operator=(const Network&);
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_CPU_NETWORK_H_ */
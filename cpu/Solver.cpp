@@ -0,0 +1,106 @@
+/*
+ * Solver.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Solver.h"
+#include "rudra/util/Logger.h"
+#include <cmath>
+
+namespace rudra {
+Solver::Solver(const std::string& type, const std::vector<ParamBlock>& blocks,
+		size_t numParams, float momentum, float rho, float epsilon) :
+		type(SGD), blocks(blocks), rho(rho), epsilon(epsilon), lrMult(1.0f), history(
+				numParams, 0.0f) {
+	if (type == "sgd") {
+		this->type = SGD;
+	} else if (type == "adagrad") {
+		this->type = ADAGRAD;
+	} else if (type == "adadelta") {
+		this->type = ADADELTA;
+		updates.assign(numParams, 0.0f);
+	} else {
+		Logger::logFatal("unknown solver type " + type);
+	}
+	if (momentum >= 0.0f) {
+		for (size_t b = 0; b < this->blocks.size(); ++b) {
+			this->blocks[b].mom = momentum;
+		}
+	}
+}
+
+void Solver::update(float* weights, const float* gradients,
+		float multiplier) {
+	for (size_t b = 0; b < blocks.size(); ++b) {
+		const ParamBlock& block = blocks[b];
+		const float rate = block.alpha * lrMult;
+		const float lambda = block.lambda;
+		const float mom = block.mom;
+		float* w = weights + block.offset;
+		const float* grad = gradients + block.offset;
+		float* h = &history[block.offset];
+		const long n = (long) block.size;
+		switch (type) {
+		case SGD:
+#pragma omp parallel for schedule(static)
+			for (long i = 0; i < n; ++i) {
+				const float g = multiplier * grad[i] + lambda * w[i];
+				h[i] = mom * h[i] - rate * g;
+				w[i] += h[i];
+			}
+			break;
+		case ADAGRAD:
+#pragma omp parallel for schedule(static)
+			for (long i = 0; i < n; ++i) {
+				const float g = multiplier * grad[i] + lambda * w[i];
+				h[i] += g * g;
+				w[i] -= rate * g / (sqrtf(h[i]) + epsilon);
+			}
+			break;
+		case ADADELTA: {
+			float* u = &updates[block.offset];
+#pragma omp parallel for schedule(static)
+			for (long i = 0; i < n; ++i) {
+				const float g = multiplier * grad[i] + lambda * w[i];
+				h[i] = rho * h[i] + (1.0f - rho) * g * g;
+				const float step = sqrtf(u[i] + epsilon)
+						/ sqrtf(h[i] + epsilon) * g;
+				u[i] = rho * u[i] + (1.0f - rho) * step * step;
+				w[i] -= lrMult * step;
+			}
+			break;
+		}
+		}
+	}
+}
+} /* namespace rudra */
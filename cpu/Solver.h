@@ -0,0 +1,85 @@
+/*
+ * Solver.h
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RUDRA_CPU_SOLVER_H_
+#define RUDRA_CPU_SOLVER_H_
+
+#include "Layers.h"
+#include <string>
+#include <vector>
+
+namespace rudra {
+/**
+ * Applies gradients to the weights of a Network, block by block with each
+ * block's learning rate (alpha), weight decay (lambda) and momentum.
+ * The solver type is one of
+ *   sgd      - SGD with momentum: v = mom * v - rate * (g + lambda * w)
+ *   adagrad  - rate * g / sqrt(sum of g^2), with weight decay in g
+ *   adadelta - Zeiler's AdaDelta, with decay rho and conditioner epsilon,
+ *              scaled by the learning rate multiplier but not by alpha
+ * where g is the incoming gradient times the multiplier passed to update(),
+ * and rate is alpha times the learning rate multiplier.
+ */
+class Solver {
+public:
+	/**
+	 * @param momentum if not negative, overrides the momentum of every block
+	 */
+	Solver(const std::string& type, const std::vector<ParamBlock>& blocks,
+			size_t numParams, float momentum, float rho, float epsilon);
+
+	void setLearningRateMultiplier(float lrMultiplier) {
+		lrMult = lrMultiplier;
+	}
+
+	/** Update weights with multiplier * gradients. */
+	void update(float* weights, const float* gradients, float multiplier);
+
+private:
+	enum Type {
+		SGD, ADAGRAD, ADADELTA
+	};
+
+	Type type;
+	std::vector<ParamBlock> blocks;
+	float rho;
+	float epsilon;
+	float lrMult;
+	std::vector<float> history; // velocity, or accumulated squared gradient
+	std::vector<float> updates; // accumulated squared update, for AdaDelta
+};
+} /* namespace rudra */
+
+#endif /* RUDRA_CPU_SOLVER_H_ */
@@ -0,0 +1,458 @@
+/*
+ * CpuLearnerBench.cpp
+ *
+ * Rudra Distributed Learning Platform
+ *
+ * Copyright (c) IBM Corporation 2016
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of Rudra nor the names of its contributors may be used
+ *   to endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY,OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Gemm.h"
+#include "Network.h"
+#include "rudra/NativeLearner.h"
+#include "rudra/io/SyntheticData.h"
+#include "rudra/util/RudraRand.h"
+#include "rudra/util/SimdDispatch.h"
+#include "BenchHarness.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace rudra;
+
+/**
+ * Check the CPU learner: sgemm against a naive product for every transpose
+ * combination at every SIMD level, the gradients of a small network using
+ * every layer type against finite differences, and that training through
+ * the NativeLearner API on synthetic data brings the test error down,
+ * with every other minibatch run in the background and its gradients taken
+ * layer by layer as they become ready, and that a learner keeping its
+ * weights and gradients in bound arrays trains exactly as one that copies
+ * them. Then report sgemm GFLOPS, the
+ * forward+backward throughput of the given .cnn network on random input,
+ * in samples per second, and how far into backward each layer's gradients
+ * are ready.
+ * Writes its scratch files to dir.
+ * Usage: CpuLearnerBench [dir=/tmp] [cnn=../examples/lenet_mnist.cnn]
+ *                        [batch=64]
+ */
+static void fillUniform(RudraRand& rand, std::vector<float>& v) {
+	for (size_t i = 0; i < v.size(); ++i) {
+		v[i] = (float) (2.0 * rand.nextDouble() - 1.0);
+	}
+}
+
+static void naiveGemm(bool transA, bool transB, size_t M, size_t N,
+		size_t K, float alpha, const float* A, size_t lda, const float* B,
+		size_t ldb, float beta, float* C, size_t ldc) {
+	for (size_t i = 0; i < M; ++i) {
+		for (size_t j = 0; j < N; ++j) {
+			double total = 0.0;
+			for (size_t k = 0; k < K; ++k) {
+				total += (double) (transA ? A[k * lda + i] : A[i * lda + k])
+						* (transB ? B[j * ldb + k] : B[k * ldb + j]);
+			}
+			C[i * ldc + j] = alpha * total + beta * C[i * ldc + j];
+		}
+	}
+}
+
+static void checkGemm() {
+	// sizes straddling the register and cache blocks, with padded strides
+	static const size_t sizes[][3] = { { 1, 1, 1 }, { 7, 17, 5 }, { 37, 53,
+			71 }, { 130, 35, 300 } };
+	RudraRand rand(1, 0, 0);
+	const SimdLevel best = simdLevel();
+	for (int level = SIMD_SCALAR; level <= best; ++level) {
+		setSimdLevel((SimdLevel) level);
+		for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+			const size_t M = sizes[s][0], N = sizes[s][1], K = sizes[s][2];
+			for (int t = 0; t < 4; ++t) {
+				const bool tA = t & 1, tB = t & 2;
+				const size_t lda = (tA ? M : K) + 3, ldb = (tB ? K : N) + 1;
+				const size_t ldc = N + 2;
+				std::vector<float> A((tA ? K : M) * lda), B((tB ? N : K) * ldb);
+				std::vector<float> C(M * ldc), expected;
+				fillUniform(rand, A);
+				fillUniform(rand, B);
+				fillUniform(rand, C);
+				expected = C;
+				const float beta = t == 3 ? 0.0f : 0.5f;
+				if (beta == 0.0f) {
+					for (size_t i = 0; i < C.size(); ++i) {
+						C[i] = NAN; // beta 0 must not read C
+					}
+				}
+				sgemm(tA, tB, M, N, K, 1.5f, &A[0], lda, &B[0], ldb, beta,
+						&C[0], ldc);
+				naiveGemm(tA, tB, M, N, K, 1.5f, &A[0], lda, &B[0], ldb, beta,
+						&expected[0], ldc);
+				double worst = 0.0;
+				for (size_t i = 0; i < M; ++i) {
+					for (size_t j = 0; j < N; ++j) {
+						const double e = fabs(C[i * ldc + j] - expected[i * ldc + j]);
+						worst = e > worst || e != e ? e : worst;
+					}
+				}
+				char what[128];
+				snprintf(what, sizeof(what), "sgemm %s %zux%zux%zu t%d",
+						sgemmKernelName(), M, N, K, t);
+				check(worst < 1e-4 * K, what);
+			}
+		}
+	}
+	setSimdLevel(best);
+}
+
+static void benchGemm() {
+	const size_t n = 512;
+	RudraRand rand(2, 0, 0);
+	std::vector<float> A(n * n), B(n * n), C(n * n);
+	fillUniform(rand, A);
+	fillUniform(rand, B);
+	const SimdLevel best = simdLevel();
+	const SimdLevel levels[2] = { SIMD_SCALAR, best };
+	for (int l = 0; l < (best == SIMD_SCALAR ? 1 : 2); ++l) {
+		setSimdLevel(levels[l]);
+		sgemm(false, false, n, n, n, 1.0f, &A[0], n, &B[0], n, 0.0f, &C[0], n);
+		const int reps = 5;
+		const double t0 = now();
+		for (int r = 0; r < reps; ++r) {
+			sgemm(false, false, n, n, n, 1.0f, &A[0], n, &B[0], n, 0.0f, &C[0],
+					n);
+		}
+		const double t = now() - t0;
+		printf("sgemm %zu^3 %-7s %8.1f GFLOPS\n", n, sgemmKernelName(),
+				2.0 * n * n * n * reps / t * 1e-9);
+	}
+	setSimdLevel(best);
+}
+
+static void writeFile(const std::string& name, const char* text) {
+	std::ofstream f(name.c_str());
+	f << text;
+}
+
+/** Every layer type, small enough for finite differences. */
+static const char* GRADCHECK_CNN = "{\n"
+		"layerName = input\nlayerType = input\ndimInput = 7 6 2\n}\n"
+		"{\nlayerName = conv1\nlayerType = conv\nactFunc = tanh\n"
+		"dimInput = 7 6 2\ndimOutput = 7 6 3\ndimKernel = 3 3\n"
+		"dimInputPad = 1 1\ninitWstd = 0.3\ninitBstd = 0.1\n}\n"
+		"{\nlayerName = pool1\nlayerType = pool\npoolFunc = max\n"
+		"dimInput = 7 6 3\ndimOutput = 3 3 3\ndimPool = 3 2\n"
+		"dimStride = 2 2\n}\n"
+		"{\nlayerName = norm1\nlayerType = rnorm\ndimInput = 3 3 3\n"
+		"dimNorm = 3 3\nalpha = 0.5\nbeta = 0.75\n}\n"
+		"{\nlayerName = conv2\nlayerType = conv\nactFunc = identity\n"
+		"dimInput = 3 3 3\ndimOutput = 3 3 4\ndimKernel = 1 1\n"
+		"initWstd = 0.5\n}\n"
+		"{\nlayerName = act2\nlayerType = activation\nactFunc = sigmoid\n"
+		"dimInput = 3 3 4\n}\n"
+		"{\nlayerName = pool2\nlayerType = pool\npoolFunc = avg\n"
+		"dimInput = 3 3 4\ndimOutput = 2 2 4\ndimPool = 2 2\n"
+		"dimStride = 2 2\n}\n"
+		"{\nlayerName = bridge\nlayerType = bridge\ndimInput = 2 2 4\n"
+		"dimOutput = 16\n}\n"
+		"{\nlayerName = fc1\nlayerType = fully-connected\nactFunc = relu\n"
+		"dimInput = 16\ndimOutput = 9\ninitWstd = 0.5\ninitBmean = 0.1\n}\n"
+		"{\nlayerName = fc2\nlayerType = fully-connected\nactFunc = softmax\n"
+		"dimInput = 9\ndimOutput = 5\ninitWstd = 0.5\n}\n"
+		"{\nlayerName = output\nlayerType = output\ndimInput = 5\n"
+		"errFunc = cross-entropy\n}\n";
+
+static void checkGradients(const std::string& dir) {
+	const std::string cnn = dir + "/cpubench_gradcheck.cnn";
+	writeFile(cnn, GRADCHECK_CNN);
+	Network net(cnn);
+	net.initParams(3);
+	const size_t batch = 4;
+	RudraRand rand(4, 0, 0);
+	std::vector<float> X(batch * net.inputSize), Y(batch);
+	fillUniform(rand, X);
+	for (size_t s = 0; s < batch; ++s) {
+		Y[s] = (float) rand.uniform(net.outputSize);
+	}
+	net.forward(&X[0], batch);
+	net.backward(&X[0], &Y[0], 1, batch);
+	const std::vector<float> analytic(net.getGradients(),
+			net.getGradients() + net.numParams());
+
+	float* w = net.getWeights();
+	const float h = 2e-3f;
+	size_t bad = 0, tried = 0;
+	for (size_t i = 0; i < net.numParams(); i += 1 + rand.uniform(4)) {
+		const float saved = w[i];
+		w[i] = saved + h;
+		net.forward(&X[0], batch);
+		const double up = net.backward(&X[0], &Y[0], 1, batch);
+		w[i] = saved - h;
+		net.forward(&X[0], batch);
+		const double down = net.backward(&X[0], &Y[0], 1, batch);
+		w[i] = saved;
+		const double numeric = (up - down) / (2 * h);
+		const double err = fabs(numeric - analytic[i])
+				/ std::max(1e-2, fabs(numeric) + fabs(analytic[i]));
+		if (err > 5e-2) {
+			if (bad < 5) {
+				printf("param %zu: numeric %g, analytic %g\n", i, numeric,
+						analytic[i]);
+			}
+			++bad;
+		}
+		++tried;
+	}
+	printf("gradient check: %zu of %zu parameters differ\n", bad, tried);
+	// a max pool may switch inputs under a perturbation; allow a few
+	check(bad * 100 <= tried, "gradients match finite differences");
+}
+
+/** A small convolutional network for the 8x8 synthetic samples. */
+static const char* TRAIN_CNN = "{\n"
+		"layerName = input\nlayerType = input\ndimInput = 8 8 1\n}\n"
+		"{\nlayerName = conv1\nlayerType = conv\nactFunc = relu\n"
+		"dimInput = 8 8 1\ndimOutput = 8 8 8\ndimKernel = 3 3\n"
+		"dimInputPad = 1 1\ninitWstd = 0.1\nalphaW = 0.05\nmomW = 0.9\n}\n"
+		"{\nlayerName = pool1\nlayerType = pool\npoolFunc = max\n"
+		"dimInput = 8 8 8\ndimOutput = 4 4 8\ndimPool = 2 2\n}\n"
+		"{\nlayerName = bridge\nlayerType = bridge\ndimInput = 4 4 8\n"
+		"dimOutput = 128\n}\n"
+		"{\nlayerName = fc1\nlayerType = fully-connected\nactFunc = softmax\n"
+		"dimInput = 128\ndimOutput = 10\ninitWstd = 0.05\nalphaW = 0.05\n"
+		"momW = 0.9\n}\n"
+		"{\nlayerName = output\nlayerType = output\ndimInput = 10\n"
+		"errFunc = cross-entropy\n}\n";
+
+static void checkTraining(const std::string& dir) {
+	const std::string cnn = dir + "/cpubench_train.cnn";
+	const std::string cfg = dir + "/cpubench_train.cfg";
+	const std::string data = dir + "/cpubench_x.bin";
+	const std::string labels = dir + "/cpubench_y.bin";
+	writeFile(cnn, TRAIN_CNN);
+	writeFile(cfg, ("{\nlayerCfgFile = " + cnn + "\n}\n").c_str());
+	writeSyntheticData(data, labels, 2000, 64, 10, 5);
+
+	NativeLearner::setSeed(0, 7, 12345);
+	NativeLearner::initFromCFGFile(cfg);
+	NativeLearner learner(0);
+	learner.initAsLearner(data, labels, 32, "", "sgd");
+	NativeLearner tester(1);
+	tester.initAsTester(data, labels, 100, "sgd");
+	const size_t n = learner.getNetworkSize();
+	std::vector<float> weights(n), grads(n);
+
+	learner.serializeWeights(&weights[0]);
+	const float before = tester.testOneEpoch(&weights[0]);
+	const double t0 = now();
+	const int batches = 300;
+	check(learner.supportsLayerGradients(), "supportsLayerGradients");
+	const int layers = learner.getNumGradientLayers();
+	std::vector<long> offsets(layers + 1);
+	learner.getGradientLayerOffsets(&offsets[0]);
+	check(offsets[0] == 0 && offsets[layers] == (long) n, "layer offsets");
+	std::vector<float> whole(n);
+	bool same = true, ordered = true;
+	for (int b = 0; b < batches; ++b) {
+		if (b % 2 == 0) {
+			learner.trainMiniBatch();
+			learner.getGradients(&grads[0]);
+			learner.acceptGradients(&grads[0], 1.0f);
+			continue;
+		}
+		// take each layer as soon as it is ready, as an overlapped
+		// reducer would; it must already hold its final gradients
+		learner.startMiniBatch();
+		for (int ready = 0; ready < layers;) {
+			const int r = learner.waitGradientLayers(ready);
+			ordered = ordered && r > ready && r <= layers;
+			learner.getGradientRange(&grads[0], offsets[layers - r],
+					offsets[layers - ready]);
+			ready = r;
+		}
+		learner.finishMiniBatch();
+		learner.getGradients(&whole[0]);
+		same = same && memcmp(&grads[0], &whole[0], n * sizeof(float)) == 0;
+		learner.acceptGradients(&grads[0], 1.0f);
+	}
+	const double t = now() - t0;
+	check(ordered, "waitGradientLayers makes progress");
+	check(same, "gradients taken per layer match getGradients");
+	learner.serializeWeights(&weights[0]);
+	const float after = tester.testOneEpoch(&weights[0]);
+	printf("training: test error %.3f -> %.3f after %d batches"
+			" (%.0f samples/s)\n", before, after, batches, batches * 32 / t);
+	check(after < 0.5f * before && after < 0.2f, "training lowers the error");
+	learner.cleanup();
+	tester.cleanup();
+}
+
+/**
+ * Train two learners on the same minibatches, one copying its gradients and
+ * weights out as Rudra does by default, the other with them bound to the
+ * arrays they are exchanged through, and check that the weights agree
+ * exactly. Needs the files written by checkTraining.
+ */
+static void checkZeroCopy(const std::string& dir) {
+	const std::string data = dir + "/cpubench_x.bin";
+	const std::string labels = dir + "/cpubench_y.bin";
+	NativeLearner copying(2), bound(2); // the same pid draws the same samples
+	copying.initAsLearner(data, labels, 32, "", "sgd");
+	bound.initAsLearner(data, labels, 32, "", "sgd");
+	const size_t n = copying.getNetworkSize();
+	std::vector<float> weights(n), grads(n), boundWeights(n), boundGrads(n);
+	copying.serializeWeights(&weights[0]);
+	bound.deserializeWeights(&weights[0]);
+	check(bound.supportsZeroCopy(), "supportsZeroCopy");
+	bound.bindWeights(&boundWeights[0]);
+	bound.bindGradients(&boundGrads[0]);
+	check(memcmp(&weights[0], &boundWeights[0], n * sizeof(float)) == 0,
+			"bindWeights copies the weights in");
+	const int batches = 50;
+	const int layers = bound.getNumGradientLayers();
+	std::vector<long> offsets(layers + 1);
+	bound.getGradientLayerOffsets(&offsets[0]);
+	for (int b = 0; b < batches; ++b) {
+		copying.trainMiniBatch();
+		copying.getGradients(&grads[0]);
+		copying.acceptGradients(&grads[0], 1.0f);
+		copying.serializeWeights(&weights[0]);
+		copying.deserializeWeights(&weights[0]);
+		if (b % 2 == 0) {
+			bound.trainMiniBatch();
+		} else {
+			bound.startMiniBatch();
+			for (int ready = 0; ready < layers;) {
+				const int r = bound.waitGradientLayers(ready);
+				bound.getGradientRange(&boundGrads[0], offsets[layers - r],
+						offsets[layers - ready]);
+				ready = r;
+			}
+			bound.finishMiniBatch();
+		}
+		bound.getGradients(&boundGrads[0]); // no copy
+		bound.acceptGradients(&boundGrads[0], 1.0f);
+		bound.serializeWeights(&boundWeights[0]);
+		bound.deserializeWeights(&boundWeights[0]);
+	}
+	check(memcmp(&grads[0], &boundGrads[0], n * sizeof(float)) == 0,
+			"bound gradients match copied ones");
+	check(memcmp(&weights[0], &boundWeights[0], n * sizeof(float)) == 0,
+			"bound weights match copied ones");
+	// unbinding copies the weights back into the learner's own storage
+	bound.bindWeights(NULL);
+	bound.bindGradients(NULL);
+	std::vector<float> after(n);
+	bound.serializeWeights(&after[0]);
+	check(memcmp(&weights[0], &after[0], n * sizeof(float)) == 0,
+			"unbinding keeps the weights");
+	printf("zero copy: %d batches with bound weights and gradients match\n",
+			batches);
+	copying.cleanup();
+	bound.cleanup();
+}
+
+/** Records when backward() finishes each layer. */
+class ReadyTimes: public GradientObserver {
+public:
+	std::vector<double> at;
+
+	void layersReady(size_t ready) {
+		at.resize(ready, now());
+	}
+};
+
+static void benchNetwork(const std::string& cnn, size_t batch) {
+	std::ifstream f(cnn.c_str());
+	if (!f) {
+		printf("skipping throughput: cannot open %s\n", cnn.c_str());
+		return;
+	}
+	Network net(cnn);
+	net.initParams(6);
+	RudraRand rand(6, 0, 0);
+	std::vector<float> X(batch * net.inputSize), Y(batch);
+	fillUniform(rand, X);
+	for (size_t s = 0; s < batch; ++s) {
+		Y[s] = (float) rand.uniform(net.outputSize);
+	}
+	net.forward(&X[0], batch);
+	net.backward(&X[0], &Y[0], 1, batch);
+	const int reps = 10;
+	double forward = 0.0;
+	const double t0 = now();
+	for (int r = 0; r < reps; ++r) {
+		const double t1 = now();
+		net.forward(&X[0], batch);
+		forward += now() - t1;
+		net.backward(&X[0], &Y[0], 1, batch);
+	}
+	const double t = now() - t0;
+	printf("%s: %zu parameters, batch %zu: forward %.0f samples/s,"
+			" forward+backward %.0f samples/s\n", cnn.c_str(), net.numParams(),
+			batch, batch * reps / forward, batch * reps / t);
+
+	// how early each layer's gradients could start being reduced
+	ReadyTimes ready;
+	const double t1 = now();
+	net.forward(&X[0], batch);
+	const double t2 = now();
+	net.backward(&X[0], &Y[0], 1, batch, &ready);
+	const double t3 = now();
+	const std::vector<size_t>& offsets = net.getLayerOffsets();
+	const size_t layers = offsets.size() - 1;
+	check(ready.at.size() == layers, "backward reports every layer");
+	for (size_t r = 0; r < ready.at.size(); ++r) {
+		const size_t l = layers - 1 - r;
+		printf("  layer %zu: %zu parameters ready %.1f%% into backward"
+				" (%.2f ms after forward)\n", l, offsets[l + 1] - offsets[l],
+				100.0 * (ready.at[r] - t2) / (t3 - t2),
+				(ready.at[r] - t2) * 1e3);
+	}
+	printf("  forward %.2f ms, backward %.2f ms\n", (t2 - t1) * 1e3,
+			(t3 - t2) * 1e3);
+}
+
+int main(int argc, char** argv) {
+	const std::string dir = argc > 1 ? argv[1] : "/tmp";
+	const std::string cnn = argc > 2 ? argv[2] : "../examples/lenet_mnist.cnn";
+	const size_t batch = argc > 3 ? atol(argv[3]) : 64;
+	printf("SIMD level %s, sgemm kernel %s\n", simdLevelName(simdLevel()),
+			sgemmKernelName());
+	checkGemm();
+	checkGradients(dir);
+	checkTraining(dir);
+	checkZeroCopy(dir);
+	benchGemm();
+	benchNetwork(cnn, batch);
+	return checksResult();
+}
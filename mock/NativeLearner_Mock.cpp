@@ -28,8 +28,8 @@ void NativeLearner::setMoM(float mom) {
     std::cout << ">>> NativeLearner::setMoM(" << mom << ")" << std::endl;
 }
 
-void NativeLearner::setWorkingDirectory(std::string jobId) {
-    std::cout << ">>> NativeLearner::setWorkingDirectory(" << jobID << ")" << std::endl;
+void NativeLearner::setJobID(std::string jobID) {
+    std::cout << ">>> NativeLearner::setJobID(\"" << jobID << "\")" << std::endl;
 }
 
 void NativeLearner::initFromCFGFile(std::string confName) {
@@ -40,16 +40,18 @@ void NativeLearner::cleanup() {
 
 }
 
-void NativeLearner::checkpointIfNeeded(int whichEpoch) {
-    std::cout << ">>> NativeLearner::checkpointIfNeeded(" << whichEpoch << ")" << std::endl;
+void NativeLearner::checkpoint(std::string outputFileName) {
+    std::cout << ">>> NativeLearner::checkpoint(\"" << outputFileName << "\")" << std::endl;
 }
 
-void NativeLearner::initAsLearner(std::string weightsFile, std::string solverType) {
-    std::cout << ">>> NativeLearner::initAsLearner(\"" << weightsFile << "\", \"" << solverType << "\")" << std::endl;
+void NativeLearner::initAsLearner(std::string trainData, std::string trainLabels,
+                                  size_t batchSize, std::string weightsFile, std::string solverType) {
+    std::cout << ">>> NativeLearner::initAsLearner(\"" << trainData << "\", \"" << trainLabels << "\", " << batchSize << ", \"" << weightsFile << "\", \"" << solverType << "\")" << std::endl;
 }
 
-void NativeLearner::initAsTester(long placeID, std::string solverType) {
-    std::cout << ">>> NativeLearner::initAsTester(" << placeID << ", \"" << solverType << "\")" << std::endl;
+void NativeLearner::initAsTester(std::string testData, std::string testLabels,
+                                 size_t batchSize, std::string solverType) {
+    std::cout << ">>> NativeLearner::initAsTester(\"" << testData << "\", \"" << testLabels << "\", " << batchSize << ", \"" << solverType << "\")" << std::endl;
 }
 
 int NativeLearner::getNetworkSize() {
@@ -58,6 +60,46 @@ int NativeLearner::getNetworkSize() {
 
 float NativeLearner::trainMiniBatch() {
     std::cout << ">>> NativeLearner::trainMiniBatch()" << std::endl;
+    return 1.0;
+}
+
+bool NativeLearner::supportsLayerGradients() {
+    return true;
+}
+
+int NativeLearner::getNumGradientLayers() {
+    return 1;
+}
+
+void NativeLearner::getGradientLayerOffsets(long *offsets) {
+    offsets[0] = 0;
+    offsets[1] = getNetworkSize();
+}
+
+void NativeLearner::startMiniBatch() {
+    std::cout << ">>> NativeLearner::startMiniBatch()" << std::endl;
+}
+
+int NativeLearner::waitGradientLayers(int ready) {
+    std::cout << ">>> NativeLearner::waitGradientLayers(" << ready << ")" << std::endl;
+    return 1;
+}
+
+float NativeLearner::finishMiniBatch() {
+    std::cout << ">>> NativeLearner::finishMiniBatch()" << std::endl;
+    return 1.0;
+}
+
+void NativeLearner::getGradientRange(float *gradients, long lo, long hi) {
+    std::cout << ">>> NativeLearner::getGradientRange(" << gradients << ", " << lo << ", " << hi << ")" << std::endl;
+}
+
+void NativeLearner::accumulateGradientRange(float *gradients, long lo, long hi) {
+    std::cout << ">>> NativeLearner::accumulateGradientRange(" << gradients << ", " << lo << ", " << hi << ")" << std::endl;
+}
+
+double NativeLearner::getTrainSeconds() {
+    return 0.0;
 }
 
 void NativeLearner::getGradients(float *gradients) {
@@ -80,14 +122,25 @@ void NativeLearner::deserializeWeights(float *weights) {
     std::cout << ">>> NativeLearner::deserializeWeights(" << weights << ")" << std::endl;
 }
 
+bool NativeLearner::supportsZeroCopy() {
+    return true;
+}
+
+void NativeLearner::bindWeights(float *weights) {
+    std::cout << ">>> NativeLearner::bindWeights(" << weights << ")" << std::endl;
+}
+
+void NativeLearner::bindGradients(float *gradients) {
+    std::cout << ">>> NativeLearner::bindGradients(" << gradients << ")" << std::endl;
+}
 
-void NativeLearner::acceptGradients(float *grad, size_t numMB) {
-    std::cout << ">>> NativeLearner::acceptGradients(" << grad << ", " << numMB << ")" << std::endl;
+void NativeLearner::acceptGradients(float *grad, const float multiplier) {
+    std::cout << ">>> NativeLearner::acceptGradients(" << grad << ", " << multiplier << ")" << std::endl;
 }
 
-float NativeLearner::testOneEpochSC(float *weights, size_t numTesters, size_t myIndex) {
-    std::cout << ">>> NativeLearner::testOneEpochSC(" << weights << ", " << numTesters << ", " << myIndex << ")" << std::endl;
-return 100.0;
+float NativeLearner::testOneEpoch(float *weights) {
+    std::cout << ">>> NativeLearner::testOneEpoch(" << weights << ")" << std::endl;
+    return 1.0;
 }
 
 } // namespace rudra